@@ -0,0 +1,158 @@
+#include <tmtp/Tmtp.h>
+#include <tmtp/TmtpPacket.h>
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+/*
+ * Counts the heap allocations made while receiving a frame, for each way of passing frames to the channels.
+ *
+ * A replacement operator new counts the allocations and their Bytes while a frame is received. Frames of 1115 Bytes
+ * carry Space Packets of 4000 Bytes (each spanning several frames) or of 26 Bytes (many in each frame). The packets are
+ * taken out of the virtual channel outside the counted section.
+ *
+ * Results per frame (Release build, GCC 12). Before is the receive path passing frames by value through each layer;
+ * after is the path passing them by reference or by move:
+ *
+ *	Scenario                                    Before                 After
+ *	4000-Byte packets, vector API               8.03 allocs, 8567 B    2.78 allocs, 4131 B
+ *	4000-Byte packets, pointer API              7.03 allocs, 7452 B    2.78 allocs, 4131 B
+ *	4000-Byte packets, master channel, copy     4.03 allocs, 6339 B    1.78 allocs, 4127 B
+ *	4000-Byte packets, master channel, move     3.03 allocs, 5234 B    0.78 allocs, 3022 B
+ *	26-Byte packets, vector API                 11.13 allocs, 5709 B   5.13 allocs, 1269 B
+ *	26-Byte packets, pointer API                10.13 allocs, 4594 B   5.13 allocs, 1269 B
+ *	26-Byte packets, master channel, copy       7.13 allocs, 3481 B    4.13 allocs, 1265 B
+ *	26-Byte packets, master channel, move       6.13 allocs, 2376 B    3.13 allocs, 160 B
+ *
+ * The remaining allocations are the Data Field copied out of the raw frame, the reassembled packets and the warning
+ * strings. The master channel scenarios show the cost of passing a TmTransferFrame by const reference: the frame is
+ * copied once for that layer, which moving the frame avoids.
+ */
+
+static size_t allocationCount = 0;		// Allocations while counting.
+static size_t allocatedBytes = 0;		// Bytes allocated while counting.
+static bool counting = false;			// Indicates whether allocations are counted.
+
+void* operator new(size_t size)
+{
+	if (counting) {
+		allocationCount++;
+		allocatedBytes += size;
+	}
+	void *pointer = malloc(size ? size : 1);
+	if (!pointer) {
+		throw bad_alloc();
+	}
+	return pointer;
+}
+
+// The replacements of operator delete are kept out of line; GCC otherwise takes the inlined free() for a mismatch.
+__attribute__((noinline)) void operator delete(void *pointer) noexcept
+{
+	free(pointer);
+}
+
+__attribute__((noinline)) void operator delete(void *pointer, size_t) noexcept
+{
+	free(pointer);
+}
+
+/*!	\brief Ways of passing a received frame to the channels. */
+enum ReceiveMode {
+	physicalVector,		/**< TmPhysicalChannel::receiveFrame() with the raw frame as vector. */
+	physicalPointer,	/**< TmPhysicalChannel::receiveFrame() with the raw frame in place. */
+	masterCopy,			/**< TmMasterChannel::receiveFrame() with an unwrapped frame passed by const reference. */
+	masterMove			/**< TmMasterChannel::receiveFrame() with an unwrapped frame moved in. */
+};
+
+/*!	\brief Receives the frames through a new channel chain and prints the allocations per frame. */
+static void countAllocations(const char *name, const vector<vector<uint8_t> > &rawFrames, ReceiveMode mode)
+{
+	const size_t warmUpFrames = 20;			// Frames received before counting, so that the queues have grown.
+	SpacePacketConf conf;
+	TmPhysicalChannel physicalChannel(1115);
+	TmMasterChannel *masterChannel = physicalChannel.createTmMasterChannel(5);
+	TmVirtualChannel *virtualChannel = masterChannel->createTmVirtualChannel(0);
+	virtualChannel->setNetProtConf(&conf);
+
+	vector<TmTransferFrame> frames;			// The unwrapped frames for the master channel scenarios.
+	if ((mode == masterCopy) || (mode == masterMove)) {
+		for (size_t i = 0; i < rawFrames.size(); i++) {
+			frames.push_back(TmTransferFrame(1115));
+			frames.back().unwrap(rawFrames[i]);
+		}
+	}
+
+	size_t packetCount = 0;
+	for (size_t i = 0; i < rawFrames.size(); i++) {
+		if (i == warmUpFrames) {
+			allocationCount = 0;
+			allocatedBytes = 0;
+		}
+		counting = (i >= warmUpFrames);
+		switch (mode) {
+			case physicalVector:
+				physicalChannel.receiveFrame(rawFrames[i], TmFrameTimestamp(), TmFrameBitrate());
+				break;
+			case physicalPointer:
+				physicalChannel.receiveFrame(&rawFrames[i][0], rawFrames[i].size(), TmFrameTimestamp(), TmFrameBitrate());
+				break;
+			case masterCopy:
+				masterChannel->receiveFrame(static_cast<const TmTransferFrame&>(frames[i]));
+				break;
+			case masterMove:
+				masterChannel->receiveFrame(std::move(frames[i]));
+				break;
+		}
+		counting = false;
+		while (virtualChannel->packetAvailable()) {
+			virtualChannel->receivePacket();
+			packetCount++;
+		}
+	}
+
+	size_t frameCount = rawFrames.size() - warmUpFrames;
+	cout << name << ": " << (double) allocationCount / frameCount << " allocs, "
+		<< (double) allocatedBytes / frameCount << " B per frame (" << packetCount << " packets)" << endl;
+}
+
+/*!	\brief Sends packets of the given length and returns the raw frames. */
+static vector<vector<uint8_t> > sendFrames(size_t packetLength, size_t packetCount)
+{
+	SpacePacketConf conf;
+	TmPhysicalChannel physicalChannel(1115);
+	TmMasterChannel *masterChannel = physicalChannel.createTmMasterChannel(5);
+	TmVirtualChannel *virtualChannel = masterChannel->createTmVirtualChannel(0);
+	virtualChannel->setNetProtConf(&conf);
+
+	vector<vector<uint8_t> > rawFrames;
+	vector<uint8_t> message(packetLength, 0x55);
+	for (size_t i = 0; i < packetCount; i++) {
+		virtualChannel->sendPacket(conf.genTestPacket(message));
+		while (virtualChannel->frameAvailable()) {
+			rawFrames.push_back(physicalChannel.sendFrame(TmFrameTimestamp()));
+		}
+	}
+	return rawFrames;
+}
+
+int main()
+{
+	vector<vector<uint8_t> > largePackets = sendFrames(4000, 300);
+	countAllocations("4000-Byte packets, vector API", largePackets, physicalVector);
+	countAllocations("4000-Byte packets, pointer API", largePackets, physicalPointer);
+	countAllocations("4000-Byte packets, master channel, copy", largePackets, masterCopy);
+	countAllocations("4000-Byte packets, master channel, move", largePackets, masterMove);
+
+	vector<vector<uint8_t> > smallPackets = sendFrames(26, 20000);
+	countAllocations("26-Byte packets, vector API", smallPackets, physicalVector);
+	countAllocations("26-Byte packets, pointer API", smallPackets, physicalPointer);
+	countAllocations("26-Byte packets, master channel, copy", smallPackets, masterCopy);
+	countAllocations("26-Byte packets, master channel, move", smallPackets, masterMove);
+
+	return 0;
+}
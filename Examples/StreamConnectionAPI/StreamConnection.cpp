@@ -1,5 +1,6 @@
 #include "StreamConnection.h"
 #include "StreamPacket.h"
+#include "StreamRingBuffer.h"
 #include <stdlib.h>
 #include <string.h>
 #include <iostream>
@@ -19,7 +20,11 @@ typedef int socklen_t;
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netdb.h>
+#include <sys/uio.h>
 #define INVALID_SOCKET -1
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // SO_NOSIGPIPE is set on the socket instead
+#endif
 #endif //_WIN32
 
 using namespace std;
@@ -79,6 +84,10 @@ void StreamConnection::acceptConnection()
 	if (connectionFd == INVALID_SOCKET) {
 		mySocketError("ERROR on accepting client connection");
 	}
+#ifdef SO_NOSIGPIPE
+	int noSigpipe = 1;
+	setsockopt(connectionFd, SOL_SOCKET, SO_NOSIGPIPE, &noSigpipe, sizeof(noSigpipe));
+#endif
 	cout << "client connected from ip " << hex << ntohl(clientAddr.sin_addr.s_addr) << endl;
 	status = Connected;
 }
@@ -103,6 +112,10 @@ void StreamConnection::connectToHost(string host, unsigned short port)
 	if (connectionFd == INVALID_SOCKET) {
 		mySocketError("ERROR opening client socket");
 	}
+#ifdef SO_NOSIGPIPE
+	int noSigpipe = 1;
+	setsockopt(connectionFd, SOL_SOCKET, SO_NOSIGPIPE, &noSigpipe, sizeof(noSigpipe));
+#endif
 
 	// resolve server address
 	server = gethostbyname(host.c_str());
@@ -148,30 +161,41 @@ vector<unsigned char> StreamConnection::readPacket()
 			switch (state) {
 				case Start:
 					if (readBuffer.size() < 1) {
-						vector<unsigned char> chunk = readChunk();
-						readBuffer.insert(readBuffer.end(), chunk.begin(), chunk.end());
+						readChunk();
 					} else {
-						headerLength = packet.getHeaderLength(readBuffer[0]);
+						headerLength = packet.getHeaderLength(readBuffer.front());
+						readBuffer.reserve(headerLength);
 						state = ReadingHeader;
 					}
 					break;
 				case ReadingHeader:
 					if (readBuffer.size() < headerLength) {
-						vector<unsigned char> chunk = readChunk();
-						readBuffer.insert(readBuffer.end(), chunk.begin(), chunk.end());
+						readChunk();
 					} else {
-						vector<unsigned char> header (readBuffer.begin(), readBuffer.begin() + headerLength);
-						packetLength = packet.getLength(header);
+						const unsigned char *view = readBuffer.peek(headerLength);
+						vector<unsigned char> header (view, view + headerLength);
+						try {
+							packetLength = packet.getLength(header);
+						} catch (StreamPacketError &e) {
+							ostringstream msg;
+							msg << "Error in StreamPacket: " << e.what() << endl;
+							throw StreamConnectionError(msg.str());
+						}
+						if (packetLength > MAX_PACKET_SIZE) {
+							throw StreamConnectionError("Error in StreamPacket: Packet too long");
+						}
+						readBuffer.reserve(packetLength);
 						state = ReadingContent;
 					}
 					break;
 				case ReadingContent:
 					if (readBuffer.size() < packetLength) {
-						vector<unsigned char> chunk = readChunk();
-						readBuffer.insert(readBuffer.end(), chunk.begin(), chunk.end());
+						readChunk();
 					} else {
-						vector<unsigned char> raw (readBuffer.begin(), readBuffer.begin() + packetLength);
-						readBuffer.erase(readBuffer.begin(), readBuffer.begin() + packetLength);
+						// the packet is framed in place, no Bytes are shifted when it is consumed
+						const unsigned char *view = readBuffer.peek(packetLength);
+						vector<unsigned char> raw (view, view + packetLength);
+						readBuffer.consume(packetLength);
 						try {
 							packet.unwrap(raw);
 							data = packet.getContent();
@@ -196,14 +220,13 @@ vector<unsigned char> StreamConnection::readPacket()
 	return data;
 }
 
-void StreamConnection::writePacket(vector<unsigned char> data)
+void StreamConnection::writePacket(const vector<unsigned char> &data)
 {
 	StreamPacket packet;
-	vector<unsigned char> raw;
+	vector<unsigned char> header;
 
 	try {
-		packet.setContent(data);
-		raw = packet.wrap();
+		header = packet.wrapHeader(data.size());
 	} catch (StreamPacketError &e) {
 		ostringstream msg;
 		msg << "Error in StreamPacket: " << e.what() << endl;
@@ -211,50 +234,91 @@ void StreamConnection::writePacket(vector<unsigned char> data)
 	}
 
 	if (status == Connected) {
-		while (raw.size() > 0) {
-			vector<unsigned char> chunk;
-			if (raw.size() > SEND_CHUNK_SIZE) {
-				chunk.assign(raw.begin(), raw.begin() + SEND_CHUNK_SIZE);
-				raw.erase(raw.begin(), raw.begin() + SEND_CHUNK_SIZE);
-			} else {
-				chunk = raw;
-				raw.clear();
+		// header and payload are sent from where they are, until the socket took all of it
+		unsigned long total = header.size() + data.size();
+		unsigned long sent = 0;
+		while (sent < total) {
+#ifdef _WIN32
+			// Windows specific
+			const vector<unsigned char> &part = (sent < header.size()) ? header : data;
+			unsigned long offset = (sent < header.size()) ? sent : sent - header.size();
+			int n = send(connectionFd, reinterpret_cast<const char*>(&part[offset]), part.size() - offset, 0);
+#else
+			// POSIX specific
+			struct iovec iov[2];
+			int count = 0;
+			if (sent < header.size()) {
+				iov[count].iov_base = &header[sent];
+				iov[count].iov_len = header.size() - sent;
+				count++;
 			}
-			char buffer[SEND_CHUNK_SIZE];
-			for (unsigned short i = 0; i < chunk.size(); i++) {
-				buffer[i] = chunk[i];
+			unsigned long dataSent = (sent < header.size()) ? 0 : sent - header.size();
+			if (dataSent < data.size()) {
+				iov[count].iov_base = const_cast<unsigned char*>(&data[dataSent]);
+				iov[count].iov_len = data.size() - dataSent;
+				count++;
 			}
-			int n = send(connectionFd, buffer, chunk.size(), 0);
+			// a peer which has gone away must not raise SIGPIPE, the error is reported instead
+			struct msghdr msg;
+			memset(&msg, 0, sizeof(msg));
+			msg.msg_iov = iov;
+			msg.msg_iovlen = count;
+			ssize_t n = sendmsg(connectionFd, &msg, MSG_NOSIGNAL);
+#endif // _WIN32
 			if (n < 0) {
+#ifndef _WIN32
+				if (errno == EINTR) {
+					continue;
+				}
+#endif // _WIN32
 				mySocketError("ERROR writing to socket");
 			}
+			sent += n;
 		}
 	} else {
 		throw StreamConnectionError("Connection closed");
 	}
 }
 
-vector<unsigned char> StreamConnection::readChunk()
+unsigned long StreamConnection::readChunk()
 {
-	vector<unsigned char> chunk;
+	unsigned long received = 0;
 
 	if (status == Connected) {
-		char buffer[READ_BUFFER_SIZE];
-		int n = recv(connectionFd, buffer, READ_BUFFER_SIZE, 0);
+		// receive directly into the free space of the ring buffer
+		unsigned char *regions[2];
+		unsigned long lengths[2];
+		unsigned int count = readBuffer.getWriteRegions(regions, lengths);
+		if (count == 0) {
+			throw StreamConnectionError("Read buffer full");
+		}
+#ifdef _WIN32
+		// Windows specific
+		int n = recv(connectionFd, reinterpret_cast<char*>(regions[0]), lengths[0], 0);
+#else
+		// POSIX specific
+		struct iovec iov[2];
+		for (unsigned int i = 0; i < count; i++) {
+			iov[i].iov_base = regions[i];
+			iov[i].iov_len = lengths[i];
+		}
+		ssize_t n = readv(connectionFd, iov, count);
+#endif // _WIN32
 		if (n < 0) {
 			mySocketError("ERROR reading from socket");
 		} else if (n == 0) {
 			closeConnection();
 			//throw StreamConnectionError("Connection reset by peer");
 		} else {
-			chunk.assign(buffer, buffer + n/sizeof(unsigned char));
-			//cout << "Received bytes: " << dec << chunk.size() << endl;
+			readBuffer.commitWrite(n);
+			received = n;
+			//cout << "Received bytes: " << dec << received << endl;
 		}
 	} else {
 		throw StreamConnectionError("Connection closed");
 	}
 
-	return chunk;
+	return received;
 }
 
 void StreamConnection::mySocketError(string msg)
@@ -289,6 +353,5 @@ void StreamConnection::myCloseSocket(int socket)
  * - handle resets by peer correctly
  * - thread save alternative for strerror
  * - resync if a problem occured while reading a packet
- * - multiple connections handled with select
- * - check if send buffer is full
+ * - multiple connections: see StreamServer
  */
@@ -4,10 +4,10 @@
 #include <stdexcept>
 #include <vector>
 #include <string>
+#include "StreamRingBuffer.h"
 
 //definitions
-#define READ_BUFFER_SIZE 512
-#define SEND_CHUNK_SIZE 512
+#define MAX_PACKET_SIZE 67108864
 
 using namespace std;
 
@@ -40,10 +40,10 @@ class StreamConnection {
 		virtual ConnectionStatus getStatus();
 
 		virtual vector<unsigned char> readPacket();
-		virtual void writePacket(vector<unsigned char> data);
+		virtual void writePacket(const vector<unsigned char> &data);
 
 	protected:
-		virtual vector<unsigned char> readChunk();
+		virtual unsigned long readChunk();
 		virtual void mySocketError(string msg); // may throw StreamConnectionError
 		virtual void myCloseSocket(int socket);
 
@@ -52,7 +52,7 @@ class StreamConnection {
 		ConnectionStatus status;
 		int serverFd;
 		int connectionFd;
-		vector<unsigned char> readBuffer;
+		StreamRingBuffer readBuffer;
 };
 
 #endif // StreamConnection_h
@@ -36,17 +36,28 @@ unsigned long StreamPacket::getLength(vector<unsigned char> header)
 	return length;
 }
 
-vector<unsigned char> StreamPacket::wrap()
+vector<unsigned char> StreamPacket::wrapHeader(unsigned long contentLength)
 {
-	vector<unsigned char> raw;
+	vector<unsigned char> header;
+
+	if (contentLength > 0xffffffffUL - headerLength) {
+		throw StreamPacketError("Content too long");
+	}
+	unsigned long length = contentLength + headerLength;
+
+	header.push_back(version & 0x00ff);
+	header.push_back((length >> 24) & 0x000000ff);
+	header.push_back((length >> 16) & 0x000000ff);
+	header.push_back((length >> 8) & 0x000000ff);
+	header.push_back(length & 0x000000ff);
 
-	unsigned long length = content.size() + headerLength;
+	return header;
+}
+
+vector<unsigned char> StreamPacket::wrap()
+{
+	vector<unsigned char> raw = wrapHeader(content.size());
 
-	raw.push_back(version & 0x00ff);
-	raw.push_back((length >> 24) & 0x000000ff);
-	raw.push_back((length >> 16) & 0x000000ff);
-	raw.push_back((length >> 8) & 0x000000ff);
-	raw.push_back(length & 0x000000ff);
 	if (content.size() != 0) {
 		raw.insert(raw.end(), content.begin(), content.end());
 	}
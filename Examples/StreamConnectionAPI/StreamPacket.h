@@ -28,6 +28,7 @@ class StreamPacket
 		virtual unsigned long getHeaderLength(unsigned char firstByteOfHeader);
 		virtual unsigned long getLength(vector<unsigned char> header);
 
+		virtual vector<unsigned char> wrapHeader(unsigned long contentLength);
 		virtual vector<unsigned char> wrap();
 		virtual void unwrap(vector<unsigned char> raw);
 
@@ -1,7 +1,23 @@
 #include "StreamPacketCortex.h"
+#include <algorithm>
 #include <limits.h>
 
 
+StreamPacketCortex::StreamPacketCortex()
+	: flowId(0)
+{
+}
+
+void StreamPacketCortex::setFlowId(unsigned long id)
+{
+	flowId = id & 0xffffffffUL;
+}
+
+unsigned long StreamPacketCortex::getFlowId()
+{
+	return flowId;
+}
+
 unsigned long StreamPacketCortex::getHeaderLength(unsigned char)
 {
 	return headerLength;
@@ -9,63 +25,82 @@ unsigned long StreamPacketCortex::getHeaderLength(unsigned char)
 
 unsigned long StreamPacketCortex::getLength(vector<unsigned char> header)
 {
-	long length = 0;
-
-	if (readLong(header.begin()) != messageStart) {
+	if (header.size() < headerLength) {
+		throw StreamPacketCortexError("Header too short");
+	} else if (readLong(header.begin()) != messageStart) {
 		throw StreamPacketCortexError("Header start didn't match start delimiter");
-	} else {
-		length = readLong(header.begin() + 1*4);
+	}
+	long length = readLong(header.begin() + 1*4);
+	if (length < headerLength + postambleLength) {
+		throw StreamPacketCortexError("Header has invalid size");
 	}
 	return (unsigned long) length;
 }
 
 vector<unsigned char> StreamPacketCortex::wrap()
 {
-	throw StreamPacketCortexError("Wrap function not supportet in Cortex Packet");
-	return vector<unsigned char>();
+	if (content.size() > 0x7fffffffUL - headerLength - postambleLength) {
+		throw StreamPacketCortexError("Content too long");
+	}
+	unsigned long length = content.size() + headerLength + postambleLength;
+	vector<unsigned char> raw (length);
+
+	writeULong(raw.begin(), (unsigned long) messageStart);
+	writeULong(raw.begin() + 1*4, length);
+	writeULong(raw.begin() + 2*4, flowId);
+	copy(content.begin(), content.end(), raw.begin() + headerLength);
+	writeULong(raw.end() - postambleLength, (unsigned long) messageEnd);
+
+	return raw;
 }
 
 void StreamPacketCortex::unwrap(vector<unsigned char> raw)
 {
-	if (raw.size() < headerLength) {
+	if (raw.size() < headerLength + postambleLength) {
 		throw StreamPacketCortexError("Raw packet too short");
 	} else if (readLong(raw.begin()) != messageStart) {
 		throw StreamPacketCortexError("Packet start didn't match start delimiter");
 	} else if (readLong(raw.end() - postambleLength) != messageEnd){
 		throw StreamPacketCortexError("Packet end didn't match end delimiter");
 	} else {
-		if (raw.size() != (unsigned long) readLong(raw.begin() + 1*4)) {
+		if (raw.size() != readULong(raw.begin() + 1*4)) {
 			throw StreamPacketCortexError("Raw packet has wrong size");
 		} else {
+			flowId = readULong(raw.begin() + 2*4);
 			content.assign(raw.begin() + headerLength, raw.end() - postambleLength);
 		}
 	}
 }
 
+// reverses the bit order of a 32 bit word
 unsigned long StreamPacketCortex::reverseBitOrder(unsigned long n)
 {
-	n = ((n > 1) & 0x55555555) | ((n << 1) & 0xaaaaaaaa) ;
-	n = ((n > 2) & 0x33333333) | ((n << 2) & 0xcccccccc) ;
-	n = ((n > 4) & 0x0f0f0f0f) | ((n << 4) & 0xf0f0f0f0) ;
-	n = ((n > 8) & 0x00ff00ff) | ((n << 8) & 0xff00ff00) ;
-	n = ((n >16) & 0x0000ffff) | ((n << 16) & 0xffff0000) ;
+	n = ((n >> 1) & 0x55555555) | ((n << 1) & 0xaaaaaaaa);
+	n = ((n >> 2) & 0x33333333) | ((n << 2) & 0xcccccccc);
+	n = ((n >> 4) & 0x0f0f0f0f) | ((n << 4) & 0xf0f0f0f0);
+	n = ((n >> 8) & 0x00ff00ff) | ((n << 8) & 0xff00ff00);
+	n = ((n >> 16) & 0x0000ffff) | ((n << 16) & 0xffff0000);
 	return n;
 }
 
-unsigned long StreamPacketCortex::readULong(vector<unsigned char>::iterator it)
+// Cortex words are big endian, the Bytes are in network order
+unsigned long StreamPacketCortex::readULong(vector<unsigned char>::const_iterator it)
 {
-	unsigned long n = 0;
-	n |= *(it)   << 24;
-	n |= *(it+1) << 16;
-	n |= *(it+2) << 8;
-	n |= *(it+3);
-	n = reverseBitOrder(n);
-	return n;
+	return ((unsigned long) it[0] << 24) | ((unsigned long) it[1] << 16) | ((unsigned long) it[2] << 8)
+		| (unsigned long) it[3];
 }
 
-long StreamPacketCortex::readLong(vector<unsigned char>::iterator it)
+// sign extension of a 32 bit word without type punning
+long StreamPacketCortex::readLong(vector<unsigned char>::const_iterator it)
 {
 	unsigned long n = readULong(it);
-	long ret = *(reinterpret_cast<long*>(&n));
-	return ret;
+	return (long) (n & 0x7fffffffUL) + (long) (n >> 31) * (-0x7fffffffL - 1);
+}
+
+void StreamPacketCortex::writeULong(vector<unsigned char>::iterator it, unsigned long n)
+{
+	it[0] = (n >> 24) & 0xff;
+	it[1] = (n >> 16) & 0xff;
+	it[2] = (n >> 8) & 0xff;
+	it[3] = n & 0xff;
 }
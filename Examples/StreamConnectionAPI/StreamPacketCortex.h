@@ -14,6 +14,7 @@ class StreamPacketCortexError : public StreamPacketError {
 	   	{}
 };
 
+// Cortex message: start flag, total size and flow ID (32 bit big endian each), content, end flag
 class StreamPacketCortex : public StreamPacket {
 	// definitions
 	protected:
@@ -24,6 +25,11 @@ class StreamPacketCortex : public StreamPacket {
 
 	// methods
 	public:
+		StreamPacketCortex();
+
+		virtual void setFlowId(unsigned long id);
+		virtual unsigned long getFlowId();
+
 		virtual unsigned long getHeaderLength(unsigned char firstByteOfHeader);
 		virtual unsigned long getLength(vector<unsigned char> header);
 
@@ -32,9 +38,13 @@ class StreamPacketCortex : public StreamPacket {
 
 	protected:
 		virtual unsigned long reverseBitOrder(unsigned long n);
-		virtual unsigned long readULong(vector<unsigned char>::iterator it);
-		virtual long readLong(vector<unsigned char>::iterator it);
+		virtual unsigned long readULong(vector<unsigned char>::const_iterator it);
+		virtual long readLong(vector<unsigned char>::const_iterator it);
+		virtual void writeULong(vector<unsigned char>::iterator it, unsigned long n);
 
+	// variables
+	protected:
+		unsigned long flowId;
 };
 
 #endif // StreamPacketCortex_h
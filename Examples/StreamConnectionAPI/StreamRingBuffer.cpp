@@ -0,0 +1,120 @@
+#include "StreamRingBuffer.h"
+#include <string.h>
+#include <vector>
+
+using namespace std;
+
+StreamRingBuffer::StreamRingBuffer(unsigned long capacity)
+{
+	this->capacity = 1;
+	while (this->capacity < capacity) {
+		this->capacity <<= 1;
+	}
+	storage.resize(2 * this->capacity);
+	readPos = 0;
+	writePos = 0;
+}
+
+unsigned long StreamRingBuffer::getCapacity()
+{
+	return capacity;
+}
+
+unsigned long StreamRingBuffer::size()
+{
+	return writePos - readPos;
+}
+
+unsigned long StreamRingBuffer::space()
+{
+	return capacity - size();
+}
+
+void StreamRingBuffer::clear()
+{
+	readPos = 0;
+	writePos = 0;
+}
+
+unsigned int StreamRingBuffer::getWriteRegions(unsigned char *regions[2], unsigned long lengths[2])
+{
+	unsigned long free = space();
+	unsigned long start = writePos & (capacity - 1);
+	unsigned long first = capacity - start;
+
+	if (free == 0) {
+		return 0;
+	}
+	regions[0] = &storage[start];
+	if (free <= first) {
+		lengths[0] = free;
+		return 1;
+	}
+	lengths[0] = first;
+	regions[1] = &storage[0];
+	lengths[1] = free - first;
+	return 2;
+}
+
+void StreamRingBuffer::commitWrite(unsigned long length)
+{
+	if (length > space()) {
+		throw StreamRingBufferError("Write beyond the free space");
+	}
+	writePos += length;
+}
+
+unsigned char StreamRingBuffer::front()
+{
+	if (size() < 1) {
+		throw StreamRingBufferError("Buffer empty");
+	}
+	return storage[readPos & (capacity - 1)];
+}
+
+const unsigned char *StreamRingBuffer::peek(unsigned long length)
+{
+	if (length > size()) {
+		throw StreamRingBufferError("View beyond the stored Bytes");
+	}
+	unsigned long start = readPos & (capacity - 1);
+	if (start + length > capacity) {
+		// only the wrapped part is copied, behind the end of the ring
+		memcpy(&storage[capacity], &storage[0], start + length - capacity);
+	}
+	return &storage[start];
+}
+
+void StreamRingBuffer::consume(unsigned long length)
+{
+	if (length > size()) {
+		throw StreamRingBufferError("Consumed more than the stored Bytes");
+	}
+	readPos += length;
+	if (readPos == writePos) {
+		// start over at the beginning, so the next views do not wrap
+		readPos = 0;
+		writePos = 0;
+	}
+}
+
+void StreamRingBuffer::reserve(unsigned long length)
+{
+	if (length <= capacity) {
+		return;
+	}
+	unsigned long newCapacity = capacity;
+	while (newCapacity < length) {
+		newCapacity <<= 1;
+	}
+	// rare: a packet longer than the ring, the stored Bytes are moved to the start of a larger ring
+	unsigned long stored = size();
+	vector<unsigned char> newStorage(2 * newCapacity);
+	if (stored > 0) {
+		memcpy(&newStorage[0], peek(stored), stored);
+	}
+	storage.swap(newStorage);
+	capacity = newCapacity;
+	readPos = 0;
+	writePos = stored;
+}
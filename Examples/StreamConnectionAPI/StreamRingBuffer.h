@@ -0,0 +1,51 @@
+#ifndef StreamRingBuffer_h
+#define StreamRingBuffer_h
+
+#include <stdexcept>
+#include <vector>
+#include <string>
+
+//definitions
+#define RING_BUFFER_SIZE 65536
+
+using namespace std;
+
+class StreamRingBufferError : public runtime_error {
+	public:
+		StreamRingBufferError(const string& what_arg)
+		   	: runtime_error(what_arg)
+	   	{}
+};
+
+// Byte queue of fixed capacity (a power of two) between the socket and the packet parser.
+// The socket writes into the free space (up to two regions, see getWriteRegions(), for readv),
+// the parser reads the oldest Bytes in place (see peek()) and drops them (see consume()).
+// Nothing is shifted when Bytes are consumed. Only a view which wraps around the end copies
+// its wrapped part behind the end of the storage, so every view is contiguous.
+class StreamRingBuffer {
+	// methods
+	public:
+		StreamRingBuffer(unsigned long capacity = RING_BUFFER_SIZE);
+
+		virtual unsigned long getCapacity();
+		virtual unsigned long size();
+		virtual unsigned long space();
+		virtual void clear();
+
+		virtual unsigned int getWriteRegions(unsigned char *regions[2], unsigned long lengths[2]);
+		virtual void commitWrite(unsigned long length); // may throw StreamRingBufferError
+
+		virtual unsigned char front(); // may throw StreamRingBufferError
+		virtual const unsigned char *peek(unsigned long length); // may throw StreamRingBufferError
+		virtual void consume(unsigned long length); // may throw StreamRingBufferError
+		virtual void reserve(unsigned long length);
+
+	// variables
+	protected:
+		vector<unsigned char> storage; // capacity Bytes of ring, then capacity Bytes for wrapped views
+		unsigned long capacity;
+		unsigned long readPos; // total Bytes consumed
+		unsigned long writePos; // total Bytes written
+};
+
+#endif // StreamRingBuffer_h
@@ -0,0 +1,407 @@
+#include "StreamServer.h"
+#include "StreamConnection.h"
+#include "StreamPacket.h"
+#include "StreamRingBuffer.h"
+#include <string.h>
+#include <vector>
+#include <sstream>
+
+#ifndef __linux__
+#error "StreamServer needs epoll (Linux)"
+#endif // __linux__
+
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+
+using namespace std;
+
+StreamServer::StreamServer(unsigned long highWaterMark)
+{
+	serverFd = -1;
+	this->highWaterMark = highWaterMark;
+	epollFd = epoll_create1(0);
+	if (epollFd < 0) {
+		mySocketError("ERROR creating epoll instance");
+	}
+}
+
+StreamServer::~StreamServer()
+{
+	while (!clients.empty()) {
+		closeClient(clients.begin()->first);
+	}
+	closeServer();
+	close(epollFd);
+}
+
+void StreamServer::openServer(unsigned short port)
+{
+	struct sockaddr_in serverAddr;
+
+	// create non-blocking socket
+	serverFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if (serverFd < 0) {
+		mySocketError("ERROR opening server socket");
+	}
+	int reuse = 1;
+	setsockopt(serverFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	// fill server address structure
+	memset(&serverAddr, 0, sizeof(serverAddr));
+	serverAddr.sin_family = AF_INET;
+	serverAddr.sin_addr.s_addr = INADDR_ANY;
+	serverAddr.sin_port = htons(port);
+
+	// bind socket and listen
+	if (bind(serverFd, reinterpret_cast<struct sockaddr*>(&serverAddr), sizeof(serverAddr)) < 0) {
+		mySocketError("ERROR on binding server socket");
+	}
+	if (listen(serverFd, SOMAXCONN) < 0) {
+		mySocketError("ERROR on listening");
+	}
+
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.fd = serverFd;
+	if (epoll_ctl(epollFd, EPOLL_CTL_ADD, serverFd, &event) < 0) {
+		mySocketError("ERROR adding server socket to epoll");
+	}
+}
+
+void StreamServer::closeServer()
+{
+	if (serverFd >= 0) {
+		close(serverFd); // also removes it from the epoll set
+		serverFd = -1;
+	}
+}
+
+int StreamServer::poll(int timeoutMs)
+{
+	struct epoll_event events[MAX_EVENTS];
+
+	int n = epoll_wait(epollFd, events, MAX_EVENTS, timeoutMs);
+	if (n < 0) {
+		if (errno == EINTR) {
+			return 0;
+		}
+		mySocketError("ERROR waiting for events");
+	}
+	for (int i = 0; i < n; i++) {
+		int fd = events[i].data.fd;
+		if (fd == serverFd) {
+			acceptClients();
+			continue;
+		}
+		map<int, shared_ptr<Client> >::iterator it = clients.find(fd);
+		if (it == clients.end()) {
+			continue; // closed by an earlier event of this round
+		}
+		shared_ptr<Client> client = it->second;
+		if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+			readClient(*client);
+		}
+		if ((events[i].events & EPOLLOUT) && (clients.count(fd) > 0)) {
+			flushClient(*client);
+		}
+	}
+	return n;
+}
+
+bool StreamServer::packetAvailable()
+{
+	return !received.empty();
+}
+
+vector<unsigned char> StreamServer::readPacket(int &client)
+{
+	vector<unsigned char> data;
+
+	client = -1;
+	if (!received.empty()) {
+		client = received.front().first;
+		data.swap(received.front().second);
+		received.pop_front();
+	}
+	return data;
+}
+
+bool StreamServer::writePacket(int client, const vector<unsigned char> &data)
+{
+	map<int, shared_ptr<Client> >::iterator it = clients.find(client);
+	if (it == clients.end()) {
+		throw StreamServerError("No such client");
+	}
+	shared_ptr<Client> keep = it->second; // a failing send closes the client
+	shared_ptr<const vector<unsigned char> > payload(new vector<unsigned char>(data));
+	return queuePacket(*keep, payload);
+}
+
+unsigned long StreamServer::broadcastPacket(const vector<unsigned char> &data)
+{
+	// one copy of the payload, shared by the output queues of all clients
+	shared_ptr<const vector<unsigned char> > payload(new vector<unsigned char>(data));
+	vector<int> fds = getClients();
+	unsigned long queued = 0;
+
+	for (unsigned long i = 0; i < fds.size(); i++) {
+		map<int, shared_ptr<Client> >::iterator it = clients.find(fds[i]);
+		if (it == clients.end()) {
+			continue;
+		}
+		shared_ptr<Client> keep = it->second; // a failing send closes the client
+		if (queuePacket(*keep, payload)) {
+			queued++;
+		}
+	}
+	return queued;
+}
+
+vector<int> StreamServer::getClients()
+{
+	vector<int> fds;
+
+	for (map<int, shared_ptr<Client> >::iterator it = clients.begin(); it != clients.end(); ++it) {
+		fds.push_back(it->first);
+	}
+	return fds;
+}
+
+unsigned long StreamServer::getQueuedBytes(int client)
+{
+	map<int, shared_ptr<Client> >::iterator it = clients.find(client);
+	return (it == clients.end()) ? 0 : it->second->queuedBytes;
+}
+
+unsigned long StreamServer::getDroppedPackets(int client)
+{
+	map<int, shared_ptr<Client> >::iterator it = clients.find(client);
+	return (it == clients.end()) ? 0 : it->second->droppedPackets;
+}
+
+void StreamServer::closeClient(int client)
+{
+	map<int, shared_ptr<Client> >::iterator it = clients.find(client);
+	if (it != clients.end()) {
+		close(client); // also removes it from the epoll set
+		clients.erase(it);
+	}
+}
+
+void StreamServer::acceptClients()
+{
+	while (true) {
+		int fd = accept4(serverFd, NULL, NULL, SOCK_NONBLOCK);
+		if (fd < 0) {
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == ECONNABORTED) || (errno == EINTR)) {
+				return; // all pending connections accepted
+			}
+			mySocketError("ERROR on accepting client connection");
+		}
+
+		shared_ptr<Client> client(new Client());
+		client->fd = fd;
+		client->queuedBytes = 0;
+		client->droppedPackets = 0;
+		client->writeWatched = false;
+
+		struct epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.fd = fd;
+		if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+			close(fd);
+			mySocketError("ERROR adding client socket to epoll");
+		}
+		clients[fd] = client;
+	}
+}
+
+void StreamServer::readClient(Client &client)
+{
+	int fd = client.fd;
+
+	// read until the socket is drained (level triggered, so a full buffer is read again later)
+	while (true) {
+		unsigned char *regions[2];
+		unsigned long lengths[2];
+		unsigned int count = client.readBuffer.getWriteRegions(regions, lengths);
+		if (count == 0) {
+			if (!parsePackets(client)) {
+				return;
+			}
+			count = client.readBuffer.getWriteRegions(regions, lengths);
+			if (count == 0) {
+				return;
+			}
+		}
+		struct iovec iov[2];
+		for (unsigned int i = 0; i < count; i++) {
+			iov[i].iov_base = regions[i];
+			iov[i].iov_len = lengths[i];
+		}
+		ssize_t n = readv(fd, iov, count);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+				break;
+			}
+			closeClient(fd); // reset by peer
+			return;
+		}
+		if (n == 0) {
+			if (parsePackets(client)) {
+				closeClient(fd);
+			}
+			return;
+		}
+		client.readBuffer.commitWrite(n);
+	}
+	parsePackets(client);
+}
+
+bool StreamServer::parsePackets(Client &client)
+{
+	StreamPacket packet;
+
+	while (client.readBuffer.size() >= 1) {
+		unsigned long headerLength = packet.getHeaderLength(client.readBuffer.front());
+		if (client.readBuffer.size() < headerLength) {
+			client.readBuffer.reserve(headerLength);
+			return true;
+		}
+		const unsigned char *view = client.readBuffer.peek(headerLength);
+		unsigned long packetLength;
+		try {
+			packetLength = packet.getLength(vector<unsigned char> (view, view + headerLength));
+		} catch (StreamPacketError &e) {
+			closeClient(client.fd); // the stream cannot be resynchronized
+			return false;
+		}
+		if ((packetLength < headerLength) || (packetLength > MAX_PACKET_SIZE)) {
+			closeClient(client.fd);
+			return false;
+		}
+		if (client.readBuffer.size() < packetLength) {
+			client.readBuffer.reserve(packetLength);
+			return true;
+		}
+		view = client.readBuffer.peek(packetLength);
+		received.push_back(make_pair(client.fd, vector<unsigned char> (view + headerLength, view + packetLength)));
+		client.readBuffer.consume(packetLength);
+	}
+	return true;
+}
+
+bool StreamServer::queuePacket(Client &client, shared_ptr<const vector<unsigned char> > payload)
+{
+	StreamPacket packet;
+	OutputPacket out;
+
+	out.header = packet.wrapHeader(payload->size());
+	unsigned long length = out.header.size() + payload->size();
+	if ((client.queuedBytes > 0) && (client.queuedBytes + length > highWaterMark)) {
+		client.droppedPackets++; // slow consumer: drop instead of stalling the others
+		return false;
+	}
+	out.payload = payload;
+	out.sent = 0;
+	client.output.push_back(out);
+	client.queuedBytes += length;
+	if (!client.writeWatched) {
+		flushClient(client); // most packets leave right away
+		if (clients.count(client.fd) == 0) {
+			return false; // the send failed and the client was closed
+		}
+	}
+	return true;
+}
+
+void StreamServer::flushClient(Client &client)
+{
+	while (!client.output.empty()) {
+		struct iovec iov[2 * MAX_WRITE_PACKETS];
+		int count = 0;
+		for (unsigned long i = 0; (i < client.output.size()) && (i < MAX_WRITE_PACKETS); i++) {
+			OutputPacket &out = client.output[i];
+			unsigned long sent = out.sent;
+			if (sent < out.header.size()) {
+				iov[count].iov_base = &out.header[sent];
+				iov[count].iov_len = out.header.size() - sent;
+				count++;
+				sent = 0;
+			} else {
+				sent -= out.header.size();
+			}
+			if (sent < out.payload->size()) {
+				iov[count].iov_base = const_cast<unsigned char*>(&(*out.payload)[sent]);
+				iov[count].iov_len = out.payload->size() - sent;
+				count++;
+			}
+		}
+		// a subscriber which has gone away must not raise SIGPIPE and take the whole server down
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = count;
+		ssize_t n = sendmsg(client.fd, &msg, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+				watchWrite(client, true); // continue when the socket has room again
+				return;
+			}
+			closeClient(client.fd);
+			return;
+		}
+		unsigned long left = n;
+		client.queuedBytes -= left;
+		while (left > 0) {
+			OutputPacket &out = client.output.front();
+			unsigned long rest = out.header.size() + out.payload->size() - out.sent;
+			if (left < rest) {
+				out.sent += left;
+				left = 0;
+			} else {
+				left -= rest;
+				client.output.pop_front();
+			}
+		}
+	}
+	watchWrite(client, false);
+}
+
+void StreamServer::watchWrite(Client &client, bool watch)
+{
+	if (client.writeWatched == watch) {
+		return;
+	}
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = watch ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+	event.data.fd = client.fd;
+	if (epoll_ctl(epollFd, EPOLL_CTL_MOD, client.fd, &event) < 0) {
+		mySocketError("ERROR changing client events");
+	}
+	client.writeWatched = watch;
+}
+
+void StreamServer::mySocketError(string msg)
+{
+	int currentError = errno;
+	msg.append(": ");
+	//FIXME strerror is not thread save
+	msg.append(strerror(currentError));
+	throw StreamServerError(msg);
+}
@@ -0,0 +1,89 @@
+#ifndef StreamServer_h
+#define StreamServer_h
+
+#include "StreamRingBuffer.h"
+#include <stdexcept>
+#include <vector>
+#include <deque>
+#include <map>
+#include <string>
+#include <memory>
+
+//definitions
+#define HIGH_WATER_MARK 4194304
+#define MAX_EVENTS 64
+#define MAX_WRITE_PACKETS 32
+
+using namespace std;
+
+class StreamServerError : public runtime_error {
+	public:
+		StreamServerError(const string& what_arg)
+		   	: runtime_error(what_arg)
+	   	{}
+};
+
+// Event driven server for StreamPackets with any number of clients (Linux, epoll).
+// All sockets are non-blocking; poll() waits for events and accepts, reads and writes
+// as far as the sockets allow. Received packets are queued for readPacket().
+// Each client has its own output queue. Packets are sent with sendmsg directly from the
+// payload, which is shared by all clients of a broadcast. A client whose queue exceeds
+// the high-water mark has further packets dropped (counted), so one slow consumer never
+// stalls the others.
+class StreamServer {
+	// definitions
+	protected:
+		struct OutputPacket {
+			vector<unsigned char> header;
+			shared_ptr<const vector<unsigned char> > payload;
+			unsigned long sent; // Bytes of header and payload already sent
+		};
+
+		struct Client {
+			int fd;
+			StreamRingBuffer readBuffer;
+			deque<OutputPacket> output;
+			unsigned long queuedBytes;
+			unsigned long droppedPackets;
+			bool writeWatched; // EPOLLOUT requested
+		};
+
+	// methods
+	public:
+		StreamServer(unsigned long highWaterMark = HIGH_WATER_MARK);
+		~StreamServer();
+		virtual void openServer(unsigned short port); // may throw StreamServerError
+		virtual void closeServer();
+
+		virtual int poll(int timeoutMs); // may throw StreamServerError
+
+		virtual bool packetAvailable();
+		virtual vector<unsigned char> readPacket(int &client);
+
+		virtual bool writePacket(int client, const vector<unsigned char> &data);
+		virtual unsigned long broadcastPacket(const vector<unsigned char> &data);
+
+		virtual vector<int> getClients();
+		virtual unsigned long getQueuedBytes(int client);
+		virtual unsigned long getDroppedPackets(int client);
+		virtual void closeClient(int client);
+
+	protected:
+		virtual void acceptClients();
+		virtual void readClient(Client &client);
+		virtual bool parsePackets(Client &client);
+		virtual bool queuePacket(Client &client, shared_ptr<const vector<unsigned char> > payload); // false if dropped or the client was closed
+		virtual void flushClient(Client &client);
+		virtual void watchWrite(Client &client, bool watch);
+		virtual void mySocketError(string msg); // may throw StreamServerError
+
+	// variables
+	protected:
+		int serverFd;
+		int epollFd;
+		unsigned long highWaterMark;
+		map<int, shared_ptr<Client> > clients;
+		deque<pair<int, vector<unsigned char> > > received;
+};
+
+#endif // StreamServer_h
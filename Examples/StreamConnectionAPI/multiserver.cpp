@@ -0,0 +1,21 @@
+#include "StreamServer.h"
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+// Telemetry fan-out: every packet received from a client is sent to all clients.
+int main () {
+	StreamServer server;
+	server.openServer(3000);
+	while (true) {
+		server.poll(1000);
+		while (server.packetAvailable()) {
+			int client;
+			vector<unsigned char> data = server.readPacket(client);
+			unsigned long queued = server.broadcastPacket(data);
+			cout << "packet of length " << dec << data.size() << " from client " << client << " sent to " << queued << " clients" << endl;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,91 @@
+#ifndef EncapsulationPacketConf_h
+#define EncapsulationPacketConf_h
+
+#include "NetProtConf.h"
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+/*! \brief Network protocol configuration for CCSDS Encapsulation Packets (CCSDS 133.1-B), e.g. for IP over CCSDS.
+ *
+ * The first Byte of an Encapsulation Packet holds the packet version (111), the protocol ID (3 bits) and the
+ * length of length (2 bits). The length of length alone selects the layout of the header:
+ *	- 00: a 1-Byte header without length field. Only allowed for idle packets (protocol ID 000), so it is a 1-Byte idle packet.
+ *	- 01: a 2-Byte header, the packet length in the 2nd Byte.
+ *	- 10: a 4-Byte header, the packet length in the 3rd and 4th Bytes.
+ *	- 11: an 8-Byte header, the packet length in the 5th to 8th Bytes.
+ *
+ * The packet length is the total length, header included. The header length of each possible first Byte is kept in a
+ * table, so a header is parsed with one lookup and one read of the length field (see parseHeader()).
+ *
+ * A virtual channel carries Space Packets together with Encapsulation Packets through a MultiplexedProtConf, with this
+ * configuration assigned to packet version 111 and a SpacePacketConf to versions 000 and 001.
+ */
+class EncapsulationPacketConf : public NetProtConf {
+
+// definitions
+public:
+	static const uint8_t packetVersion = 7;			/**< Packet version of Encapsulation Packets (111). */
+	static const uint8_t idleProtocolId = 0;		/**< Protocol ID of Encapsulation idle packets. */
+	static const uint8_t ipeProtocolId = 2;			/**< Protocol ID of IP packets with the IP Extension header. */
+	static const uint8_t idlePacket = 0xE0;			/**< 1-Byte idle packet: version 111, protocol ID 000, length of length 00. */
+
+// methods
+public:
+
+/*! \brief Constructor of the EncapsulationPacketConf class. Test packets are generated with protocol ID 2 (IPE). */
+	EncapsulationPacketConf();
+
+/*! \brief Sets the protocol ID of the packets generated by genTestPacket() (3 bits). */
+	virtual void setProtocolId(uint8_t protocolId);
+
+/*! \brief Checks if the first Byte of a packet belongs to an idle packet (protocol ID 000). */
+	virtual bool isIdlePacket(uint8_t firstByteOfHeader);
+
+/*! \brief Returns the header length selected by the length of length bits of the first Byte of a packet. */
+	virtual uint64_t getPacketHeaderLength(uint8_t firstByteOfHeader);
+
+/*! \brief Extracts the total packet length from a complete header.
+ *
+ * A length field shorter than the header itself is returned as the header length, so a corrupted packet ends right away
+ * and is dropped by validatePacket().
+ */
+	virtual uint64_t extractPacketLength(const vector<uint8_t> &header);
+
+/*! \brief Counts the idle packets at the beginning of a buffer.
+ *
+ * Runs of 1-Byte idle packets are found 16 Bytes at a time (see NetProtConf::countLeadingMasked()), longer idle packets
+ * are skipped by their length field. An idle packet which does not fit into the buffer is left to the virtual channel,
+ * which reassembles it and drops it after the frame. The count stops at the first Byte of any other packet version.
+ */
+	virtual size_t skipIdlePackets(const uint8_t *data, size_t length);
+
+/*! \brief Checks that the length field of a complete received packet matches its size. */
+	virtual bool validatePacket(const vector<uint8_t> &packet);
+
+/*! \brief Returns a 1-Byte idle packet (0xE0). */
+	virtual uint8_t genIdlePacket();
+
+/*! \brief Encapsulates a message into an Encapsulation Packet with the shortest header its length fits into. */
+	virtual vector<uint8_t> genTestPacket(vector<uint8_t> message);
+
+/*! \brief Displays the header fields of a packet for debugging. */
+	virtual void packetDebugOutput(vector<uint8_t> packet);
+
+/*! \brief Parses the header of an Encapsulation Packet in place.
+ * \param data First Byte of the packet.
+ * \param length Number of Bytes available.
+ * \param packetLength Set to the total packet length if the header is complete (1 for a 1-Byte idle packet).
+ * \return The header length, or zero if the first Byte is not an Encapsulation Packet or the header is incomplete.
+ */
+	static uint64_t parseHeader(const uint8_t *data, size_t length, uint64_t &packetLength);
+
+// variables
+protected:
+	uint8_t testProtocolId;					/*!< Protocol ID of the test packets. */
+};
+
+#endif // EncapsulationPacketConf_h
@@ -0,0 +1,97 @@
+#ifndef MultiplexedProtConf_h
+#define MultiplexedProtConf_h
+
+#include "NetProtConf.h"
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+/*! \brief Network protocol configuration which lets a virtual channel carry packets of several protocols.
+ *
+ * Each packet version (the three most significant bits of the first header Byte) can be assigned its own
+ * configuration, e.g. a SpacePacketConf for versions 000 and 001 (its idle packets) and an EncapsulationPacketConf for
+ * version 111. Every call is passed to the configuration of the version found in the first Byte of the packet.
+ *
+ * The configuration, the header length and the idle flag of each of the 256 possible first Bytes are kept in lookup
+ * tables, so the reassembly loop of the virtual channel finds them with a single lookup. The tables assume that
+ * isIdlePacket() and getPacketHeaderLength() of the sub-configurations only depend on the first Byte; call
+ * refreshLookupTables() if a sub-configuration changes its header layout.
+ *
+ * Bytes with a version without configuration are skipped like idle packets. Idle fill and test packets are generated by
+ * the default configuration (see setDefaultProtConf()).
+ *
+ * \note The skipIdlePackets() of a sub-configuration has to stop at the first Byte of another packet version.
+ * Sub-configurations are not owned and have to outlive this one.
+ */
+class MultiplexedProtConf : public NetProtConf {
+
+// definitions
+public:
+	static const uint8_t versionCount = 8;		/**< Number of packet versions (3 bits). */
+
+// methods
+public:
+
+/*! \brief Constructor of the MultiplexedProtConf class. No packet version has a configuration yet. */
+	MultiplexedProtConf();
+
+/*! \brief Assigns a configuration to a packet version.
+ * \param version Packet version (3 bits).
+ * \param conf Configuration for the packets of this version, or NULL to skip them.
+ *
+ * The first configuration assigned becomes the default configuration.
+ */
+	virtual void setProtConf(uint8_t version, NetProtConf *conf);
+
+/*! \brief Retrieves the configuration of a packet version (NULL if none). */
+	virtual NetProtConf *getProtConf(uint8_t version);
+
+/*! \brief Selects the configuration which generates idle fill and test packets. */
+	virtual void setDefaultProtConf(NetProtConf *conf);
+
+/*! \brief Retrieves the configuration which generates idle fill and test packets (NULL if none). */
+	virtual NetProtConf *getDefaultProtConf();
+
+/*! \brief Queries the sub-configurations again for the header length and idle flag of each first Byte. */
+	virtual void refreshLookupTables();
+
+/*! \brief Checks if the first Byte of a packet belongs to an idle packet (one lookup). */
+	virtual bool isIdlePacket(uint8_t firstByteOfHeader);
+
+/*! \brief Returns the header length of a packet (one lookup). */
+	virtual uint64_t getPacketHeaderLength(uint8_t firstByteOfHeader);
+
+/*! \brief Extracts the packet length with the configuration of the packet version. */
+	virtual uint64_t extractPacketLength(const vector<uint8_t> &header);
+
+/*! \brief Counts the idle packets at the beginning of a buffer, passing each run to the configuration of its version. */
+	virtual size_t skipIdlePackets(const uint8_t *data, size_t length);
+
+/*! \brief Checks a complete received packet with the configuration of its version. */
+	virtual bool validatePacket(const vector<uint8_t> &packet);
+
+/*! \brief Generates an idle packet with the default configuration. */
+	virtual uint8_t genIdlePacket();
+
+/*! \brief Fills a buffer with idle packets of the default configuration. */
+	virtual void genIdleFill(uint8_t *dest, size_t length);
+
+/*! \brief Generates a test packet with the default configuration. */
+	virtual vector<uint8_t> genTestPacket(vector<uint8_t> message);
+
+/*! \brief Displays a packet with the configuration of its version. */
+	virtual void packetDebugOutput(vector<uint8_t> packet);
+
+// variables
+protected:
+	NetProtConf *versionConfs[versionCount];	/*!< Configuration of each packet version (not owned). */
+	NetProtConf *defaultConf;					/*!< Configuration for idle fill and test packets (not owned). */
+	NetProtConf *confLookup[256];				/*!< Configuration of each first Byte. */
+	uint64_t headerLengthLookup[256];			/*!< Header length of each first Byte. */
+	bool idleLookup[256];						/*!< Idle flag of each first Byte. */
+};
+
+#endif // MultiplexedProtConf_h
@@ -13,6 +13,7 @@
 
 #include <vector>
 #include <stdint.h>
+#include <stddef.h>
 
 using namespace std;
 
@@ -46,7 +47,7 @@ public:
 	 * This virtual member is NOT IMPLEMENTED. It simply returns a 1.
 	 * Idle packets have a length of 1.
 	 */
-	virtual uint64_t extractPacketLength(vector<uint8_t> header);
+	virtual uint64_t extractPacketLength(const vector<uint8_t> &header);
 
 	/*! \brief Receives the header of a packet (only the first 8 bits) and returns its length.
 	 * 
@@ -62,6 +63,32 @@ public:
 	 */
 	virtual uint8_t genIdlePacket();
 
+	/*! \brief Fills a buffer with idle packets.
+	 * \param dest First Byte of the buffer.
+	 * \param length Number of Bytes to fill.
+	 * 
+	 * Used to pad the TM Data Field when no more packets are waiting to be sent.
+	 * The default implementation sets every Byte to genIdlePacket() with a single memset.
+	 */
+	virtual void genIdleFill(uint8_t *dest, size_t length);
+
+	/*! \brief Counts the idle packets at the beginning of a buffer.
+	 * \param data First Byte of the buffer (the start of a packet).
+	 * \param length Number of Bytes in the buffer.
+	 * \return The number of Bytes that can be skipped, i.e. the position of the first non-idle packet (or length).
+	 * 
+	 * The default implementation checks every Byte with isIdlePacket(). 
+	 * Protocols with single-Byte idle packets should override it with countLeadingVersion().
+	 */
+	virtual size_t skipIdlePackets(const uint8_t *data, size_t length);
+	/*! \brief Checks the error control of a complete received packet.
+	 * \param packet The complete packet, header included.
+	 * \return FALSE if the packet is corrupted and has to be dropped.
+	 * 
+	 * The default implementation has no error control and accepts every packet.
+	 */
+	virtual bool validatePacket(const vector<uint8_t> &packet);
+
 	/*! \brief Receives a message vector and returns it with a header with hard-coded test values.
 	 * 
 	 * This virtual member is NOT IMPLEMENTED. It simply returns a 1.
@@ -73,6 +100,27 @@ public:
 	 * This member assumes all packets are idle packets! It displays: IdlePacket[SIZE_IN_BITS] Content: "PACKET_CONTENT_AS_IS
 	 */
 	virtual void packetDebugOutput(vector<uint8_t> packet);
+
+protected:
+	/*! \brief Counts the leading Bytes of a buffer whose three most significant bits match a packet version.
+	 * \param data First Byte of the buffer.
+	 * \param length Number of Bytes in the buffer.
+	 * \param version Packet version (3 bits) to compare to.
+	 * \return The position of the first Byte with a different version, or length if all of them match.
+	 * 
+	 * Compares 16 Bytes at once if SSE2 is available.
+	 */
+	static size_t countLeadingVersion(const uint8_t *data, size_t length, uint8_t version);
+	/*! \brief Counts the leading Bytes of a buffer which match a bit pattern under a mask.
+	 * \param data First Byte of the buffer.
+	 * \param length Number of Bytes in the buffer.
+	 * \param mask Bits of each Byte to compare (0xFF for a whole Byte).
+	 * \param bits Bit pattern to compare to.
+	 * \return The position of the first Byte which does not match, or length if all of them match.
+	 * 
+	 * Used by countLeadingVersion(). Compares 16 Bytes at once if SSE2 is available.
+	 */
+	static size_t countLeadingMasked(const uint8_t *data, size_t length, uint8_t mask, uint8_t bits);
 };
 
 #endif // NetProtConf_h
@@ -0,0 +1,165 @@
+#ifndef PacketRouter_h
+#define PacketRouter_h
+
+#include "GroundPacketServer.h"
+#include "SpacePacketConf.h"
+#include "TmVirtualChannel.h"
+#include "myErrors.h"
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+class NetProtConf;
+
+/*!	\brief Distributes the Space Packets received on a virtual channel to several consumers by APID.
+ *
+ * The router is connected to a virtual channel like any other packet sink (TmVirtualChannel::connectPacketSink and
+ * PacketServer::connectTmVc). Each received packet is placed in the queue of one route, e.g. archive, real-time display
+ * or derived parameter processing. The consumers take the packets from their queue with PacketRouter::receivePacket.
+ *
+ * The route of a packet is found with a lookup table of all 2048 APIDs (11 bits, see SpacePacketConf), so routing
+ * takes constant time. For packets with a Data Field Header (PUS), a route can also be given per APID, service type and
+ * subtype; it overrides the route of the APID. Packets of APIDs without a route go to the default route, if any, and are
+ * dropped otherwise.
+ *
+ * Each route queue holds a limited number of packets. When it is full, either the new packet or the oldest queued
+ * packet is dropped, depending on the overflow policy of the route.
+ */
+class PacketRouter : public GroundPacketServer
+{
+//
+// definitions
+//
+public:
+	/*! \brief What to do with a packet routed to a full queue. */
+	enum OverflowPolicy {
+		dropNewest,		/**< The new packet is dropped (the queue keeps the oldest packets). */
+		dropOldest		/**< The oldest queued packet is dropped (the queue keeps the newest packets). */
+	};
+
+	static const size_t noRoute = (size_t) -1;	/**< Returned by PacketRouter::findRoute if a packet has no route. */
+
+//
+// methods
+//
+public:
+
+/*! \brief Constructor of the PacketRouter class.
+ *	\param conf Network protocol configuration, used for the debug output.
+ *
+ * There are no routes and no default route.
+ */
+	PacketRouter(NetProtConf *conf);
+
+/*! \brief Adds a route with its own queue.
+ *	\param name Name of the route, used for the debug output.
+ *	\param capacity Maximum number of packets in the queue (at least one).
+ *	\param policy What to do with packets routed to a full queue.
+ *	\return The number of the new route.
+ */
+	virtual size_t addRoute(string name, size_t capacity, OverflowPolicy policy = dropNewest);
+
+/*! \brief Routes all packets of an APID to a route.
+ *
+ * \note May throw GroundPacketServerError if the APID or the route does not exist.
+ */
+	virtual void routeApid(uint16_t apid, size_t route);
+
+/*! \brief Routes all packets of a range of APIDs (first and last included) to a route. */
+	virtual void routeApidRange(uint16_t firstApid, uint16_t lastApid, size_t route);
+
+/*! \brief Routes the packets of an APID with a PUS service type and subtype to a route, overriding the route of the APID.
+ *
+ * \note May throw GroundPacketServerError if the APID or the route does not exist.
+ */
+	virtual void routePusService(uint16_t apid, uint8_t serviceType, uint8_t serviceSubtype, size_t route);
+
+/*! \brief Removes the route of an APID, including its PUS service routes. */
+	virtual void unrouteApid(uint16_t apid);
+
+/*! \brief Routes the packets of all APIDs without a route to a route. */
+	virtual void setDefaultRoute(size_t route);
+
+/*! \brief Drops the packets of all APIDs without a route (default). */
+	virtual void clearDefaultRoute();
+
+/*! \brief Finds the route of a packet.
+ *	\param packet A complete Space Packet.
+ *	\return The number of the route, or PacketRouter::noRoute.
+ */
+	virtual size_t findRoute(const vector<uint8_t> &packet);
+
+/*! \brief Places a packet in the queue of its route, applying the overflow policy of the route. */
+	virtual void routePacket(const TimeTaggedPacket &packet);
+
+/*! \brief Takes all packets from the input queue of the virtual channel and routes them.
+ *
+ *	\note may throw GroundPacketServerError if:
+ *	- No virtual channel was specified.
+ *	- There were any virtual channel errors.
+ */
+	virtual void signalNewPacket();
+
+/*! \brief Indicates whether the queue of a route holds a packet. */
+	virtual bool packetAvailable(size_t route);
+
+/*! \brief Takes the oldest packet from the queue of a route.
+ *
+ * \note May throw GroundPacketServerError if the route does not exist or its queue is empty.
+ */
+	virtual TimeTaggedPacket receivePacket(size_t route);
+
+/*! \brief Retrieves the number of routes. */
+	virtual size_t getRouteCount();
+
+/*! \brief Retrieves the name of a route. */
+	virtual string getRouteName(size_t route);
+
+/*! \brief Retrieves the number of packets in the queue of a route. */
+	virtual size_t getQueuedCount(size_t route);
+
+/*! \brief Retrieves the number of packets placed in the queue of a route. */
+	virtual uint64_t getRoutedCount(size_t route);
+
+/*! \brief Retrieves the number of packets dropped by the overflow policy of a route. */
+	virtual uint64_t getDroppedCount(size_t route);
+
+/*! \brief Retrieves the number of packets dropped because they had no route. */
+	virtual uint64_t getUnroutedCount();
+
+protected:
+/*! \brief Throws a GroundPacketServerError if the route does not exist. */
+	virtual void checkRoute(size_t route);
+
+/*! \brief Key of a PUS service route. */
+	static uint32_t pusKey(uint16_t apid, uint8_t serviceType, uint8_t serviceSubtype);
+
+//
+// variables
+//
+protected:
+	/*! \brief A consumer of packets with its queue. */
+	struct PacketRoute {
+		string name;					/**< Name of the route. */
+		size_t capacity;				/**< Maximum number of packets in the queue. */
+		OverflowPolicy policy;			/**< What to do with packets routed to a full queue. */
+		deque<TimeTaggedPacket> queue;	/**< Packets waiting for the consumer. */
+		uint64_t routedCount;			/**< Number of packets placed in the queue. */
+		uint64_t droppedCount;			/**< Number of packets dropped by the overflow policy. */
+	};
+
+	vector<PacketRoute> routes;			/*!< All routes. */
+	vector<size_t> apidRoutes;			/*!< Route of each APID (PacketRouter::noRoute for the default route). */
+	vector<bool> apidHasPusRoutes;		/*!< Indicates whether an APID has PUS service routes, so the map is only searched for those. */
+	map<uint32_t, size_t> pusRoutes;	/*!< Routes per APID, service type and subtype. */
+	size_t defaultRoute;				/*!< Route of the packets of APIDs without a route. */
+	uint64_t unroutedCount;				/*!< Number of packets dropped because they had no route. */
+};
+
+#endif // PacketRouter_h
@@ -0,0 +1,146 @@
+#ifndef SpacePacketBuilder_h
+#define SpacePacketBuilder_h
+
+#include "SpacePacketConf.h"
+#include "myErrors.h"
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+class TmVirtualChannel;
+
+/*! \brief Generates CCSDS Space Packets with a sequence counter per APID.
+ *
+ * Each packet is written in a single pass directly into its destination: a buffer given by the caller, or a packet
+ * reserved in the output queue of a virtual channel (see TmVirtualChannel::allocSendPacket). The user data is copied
+ * exactly once.
+ *
+ * A packet consists of:
+ *	- The 6-Byte primary header: version 0, packet type, Data Field Header flag, APID, grouping flags,
+ *	  the 14-bit source sequence count of the APID and the packet length.
+ *	- Optionally, a 4-Byte PUS Data Field Header: PUS version, service type, service subtype and the packet
+ *	  subcounter of the APID (the layout read by SpacePacketConf::packetDebugOutput).
+ *	- The user data.
+ *	- Optionally, the 2-Byte Packet Error Control field (see SpacePacketConf::computeErrorControl).
+ *
+ * The sequence count of an APID is only incremented when a packet was actually written.
+ */
+class SpacePacketBuilder {
+//
+// definitions
+//
+public:
+	static const uint16_t primaryHeaderLength = 6;		/**< Length of the packet primary header. */
+	static const uint16_t pusHeaderLength = 4;			/**< Length of the PUS Data Field Header written by the builder. */
+	static const size_t maxDataFieldLength = 65536;		/**< Longest Packet Data Field (16-bit length field plus one). */
+
+//
+// methods
+//
+public:
+
+/*! \brief Constructor of the SpacePacketBuilder class.
+ *
+ * Builds telemetry packets (type 0) with PUS version 1 and without error control. All sequence counts start at zero.
+ */
+	SpacePacketBuilder();
+
+/*! \brief Sets the packet type (0 = telemetry, 1 = telecommand). */
+	virtual void setPacketType(uint16_t type);
+
+/*! \brief Sets the PUS version written into the PUS Data Field Header (3 bits). */
+	virtual void setPusVersion(uint16_t version);
+
+/*! \brief Selects the Packet Error Control field appended to each packet. */
+	virtual void setPacketErrorControl(SpacePacketConf::PacketErrorControl type);
+
+/*! \brief Retrieves the selected Packet Error Control. */
+	virtual SpacePacketConf::PacketErrorControl getPacketErrorControl();
+
+/*! \brief Computes the total length of a packet.
+ *	\param length Number of Bytes of user data.
+ *	\param pusHeader TRUE if the packet has a PUS Data Field Header.
+ */
+	virtual size_t getPacketLength(size_t length, bool pusHeader);
+
+/*! \brief Writes a packet without Data Field Header into a buffer.
+ *	\param dest First Byte of the buffer.
+ *	\param capacity Number of Bytes available in the buffer.
+ *	\param apid Application Process ID (0 to 2047).
+ *	\param data User data.
+ *	\param length Number of Bytes of user data (at least one).
+ *	\param groupingFlags The grouping flags (see SpacePacketConf::GroupingFlags).
+ *	\return The number of Bytes written.
+ *
+ * \note May throw SpacePacketBuilderError if the APID is out of range, the data is too short or too long,
+ * or the buffer is too small.
+ */
+	virtual size_t buildPacket(uint8_t *dest, size_t capacity, uint16_t apid, const uint8_t *data, size_t length,
+			uint16_t groupingFlags = SpacePacketConf::unsegmented);
+
+/*! \brief Writes a packet with a PUS Data Field Header into a buffer.
+ *	\param dest First Byte of the buffer.
+ *	\param capacity Number of Bytes available in the buffer.
+ *	\param apid Application Process ID (0 to 2047).
+ *	\param serviceType The PUS service type.
+ *	\param serviceSubtype The PUS service subtype.
+ *	\param data User data (may be empty).
+ *	\param length Number of Bytes of user data.
+ *	\return The number of Bytes written.
+ *
+ * \note May throw SpacePacketBuilderError like SpacePacketBuilder::buildPacket.
+ */
+	virtual size_t buildPusPacket(uint8_t *dest, size_t capacity, uint16_t apid, uint8_t serviceType, uint8_t serviceSubtype,
+			const uint8_t *data, size_t length);
+
+/*! \brief Writes a packet without Data Field Header directly into the output queue of a virtual channel.
+ *	\return The number of Bytes written.
+ *
+ * \note May throw SpacePacketBuilderError, or TmVirtualChannelError if the output queue is full.
+ */
+	virtual size_t sendPacket(TmVirtualChannel *vc, uint16_t apid, const uint8_t *data, size_t length,
+			uint16_t groupingFlags = SpacePacketConf::unsegmented);
+
+/*! \brief Writes a packet with a PUS Data Field Header directly into the output queue of a virtual channel.
+ *	\return The number of Bytes written.
+ *
+ * \note May throw SpacePacketBuilderError, or TmVirtualChannelError if the output queue is full.
+ */
+	virtual size_t sendPusPacket(TmVirtualChannel *vc, uint16_t apid, uint8_t serviceType, uint8_t serviceSubtype,
+			const uint8_t *data, size_t length);
+
+/*! \brief Retrieves the source sequence count of the next packet of an APID. */
+	virtual uint16_t getSequenceCount(uint16_t apid);
+
+/*! \brief Sets the source sequence count of the next packet of an APID (14 bits). */
+	virtual void setSequenceCount(uint16_t apid, uint16_t count);
+
+/*! \brief Sets the sequence counts and PUS packet subcounters of all APIDs to zero. */
+	virtual void resetSequenceCounts();
+
+protected:
+/*! \brief Checks the parameters of a packet and returns its total length.
+ *
+ * \note May throw SpacePacketBuilderError.
+ */
+	virtual size_t checkPacket(uint16_t apid, size_t length, bool pusHeader, uint16_t groupingFlags);
+
+/*! \brief Writes a packet of known length (see SpacePacketBuilder::checkPacket) and advances the counters of the APID. */
+	virtual void writePacket(uint8_t *dest, size_t packetLength, uint16_t apid, bool pusHeader, uint8_t serviceType,
+			uint8_t serviceSubtype, const uint8_t *data, size_t length, uint16_t groupingFlags);
+
+//
+// variables
+//
+protected:
+	uint16_t packetType;							/*!< Packet type (0 = telemetry, 1 = telecommand). */
+	uint16_t pusVersion;							/*!< PUS version of the Data Field Header. */
+	SpacePacketConf::PacketErrorControl errorControl;	/*!< Type of the Packet Error Control field. */
+	vector<uint16_t> sequenceCounts;				/*!< Source sequence count of the next packet, per APID. */
+	vector<uint8_t> pusSubcounters;					/*!< PUS packet subcounter of the next packet, per APID. */
+};
+
+#endif // SpacePacketBuilder_h
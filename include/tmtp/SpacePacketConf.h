@@ -18,6 +18,25 @@
 class SpacePacketConf : public NetProtConf {			// Inherits from NetProtConf all its members as public.
 
 // definitions
+public:
+	/*! \brief Type of the Packet Error Control field at the end of each packet (see ECSS-E-70-41A). */
+	enum PacketErrorControl {
+		noErrorControl,			/**< Packets carry no error control field (default). */
+		crcErrorControl,		/**< CRC-16 (polynomial 0x1021, initial value 0xFFFF), as used for the FECF. */
+		checksumErrorControl	/**< ISO checksum (ISO 8473 Fletcher checksum). */
+	};
+
+	/*! \brief Values of the grouping flags of a Space Packet. */
+	enum GroupingFlags {
+		continuationSegment = 0,	/**< Continuation segment of a segmented unit. */
+		firstSegment = 1,			/**< First segment of a segmented unit. */
+		lastSegment = 2,			/**< Last segment of a segmented unit. */
+		unsegmented = 3				/**< Unsegmented packet. */
+	};
+
+	static const uint16_t apidCount = 2048;		/**< Number of Application Process IDs (11 bits). */
+	static const uint16_t idleApid = 0x07FF;	/**< APID of CCSDS idle packets, which are never checked. */
+
 protected:
 	static const uint16_t idlePacketVersion = 1;	// 0000 0000 0000 0001
 	static const uint16_t testPacketVersion = 0;	// 0000 0000 0000 0000
@@ -49,7 +68,59 @@ public:
  * Extracts the 5th and 6th Bytes of the packet header (which contains the packet length) and adds them to the packetHeaderLength (hardcoded to 6). 
  * ... And then it adds a 1.
  */
-	virtual uint64_t extractPacketLength(vector<uint8_t> header);
+	virtual uint64_t extractPacketLength(const vector<uint8_t> &header);
+
+/*! \brief Counts the idle packets at the beginning of a buffer.
+ * \param data First Byte of the buffer (the start of a packet).
+ * \param length Number of Bytes in the buffer.
+ * 
+ * Idle packets are a single Byte with packet version 001, so the whole run is found at once with NetProtConf::countLeadingVersion().
+ */
+	virtual size_t skipIdlePackets(const uint8_t *data, size_t length);
+
+/*! \brief Selects the Packet Error Control used by validatePacket() and genTestPacket(). Resets the invalid packet counters. */
+	virtual void setPacketErrorControl(PacketErrorControl type);
+
+/*! \brief Retrieves the selected Packet Error Control. */
+	virtual PacketErrorControl getPacketErrorControl();
+
+/*! \brief Checks the Packet Error Control field of a complete received packet.
+ * \param packet The complete space packet, header included.
+ * \return FALSE if the packet is too short or the error control fails.
+ * 
+ * The CRC and the checksum are computed over the whole packet, including the error control field. They result in zero for a valid packet. \n
+ * Invalid packets are counted per APID (see getInvalidPacketCount()). Without error control, or for idle packets, every packet is accepted.
+ */
+	virtual bool validatePacket(const vector<uint8_t> &packet);
+
+/*! \brief Retrieves the number of invalid packets received for an APID. */
+	virtual uint64_t getInvalidPacketCount(uint16_t apid);
+
+/*! \brief Retrieves the number of invalid packets received for all APIDs. */
+	virtual uint64_t getInvalidPacketCount();
+
+/*! \brief Extracts the APID from a packet primary header. At least its first two Bytes have to be readable. */
+	static uint16_t extractApid(const uint8_t *header);
+
+/*! \brief Extracts the grouping flags (see SpacePacketConf::GroupingFlags) from a packet primary header. At least its first four Bytes have to be readable. */
+	static uint16_t extractGroupingFlags(const uint8_t *header);
+
+/*! \brief Computes the Packet Error Control field of a packet.
+ * \param type The type of error control.
+ * \param data The packet without its error control field.
+ * \param length Number of Bytes of the packet without its error control field.
+ * \return The two Bytes to append to the packet (zero for SpacePacketConf::noErrorControl).
+ */
+	static uint16_t computeErrorControl(PacketErrorControl type, const uint8_t *data, size_t length);
+
+/*! \brief Computes the CRC-16 of a buffer (polynomial 0x1021, initial value 0xFFFF, see TmCrc16). */
+	static uint16_t crc16(const uint8_t *data, size_t length);
+
+/*! \brief Computes the two ISO checksum sums C0 (high Byte) and C1 (low Byte) of a buffer, both modulo 255.
+ *
+ * The sums are kept in 64 bits, so the modulo is only taken once at the end for any packet length.
+ */
+	static uint16_t isoChecksumSums(const uint8_t *data, size_t length);
 
 /*! \brief Returns the hardcoded value of variable packetHeaderLength.
  * \param firstByteOfHeader Supposed to be the first Byte of a packet header, but does absolutely nothing with it.
@@ -75,6 +146,7 @@ public:
  * 
  * The 1st, 2nd and 4th Bytes are all zeros while the 3rd Byte stores a 192 (1100 0000), 
  * while the 5th and 6th contain the message length expressed as an uint16_t.
+ * If a Packet Error Control is selected, the two Bytes of the error control field are appended and counted in the length.
  */
 	virtual vector<uint8_t> genTestPacket(vector<uint8_t> message);
 	
@@ -100,6 +172,11 @@ public:
  * The 2nd Byte "pusServiceType", the 3rd "pusServiceSubtype and the 4th "pusPacketSubcounter".
  */
 	virtual void packetDebugOutput(vector<uint8_t> packet);
+
+// variables
+protected:
+	PacketErrorControl errorControl;				/*!< Type of the Packet Error Control field. */
+	vector<uint64_t> invalidPacketCount;			/*!< Number of invalid packets received, per APID. */
 };
 
 #endif // SpacePacketConf_h
@@ -0,0 +1,163 @@
+#ifndef SpacePacketSequencer_h
+#define SpacePacketSequencer_h
+
+#include "GroundPacketServer.h"
+#include "SpacePacketConf.h"
+#include "TmVirtualChannel.h"
+#include "TmSequenceTracker.h"
+#include "TmFrameTimestamp.h"
+#include "TmFrameBitrate.h"
+#include "myErrors.h"
+
+#include <vector>
+#include <queue>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+class NetProtConf;
+
+/*! \brief An application data unit: the user data of one unsegmented Space Packet, or of all segments of a segmented one. */
+struct ApplicationDataUnit {
+	uint16_t apid;					/**< Application Process ID of the packets. */
+	vector<uint8_t> data;			/**< Packet Data Fields of all segments, in order. */
+	uint16_t segments;				/**< Number of packets the unit was reassembled from. */
+	TmFrameTimestamp timestamp;		/**< Timestamp of the first Byte of the first packet. */
+	TmFrameBitrate bitrate;			/**< Reference bitrate of the timestamp. */
+};
+
+/*!	\brief Follows the source sequence count of the Space Packets of each APID and reassembles segmented packets.
+ *
+ * Each APID has its own 14-bit source sequence count. The sequencer compares each received count against the count
+ * expected for the APID (see TmSequenceTracker::classify) and finds missing, duplicate and out-of-order packets:
+ *	- A count ahead of the expected one means the skipped packets are lost.
+ *	- A count behind the expected one is a late packet if it was counted as lost, and a duplicate otherwise.
+ *	  The last 64 counts of each APID are remembered in a bit mask for this.
+ *	- A count further behind than the bit mask is taken as a restart of the source counter.
+ *
+ * Duplicates are dropped. All other packets are turned into application data units: unsegmented packets right away,
+ * segmented packets (grouping flags first, continuation and last segment) once the last segment arrives. A segmented
+ * unit with a missing segment is discarded and counted as incomplete. \n
+ * A late packet leaves the segmented unit being reassembled for its APID alone: an unsegmented one becomes a unit of
+ * its own, a late segment is dropped and counted, since the rest of its unit is already gone.
+ *
+ * The state of all 2048 APIDs is a single flat array of small records, so it stays in the cache at high packet rates.
+ * The segments being reassembled are kept apart from it.
+ *
+ * Like PacketRouter, the sequencer can be connected to a virtual channel as its packet sink. Packets from any other
+ * source (e.g. a route of a PacketRouter) are passed to SpacePacketSequencer::processPacket.
+ */
+class SpacePacketSequencer : public GroundPacketServer
+{
+//
+// definitions
+//
+public:
+	static const uint16_t sequenceCountModulus = 16384;	/**< The source sequence count has 14 bits. */
+	static const uint16_t recentCounts = 64;			/**< Number of counts per APID remembered to tell late packets from duplicates. */
+
+//
+// methods
+//
+public:
+
+/*! \brief Constructor of the SpacePacketSequencer class.
+ *	\param conf Network protocol configuration, used for the debug output.
+ *	\param bufferSize Maximum number of application data units waiting in the output queue.
+ */
+	SpacePacketSequencer(NetProtConf *conf, size_t bufferSize = 1000);
+
+/*! \brief Follows the sequence count of a packet and reassembles it into an application data unit.
+ *	\param packet A complete Space Packet with its timestamp.
+ *	\return The classification of the sequence count. Packets shorter than a header with one Byte of data are
+ *	dropped, counted as malformed and returned as TmSequenceTracker::malformed.
+ */
+	virtual TmSequenceTracker::SequenceStatus processPacket(const TimeTaggedPacket &packet);
+
+/*! \brief Takes all packets from the input queue of the virtual channel and processes them.
+ *
+ *	\note may throw GroundPacketServerError if:
+ *	- No virtual channel was specified.
+ *	- There were any virtual channel errors.
+ */
+	virtual void signalNewPacket();
+
+/*! \brief Indicates whether an application data unit is waiting in the output queue. */
+	virtual bool aduAvailable();
+
+/*! \brief Takes the oldest application data unit from the output queue.
+ *
+ * \note May throw GroundPacketServerError if the queue is empty.
+ */
+	virtual ApplicationDataUnit receiveAdu();
+
+/*! \brief Forgets the sequence count, the statistics and the segments of all APIDs. */
+	virtual void reset();
+
+/*! \brief Retrieves the source sequence count expected next for an APID. */
+	virtual uint16_t getExpectedCount(uint16_t apid);
+
+/*! \brief Retrieves the number of packets accepted for an APID (duplicates excluded). */
+	virtual uint64_t getPacketCount(uint16_t apid);
+
+/*! \brief Retrieves the number of packets lost for an APID (skipped counts minus the packets which arrived late). */
+	virtual uint64_t getLostCount(uint16_t apid);
+
+/*! \brief Retrieves the number of duplicate packets dropped for an APID. */
+	virtual uint64_t getDuplicateCount(uint16_t apid);
+
+/*! \brief Retrieves the number of packets which arrived out of order for an APID. */
+	virtual uint64_t getOutOfOrderCount(uint16_t apid);
+
+/*! \brief Retrieves the number of segmented units discarded for an APID because of a missing segment. */
+	virtual uint64_t getIncompleteCount(uint16_t apid);
+
+/*! \brief Retrieves the number of segments dropped for an APID because they arrived late. */
+	virtual uint64_t getLateSegmentCount(uint16_t apid);
+
+/*! \brief Retrieves the number of packets dropped because they were too short to be Space Packets with data. */
+	virtual uint64_t getMalformedCount();
+
+/*! \brief Retrieves the number of application data units dropped because the output queue was full. */
+	virtual uint64_t getOverflowCount();
+
+protected:
+/*! \brief Adds a packet to the segmented unit being reassembled for its APID, or turns it into a unit of its own. */
+	virtual void reassemble(const TimeTaggedPacket &packet, uint16_t apid, uint16_t groupingFlags, bool inSequence);
+
+/*! \brief Turns a late unsegmented packet into a unit of its own and drops a late segment, without touching the
+ * segmented unit being reassembled for its APID.
+ */
+	virtual void processLatePacket(const TimeTaggedPacket &packet, uint16_t apid, uint16_t groupingFlags);
+
+/*! \brief Places an application data unit in the output queue. */
+	virtual void queueAdu(ApplicationDataUnit &adu);
+
+//
+// variables
+//
+protected:
+	/*! \brief Sequence state of an APID. */
+	struct ApidState {
+		uint64_t receivedMask;		/**< Bit i is set if the count i+1 before the expected one was received. */
+		uint64_t packetCount;		/**< Number of packets accepted. */
+		uint64_t lostCount;			/**< Number of packets lost. */
+		uint64_t duplicateCount;	/**< Number of duplicates. */
+		uint64_t outOfOrderCount;	/**< Number of late packets. */
+		uint64_t incompleteCount;	/**< Number of segmented units discarded. */
+		uint64_t lateSegmentCount;	/**< Number of late segments dropped. */
+		uint16_t expectedCount;		/**< Source sequence count expected next. */
+		bool synchronised;			/**< Indicates whether a first count has been received. */
+		bool segmenting;			/**< Indicates whether a segmented unit is being reassembled. */
+	};
+
+	vector<ApidState> apidStates;				/*!< Sequence state of each APID. */
+	vector<ApplicationDataUnit> segmentedUnits;	/*!< Segmented unit being reassembled for each APID. */
+	queue<ApplicationDataUnit> aduFifo;			/*!< Output queue of complete application data units. */
+	size_t aduBufferSize;						/*!< Maximum number of units in the output queue. */
+	uint64_t overflowCount;						/*!< Number of units dropped because the output queue was full. */
+	uint64_t malformedCount;					/*!< Number of packets dropped because they were too short. */
+};
+
+#endif // SpacePacketSequencer_h
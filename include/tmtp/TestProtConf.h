@@ -44,7 +44,15 @@ public:
  * 
  * Extracts the 13 least significant bits of the packet header (which contains the packet length).
  */
-	virtual uint64_t extractPacketLength(vector<uint8_t> header);
+	virtual uint64_t extractPacketLength(const vector<uint8_t> &header);
+
+/*! \brief Counts the idle packets at the beginning of a buffer.
+ * \param data First Byte of the buffer (the start of a packet).
+ * \param length Number of Bytes in the buffer.
+ * 
+ * Idle packets are a single Byte with packet version 000, so the whole run is found at once with NetProtConf::countLeadingVersion().
+ */
+	virtual size_t skipIdlePackets(const uint8_t *data, size_t length);
 
 /*! \brief Retrieves the hardcoded value of variable packetHeaderLength. 
  * \param firstByteOfHeader Supposed to be the first Byte of a packet header, but does absolutely nothing with it.
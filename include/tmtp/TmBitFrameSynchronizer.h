@@ -0,0 +1,98 @@
+#ifndef TmBitFrameSynchronizer_h
+#define TmBitFrameSynchronizer_h
+
+#include "TmFrameSynchronizer.h"
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+/*! \brief Finds the CADUs in a received bit stream which is not aligned to Bytes.
+ *
+ * Works like TmFrameSynchronizer, but the ASM may start at any bit. The stream is still handed over in Bytes, with the
+ * first received bit in the most significant bit of each Byte.
+ *
+ * A position matches if it differs from the ASM in at most the tolerated number of bits (see setAsmErrorTolerance()).
+ * The ASM is correlated at all 8 bit offsets of a Byte at once: 8 Bytes of the stream are loaded into a 64-bit word,
+ * and each of its 8 shifts by 0 to 7 bits yields the 32 bits starting at one bit offset. With SSE2 and up to 3 tolerated
+ * bit errors, 16 Bytes are first realigned to each bit offset and compared with the 4 ASM Bytes: with t bit errors, at
+ * least 4 - t of them match, so only few positions are counted bit by bit. This searches several Gbit/s on one core. \n
+ * The frames are realigned to Bytes with 64-bit shifts of 8 Bytes at a time.
+ *
+ * In the lock and flywheel states, a missing ASM is also looked for up to a few bits before and after its expected
+ * position (see setSlipWindow()). If it is found there, the demodulator slipped bits: the synchronizer follows the new
+ * position without losing the lock.
+ */
+class TmBitFrameSynchronizer : public TmFrameSynchronizer {
+//
+// methods
+//
+public:
+
+/*! \brief Constructor of the TmBitFrameSynchronizer class.
+ *	\param channel The physical channel receiving the frames. It is not deleted by the synchronizer.
+ *
+ * No bit errors are tolerated in the ASM and slips of one bit are followed.
+ * \note May throw TmFrameSynchronizerError if no physical channel is given.
+ */
+	TmBitFrameSynchronizer(TmPhysicalChannel *channel);
+
+/*! \brief Sets the number of bit errors tolerated in the ASM (0 to 8). */
+	virtual void setAsmErrorTolerance(uint16_t bits);
+
+/*! \brief Retrieves the number of bit errors tolerated in the ASM. */
+	virtual uint16_t getAsmErrorTolerance();
+
+/*! \brief Sets the largest bit slip followed in the lock and flywheel states (0 to 7 bits, 0 to switch it off). */
+	virtual void setSlipWindow(uint16_t bits);
+
+/*! \brief Retrieves the largest bit slip followed. */
+	virtual uint16_t getSlipWindow();
+
+/*! \brief Processes the next chunk of the received bit stream.
+ *	\param data The received bits, the first one in the most significant bit of the first Byte.
+ *	\param length Number of received Bytes.
+ *	\param timestamp Receipt time of the first bit of the chunk.
+ *	\param bitrate The bitrate of the stream, to compute the timestamps of the frames.
+ *	\return The warnings of the physical channel for all frames passed on, and the losses of synchronization.
+ *
+ * \note May throw TmFrameSynchronizerError if the physical channel uses variable-length frames.
+ */
+	virtual TmChannelWarning receiveData(const uint8_t *data, size_t length, TmFrameTimestamp timestamp = TmFrameTimestamp(),
+			TmFrameBitrate bitrate = TmFrameBitrate());
+
+/*! \brief Discards the buffered bits and returns to the search. The counters are kept. */
+	virtual void reset();
+
+/*! \brief Retrieves the bit offset of the last ASM found (0 to 7). */
+	virtual uint16_t getBitOffset();
+
+/*! \brief Retrieves the number of bit slips followed. */
+	virtual uint64_t getSlipCount();
+
+protected:
+/*! \brief Searches the buffer for the first ASM from a bit position on.
+ *	\return The bit position of the ASM, or the first position which could not be checked if there is none.
+ */
+	virtual size_t findAsm(size_t bit);
+
+/*! \brief Checks if the ASM (with the tolerated bit errors) starts at a bit position. */
+	virtual bool matchAsm(size_t bit);
+
+/*! \brief Copies Bytes starting at a bit position of the buffer into a frame. */
+	virtual void extractBits(size_t bit, uint8_t *dest, size_t length);
+
+//
+// variables
+//
+protected:
+	uint16_t asmErrorTolerance;		/*!< Bit errors tolerated in the ASM (default = 0). */
+	uint16_t slipWindow;			/*!< Largest bit slip followed (default = 1). */
+	size_t bitOffset;				/*!< Bit offset of the first unprocessed bit in the first Byte of the buffer. */
+	uint16_t asmBitOffset;			/*!< Bit offset of the last ASM found. */
+	uint64_t slipCount;				/*!< Bit slips followed. */
+};
+
+#endif // TmBitFrameSynchronizer_h
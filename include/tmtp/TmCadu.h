@@ -0,0 +1,65 @@
+#ifndef TmCadu_h
+#define TmCadu_h
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+/*! \brief Channel Access Data Units (CADU): the Attached Sync Marker and the pseudo-randomizer (CCSDS 131.0-B).
+ *
+ * On the link, each frame (with the Reed-Solomon check symbols, if used) is preceded by the 4-Byte Attached Sync Marker
+ * 0x1ACFFC1D and XORed with the pseudo-random sequence of the polynomial x^8 + x^7 + x^5 + x^3 + 1 (seed all ones,
+ * period 255 Bytes). The ASM itself is not randomized. Randomizing twice restores the data, so randomize() also
+ * derandomizes.
+ *
+ * The random sequence is computed once when the library is loaded and applied 8 Bytes at a time. \n
+ * The receiving side is implemented by TmFrameSynchronizer, which finds the ASM in a Byte stream.
+ */
+class TmCadu {
+//
+// definitions
+//
+public:
+	static const uint32_t attachedSyncMarker = 0x1ACFFC1D;	/**< The CCSDS Attached Sync Marker. */
+	static const size_t asmLength = 4;						/**< Length of the Attached Sync Marker in Bytes. */
+	static const size_t randomPeriod = 255;				/**< Period of the pseudo-random sequence in Bytes. */
+
+//
+// methods
+//
+public:
+
+/*! \brief XORs a buffer with the pseudo-random sequence, starting with its first Byte. Also derandomizes. */
+	static void randomize(uint8_t *data, size_t length);
+
+/*! \brief Retrieves the first 255 Bytes of the pseudo-random sequence (0xFF, 0x48, 0x0E, 0xC0, ...). */
+	static const uint8_t *getRandomSequence();
+
+/*! \brief Builds a CADU: the ASM followed by the (randomized) frame.
+ *	\param frame The frame as returned by TmPhysicalChannel::sendFrame.
+ *	\param randomized Set to FALSE for links without pseudo-randomization.
+ */
+	static vector<uint8_t> wrap(const vector<uint8_t> &frame, bool randomized = true);
+
+/*! \brief Checks and removes the ASM of a CADU and derandomizes the frame.
+ *	\param cadu The CADU. On return, the frame ready for TmPhysicalChannel::receiveFrame.
+ *	\param randomized Set to FALSE for links without pseudo-randomization.
+ *	\return FALSE (and the CADU is left untouched) if it does not start with the ASM.
+ */
+	static bool unwrap(vector<uint8_t> &cadu, bool randomized = true);
+
+/*! \brief Checks if a buffer holds the ASM at its beginning. At least asmLength Bytes have to be readable. */
+	static bool isAsm(const uint8_t *data);
+
+/*! \brief Searches a buffer for the first ASM.
+ *	\return The position of the first ASM, or length if there is none.
+ *
+ * Compares 16 positions at once with SSE2: the buffer is loaded at four consecutive offsets and each load is compared to
+ * one Byte of the ASM, so one AND of the four results marks the positions of complete ASMs.
+ */
+	static size_t findAsm(const uint8_t *data, size_t length);
+};
+
+#endif // TmCadu_h
@@ -0,0 +1,57 @@
+#ifndef TmConvolutionalEncoder_h
+#define TmConvolutionalEncoder_h
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+/*! \brief CCSDS rate 1/2, constraint length 7 convolutional encoder (CCSDS 131.0-B).
+ *
+ * Each data bit yields two channel symbols, from the generator polynomials G1 = 171 (octal) and G2 = 133 (octal); the
+ * G2 symbol is inverted by default, as the standard requires. The shift register is kept between calls, so a stream
+ * can be encoded in pieces of any size. \n
+ * The received symbols are decoded by TmViterbiDecoder.
+ */
+class TmConvolutionalEncoder {
+//
+// definitions
+//
+public:
+	static const uint8_t polynomialG1 = 0x4F;		/**< G1 = 171 (octal), bit 0 applied to the newest bit. */
+	static const uint8_t polynomialG2 = 0x6D;		/**< G2 = 133 (octal), bit 0 applied to the newest bit. */
+
+//
+// methods
+//
+public:
+
+/*! \brief Constructor of the TmConvolutionalEncoder class. The shift register is cleared and the G2 symbol is inverted. */
+	TmConvolutionalEncoder();
+
+/*! \brief Sets the inversion flag of the G2 symbol (TRUE for CCSDS). */
+	virtual void setInvertSecondSymbol(bool invert);
+
+/*! \brief Retrieves the inversion flag of the G2 symbol. */
+	virtual bool getInvertSecondSymbol();
+
+/*! \brief Clears the shift register. */
+	virtual void reset();
+
+/*! \brief Encodes data Bytes.
+ *	\param data The data, first bit in the most significant bit of the first Byte.
+ *	\param length Number of data Bytes.
+ *	\param symbols Receives the channel symbols, 2 Bytes per data Byte, first symbol in the most significant bit.
+ */
+	virtual void encode(const uint8_t *data, size_t length, vector<uint8_t> &symbols);
+
+//
+// variables
+//
+protected:
+	bool invertSecondSymbol;	/*!< Inversion flag of the G2 symbol (default = TRUE). */
+	uint8_t shiftRegister;		/*!< The last 7 data bits, the newest in bit 0. */
+};
+
+#endif // TmConvolutionalEncoder_h
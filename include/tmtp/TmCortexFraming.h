@@ -0,0 +1,118 @@
+#ifndef TmCortexFraming_h
+#define TmCortexFraming_h
+
+#include "myErrors.h"
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+/*! \brief Framing of transfer frames in the TCP messages of Cortex-style baseband units.
+ *
+ * Each message carries one frame:
+ *	- Bytes 0-3: the start flag 1234567890 (0x499602D2).
+ *	- Bytes 4-7: the total message length, header and end flag included.
+ *	- Bytes 8-11: the flow ID.
+ *	- A frame header of a configurable length (see the constructor). Its layout depends on the configuration of the
+ *	  unit; it is skipped on reception and sent as zeros.
+ *	- The frame.
+ *	- The last 4 Bytes: the end flag -1234567890 (0xB669FD2E).
+ *
+ * All fields are 32-bit big endian words. Messages are parsed in place (see parseMessage()), so the frame is passed to
+ * the physical channel right from the receive buffer. TmFrameIngestServer::listenCortexTcp() receives them.
+ *
+ * A framing object is only read while receiving, so one object can serve any number of connections.
+ */
+class TmCortexFraming {
+//
+// definitions
+//
+public:
+	static const uint32_t startFlag = 1234567890;		/**< First word of each message. */
+	static const uint32_t endFlag = 0xB669FD2E;		/**< Last word of each message (-1234567890). */
+	static const size_t headerLength = 12;				/**< Start flag, message length and flow ID. */
+	static const size_t postambleLength = 4;			/**< End flag. */
+	static const size_t maxFrameHeaderLength = 1024;	/**< Longest frame header. */
+	static const size_t maxFrameLength = 65535;			/**< Longest frame. */
+	static const size_t maxMessageLength = headerLength + maxFrameHeaderLength + maxFrameLength + postambleLength;	/**< Longest message. */
+
+	/*! \brief A message parsed in place. */
+	struct Message {
+		uint32_t flowId;			/**< Flow ID of the message. */
+		const uint8_t *frame;		/**< First Byte of the frame (in the parsed buffer). */
+		size_t frameLength;			/**< Frame length. */
+	};
+
+//
+// methods
+//
+public:
+
+/*! \brief Constructor of the TmCortexFraming class. Messages of all flows are accepted.
+ *	\param frameHeaderLength Length of the frame header between the message header and the frame (at most 1024).
+ *
+ * \note May throw TmCortexFramingError if the frame header is too long.
+ */
+	TmCortexFraming(size_t frameHeaderLength = 0);
+
+/*! \brief Destructor of the TmCortexFraming class. */
+	virtual ~TmCortexFraming();
+
+/*! \brief Retrieves the length of the frame header. */
+	virtual size_t getFrameHeaderLength();
+
+/*! \brief Sets the flow ID of the messages built by wrapFrame(). */
+	virtual void setFlowId(uint32_t flowId);
+
+/*! \brief Retrieves the flow ID of the messages built by wrapFrame(). */
+	virtual uint32_t getFlowId();
+
+/*! \brief Selects whether only messages with the flow ID of setFlowId() are accepted (see acceptsFlow()). */
+	virtual void setFlowFilter(bool active);
+
+/*! \brief Checks if the frames of a flow are passed on. */
+	virtual bool acceptsFlow(uint32_t flowId);
+
+/*! \brief Builds the message of a frame.
+ *
+ * \note May throw TmCortexFramingError if the frame is longer than 65535 Bytes.
+ */
+	virtual vector<uint8_t> wrapFrame(const vector<uint8_t> &frame);
+
+/*! \brief Parses a message in place.
+ *	\param data First Byte of the message.
+ *	\param length Number of Bytes available.
+ *	\param message Set to the flow ID and the frame of the message if it is complete.
+ *	\return The message length if the message is complete, zero if more Bytes are needed.
+ *
+ * \note May throw TmCortexFramingError if a flag is missing or the message length is invalid.
+ */
+	virtual size_t parseMessage(const uint8_t *data, size_t length, Message &message);
+
+/*! \brief Reads a 32-bit big endian word. */
+	static inline uint32_t loadWord(const uint8_t *data)
+	{
+		return ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) | ((uint32_t) data[2] << 8) | (uint32_t) data[3];
+	}
+
+/*! \brief Writes a 32-bit big endian word. */
+	static inline void storeWord(uint8_t *data, uint32_t word)
+	{
+		data[0] = (uint8_t) (word >> 24);
+		data[1] = (uint8_t) (word >> 16);
+		data[2] = (uint8_t) (word >> 8);
+		data[3] = (uint8_t) word;
+	}
+
+//
+// variables
+//
+protected:
+	size_t frameHeaderLength;		/*!< Length of the frame header. */
+	uint32_t flowId;				/*!< Flow ID of the built messages and of the filter. */
+	bool flowFilter;				/*!< Indicates whether only the flow ID is accepted. */
+};
+
+#endif // TmCortexFraming_h
@@ -0,0 +1,32 @@
+#ifndef TmCrc16_h
+#define TmCrc16_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+/*! \brief The CCSDS CRC-16: generator polynomial x^16 + x^12 + x^5 + 1, Shift Register initialized to all ones.
+ *
+ * It is the Frame Error Control Field of TM Transfer Frames (see TmTransferFrame::crc()) and the CRC Packet Error
+ * Control of Space Packets (see SpacePacketConf::crc16()). The CRC over a message followed by its own CRC is zero. \n
+ * The lookup table of the Shift Register contribution of each Byte is computed once when the library is loaded.
+ */
+class TmCrc16 {
+//
+// definitions
+//
+public:
+	static const uint16_t polynomial = 0x1021;		/**< Generator polynomial without the x^16 term. */
+	static const uint16_t initialValue = 0xFFFF;	/**< Initial value of the Shift Register. */
+
+//
+// methods
+//
+public:
+
+/*! \brief Computes the CRC of a buffer, one Byte at a time. */
+	static uint16_t compute(const uint8_t *data, size_t length);
+};
+
+#endif // TmCrc16_h
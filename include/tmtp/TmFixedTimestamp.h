@@ -0,0 +1,80 @@
+#ifndef TmFixedTimestamp_h
+#define TmFixedTimestamp_h
+
+#include "TmFrameTimestamp.h"
+#include <stdint.h>
+
+using namespace std;
+
+/*! \brief Fixed-point timestamp: integer seconds plus fractions of a second in units of 2^-32 seconds.
+ *
+ * Used to compute packet timestamps from a frame timestamp without floating point arithmetic. \n
+ * The duration of one Byte at a given bitrate is computed once per frame with TmFixedTimestamp::byteScale.
+ * Afterwards, the timestamp of any Byte within the frame is a single multiply-add (see TmFixedTimestamp::addBytes).
+ *
+ * A fraction of 2^-32 seconds (about 0.23 ns) is exactly representable as a double, so the conversion
+ * from and to TmFrameTimestamp does not lose any precision.
+ */
+class TmFixedTimestamp {
+//
+// definitions
+//
+public:
+	static const uint16_t scaleFractionBits = 8;	/**< Additional fractional bits of the Byte duration, to keep the rounding error per Byte small. */
+
+//
+// methods
+//
+public:
+
+/*! \brief Default constructor. Creates an empty (invalid) timestamp. */
+	TmFixedTimestamp();
+
+/*! \brief Constructor of the TmFixedTimestamp class.
+ *	\param secs Seconds since Epoch.
+ *	\param fracs Fractions of a second in units of 2^-32 seconds.
+ */
+	TmFixedTimestamp(uint64_t secs, uint32_t fracs);
+
+/*! \brief Converts a TmFrameTimestamp. The fractions are rounded down to the next 2^-32 seconds. */
+	explicit TmFixedTimestamp(TmFrameTimestamp timestamp);
+
+/*! \brief Computes the duration of one Byte at a given bitrate.
+ *	\param bitrate The bitrate in bits per second.
+ *	\return The duration of one Byte in units of 2^-(32+scaleFractionBits) seconds, or zero if the bitrate is not positive.
+ */
+	static uint64_t byteScale(double bitrate);
+
+/*! \brief Advances the timestamp by the duration of a number of Bytes.
+ *	\param bytes Number of Bytes.
+ *	\param scale Duration of one Byte as returned by TmFixedTimestamp::byteScale.
+ */
+	virtual void addBytes(uint64_t bytes, uint64_t scale);
+
+/*! \brief Advances the timestamp by a duration in units of 2^-32 seconds. */
+	virtual void addFractions(uint64_t fracs);
+
+/*! \brief Converts the timestamp into a TmFrameTimestamp. Never throws, since the fractions are always smaller than 1. */
+	virtual TmFrameTimestamp toTimestamp();
+
+/*! \brief Retrieves the seconds part of the timestamp. */
+	virtual uint64_t getSeconds();
+
+/*! \brief Retrieves the fractions of a second in units of 2^-32 seconds. */
+	virtual uint32_t getFractions();
+
+/*! \brief Retrieves the fractions of a second in nanoseconds (rounded down). */
+	virtual uint32_t getNanoseconds();
+
+/*! \brief Returns FALSE if the seconds are zero, like TmFrameTimestamp::isValid. */
+	virtual bool isValid();
+
+//
+// variables
+//
+protected:
+	uint64_t seconds;		/*!< Seconds since Epoch. */
+	uint32_t fractions;		/*!< Fractions of a second in units of 2^-32 seconds. */
+};
+
+#endif // TmFixedTimestamp_h
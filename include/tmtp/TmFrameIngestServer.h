@@ -0,0 +1,229 @@
+#ifndef TmFrameIngestServer_h
+#define TmFrameIngestServer_h
+
+#include "myErrors.h"
+#include "TmFrameTimestamp.h"
+#include "TmFrameBitrate.h"
+
+#include <vector>
+#include <map>
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+
+using namespace std;
+
+class TmPhysicalChannel;	// Uses the TmPhysicalChannel class.
+class TmCortexFraming;		// Uses the TmCortexFraming class.
+
+/*! \brief Server receiving transfer frames over TCP and UDP and passing them to physical channels (Boost.Asio).
+ *
+ * Each listener (see listenTcp() and listenUdp()) feeds one physical channel. A TCP listener accepts any number of
+ * connections; a UDP listener receives datagrams from any number of senders. All sockets are served asynchronously
+ * by a pool of worker threads (see start()).
+ *
+ * Frames are sent as records: a 20-Byte header followed by the frame.
+ *	- Bytes 0-1: the record marker 0x54 0x4D ("TM").
+ *	- Bytes 2-3: the frame length.
+ *	- Bytes 4-11: the seconds of the receipt timestamp (0: no timestamp).
+ *	- Bytes 12-15: the fractions of the timestamp in units of 2^-32 seconds.
+ *	- Bytes 16-19: the bitrate in bit/s (0: unknown).
+ *
+ * All fields are big endian. A TCP connection carries a stream of records; a UDP datagram carries one or more whole
+ * records. wrapFrame() builds a record for a sender. \n
+ * The records are parsed in place in the receive buffer of each socket. If the marker is missing, the TCP stream is
+ * searched for the next marker and the rest of a datagram is dropped; both count as framing errors. \n
+ * A TCP listener can take the messages of Cortex-style baseband units instead (see listenCortexTcp()).
+ *
+ * All complete records of a read are parsed first and then passed to the physical channel in batches, taking the
+ * lock of the channel once per batch.
+ *
+ * The frames of one connection are passed on in order. Several connections may feed the same physical channel: the
+ * calls of receiveFrame() are serialized per physical channel, so the channel and everything behind it (master and
+ * virtual channels, their callbacks) is only used by one worker thread at a time. Other threads must not use the
+ * physical channels while the server runs.
+ *
+ * The warnings of the physical channels are collected until popWarnings() is called; call it regularly. The traffic
+ * of each connection is counted (see getConnectionMetrics()).
+ */
+class TmFrameIngestServer {
+//
+// definitions
+//
+public:
+	static const size_t recordHeaderLength = 20;		/**< Length of the record header. */
+	static const uint8_t recordMarker[2];				/**< First two Bytes of each record ("TM"). */
+	static const size_t maxRecordLength = 65535 + 20;	/**< Longest record (frame of 65535 Bytes). */
+	static const size_t defaultThreadCount = 2;		/**< Default number of worker threads. */
+
+	enum Transport {
+		tcpTransport = 0,				/**< Transport of a TCP connection. */
+		udpTransport = 1				/**< Transport of the datagrams of a UDP sender. */
+	};
+
+	/*! \brief The traffic counters of a TCP connection or of a UDP sender. */
+	struct ConnectionMetrics {
+		Transport transport;			/**< TCP or UDP. */
+		string remoteEndpoint;			/**< Address and port of the peer. */
+		uint16_t localPort;				/**< Port of the listener. */
+		bool open;						/**< FALSE once a TCP connection is closed. */
+		uint64_t byteCount;				/**< Bytes received. */
+		uint64_t frameCount;			/**< Frames passed to the physical channel. */
+		uint64_t framingErrorCount;		/**< Missing record markers and invalid datagrams. */
+		uint64_t warningCount;			/**< Frames for which the physical channel reported warnings. */
+	};
+
+//
+// methods
+//
+public:
+
+/*! \brief Constructor of the TmFrameIngestServer class.
+ *	\param threadCount Number of worker threads started by start() (at least 1).
+ */
+	TmFrameIngestServer(size_t threadCount = defaultThreadCount);
+
+/*! \brief Destructor of the TmFrameIngestServer class. Stops the worker threads and closes all sockets. */
+	virtual ~TmFrameIngestServer();
+
+/*! \brief Opens a TCP listener feeding a physical channel.
+ *	\param port The port to listen on, 0 for any free port.
+ *	\param channel The physical channel receiving the frames (not owned).
+ *	\param address The local address to bind to.
+ *	\return The port the listener is bound to.
+ *
+ * \note May throw TmFrameIngestServerError if the socket cannot be opened.
+ */
+	virtual uint16_t listenTcp(uint16_t port, TmPhysicalChannel *channel, string address = "0.0.0.0");
+
+/*! \brief Opens a TCP listener receiving Cortex messages (see TmCortexFraming) and feeding a physical channel.
+ *	\param port The port to listen on, 0 for any free port.
+ *	\param channel The physical channel receiving the frames (not owned).
+ *	\param framing The framing of the messages, e.g. the frame header length and the flow filter (not owned, NULL for the defaults).
+ *	\param address The local address to bind to.
+ *	\return The port the listener is bound to.
+ *
+ * A missing start or end flag counts as a framing error, and the stream is searched for the next start flag. Messages
+ * of flows the framing does not accept are skipped.
+ * \note May throw TmFrameIngestServerError if the socket cannot be opened.
+ */
+	virtual uint16_t listenCortexTcp(uint16_t port, TmPhysicalChannel *channel, TmCortexFraming *framing = NULL,
+			string address = "0.0.0.0");
+
+/*! \brief Opens a UDP listener feeding a physical channel.
+ *	\param port The port to listen on, 0 for any free port.
+ *	\param channel The physical channel receiving the frames (not owned).
+ *	\param address The local address to bind to.
+ *	\return The port the listener is bound to.
+ *
+ * \note May throw TmFrameIngestServerError if the socket cannot be opened.
+ */
+	virtual uint16_t listenUdp(uint16_t port, TmPhysicalChannel *channel, string address = "0.0.0.0");
+
+/*! \brief Starts the worker threads. Does nothing if they already run. */
+	virtual void start();
+
+/*! \brief Stops the worker threads. The sockets stay open; start() resumes receiving. */
+	virtual void stop();
+
+/*! \brief Indicates whether the worker threads run. */
+	virtual bool isRunning();
+
+/*! \brief Retrieves a copy of the counters of all connections and UDP senders seen so far. */
+	virtual vector<ConnectionMetrics> getConnectionMetrics();
+
+/*! \brief Retrieves the warnings collected since the last call and clears them. */
+	virtual TmChannelWarning popWarnings();
+
+/*! \brief Builds the record of a frame, to be sent to the server.
+ *
+ * \note May throw TmFrameIngestServerError if the frame is longer than 65535 Bytes.
+ */
+	static vector<uint8_t> wrapFrame(const vector<uint8_t> &frame, TmFrameTimestamp timestamp = TmFrameTimestamp(),
+			TmFrameBitrate bitrate = TmFrameBitrate());
+
+/*! \brief Parses a record in place.
+ *	\param data First Byte of the record.
+ *	\param length Number of Bytes available.
+ *	\param timestamp Set to the timestamp of the frame if the record is complete.
+ *	\param bitrate Set to the bitrate of the frame if the record is complete.
+ *	\return The record length if the record is complete, zero if more Bytes are needed.
+ *
+ * \note May throw TmFrameIngestServerError if the record marker is missing.
+ */
+	static size_t parseRecord(const uint8_t *data, size_t length, TmFrameTimestamp &timestamp, TmFrameBitrate &bitrate);
+
+protected:
+	static const size_t frameBatchLength = 64;		/**< Most frames passed to a physical channel under one lock. */
+
+	/*! \brief A frame found in a receive buffer. */
+	struct FrameReference {
+		const uint8_t *frame;			/**< First Byte of the frame (in the receive buffer). */
+		size_t length;					/**< Frame length. */
+		TmFrameTimestamp timestamp;		/**< Timestamp of the frame. */
+		TmFrameBitrate bitrate;			/**< Bitrate of the frame. */
+	};
+
+	class TcpListener;	// Accepts the TCP connections of a port (defined in TmFrameIngestServer.cpp).
+	class TcpSession;	// Receives the records of a TCP connection (defined in TmFrameIngestServer.cpp).
+	class UdpListener;	// Receives the datagrams of a port (defined in TmFrameIngestServer.cpp).
+	friend class TcpListener;
+	friend class TcpSession;
+	friend class UdpListener;
+
+/*! \brief Adds the counters of a new connection and returns their index. */
+	virtual size_t addConnection(Transport transport, string remoteEndpoint, uint16_t localPort);
+
+/*! \brief Opens a TCP listener of records (cortex NULL) or of Cortex messages. */
+	virtual uint16_t openTcpListener(uint16_t port, TmPhysicalChannel *channel, TmCortexFraming *cortex, string address);
+
+/*! \brief Passes the complete records of a buffer to a physical channel.
+ *	\param data The received Bytes.
+ *	\param length Number of received Bytes.
+ *	\param channel The physical channel of the listener.
+ *	\param cortex The framing of a Cortex listener, NULL for records.
+ *	\param connection Index of the counters of the connection.
+ *	\param datagram TRUE for a datagram (whole records only), FALSE for a stream.
+ *	\param received Number of Bytes received by the read, added to the counters of the connection.
+ *	\return The number of Bytes consumed; a stream keeps the rest for the next read.
+ */
+	virtual size_t processRecords(const uint8_t *data, size_t length, TmPhysicalChannel *channel, TmCortexFraming *cortex,
+			size_t connection, bool datagram, size_t received);
+
+/*! \brief Passes a batch of frames to a physical channel, holding its lock once.
+ *	\param frames The frames.
+ *	\param count Number of frames.
+ *	\param channel The physical channel.
+ *	\param collected Collects the warnings of the physical channel.
+ *	\return The number of frames for which the physical channel reported warnings.
+ */
+	virtual uint64_t deliverFrames(FrameReference *frames, size_t count, TmPhysicalChannel *channel,
+			TmChannelWarning &collected);
+
+/*! \brief Retrieves the mutex serializing the calls of a physical channel. */
+	virtual boost::mutex *getChannelMutex(TmPhysicalChannel *channel);
+
+//
+// variables
+//
+protected:
+	boost::asio::io_context ioContext;		/*!< Runs the handlers of all sockets. */
+	boost::shared_ptr<boost::asio::executor_work_guard<boost::asio::io_context::executor_type> > workGuard;	/*!< Keeps the worker threads running while idle. */
+	boost::thread_group threads;			/*!< The worker threads. */
+	size_t threadCount;						/*!< Number of worker threads. */
+	bool running;							/*!< Indicates whether the worker threads run. */
+
+	vector<boost::shared_ptr<TcpListener> > tcpListeners;	/*!< The TCP listeners. */
+	vector<boost::shared_ptr<UdpListener> > udpListeners;	/*!< The UDP listeners. */
+	map<TmPhysicalChannel *, boost::shared_ptr<boost::mutex> > channelMutexes;	/*!< Serializes the calls of each physical channel. */
+	TmCortexFraming *defaultCortexFraming;	/*!< Framing of the Cortex listeners opened without one (owned). */
+
+	boost::mutex mutex;						/*!< Protects the counters, the warnings and the channel mutexes. */
+	vector<ConnectionMetrics> metrics;		/*!< Counters of each connection. */
+	TmChannelWarning warnings;				/*!< Warnings collected from the physical channels. */
+};
+
+#endif // TmFrameIngestServer_h
@@ -0,0 +1,83 @@
+#ifndef TmFrameLayout_h
+#define TmFrameLayout_h
+
+#include <stdint.h>
+
+using namespace std;
+
+/*! \brief Precomputed positions and lengths of the fields of a TM Transfer Frame.
+ *
+ * The layout of a frame only depends on the total frame length and on which optional fields are present
+ * (Secondary Header, Operational Control Field and Frame Error Control Field). \n
+ * Since these settings are fixed for a given channel configuration, all offsets are computed once when the
+ * layout is created. Afterwards, retrieving the Data Field start, end or length is a plain load.
+ *
+ * A layout is immutable. If the configuration changes, a new layout has to be created.
+ */
+class TmFrameLayout {
+//
+// definitions
+//
+public:
+	static const uint16_t primaryHeaderLength = 6;		/**< 6-Byte Primary Header.*/
+	static const uint16_t fecfLength = 2;				/**< Frame Error Control Field (optional) is 2 Bytes long.*/
+	static const uint16_t maxSecondHeaderLength = 64;	/**< The Secondary Header (including its ID) is at most 64 Bytes long.*/
+
+//
+// methods
+//
+public:
+
+/*! \brief Default constructor. Creates the layout of a minimum size frame (7 Bytes) without any optional fields. */
+	TmFrameLayout();
+
+/*! \brief Constructor of the TmFrameLayout class.
+ *	\param length The length of the whole TM Transfer Frame in Bytes.
+ *	\param secondHeaderLength The length of the Secondary Header (ID + Data Field) in Bytes, or zero if there is no Secondary Header.
+ *	\param ocf TRUE if the Operational Control Field is present.
+ *	\param fecf TRUE if the Frame Error Control Field is present.
+ *
+ * Computes the start, end and length of the TM Data Field as well as the maximum Secondary Header length. \n
+ * If the optional fields do not fit in the frame, the Data Field length is zero.
+ */
+	TmFrameLayout(uint16_t length, uint16_t secondHeaderLength, bool ocf, bool fecf);
+
+/*! \brief Retrieves the length of the whole TM Transfer Frame. */
+	uint16_t getFrameLength() const { return frameLength; }
+
+/*! \brief Retrieves the length of the Secondary Header (ID + Data Field), zero if not present. */
+	uint16_t getSecondHeaderLength() const { return secondHeaderLength; }
+
+/*! \brief Retrieves the position (in Bytes) where the TM Data Field starts. */
+	uint16_t getDataFieldStart() const { return dataFieldStart; }
+
+/*! \brief Retrieves the position (in Bytes) where the TM Data Field ends (i.e. where the trailer starts). */
+	uint16_t getDataFieldEnd() const { return dataFieldEnd; }
+
+/*! \brief Retrieves the TM Data Field length. Zero if the frame is too short for the configured fields. */
+	uint16_t getDataFieldLength() const { return dataFieldLength; }
+
+/*! \brief Retrieves the maximum Secondary Header length that still leaves one Byte for the TM Data Field (at most 64). */
+	uint16_t getMaxSecondHeaderLength() const { return maxSecondHeader; }
+
+/*! \brief Retrieves the value of the Operational Control Field flag the layout was computed for. */
+	bool getOcfStatus() const { return ocfPresent; }
+
+/*! \brief Retrieves the value of the Frame Error Control Field flag the layout was computed for. */
+	bool getFecfStatus() const { return fecfPresent; }
+
+//
+// variables
+//
+protected:
+	uint16_t frameLength;			/*!< Total frame length in Bytes. */
+	uint16_t secondHeaderLength;	/*!< Secondary Header length (ID + Data Field) in Bytes, zero if not present. */
+	uint16_t dataFieldStart;		/*!< Position of the first Byte of the TM Data Field. */
+	uint16_t dataFieldEnd;			/*!< Position of the first Byte after the TM Data Field. */
+	uint16_t dataFieldLength;		/*!< Length of the TM Data Field in Bytes. */
+	uint16_t maxSecondHeader;		/*!< Maximum Secondary Header length for this frame length and trailer. */
+	bool ocfPresent;				/*!< Operational Control Field flag. */
+	bool fecfPresent;				/*!< Frame Error Control Field flag. */
+};
+
+#endif // TmFrameLayout_h
@@ -0,0 +1,147 @@
+#ifndef TmFrameSynchronizer_h
+#define TmFrameSynchronizer_h
+
+#include "myErrors.h"
+#include "TmFrameTimestamp.h"
+#include "TmFrameBitrate.h"
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+class TmPhysicalChannel;	// Uses the TmPhysicalChannel class.
+
+/*! \brief Finds the CADUs in a received Byte stream and passes their frames to a physical channel.
+ *
+ * The stream is handed over in chunks of any size (see receiveData()); a CADU may span several chunks. The synchronizer
+ * runs the usual state machine:
+ *	- Search: the stream is scanned for the ASM (see TmCadu::findAsm()). Bytes before it are discarded.
+ *	- Check: the ASM has to be found again at the start of the next checkThreshold CADUs, since the first ASM may have
+ *	  been a pattern in the data. The frame of the CADU completing the check is already passed on; those before it
+ *	  are discarded, i.e. the first CADU only with the default threshold of 1. A missing ASM returns to the search.
+ *	- Lock: each frame is derandomized and passed to TmPhysicalChannel::receiveFrame().
+ *	- Flywheel: the ASM was missing, but the frames are still taken from their expected positions. The ASM found again
+ *	  returns to the lock; more than flywheelThreshold missing ASMs in a row return to the search, one Byte after the
+ *	  last expected ASM.
+ *
+ * The CADU length is the codeblock length of the physical channel (its frame length plus the Reed-Solomon check
+ * symbols, see TmPhysicalChannel::getCodeblockLength()) plus the 4-Byte ASM, so frames have to be of fixed length. \n
+ * The timestamp of each frame is computed from the timestamp of the chunk and the bitrate, for the first Byte after
+ * the ASM. A frame gets an invalid timestamp (see TmFrameTimestamp::isValid()) if the chunk has no valid timestamp or
+ * bitrate, or if its time would fall before the first second of the epoch.
+ */
+class TmFrameSynchronizer {
+//
+// definitions
+//
+public:
+	/*! \brief States of the synchronizer. */
+	enum SyncState {
+		searchState,		/**< Searching the ASM. */
+		checkState,			/**< Confirming the ASM found. */
+		lockState,			/**< Synchronized. */
+		flywheelState		/**< Synchronized, but the last ASM was missing. */
+	};
+
+//
+// methods
+//
+public:
+
+/*! \brief Constructor of the TmFrameSynchronizer class.
+ *	\param channel The physical channel receiving the frames. It is not deleted by the synchronizer.
+ *
+ * Derandomization is active, the check threshold is 1 and the flywheel threshold is 3.
+ * \note May throw TmFrameSynchronizerError if no physical channel is given.
+ */
+	TmFrameSynchronizer(TmPhysicalChannel *channel);
+
+/*! \brief Sets the derandomization flag to TRUE: the frames were randomized by the sender (default). */
+	virtual void activateDerandomization();
+
+/*! \brief Sets the derandomization flag to FALSE. */
+	virtual void deactivateDerandomization();
+
+/*! \brief Retrieves the value of the derandomization flag. */
+	virtual bool getDerandomizationStatus();
+
+/*! \brief Sets the number of CADUs which have to start with the ASM before the frames are passed on (0 to lock at once). */
+	virtual void setCheckThreshold(uint16_t count);
+
+/*! \brief Retrieves the check threshold. */
+	virtual uint16_t getCheckThreshold();
+
+/*! \brief Sets the number of missing ASMs in a row which are bridged before returning to the search. */
+	virtual void setFlywheelThreshold(uint16_t count);
+
+/*! \brief Retrieves the flywheel threshold. */
+	virtual uint16_t getFlywheelThreshold();
+
+/*! \brief Retrieves the state of the synchronizer. */
+	virtual SyncState getState();
+
+/*! \brief Processes the next chunk of the received Byte stream.
+ *	\param data The received Bytes.
+ *	\param length Number of received Bytes.
+ *	\param timestamp Receipt time of the first Byte of the chunk.
+ *	\param bitrate The bitrate of the stream, to compute the timestamps of the frames.
+ *	\return The warnings of the physical channel for all frames passed on, and the losses of synchronization.
+ *
+ * All complete CADUs are processed; the remaining Bytes are kept for the next chunk.
+ * \note May throw TmFrameSynchronizerError if the physical channel uses variable-length frames.
+ */
+	virtual TmChannelWarning receiveData(const uint8_t *data, size_t length, TmFrameTimestamp timestamp = TmFrameTimestamp(),
+			TmFrameBitrate bitrate = TmFrameBitrate());
+
+/*! \brief Discards the buffered Bytes and returns to the search. The counters are kept. */
+	virtual void reset();
+
+/*! \brief Retrieves the number of frames passed to the physical channel. */
+	virtual uint64_t getFrameCount();
+
+/*! \brief Retrieves the number of frames passed on in the flywheel state, i.e. without their ASM. */
+	virtual uint64_t getFlywheelFrameCount();
+
+/*! \brief Retrieves the number of times the synchronization was lost. */
+	virtual uint64_t getLostLockCount();
+
+/*! \brief Retrieves the number of Bytes skipped while searching the ASM. */
+	virtual uint64_t getSkippedByteCount();
+
+protected:
+/*! \brief Advances the state machine by one CADU.
+ *	\param asmFound Indicates whether the CADU starts with the ASM.
+ *	\param warning Receives the message if the synchronization is lost.
+ *	\return FALSE if the synchronizer returned to the search. Otherwise, the frame is passed on unless in the check state.
+ */
+	virtual bool updateState(bool asmFound, TmChannelWarning &warning);
+
+/*! \brief Derandomizes a frame and passes it to the physical channel.
+ *	\param frame The frame with its check symbols, as received.
+ *	\param timestamp Receipt time of the first Byte of the chunk.
+ *	\param bitrate The bitrate of the stream.
+ *	\param bitOffset Number of bits from the start of the chunk to the start of the frame (negative for earlier chunks).
+ */
+	virtual TmChannelWarning deliverFrame(vector<uint8_t> &frame, TmFrameTimestamp timestamp, TmFrameBitrate bitrate,
+			int64_t bitOffset);
+
+//
+// variables
+//
+protected:
+	TmPhysicalChannel *physicalChannel;	/*!< Physical channel receiving the frames (not owned). */
+	bool derandomize;					/*!< Derandomization flag (default = TRUE). */
+	uint16_t checkThreshold;			/*!< CADUs confirmed before the lock (default = 1). */
+	uint16_t flywheelThreshold;			/*!< Missing ASMs bridged (default = 3). */
+	SyncState state;					/*!< State of the synchronizer. */
+	uint16_t stateCount;				/*!< ASMs confirmed in the check state, or missed in the flywheel state. */
+	vector<uint8_t> buffer;				/*!< Received Bytes not processed yet. */
+	uint64_t frameCount;				/*!< Frames passed on. */
+	uint64_t flywheelFrameCount;		/*!< Frames passed on without their ASM. */
+	uint64_t lostLockCount;				/*!< Losses of synchronization. */
+	uint64_t skippedByteCount;			/*!< Bytes skipped while searching. */
+};
+
+#endif // TmFrameSynchronizer_h
@@ -4,6 +4,7 @@
 #include "TmOcf.h"
 #include "myErrors.h"
 #include "TmFrameTimestamp.h"
+#include "TmSequenceTracker.h"
 
 #include <queue>
 #include <vector>
@@ -51,7 +52,7 @@ public:
  * Creates a master channel with the following (default) attributes:
  * 		- ocfPresent = true;
  * 		- sendFrameCount = 0;
- * 		- recFrameCount = 0;
+ * 		- recSequence = TmSequenceTracker(256);
  * 		- secondHeaderPresent = false;
  * 		- extendedVcFrameCountUsed = false;
  * 		- ocfSink = NULL;
@@ -69,7 +70,7 @@ public:
  *		- initialConf = netProtConf = new NetProtConf;
  *		- debugOutput = false;
  *		- sendFrameCount = 0;
- *		- recFrameCount = 0;
+ *		- recSequence = TmSequenceTracker(256);
  *		- recPacketHeaderLength = 0;
  *		- recPacketLength = 0;
  * 
@@ -94,12 +95,21 @@ public:
 /*! \brief Retrieves the received frame counter. */
 	virtual uint16_t getRecFrameCount();
 
+/*! \brief Retrieves the tracker of the received frame counter, which holds the loss, duplicate and out-of-order statistics and the recent gaps. */
+	virtual TmSequenceTracker& getRecSequence();
+
+/*! \brief Retrieves the number of idle frames received (see TmMasterChannel::isIdleFrame). */
+	virtual uint64_t getRecIdleFrameCount();
+
 /*! \brief Retrieves the total frame length as configured in the physical channel. */
 	virtual uint16_t getFrameLength();
 
 /*! \brief Retrieves the FECF flag as configured in the physical channel. */
 	virtual bool getFecfStatus();
 
+/*! \brief Retrieves the variable frame length flag as configured in the physical channel. */
+	virtual bool getVariableFrameLengthStatus();
+
 /*! \brief Sets the OCF Flag to TRUE. */
 	virtual void activateOcf();
 
@@ -148,12 +158,28 @@ public:
  * 
  * Analyzes the contents of the received frame and verifies the following matches the physical channel settings:
  *	- The Spacecraft ID.
- *	- Master Channel Frame Counter (if they don't match, they local MC counter is rectified).
+ *	- Master Channel Frame Counter (see TmSequenceTracker). Lost frames are reported; duplicate and late frames are dropped.
  *	- OCF Flag.
  * Also, the position in the VC vector corresponding to the VC ID received is checked for configuration. \n
  * Lastly, if the input OCF queue has not reached its limit, it extracts the OCF message and puts it in the input queue.
  */
-	virtual TmChannelWarning receiveFrame(TmTransferFrame frame);
+	virtual TmChannelWarning receiveFrame(TmTransferFrame &&frame);
+
+/*! \brief Same as receiveFrame(TmTransferFrame&&) for a frame the caller keeps.
+ *
+ * The frame, including its Data Field, is deep-copied first. A caller passing a frame down by const reference at each
+ * layer pays one copy per layer (see Examples/Allocation_Example.cpp): move the frame in if it is no longer needed, or
+ * pass the raw frame to TmPhysicalChannel::receiveFrame(), which reads it in place.
+ */
+	virtual TmChannelWarning receiveFrame(const TmTransferFrame &frame);
+
+/*! \brief Checks whether a received frame carries only idle data.
+ *	\param frame The received frame; only its headers need to be unwrapped.
+ *
+ * A frame is idle if its First Header Pointer is TmTransferFrame::fhpOnlyIdleData or if it was sent on the idle channel. \n
+ * Idle frames only update the frame counters and deliver their OCF. Their Data Field is neither copied nor scanned for packets.
+ */
+	virtual bool isIdleFrame(TmTransferFrame &frame);
 
 /*! \brief Prepares a frame according to the physical channel settings to be sent over a virtual channel and appends a timestamp.
  *	\param timestamp A Timestamp as specified in the TmFrameTimestamp class.
@@ -223,10 +249,11 @@ protected:
     uint16_t spacecraftId;					/*!< Spacecraft Identifier. */
     bool ocfPresent;								/*!< Operational Control Field Flag. */
     uint16_t sendFrameCount;					/*!< Sent frame counter. */
-    uint16_t recFrameCount;					/*!< Received frame counter. */
+    TmSequenceTracker recSequence;			/*!< Follows the received frame counter (losses, duplicates and late frames). */
     bool secondHeaderPresent;						/*!< Secondary Header Flag. */
 	bool extendedVcFrameCountUsed;					/*!< (Not part of the standard) Locally used flag to indicate usage of the Extended VC Frame Counter. */
 	uint16_t idleChannel;						/*!< The ID of the channel permanently marked as idle (the 8th). */
+	uint64_t recIdleFrameCount;					/*!< Number of idle frames received. */
 };
 
 #endif // TmMasterChannel_h
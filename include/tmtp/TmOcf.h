@@ -29,7 +29,7 @@ using namespace std;
  *					2.- setContent(uint64_t data)
  *					3.- wrap()
  *
- *				This will be done, for example, by the sending device. The receiving device will only need to use unwrap(vector<uint8_t> raw) \n
+ *				This will be done, for example, by the sending device. The receiving device will only need to use unwrap(const vector<uint8_t> &raw) \n
  *				For more details, read the warnings on the coments above each member function.
  */
 class TmOcf
@@ -99,7 +99,7 @@ public:
 	* \note May throw TmOcfError. 
 	* There is no mechanism to ensure a raw OCF is generated BEFORE calling this function. Use TmOcf::wrap() to generate one.
 	*/
-	virtual void unwrap(vector<uint8_t> raw);
+	virtual void unwrap(const vector<uint8_t> &raw);
 
 	/*! \brief Displays a message (for debugging) with the Report Type and OCF contents in hexadecimal. */
 	virtual void debugOutput();
@@ -0,0 +1,183 @@
+#ifndef TmPacketPublisher_h
+#define TmPacketPublisher_h
+
+#include "GroundPacketServer.h"
+#include "SpacePacketConf.h"
+#include "TmVirtualChannel.h"
+#include "TmFrameTimestamp.h"
+#include "myErrors.h"
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+
+using namespace std;
+
+class NetProtConf;
+
+/*!	\brief Streams the received packets to any number of subscribers over TCP (real-time telemetry fan-out).
+ *
+ * The publisher is connected to one or more virtual channels as their packet sink (see addTmVc()); packets from any
+ * other source are passed to publishPacket(). Subscribers connect over TCP and receive each packet with its virtual
+ * channel, APID and timestamp, framed like the StreamPacket of the StreamConnection example:
+ *	- Byte 0: the framing version (1).
+ *	- Bytes 1-4: the total length of the message, framing included.
+ *	- Byte 5: the message type (TmPacketPublisher::packetMessage).
+ *	- Byte 6: the virtual channel ID.
+ *	- Bytes 7-8: the APID of a Space Packet, TmPacketPublisher::anyApid for other packets.
+ *	- Bytes 9-16: the seconds of the timestamp (0: no timestamp).
+ *	- Bytes 17-20: the fractions of the timestamp in units of 2^-32 seconds.
+ *	- Bytes 21-: the packet.
+ *
+ * All fields are big endian. Each packet is encoded once into a shared buffer, which is queued for every subscriber
+ * whose filter accepts it, so the work per packet does not grow with the number of subscribers beyond one queue entry
+ * each. \n
+ * A subscriber receives all packets until it sends a subscription message (see buildSubscription()), which replaces its
+ * filter by a list of virtual channel and APID pairs. The filter is compiled into a table of all virtual channels
+ * and APIDs, so a packet is matched with one lookup per subscriber.
+ *
+ * Each subscriber has a queue of limited length. When a lagging subscriber's queue is full, its oldest queued packet
+ * is dropped (and counted), so it always receives the most recent telemetry and never slows the others down.
+ *
+ * \note The sockets are served by one network thread (see start()). publishPacket() may be called from any one thread.
+ */
+class TmPacketPublisher : public GroundPacketServer
+{
+//
+// definitions
+//
+public:
+	static const uint8_t framingVersion = 1;			/**< Version of the StreamPacket framing. */
+	static const size_t framingHeaderLength = 5;		/**< Length of the StreamPacket framing header. */
+	static const size_t messageHeaderLength = 16;		/**< Length of the message header behind the framing. */
+	static const uint8_t packetMessage = 1;				/**< Message type of a published packet. */
+	static const uint8_t subscriptionMessage = 2;		/**< Message type of a subscription. */
+	static const uint8_t anyVc = 0xFF;					/**< Virtual channel ID matching all virtual channels in a subscription. */
+	static const uint16_t anyApid = 0xFFFF;				/**< APID matching all packets in a subscription, and the APID of packets which are no Space Packets. */
+	static const uint16_t vcCount = 8;					/**< Number of virtual channel IDs (3 bits). */
+	static const size_t defaultQueueLength = 1000;		/**< Default number of packets queued per subscriber. */
+
+	/*! \brief A virtual channel and APID pair of a subscription. */
+	struct Subscription {
+		uint8_t vcid;			/**< Virtual channel ID, or TmPacketPublisher::anyVc. */
+		uint16_t apid;			/**< APID, or TmPacketPublisher::anyApid. */
+	};
+
+//
+// methods
+//
+public:
+
+/*! \brief Constructor of the TmPacketPublisher class.
+ *	\param conf Network protocol configuration, used for the debug output.
+ *	\param queueLength Maximum number of packets queued per subscriber (at least one).
+ */
+	TmPacketPublisher(NetProtConf *conf, size_t queueLength = defaultQueueLength);
+
+/*! \brief Destructor of the TmPacketPublisher class. Stops the network thread and disconnects all subscribers. */
+	virtual ~TmPacketPublisher();
+
+/*! \brief Opens the TCP port the subscribers connect to.
+ *	\param port The port to listen on, 0 for any free port.
+ *	\param address The local address to bind to.
+ *	\return The port the publisher is bound to.
+ *
+ * \note May throw GroundPacketServerError if the socket cannot be opened.
+ */
+	virtual uint16_t listen(uint16_t port, string address = "0.0.0.0");
+
+/*! \brief Starts the network thread. Does nothing if it already runs. */
+	virtual void start();
+
+/*! \brief Stops the network thread. Queued packets stay queued until start() is called again. */
+	virtual void stop();
+
+/*! \brief Adds a virtual channel whose packets are published.
+ *
+ * The publisher also has to be connected as the packet sink of the virtual channel (TmVirtualChannel::connectPacketSink).
+ * A virtual channel connected with PacketServer::connectTmVc is published as well.
+ */
+	virtual void addTmVc(TmVirtualChannel *vc);
+
+/*! \brief Takes all packets from the input queues of the virtual channels and publishes them.
+ *
+ *	\note may throw GroundPacketServerError if:
+ *	- No virtual channel was specified.
+ *	- There were any virtual channel errors.
+ */
+	virtual void signalNewPacket();
+
+/*! \brief Encodes a packet once and queues it for all subscribers whose filter accepts it.
+ *	\param vcid The virtual channel ID of the packet.
+ *	\param packet The packet with its timestamp.
+ *	\return The number of subscribers the packet was queued for.
+ */
+	virtual size_t publishPacket(uint16_t vcid, const TimeTaggedPacket &packet);
+
+/*! \brief Retrieves the number of connected subscribers. */
+	virtual size_t getSubscriberCount();
+
+/*! \brief Retrieves the number of packets published. */
+	virtual uint64_t getPublishedCount();
+
+/*! \brief Retrieves the number of packets dropped from the queues of lagging subscribers. */
+	virtual uint64_t getDroppedCount();
+
+/*! \brief Builds a subscription message, to be sent by a subscriber.
+ *	\param subscriptions The virtual channel and APID pairs to receive. An empty list subscribes to all packets.
+ *	\return The framed message.
+ */
+	static vector<uint8_t> buildSubscription(const vector<Subscription> &subscriptions);
+
+/*! \brief Parses a published message.
+ *	\param message The framed message.
+ *	\param vcid Set to the virtual channel ID.
+ *	\param apid Set to the APID, TmPacketPublisher::anyApid for packets which are no Space Packets.
+ *	\param timestamp Set to the timestamp.
+ *	\param packet Set to the packet.
+ *	\return FALSE if the message is no valid packet message.
+ */
+	static bool parseMessage(const vector<uint8_t> &message, uint16_t &vcid, uint16_t &apid, TmFrameTimestamp &timestamp,
+			vector<uint8_t> &packet);
+
+protected:
+	class Subscriber;	// A connected subscriber with its queue and filter (defined in TmPacketPublisher.cpp).
+	friend class Subscriber;
+
+/*! \brief Waits for the next subscriber. */
+	virtual void accept();
+
+/*! \brief Adds an accepted subscriber and waits for the next one. */
+	virtual void handleAccept(boost::shared_ptr<Subscriber> subscriber, const boost::system::error_code &error);
+
+/*! \brief Removes a subscriber whose connection failed. */
+	virtual void removeSubscriber(Subscriber *subscriber);
+
+/*! \brief Extracts the APID of a Space Packet (TmPacketPublisher::anyApid for other packets). */
+	static uint16_t extractApid(const vector<uint8_t> &packet);
+
+//
+// variables
+//
+protected:
+	size_t queueLength;						/*!< Maximum number of packets queued per subscriber. */
+	vector<TmVirtualChannel *> tmVcs;		/*!< Virtual channels added with addTmVc(). */
+
+	boost::asio::io_context ioContext;		/*!< Runs the handlers of all sockets. */
+	boost::shared_ptr<boost::asio::executor_work_guard<boost::asio::io_context::executor_type> > workGuard;	/*!< Keeps the network thread running while idle. */
+	boost::shared_ptr<boost::asio::ip::tcp::acceptor> acceptor;	/*!< The listening socket. */
+	boost::thread thread;					/*!< The network thread. */
+	bool running;							/*!< Indicates whether the network thread runs. */
+
+	boost::mutex mutex;						/*!< Protects the subscribers, their queues and the counters. */
+	vector<boost::shared_ptr<Subscriber> > subscribers;	/*!< The connected subscribers. */
+	uint64_t publishedCount;				/*!< Packets published. */
+	uint64_t droppedCount;					/*!< Packets dropped from the queues of lagging subscribers. */
+};
+
+#endif // TmPacketPublisher_h
@@ -8,10 +8,13 @@
 #include <vector>
 #include <string>
 #include <stdint.h>
+#include <stddef.h>
 
 using namespace std;
 
 class TmMasterChannel;	// Uses the TmMasterChannel class.
+class TmTimeCorrelation;	// Uses the TmTimeCorrelation class.
+class TmReedSolomon;	// Uses the TmReedSolomon class.
 class TmFrameTimestamp;
 class TmFrameBitrate;
 
@@ -34,7 +37,7 @@ class TmPhysicalChannel {
 	public:
 	
 /*! \brief Constructor of the TmPhysicalChannel class.
- *	\param length Sets the total frame length (7 to 2048 Bytes).
+ *	\param length Sets the total frame length (7 to 65535 Bytes), or the maximum frame length for variable-length frames.
  *
  * Establishes the total frame length to have on this channel.
  * It sets the Frame Error Control Field Flag to FALSE and the Master Channel pointer to NULL.
@@ -62,6 +65,25 @@ class TmPhysicalChannel {
 /*! \brief Retrieves the value of the  FECF Flag. */
 		virtual bool getFecfStatus();
 
+/*! \brief Retrieves the length of a frame on the link: the frame length plus the Reed-Solomon check symbols, if connected. */
+		virtual size_t getCodeblockLength();
+
+/*! \brief Switches to variable-length frames (USLP style).
+ *
+ * Every frame carries its length in a frame length field (see TmTransferFrame::activateFrameLengthField()), which is
+ * read first when a frame is received. Frames may be shorter than the configured frame length: a virtual channel ends
+ * a frame after its last packet instead of filling it with idle data. \n
+ * A connected time correlation model assumes frames of equal length and should not be used with variable-length frames. \n
+ * \note May throw TmPhysicalChannelError if a Reed-Solomon code is connected (see connectReedSolomon()).
+ */
+		virtual void activateVariableFrameLength();
+
+/*! \brief Switches back to fixed-length frames. */
+		virtual void deactivateVariableFrameLength();
+
+/*! \brief Retrieves the value of the variable frame length flag. */
+		virtual bool getVariableFrameLengthStatus();
+
 /*! \brief Creates a master channel bound to this physical channel.
  *	\param scid The Spacecraft Identifier used in the master channel.
  *
@@ -69,7 +91,7 @@ class TmPhysicalChannel {
  * 	- Spacecraft ID = scid;
  * 	- ocfPresent = true;
  * 	- sendFrameCount = 0;
- * 	- recFrameCount = 0;
+ * 	- recSequence = TmSequenceTracker(256);
  * 	- secondHeaderPresent = false;
  * 	- extendedVcFrameCountUsed = false;
  * 	- ocfSink = NULL;
@@ -87,7 +109,7 @@ class TmPhysicalChannel {
  * 	- initialConf = netProtConf = new NetProtConf;
  * 	- debugOutput = false;
  * 	- sendFrameCount = 0;
- * 	- recFrameCount = 0;
+ * 	- recSequence = TmSequenceTracker(256);
  * 	- recPacketHeaderLength = 0;
  * 	- recPacketLength = 0;
  * 
@@ -103,27 +125,86 @@ class TmPhysicalChannel {
  *	\param bitrate A TmFrameBitrate object. Contains the frame bitrate used to calculate individual packet timestamps.
  *	\return Any warnings or errors found in any step in the process.
  *
+ * If a Reed-Solomon code is connected, the raw frame is followed by its check symbols: the errors are corrected first. A frame
+ * with too many errors is dropped with a warning.
  * Creates a TM Transfer Frame object to receive the data carried by the raw frame.
  * Checks the FECF Flag settings for this physical channel and activates it in the new frame if needed.
  * Takes the raw frame, reads its fields and flags and stores them in the new frame.
+ * Idle frames (see TmMasterChannel::isIdleFrame) are detected right after the headers are read; their Data Field is never copied.
+ * If a time correlation model is connected, the frame is added to it and the timestamp and bitrate are replaced by the estimates of the model.
  * If a master channel has been defined for this physical channel, verifies if the received frame has the correct master channel settings. 
  * Otherwise displays a warning that no master channel has been configured.
  * Scans for any TM Transfer Frame errors and returns its findings.
  */
-		virtual TmChannelWarning receiveFrame(vector<uint8_t> rawFrame, TmFrameTimestamp timestamp, TmFrameBitrate bitrate);
+		virtual TmChannelWarning receiveFrame(const vector<uint8_t> &rawFrame, TmFrameTimestamp timestamp, TmFrameBitrate bitrate);
+
+/*! \brief Same as receiveFrame(const vector<uint8_t>&, TmFrameTimestamp, TmFrameBitrate) for a frame the caller no longer needs.
+ *
+ * A connected Reed-Solomon code corrects the frame in the vector itself instead of a copy.
+ */
+		virtual TmChannelWarning receiveFrame(vector<uint8_t> &&rawFrame, TmFrameTimestamp timestamp, TmFrameBitrate bitrate);
+
+/*! \brief Same as receiveFrame(const vector<uint8_t>&, TmFrameTimestamp, TmFrameBitrate) for a frame given in place.
+ *	\param rawFrame First Byte of the raw frame, e.g. in a receive buffer or a shared memory slot.
+ *	\param length Number of Bytes of the raw frame.
+ *	\param timestamp The reference timestamp of the frame.
+ *	\param bitrate The reference bitrate of the frame.
+ *	\return Any warnings or errors found in any step in the process.
+ *
+ * The frame is read where it is: only the Data Field of a non-idle frame is copied into the TmTransferFrame. The buffer
+ * has to stay valid until the call returns. With a Reed-Solomon code connected, the frame is copied once for decoding.
+ */
+		virtual TmChannelWarning receiveFrame(const uint8_t *rawFrame, size_t length, TmFrameTimestamp timestamp,
+				TmFrameBitrate bitrate);
 
 /*! \brief Prepares a new TM Transfer Frame to be sent over a master- and virtual channel, if defined.
  * \param timestamp The timestamp at which the frame will be send.
  *
+ * If a Reed-Solomon code is connected, its check symbols are appended to the raw frame.
+ *
  * \note May throw TmPhysicalChannelError or TmMasterChannelError.
  */
 		virtual vector<uint8_t> sendFrame(TmFrameTimestamp timestamp);
 
+/*! \brief Connects a time correlation model to this physical channel.
+ *	\param model The model. It is not deleted by the physical channel.
+ *
+ * Each received frame of the master channel is added to the model with its timestamp and master channel frame count.
+ * As soon as the model is valid, the packet timestamps are computed from the estimated frame timestamp and bitrate instead of the given ones.
+ */
+		virtual void connectTimeCorrelation(TmTimeCorrelation *model);
+
+/*! \brief Disconnects the time correlation model. The given frame timestamps and bitrates are used again. */
+		virtual void disconnectTimeCorrelation();
+
+/*! \brief Connects a Reed-Solomon code to this physical channel.
+ *	\param code The code with its interleave depth. It is not deleted by the physical channel.
+ *
+ * Sent frames get the check symbols of the code appended; received frames are expected with them and are corrected before
+ * they are unwrapped. The frame length has to be a multiple of the interleave depth and at most 223 times the interleave
+ * depth (e.g. 1115 Bytes for depth 5). Shorter frames use a shortened code. \n
+ * The Reed-Solomon code detects errors much more reliably than the FECF, which is usually not used with it. \n
+ * Variable-length frames cannot be used with the code, whose codeblocks have a fixed length. \n
+ * \note May throw TmPhysicalChannelError if the frame length does not fit the code or variable-length frames are active.
+ */
+		virtual void connectReedSolomon(TmReedSolomon *code);
+
+/*! \brief Disconnects the Reed-Solomon code. Frames are sent and received without check symbols again. */
+		virtual void disconnectReedSolomon();
+
+	protected:
+/*! \brief Reads a decoded raw frame in place and passes it to the master channel (see receiveFrame()). */
+		virtual TmChannelWarning unwrapFrame(const uint8_t *rawFrame, size_t length, TmFrameTimestamp timestamp,
+				TmFrameBitrate bitrate);
+
 	// variables
 	protected:
 		TmMasterChannel *masterChannel;	/**< Pointer to the generated master channel. */
 		uint16_t frameLength;		/**< Total frame length. */
 		bool fecfPresent;				/**< Frame Error Control Field flag (default = FALSE). */
+		bool variableFrameLength;		/**< Variable frame length flag (default = FALSE). */
+		TmTimeCorrelation *timeCorrelation;	/**< Pointer to the connected time correlation model (default = NULL). */
+		TmReedSolomon *reedSolomon;		/**< Pointer to the connected Reed-Solomon code (default = NULL). */
 };
 
 #endif // TmPhysicalChannel_h
@@ -0,0 +1,120 @@
+#ifndef TmReedSolomon_h
+#define TmReedSolomon_h
+
+#include "myErrors.h"
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+/*! \brief CCSDS Reed-Solomon (255,223) code with interleaving (CCSDS 131.0-B).
+ *
+ * Each codeword carries up to 223 data symbols and 32 check symbols and corrects up to 16 symbol errors. The code uses
+ * the field polynomial x^8 + x^7 + x^2 + x + 1, the generator roots alpha^(11*j) for j = 112 to 143 and the dual basis
+ * symbol representation of the standard.
+ *
+ * With an interleave depth I, the Bytes of a frame are distributed over I codewords: Byte k belongs to codeword k mod I.
+ * The check symbols of all codewords are appended to the frame, interleaved the same way. Frames shorter than 223 * I
+ * Bytes are shortened codes (virtual fill), so the frame length has to be a multiple of I.
+ *
+ * Encoding runs a linear feedback shift register which XORs one precomputed row of generator products per data Byte
+ * (two 16-Byte XORs with SSE2). Decoding first re-encodes each codeword this way and compares the check symbols, which
+ * is all the work for an error-free codeword. Only codewords with errors run the full decoder
+ * (Berlekamp-Massey, Chien search and Forney).
+ *
+ * The number of symbols corrected in each codeword of the last decoded frame is kept, so the link margin can be
+ * monitored (see getLastCorrections()).
+ */
+class TmReedSolomon {
+//
+// definitions
+//
+public:
+	static const uint16_t codewordLength = 255;		/**< Symbols per codeword (n). */
+	static const uint16_t dataLength = 223;			/**< Data symbols per codeword (k). */
+	static const uint16_t parityLength = 32;		/**< Check symbols per codeword (n - k). */
+	static const uint16_t maxInterleaveDepth = 8;	/**< Highest interleave depth. */
+	static const int uncorrectable = -1;			/**< Entry of getLastCorrections() for a codeword with too many errors. */
+
+//
+// methods
+//
+public:
+
+/*! \brief Constructor of the TmReedSolomon class.
+ *	\param depth The interleave depth (1 to 8).
+ *
+ * \note May throw TmReedSolomonError if the interleave depth is out of range.
+ */
+	TmReedSolomon(uint16_t depth = 5);
+
+/*! \brief Retrieves the interleave depth. */
+	virtual uint16_t getInterleaveDepth();
+
+/*! \brief Retrieves the number of check symbols appended to each frame (32 * interleave depth). */
+	virtual size_t getCheckLength();
+
+/*! \brief Retrieves the longest frame which can be encoded (223 * interleave depth). */
+	virtual size_t getMaxFrameLength();
+
+/*! \brief Appends the check symbols of all codewords to a frame.
+ *	\param block The frame; its length has to be a multiple of the interleave depth and at most getMaxFrameLength().
+ *
+ * \note May throw TmReedSolomonError if the frame length does not fit the code.
+ */
+	virtual void encode(vector<uint8_t> &block);
+
+/*! \brief Corrects the errors of a received frame and removes its check symbols.
+ *	\param block The frame followed by its check symbols. On return, the corrected frame.
+ *	\return FALSE if at least one codeword had too many errors. The errors of the other codewords are still corrected.
+ *
+ * The corrections of each codeword are available with getLastCorrections(). \n
+ * \note May throw TmReedSolomonError if the block length does not fit the code.
+ */
+	virtual bool decode(vector<uint8_t> &block);
+
+/*! \brief Retrieves the number of symbols corrected in each codeword of the last decoded frame (TmReedSolomon::uncorrectable if it failed). */
+	virtual const vector<int> &getLastCorrections();
+
+/*! \brief Retrieves the number of codewords decoded. */
+	virtual uint64_t getCodewordCount();
+
+/*! \brief Retrieves the number of symbols corrected in all decoded codewords. */
+	virtual uint64_t getCorrectedSymbolCount();
+
+/*! \brief Retrieves the number of codewords which had too many errors. */
+	virtual uint64_t getUncorrectableCount();
+
+/*! \brief Sets the decoding statistics to zero. */
+	virtual void resetCounters();
+
+protected:
+/*! \brief Computes the check symbols of one codeword (dual basis).
+ *	\param data First data symbol of the codeword.
+ *	\param stride Distance between two symbols of the codeword (the interleave depth).
+ *	\param length Number of data symbols (without virtual fill).
+ *	\param parity The 32 check symbols.
+ */
+	static void encodeCodeword(const uint8_t *data, size_t stride, size_t length, uint8_t *parity);
+
+/*! \brief Corrects one codeword given in the conventional representation.
+ *	\param codeword The transmitted symbols (data and check symbols, without virtual fill).
+ *	\param pad Number of virtual fill symbols in front of the codeword.
+ *	\return The number of symbols corrected, or TmReedSolomon::uncorrectable.
+ */
+	static int decodeCodeword(uint8_t *codeword, int pad);
+
+//
+// variables
+//
+protected:
+	uint16_t interleaveDepth;			/*!< Interleave depth (1 to 8). */
+	vector<int> lastCorrections;		/*!< Symbols corrected per codeword of the last decoded frame. */
+	uint64_t codewordCount;				/*!< Number of codewords decoded. */
+	uint64_t correctedSymbolCount;		/*!< Number of symbols corrected. */
+	uint64_t uncorrectableCount;		/*!< Number of codewords with too many errors. */
+};
+
+#endif // TmReedSolomon_h
@@ -0,0 +1,181 @@
+#ifndef TmSequenceTracker_h
+#define TmSequenceTracker_h
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+/*! \brief Follows a modular sequence counter (e.g. a frame counter) and classifies each received count.
+ *
+ * The tracker knows which count it expects next. Each received count is compared against it:
+ *	- In sequence: the count is the expected one.
+ *	- Gap: the count is ahead of the expected one. The skipped counts are lost.
+ *	- Duplicate: the count is a few counts behind the expected one (see TmSequenceTracker::setDuplicateWindow) and was already received.
+ *	- Out of order: the count is a few counts behind the expected one and was counted as lost (the frame arrived late).
+ *
+ * The last TmSequenceTracker::recentCounts counts are remembered in a bit mask, so a late frame received twice is a
+ * duplicate the second time. Counts further behind within the duplicate window are always duplicates. \n
+ * Duplicates and late frames do not change the expected count, so the caller can simply drop them. \n
+ * A count further behind than the duplicate window is a gap as well: an 8-bit counter which skipped 128 frames
+ * or more (e.g. during a fade) looks as if it went backwards. A gap longer than the maximum gap length
+ * (see TmSequenceTracker::setMaxGapLength) is no plausible fade: such a jump back, e.g. of a 32-bit counter whose
+ * source restarted, is accepted as a new sequence without lost counts. \n
+ * A restart within the window shows as a run of consecutive counts behind the expected one
+ * (see TmSequenceTracker::setResyncThreshold), which is accepted as a new sequence. The frames of the run
+ * dropped before are counted as lost. \n
+ * The first count received is always accepted.
+ *
+ * The most recent gaps are kept in a ring of fixed size, so each update takes constant time.
+ */
+class TmSequenceTracker {
+//
+// definitions
+//
+public:
+	/*! \brief Result of the classification of a received count. */
+	enum SequenceStatus {
+		firstCount,		/**< First count received, accepted as the start of the sequence. */
+		inSequence,		/**< The count is the expected one. */
+		gap,			/**< One or more counts were skipped. */
+		duplicate,		/**< The count was already received. */
+		outOfOrder,		/**< The count was considered lost but arrived late. */
+		resync,			/**< The sequence restarted behind the expected count. */
+		malformed		/**< The count could not be read, e.g. from a packet too short (only for SpacePacketSequencer). */
+	};
+
+	/*! \brief A run of consecutive lost counts. */
+	struct SequenceGap {
+		uint64_t first;		/**< First missing count. */
+		uint64_t length;	/**< Number of missing counts. */
+		uint64_t recovered;	/**< Number of counts of this gap that arrived late. */
+	};
+
+	static const size_t defaultGapHistory = 16;		/**< Number of gaps remembered by default. */
+	static const uint16_t defaultResyncThreshold = 3;	/**< Consecutive counts behind the expected one that restart the sequence. */
+	static const uint64_t defaultDuplicateWindow = 16;	/**< Counts behind the expected one still taken for duplicates or late frames. */
+	static const uint64_t defaultMaxGapLength = 65536;	/**< Longest gap a count behind the duplicate window is taken for. */
+	static const uint16_t recentCounts = 64;			/**< Number of counts remembered to tell late frames from duplicates. */
+
+//
+// methods
+//
+public:
+
+/*! \brief Constructor of the TmSequenceTracker class.
+ *	\param modulus The counter wraps around to zero at this value (e.g. 256 for an 8-bit counter).
+ *	\param gapHistory Number of gaps remembered for TmSequenceTracker::getGaps.
+ */
+	TmSequenceTracker(uint64_t modulus = 256, size_t gapHistory = defaultGapHistory);
+
+/*! \brief Compares two counts of a modular counter.
+ *	\param expected The count expected next.
+ *	\param received The count received.
+ *	\param modulus The counter modulus.
+ *	\param distance Returns the number of skipped counts for TmSequenceTracker::gap,
+ *	or how far the received count is behind the expected one for TmSequenceTracker::outOfOrder.
+ *	\return TmSequenceTracker::inSequence, TmSequenceTracker::gap or TmSequenceTracker::outOfOrder (for any count behind).
+ *
+ * Counts less than half the modulus ahead of the expected one are a gap, all other counts are behind.
+ */
+	static SequenceStatus classify(uint64_t expected, uint64_t received, uint64_t modulus, uint64_t &distance);
+
+/*! \brief Classifies a received count and updates the expected count and statistics.
+ *	\param count The received count.
+ *
+ * Only TmSequenceTracker::duplicate and TmSequenceTracker::outOfOrder leave the expected count unchanged.
+ */
+	virtual SequenceStatus update(uint64_t count);
+
+/*! \brief Changes the counter modulus. Resets the tracker. */
+	virtual void setModulus(uint64_t modulus);
+
+/*! \brief Retrieves the counter modulus. */
+	virtual uint64_t getModulus();
+
+/*! \brief Sets the number of consecutive counts behind the expected one that are accepted as a restart of the sequence (at least 1). */
+	virtual void setResyncThreshold(uint16_t threshold);
+
+/*! \brief Sets how many counts behind the expected one a count is still taken for a duplicate or a late frame.
+ *
+ * Counts further behind are accepted as a gap. A window of half the modulus or more treats every count behind as a duplicate.
+ */
+	virtual void setDuplicateWindow(uint64_t window);
+
+/*! \brief Retrieves how many counts behind the expected one a count is still taken for a duplicate or a late frame. */
+	virtual uint64_t getDuplicateWindow();
+
+/*! \brief Sets the longest gap a count behind the duplicate window is taken for (default = 65536).
+ *
+ * Such a count is a gap of the modulus minus its distance behind the expected count if the gap is not longer, and a
+ * restart of the sequence (TmSequenceTracker::resync) without lost counts otherwise. Every gap of a counter with a
+ * modulus up to the maximum gap length is accepted.
+ */
+	virtual void setMaxGapLength(uint64_t length);
+
+/*! \brief Retrieves the longest gap a count behind the duplicate window is taken for. */
+	virtual uint64_t getMaxGapLength();
+
+/*! \brief Forgets the expected count, the gaps and the statistics. The next count is accepted as the start of the sequence. */
+	virtual void reset();
+
+/*! \brief Retrieves the count expected next (zero before the first count). */
+	virtual uint64_t getExpectedCount();
+
+/*! \brief Retrieves the number of counts lost by the last gap or resync. */
+	virtual uint64_t getLastGapLength();
+
+/*! \brief Retrieves the number of counts accepted (first, in sequence, after a gap or a resync). */
+	virtual uint64_t getAcceptedCount();
+
+/*! \brief Retrieves the number of counts lost (skipped counts minus the ones which arrived late). */
+	virtual uint64_t getLostCount();
+
+/*! \brief Retrieves the number of gaps. */
+	virtual uint64_t getGapCount();
+
+/*! \brief Retrieves the number of duplicates. */
+	virtual uint64_t getDuplicateCount();
+
+/*! \brief Retrieves the number of counts which arrived out of order. */
+	virtual uint64_t getOutOfOrderCount();
+
+/*! \brief Retrieves the number of times the sequence was restarted. */
+	virtual uint64_t getResyncCount();
+
+/*! \brief Retrieves the most recent gaps, the oldest first. */
+	virtual vector<SequenceGap> getGaps();
+
+protected:
+/*! \brief Looks for a remembered gap containing the count and marks it as recovered. Returns TRUE if found. */
+	virtual bool recoverFromGap(uint64_t count);
+
+//
+// variables
+//
+protected:
+	uint64_t modulus;				/*!< The counter wraps around to zero at this value. */
+	uint64_t expectedCount;			/*!< The count expected next. */
+	bool synchronised;				/*!< Indicates whether a first count has been received. */
+	uint64_t lastGapLength;			/*!< Number of counts lost by the last gap or resync. */
+	uint64_t duplicateWindow;		/*!< Counts behind the expected one still taken for duplicates or late frames. */
+	uint64_t maxGapLength;			/*!< Longest gap a count behind the duplicate window is taken for. */
+	uint64_t receivedMask;			/*!< Bit i is set if the count i+1 before the expected one was received. */
+
+	uint16_t resyncThreshold;		/*!< Consecutive counts behind the expected one that restart the sequence. */
+	uint16_t rejectedRun;			/*!< Number of consecutive counts behind the expected one received so far. */
+	uint64_t lastRejectedCount;		/*!< Last count behind the expected one. */
+
+	vector<SequenceGap> gaps;		/*!< Ring of the most recent gaps. */
+	size_t nextGap;					/*!< Position in the ring where the next gap is stored. */
+
+	uint64_t acceptedCount;			/*!< Number of counts accepted. */
+	uint64_t lostCount;				/*!< Number of counts lost. */
+	uint64_t gapCount;				/*!< Number of gaps. */
+	uint64_t duplicateCount;		/*!< Number of duplicates. */
+	uint64_t outOfOrderCount;		/*!< Number of counts which arrived out of order. */
+	uint64_t resyncCount;			/*!< Number of times the sequence was restarted. */
+};
+
+#endif // TmSequenceTracker_h
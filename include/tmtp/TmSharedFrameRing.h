@@ -0,0 +1,198 @@
+#ifndef TmSharedFrameRing_h
+#define TmSharedFrameRing_h
+
+#include "myErrors.h"
+#include "TmFrameTimestamp.h"
+#include "TmFrameBitrate.h"
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+class TmPhysicalChannel;	// Uses the TmPhysicalChannel class.
+
+/*! \brief Ring of frame slots in POSIX shared memory, passing frames from a producer process (e.g. an SDR demodulator)
+ * to a consumer process running the TMTP receiver.
+ *
+ * The shared memory object holds a header and a fixed number of slots. Each slot carries one frame of up to the slot
+ * size with its timestamp and bitrate. There is one producer (TmSharedFrameProducer) and one consumer
+ * (TmSharedFrameConsumer); each owns one index of the ring, so no locks are needed. A waiting side sleeps on a futex in
+ * the shared memory and is woken by the other side only if it actually sleeps.
+ *
+ * Both sides can restart at any time:
+ *	- Each slot carries the sequence number of its frame, written after the frame. A slot left half-written by a crashed
+ *	  producer is never read, and a restarted consumer continues with the first frame it did not finish.
+ *	- The producer increments the generation counter of the ring each time it attaches. The consumer counts the
+ *	  generation changes (producer restarts) and resynchronizes its index if the ring was reinitialized.
+ *	- A producer attaching to an object which holds no ring reinitializes it. A ring of a different geometry is refused,
+ *	  since a consumer may still map it and resizing it under the consumer would fault: the old object has to be removed
+ *	  (TmSharedFrameRing::remove) first. A consumer whose object was removed attaches to the new one of the same name.
+ *
+ * \note Frames are delivered at least once: a frame being processed when the consumer crashes is delivered again.
+ */
+class TmSharedFrameRing {
+//
+// definitions
+//
+public:
+	static const uint32_t magicNumber = 0x544D5246;		/**< Identifies an initialized ring ("TMRF"). */
+	static const uint32_t layoutVersion = 1;			/**< Version of the memory layout. */
+	static const size_t defaultSlotCount = 256;			/**< Default number of slots. */
+	static const size_t defaultSlotSize = 2048;			/**< Default maximum frame length (a CADU with RS check symbols fits). */
+
+//
+// methods
+//
+public:
+
+/*! \brief Constructor of the TmSharedFrameRing class. Maps the shared memory object.
+ *	\param name Name of the shared memory object (e.g. "/tmtp-frames").
+ *	\param create TRUE to create the object if it does not exist (producer), FALSE to open an existing one (consumer).
+ *	\param slotCount Number of slots used when the ring is created or reinitialized.
+ *	\param slotSize Maximum frame length used when the ring is created or reinitialized.
+ *
+ * \note May throw TmSharedFrameRingError if the object cannot be opened or mapped.
+ */
+	TmSharedFrameRing(string name, bool create, size_t slotCount = defaultSlotCount, size_t slotSize = defaultSlotSize);
+
+/*! \brief Destructor of the TmSharedFrameRing class. Unmaps the shared memory object (it is not removed). */
+	virtual ~TmSharedFrameRing();
+
+/*! \brief Retrieves the number of slots. */
+	virtual size_t getSlotCount();
+
+/*! \brief Retrieves the maximum frame length. */
+	virtual size_t getSlotSize();
+
+/*! \brief Retrieves the generation counter (number of producer attachments). */
+	virtual uint32_t getGeneration();
+
+/*! \brief Retrieves the number of frames in the ring. */
+	virtual size_t getFillLevel();
+
+/*! \brief Removes a shared memory object. Mapped rings stay usable until they are destroyed. */
+	static void remove(string name);
+
+protected:
+/*! \brief Checks whether the mapped object holds a ring of the given geometry. */
+	virtual bool isValidLayout(size_t slotCount, size_t slotSize);
+
+/*! \brief Writes the header of an empty ring. */
+	virtual void initialize(size_t slotCount, size_t slotSize);
+
+/*! \brief Maps the shared memory object with a given size. */
+	virtual void map(size_t size);
+
+/*! \brief Retrieves the slot of a frame sequence number. */
+	virtual uint8_t *slot(uint64_t sequence);
+
+//
+// variables
+//
+protected:
+	string name;				/*!< Name of the shared memory object. */
+	int fd;						/*!< File descriptor of the shared memory object. */
+	uint8_t *mapping;			/*!< The mapped object. */
+	size_t mappingSize;			/*!< Size of the mapping. */
+};
+
+/*! \brief Producer side of a TmSharedFrameRing.
+ *
+ * A frame is either copied into the ring (publishFrame()) or written directly into the next free slot (beginFrame()
+ * and commitFrame()), which saves the last copy on the producer side.
+ *
+ * If the ring is full, the producer waits for the consumer up to a timeout and drops the frame afterwards, so a stalled
+ * or crashed consumer never blocks the demodulator for long.
+ */
+class TmSharedFrameProducer : public TmSharedFrameRing {
+//
+// methods
+//
+public:
+
+/*! \brief Constructor of the TmSharedFrameProducer class. Creates or attaches to the ring and increments its generation.
+ *
+ * \note May throw TmSharedFrameRingError if the object cannot be opened or mapped, or holds a ring of another geometry.
+ */
+	TmSharedFrameProducer(string name, size_t slotCount = defaultSlotCount, size_t slotSize = defaultSlotSize);
+
+/*! \brief Retrieves the next free slot to write a frame into.
+ *	\param timeoutMs Time to wait for a free slot, in milliseconds.
+ *	\return The slot (TmSharedFrameRing::getSlotSize() Bytes), or NULL if the ring stayed full (the frame is counted as dropped).
+ */
+	virtual uint8_t *beginFrame(int timeoutMs = 0);
+
+/*! \brief Publishes the frame written into the slot returned by beginFrame().
+ *
+ * \note May throw TmSharedFrameRingError if the frame is too long or no slot was taken.
+ */
+	virtual void commitFrame(size_t length, TmFrameTimestamp timestamp = TmFrameTimestamp(), TmFrameBitrate bitrate = TmFrameBitrate());
+
+/*! \brief Copies a frame into the ring.
+ *	\return FALSE if the ring stayed full and the frame was dropped.
+ *
+ * \note May throw TmSharedFrameRingError if the frame is too long.
+ */
+	virtual bool publishFrame(const uint8_t *frame, size_t length, TmFrameTimestamp timestamp = TmFrameTimestamp(),
+			TmFrameBitrate bitrate = TmFrameBitrate(), int timeoutMs = 0);
+
+/*! \brief Retrieves the number of frames dropped because the ring was full. */
+	virtual uint64_t getDroppedCount();
+
+//
+// variables
+//
+protected:
+	uint8_t *openSlot;			/*!< Slot returned by beginFrame() and not committed yet. */
+	uint64_t droppedCount;		/*!< Frames dropped because the ring was full. */
+};
+
+/*! \brief Consumer side of a TmSharedFrameRing, passing the frames to a physical channel.
+ *
+ * The frames are passed to TmPhysicalChannel::receiveFrame() right where they are in the shared memory; the slot is
+ * released after the call returns.
+ */
+class TmSharedFrameConsumer : public TmSharedFrameRing {
+//
+// methods
+//
+public:
+
+/*! \brief Constructor of the TmSharedFrameConsumer class. Attaches to an existing ring.
+ *	\param name Name of the shared memory object.
+ *	\param channel The physical channel receiving the frames (not owned).
+ *
+ * \note May throw TmSharedFrameRingError if the ring does not exist or is not initialized.
+ */
+	TmSharedFrameConsumer(string name, TmPhysicalChannel *channel);
+
+/*! \brief Passes the frames in the ring to the physical channel, waiting for the first one if there is none.
+ *	\param timeoutMs Time to wait for a frame, in milliseconds (0: do not wait).
+ *	\param maxFrames Maximum number of frames processed by this call.
+ *	\return The warnings of the physical channel for all frames.
+ */
+	virtual TmChannelWarning poll(int timeoutMs = 0, size_t maxFrames = (size_t) -1);
+
+/*! \brief Retrieves the number of frames passed to the physical channel. */
+	virtual uint64_t getFrameCount();
+
+/*! \brief Retrieves the number of producer restarts seen. */
+	virtual uint64_t getRestartCount();
+
+protected:
+/*! \brief Attaches to a new object of the same name if the mapped one was removed. Returns TRUE if it did. */
+	virtual bool reattach();
+
+//
+// variables
+//
+protected:
+	TmPhysicalChannel *physicalChannel;	/*!< The physical channel receiving the frames (not owned). */
+	uint32_t generation;				/*!< Generation of the ring when it was last checked. */
+	uint64_t frameCount;				/*!< Frames passed to the physical channel. */
+	uint64_t restartCount;				/*!< Producer restarts seen. */
+};
+
+#endif // TmSharedFrameRing_h
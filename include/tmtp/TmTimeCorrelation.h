@@ -0,0 +1,151 @@
+#ifndef TmTimeCorrelation_h
+#define TmTimeCorrelation_h
+
+#include "TmFrameTimestamp.h"
+#include "TmFrameBitrate.h"
+#include "TmFixedTimestamp.h"
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+/*! \brief Fits a linear model of frame receipt times versus frame index.
+ *
+ * The receiver time tags each frame when its first Byte arrives. These time tags jitter, and the nominal
+ * bitrate given with each frame neither covers the synchronisation overhead between frames (ASM, CADU)
+ * nor the drift between the receiver clock and the bit clock. \n
+ * TmTimeCorrelation collects pairs of (receipt time, frame count) and fits a straight line through the
+ * most recent ones with least squares:
+ *	- The offset of the line is the receipt time of the first frame added to the model.
+ *	- The slope is the frame period, i.e. the time from the start of one frame to the start of the next one.
+ *
+ * The 8-bit master channel frame count is unwrapped into a 64-bit frame index. Once the model is valid, the
+ * index is chosen as the one closest to the receipt time, so even long gaps in the frame sequence are handled. \n
+ * A sample far off the line (see TmTimeCorrelation::setResetThreshold), or more than 127 frames before the
+ * last one, is taken as a jump of the receiver clock and restarts the model.
+ *
+ * The sums of the fit are kept relative to the oldest sample of the window and are updated for each sample,
+ * so adding a sample takes constant time.
+ *
+ * The model is attached to a physical channel with TmPhysicalChannel::connectTimeCorrelation.
+ */
+class TmTimeCorrelation {
+//
+// definitions
+//
+public:
+	static const size_t defaultWindowSize = 64;		/**< Number of samples in the fit by default. */
+	static const size_t minimumSamples = 2;			/**< Number of samples needed for a valid model. */
+
+//
+// methods
+//
+public:
+
+/*! \brief Constructor of the TmTimeCorrelation class.
+ *	\param windowSize Number of most recent samples used for the fit (at least TmTimeCorrelation::minimumSamples).
+ *
+ * The overhead is zero and the reset threshold is one second.
+ */
+	TmTimeCorrelation(size_t windowSize = defaultWindowSize);
+
+/*! \brief Sets the number of Bytes sent between two frames (e.g. 4 for the ASM of a CADU). */
+	virtual void setOverheadLength(uint16_t bytes);
+
+/*! \brief Retrieves the number of Bytes sent between two frames. */
+	virtual uint16_t getOverheadLength();
+
+/*! \brief Sets the largest distance in seconds between a sample and the model before the model is restarted. */
+	virtual void setResetThreshold(double seconds);
+
+/*! \brief Forgets all samples. */
+	virtual void reset();
+
+/*! \brief Adds the receipt time of a frame to the model.
+ *	\param timestamp Receipt time of the first Byte of the frame.
+ *	\param frameCount The master channel frame count of the frame.
+ *	\return The 64-bit frame index of the frame.
+ *
+ * Invalid timestamps and frame counts already in the model are not added.
+ */
+	virtual uint64_t addSample(TmFrameTimestamp timestamp, uint8_t frameCount);
+
+/*! \brief Returns TRUE if the model holds enough samples to be used. */
+	virtual bool isValid();
+
+/*! \brief Estimates the receipt time of the first Byte of a frame.
+ *	\param frameIndex The frame index returned by TmTimeCorrelation::addSample.
+ *
+ * Returns an empty (invalid) timestamp if the model is not valid.
+ */
+	virtual TmFrameTimestamp estimateTimestamp(uint64_t frameIndex);
+
+/*! \brief Estimates the bitrate of the physical channel.
+ *	\param frameLength The total frame length in Bytes.
+ *
+ * The bitrate counts the frame and the overhead Bytes sent within one frame period.
+ * Returns an empty (invalid) bitrate if the model is not valid.
+ */
+	virtual TmFrameBitrate estimateBitrate(uint16_t frameLength);
+
+/*! \brief Retrieves the fitted frame period in seconds (zero if the model is not valid). */
+	virtual double getFramePeriod();
+
+/*! \brief Retrieves the distance in seconds of the last sample from the model (its timing jitter). */
+	virtual double getLastResidual();
+
+/*! \brief Retrieves the number of samples in the model. */
+	virtual size_t getSampleCount();
+
+/*! \brief Retrieves the number of times the model was restarted by a sample off the line. */
+	virtual uint64_t getResetCount();
+
+protected:
+/*! \brief Computes the line through the samples, if not done since the last sample. */
+	virtual void fit();
+
+/*! \brief Computes the sums of the fit again relative to the oldest sample. */
+	virtual void rebase();
+
+/*! \brief Retrieves the time in seconds since the reference time. */
+	virtual double secondsSinceReference(TmFrameTimestamp timestamp);
+
+//
+// variables
+//
+protected:
+	/*! \brief A receipt time relative to the reference time and frame index. */
+	struct Sample {
+		double index;		/**< Frame index minus the reference index. */
+		double time;		/**< Receipt time in seconds since the reference time. */
+	};
+
+	vector<Sample> samples;			/*!< Ring of the most recent samples. */
+	size_t nextSample;				/*!< Position in the ring where the next sample is stored. */
+	size_t sampleCount;				/*!< Number of samples in the ring. */
+
+	uint64_t referenceSeconds;		/*!< Whole seconds of the first receipt time, subtracted from all samples. */
+	uint64_t referenceIndex;		/*!< Frame index subtracted from all samples. */
+	uint64_t lastIndex;				/*!< Frame index of the last sample. */
+
+	double sumIndex;				/*!< Sum of the indices of the window, relative to the oldest sample. */
+	double sumTime;					/*!< Sum of the times of the window, relative to the oldest sample. */
+	double sumIndexIndex;			/*!< Sum of the squared indices. */
+	double sumIndexTime;			/*!< Sum of the products of index and time. */
+	double baseIndex;				/*!< Index of the oldest sample when the sums were computed. */
+	double baseTime;				/*!< Time of the oldest sample when the sums were computed. */
+	size_t samplesSinceRebase;		/*!< Samples added since the sums were computed. */
+
+	bool fitDone;					/*!< Indicates whether the line matches the current samples. */
+	double offset;					/*!< Fitted time of the reference index. */
+	double period;					/*!< Fitted frame period in seconds. */
+	double lastResidual;			/*!< Distance of the last sample from the model. */
+
+	uint16_t overheadLength;		/*!< Bytes sent between two frames. */
+	double resetThreshold;			/*!< Largest distance of a sample from the model in seconds. */
+	uint64_t resetCount;			/*!< Number of times the model was restarted. */
+};
+
+#endif // TmTimeCorrelation_h
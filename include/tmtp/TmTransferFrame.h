@@ -5,9 +5,11 @@
 #include "myErrors.h"
 #include "TmFrameTimestamp.h"
 #include "TmFrameBitrate.h"
+#include "TmFrameLayout.h"
 
 #include <vector>
 #include <stdint.h>
+#include <stddef.h>
 
 using namespace std;
 
@@ -30,6 +32,12 @@ public:
 																
 	static const uint16_t fhpOnlyIdleData = 0x07FE;	/**< Predefined contents of the First Header Pointer if the TF Data Field containts idle data.*/
 
+	static const uint16_t maxFirstHeaderPointer = 0x07FD;	/**< Highest Data Field position the 11-bit First Header Pointer can address.
+																In frames longer than 2048 Bytes, later packet starts are sent as fhpNoFirstHeader.*/
+	static const uint16_t minFrameLength = 7;			/**< Shortest TM Transfer Frame (Primary Header and one Byte of Data Field).*/
+	static const uint16_t maxFrameLength = 65535;		/**< Longest TM Transfer Frame (ECSS-E-ST-50-03C limits it to 2048 Bytes).*/
+	static const uint16_t frameLengthFieldLength = 2;	/**< Length of the (optional) frame length field in the Secondary Header.*/
+
 protected:
 	static const uint16_t transferFrameVersion = 0;	/**< The TF Ver. Number shall be '00' for all TM Transfer Frames (as defined in CCSDS 135.0-B-3).*/
 	static const uint16_t secondHeaderVersion = 0;	/**< SH Ver. Number '00' (Version 1), is the only one recognized by the ECSS-E-ST-50-03C standard.*/
@@ -42,7 +50,7 @@ protected:
 public:
 
 /*! \brief Constructor for the TmTransferFrame class.
- *  \param length The length of the whole TM Transfer Frame (7 to 2048 Bytes).
+ *  \param length The length of the whole TM Transfer Frame (7 to 65535 Bytes).
  *
  * Creates a Telemetry Transfer Frame with the following (default) attributes:
  *	- spacecraftId = 0;
@@ -57,7 +65,9 @@ public:
  *	- fecfPresent = false;
  *
  * \note
- * A TmTransferFrameError is thrown if the length does not fall within the range of 7 to 2048 Bytes.
+ * A TmTransferFrameError is thrown if the length does not fall within the range of 7 to 65535 Bytes. \n
+ * Frames longer than 2048 Bytes are not covered by ECSS-E-ST-50-03C: their First Header Pointer can only address
+ * the first 2046 Bytes of the Data Field (see maxFirstHeaderPointer).
  */
     TmTransferFrame(uint16_t length);
 
@@ -161,7 +171,10 @@ public:
  * If the Extended Frame Counter is not being used and "data" and it is less than or equal to the max. SH Data Field Length, then the data is stored.
  * Otherwise an error is thrown.
  */
-	virtual void setSecondHeaderDataField(vector<uint8_t> data);
+	virtual void setSecondHeaderDataField(const vector<uint8_t> &data);
+
+/*! \brief Same as setSecondHeaderDataField(const vector<uint8_t>&), taking over the vector instead of copying it. */
+	virtual void setSecondHeaderDataField(vector<uint8_t> &&data);
 
 /*! \brief Retrieves the contents of the Secondary Header Data Field. */
 	virtual vector<uint8_t> getSecondHeaderDataField();
@@ -183,6 +196,7 @@ public:
  * that no new packet begins in the TM Data Field. (see definition for fhpNoFirstHeader) \n
  * In order to indicate that the TM Data Field contains idle data, the pattern 111 1111 111o will be used.
  * (see definition for fhpOnlyIdleData)
+ * In frames longer than 2048 Bytes, locations beyond maxFirstHeaderPointer cannot be encoded.
  *
  * \note May throw TmTransferFrameError.
  */
@@ -194,27 +208,72 @@ public:
 /*! \brief Retrieves the length of the whole TM Transfer Frame. */
     virtual uint16_t getLength();
 
-/*! \brief Calculates the TM Data Field length.
+/*! \brief Changes the length of the whole TM Transfer Frame (7 to 65535 Bytes), e.g. to shorten a variable-length frame.
+ *
+ * The Data Field is resized with the frame. \n
+ * \note May throw TmTransferFrameError.
+ */
+	virtual void setLength(uint16_t length);
+
+/*! \brief Activates the frame length field for variable-length frames (USLP style).
+ *
+ * The frame length minus one is carried in the first two Bytes of the Secondary Header Data Field, ahead of any other
+ * Secondary Header data (e.g. the extended VC Frame Counter), so the Secondary Header is activated as well. \n
+ * A receiving frame with an active frame length field accepts any frame length up to its own length and reads the
+ * actual length from the field (see peekFrameLength()).
+ */
+	virtual void activateFrameLengthField();
+
+/*! \brief Retrieves the value of the frame length field flag. */
+	virtual bool getFrameLengthFieldStatus();
+
+/*! \brief Reads the frame length field of a raw frame in place.
+ *  \param raw First Byte of the raw frame.
+ *  \param length Number of Bytes available (at least the Primary Header and three Secondary Header Bytes are needed).
+ *  \return The total frame length, or zero if the frame has no Secondary Header long enough to hold the field or
+ *  not enough Bytes are available.
+ *
+ * Lets a receiver split a stream of variable-length frames before unwrapping them.
+ */
+	static uint32_t peekFrameLength(const uint8_t *raw, size_t length);
+
+/*! \brief Retrieves the TM Data Field length.
  *  
- * It subtracts the Primary Header, Secondary Header, OCF and FECF lengths from the total TM Transfer Frame length.
- * The returned value can also be zero.
+ * The Primary Header, Secondary Header, OCF and FECF lengths subtracted from the total TM Transfer Frame length.
+ * The value is taken from the precomputed frame layout and can also be zero.
  */
     virtual uint16_t getDataFieldLength();
 
-/*! \brief Calculates the Secondary Header length.
+/*! \brief Retrieves the maximum Secondary Header length.
  *
- * It subtracts the Primary Header, minimum TM Data Field (1), OCF and FECF lengths from the total TM Transfer Frame length.
+ * The Primary Header, minimum TM Data Field (1), OCF and FECF lengths subtracted from the total TM Transfer Frame length.
  * The result is truncated if greater than 64 (standard specified maximum). 
  */
 	virtual uint16_t getMaxSecondHeaderLength();
 
+/*! \brief Retrieves the precomputed layout (field positions and lengths) for the current frame configuration.
+ *
+ * The layout is recomputed only when an optional field is activated or the Secondary Header changes size,
+ * never when the field positions are merely looked up.
+ */
+	virtual const TmFrameLayout& getFrameLayout();
+
 /*! \brief Populates the TM Data Field.
  *  \param data The contents of the TM Data Field, which must match exactly in size.
  *
  * \note
  * If "data" has not exactly the same length as the TM Data Field, a TmTransferFrameError is thrown.
  */
-    virtual void setDataField(vector<uint8_t> data);
+    virtual void setDataField(const vector<uint8_t> &data);
+
+/*! \brief Same as setDataField(const vector<uint8_t>&), taking over the vector instead of copying it. */
+	virtual void setDataField(vector<uint8_t> &&data);
+
+/*! \brief Same as setDataField(const vector<uint8_t>&) for data given in place.
+ *  \param data First Byte of the contents of the TM Data Field.
+ *  \param length Number of Bytes, which must match the TM Data Field length.
+ */
+	virtual void setDataField(const uint8_t *data, size_t length);
 
 /*! \brief Retrieves the data stored in the TM Data Field as obtained from the unwrap() function.
  * 
@@ -224,9 +283,16 @@ public:
  */
 	virtual vector<uint8_t> getDataField();
 
+/*! \brief Moves the TM Data Field out of the frame instead of copying it (see getDataField()).
+ *
+ * The returned vector has the length of the TM Data Field; the frame is left without Data Field.
+ * Used by a receiver which is the last user of the frame.
+ */
+	virtual vector<uint8_t> releaseDataField();
+
 /*! \brief Builds the different frame fields and encapsulates a packet in it.
  * 
- * It requires an already created and populated Data Field (use setDataField(vector<uint8_t>) \n
+ * It requires an already created and populated Data Field (use setDataField(const vector<uint8_t>&)) \n
  * Bare in mind that this function calls the tmOcf::wrap() function, which in order to work properly for SENDING, the following functions must be run in sequence:
  *	1.- setReportType(ReportType type)
  *	2.- setContent(uint64_t data)
@@ -262,9 +328,63 @@ public:
 /*! \brief Takes a TMTP Frame, reads the Fields and Flags and stores their values in local variables accordingly.
  *  \param raw The TMTP Frame generated by TmTransferFrame::wrap().
  *
+ * Equivalent to calling unwrapHeader(), unwrapDataField() and unwrapOcf() in sequence.
+ *
  * \note may throw TmTransferFrameError.
  */
-	virtual void unwrap(vector<uint8_t> raw);
+	virtual void unwrap(const vector<uint8_t> &raw);
+
+/*! \brief Same as unwrap(const vector<uint8_t>&) for a frame given in place (e.g. in a receive buffer).
+ *  \param raw First Byte of the frame.
+ *  \param length Number of Bytes of the frame.
+ *
+ * \note may throw TmTransferFrameError.
+ */
+	virtual void unwrap(const uint8_t *raw, size_t length);
+
+/*! \brief First stage of unwrap(): checks the frame length and FECF and reads the Primary and Secondary Headers.
+ *  \param raw The TMTP Frame generated by TmTransferFrame::wrap().
+ *
+ * Afterwards all header fields and the frame layout are available, but the Data Field is empty. \n
+ * This allows the receiver to decide (e.g. for idle frames) whether the Data Field has to be copied at all.
+ *
+ * \note may throw TmTransferFrameError.
+ */
+	virtual void unwrapHeader(const vector<uint8_t> &raw);
+
+/*! \brief Same as unwrapHeader(const vector<uint8_t>&) for a frame given in place (e.g. in a receive buffer).
+ *  \param raw First Byte of the frame.
+ *  \param length Number of Bytes of the frame.
+ *
+ * \note may throw TmTransferFrameError.
+ */
+	virtual void unwrapHeader(const uint8_t *raw, size_t length);
+
+/*! \brief Second stage of unwrap(): copies the TM Data Field out of the raw frame.
+ *  \param raw The same TMTP Frame previously passed to unwrapHeader().
+ *
+ * \note may throw TmTransferFrameError.
+ */
+	virtual void unwrapDataField(const vector<uint8_t> &raw);
+
+/*! \brief Same as unwrapDataField(const vector<uint8_t>&) for the frame previously passed to unwrapHeader(const uint8_t*, size_t).
+ *
+ * \note throws TmTransferFrameError if length differs from the length of the frame whose headers were unwrapped.
+ */
+	virtual void unwrapDataField(const uint8_t *raw, size_t length);
+
+/*! \brief Last stage of unwrap(): reads the Operational Control Field (if present) out of the raw frame.
+ *  \param raw The same TMTP Frame previously passed to unwrapHeader().
+ *
+ * \note may throw TmTransferFrameError.
+ */
+	virtual void unwrapOcf(const vector<uint8_t> &raw);
+
+/*! \brief Same as unwrapOcf(const vector<uint8_t>&) for the frame previously passed to unwrapHeader(const uint8_t*, size_t).
+ *
+ * \note may throw TmTransferFrameError, also if length differs from the length of the frame whose headers were unwrapped.
+ */
+	virtual void unwrapOcf(const uint8_t *raw, size_t length);
 
 /*! \brief Dissects the frame into its components and displays them as messages for debugging.
  *
@@ -308,18 +428,33 @@ public:
 	
 protected:
 
-/*! \brief Calculates the position (in Bytes) where the TM Data Field starts.
+/*! \brief Retrieves the position (in Bytes) where the TM Data Field starts.
  * 
  * start = primaryheaderLength + secondHeaderLength
  */
 	virtual uint16_t getDataFieldStart();
 
-/*! \brief Calculates the position (in Bytes) where the TM Data Field ends.
+/*! \brief Retrieves the position (in Bytes) where the TM Data Field ends.
  *
  * end = frameLength - (ocfLength + fecfLength)
  */
 	virtual uint16_t getDataFieldEnd();
 
+/*! \brief Recomputes the frame layout after a change of the optional fields.
+ *
+ * Called by every member function that activates an optional field or changes the Secondary Header length.
+ */
+	virtual void updateLayout();
+
+/*! \brief Verifies that a frame given in place has the length of the frame whose headers were unwrapped.
+ *
+ * \note throws TmTransferFrameError otherwise.
+ */
+	virtual void checkUnwrappedLength(const uint8_t *raw, size_t length);
+
+/*! \brief Combines the counter extension (bits 8-31) stored in the 3-Byte Secondary Header Data Field with the least significant Byte of the VC Frame Counter. */
+	virtual void mergeExtendedVcFrameCount();
+
 /*! \brief Computes a Cyclic Redundancy Check on a message (frame). 
  *  \param message The whole TM Transfer Frame (if sending, the Frame Error Control Field should be excluded).
  *
@@ -355,7 +490,15 @@ protected:
  * - S(X) is the syndrome polynomial which is zero if no error is detected and non-zero if an error is detected, 
  * with the most significant bit S0 taken as the coefficient of the highest power of X.
  */
-	virtual uint16_t crc(vector<uint8_t> message);
+	virtual uint16_t crc(const vector<uint8_t> &message);
+
+/*! \brief Computes the same Cyclic Redundancy Check as crc(const vector<uint8_t>&) on a buffer.
+ *	\param message Pointer to the first Byte of the message.
+ *	\param length Number of Bytes in the message.
+ *
+ * The shift register is advanced one Byte at a time by means of a 256-entry lookup table (see TmCrc16).
+ */
+	virtual uint16_t crc(const uint8_t *message, size_t length);
 
 //
 // variables
@@ -376,9 +519,11 @@ protected:
 	TmOcf ocf;								/*!< (Optional) Operational Control Frame Field. This local variable stores an entire TmOcf object. This is NOT directly inserted in the Frame.*/
 	bool fecfPresent;						/*!< (Not part of the standard) Locally used flag to indicate usage of the Frame Error Control Field.*/
     uint16_t frameLength;					/*!< (Not part of the standard) Locally used variable to store the total frame length in Bytes. 
-														Required parameter when instantiating this class. Must be 7 to 2048 Bytes long.*/
+														Required parameter when instantiating this class. Must be 7 to 65535 Bytes long.*/
+	bool frameLengthField;					/*!< (Not part of the standard) Indicates whether the Secondary Header carries the frame length.*/
 	TmFrameTimestamp referenceTimestamp;	/*!< (Optional and not part of the standard) Locally used timestamp to serve as reference to compute the timestamp of each packet.*/
 	TmFrameBitrate referenceBitrate;		/*!< (Optional and not part of the standard) Locally used bitrate to compute the timestamp of each packet*/
+	TmFrameLayout layout;					/*!< (Not part of the standard) Precomputed field positions for the current configuration. Kept up to date by updateLayout().*/
 };
 
 #endif // TmTransferFrame_h
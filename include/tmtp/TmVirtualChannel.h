@@ -6,6 +6,9 @@
 #include "TmFrameTimestamp.h"
 #include "TmFrameBitrate.h"
 #include "TmFrameTimestamp.h"
+#include "TmFixedTimestamp.h"
+#include "TmTransferFrame.h"
+#include "TmSequenceTracker.h"
 
 #include <boost/function.hpp>
 
@@ -16,7 +19,6 @@
 using namespace std;
 
 // Uses the following classes:
-class TmTransferFrame;
 class TmMasterChannel;
 class GroundPacketServer;
 class TmFrameTimestamp;
@@ -61,7 +63,7 @@ public:
  *		- initialConf = netProtConf = new NetProtConf;
  *		- debugOutput = false;
  *		- sendFrameCount = 0;
- *		- recFrameCount = 0;
+ *		- recSequence = TmSequenceTracker(256);
  *		- recPacketHeaderLength = 0;
  *		- recPacketLength = 0;
  * Links this virtual channel with a master channel through the *parent pointer. 
@@ -87,6 +89,9 @@ public:
 /*! \brief Retrieves the received frame counter. */
 	virtual uint64_t getRecFrameCount();
 
+/*! \brief Retrieves the tracker of the received frame counter, which holds the loss, duplicate and out-of-order statistics and the recent gaps. */
+	virtual TmSequenceTracker& getRecSequence();
+
 /*! \brief Sets the Secondary Header and the extended frame counter flags to TRUE. */
 	virtual void activateExtendedFrameCount();
 
@@ -114,7 +119,22 @@ public:
  * \note 
  * If the output queue has reached its limit, will throw a TmVirtualChannelError.
  */
-    virtual void sendPacket(vector<uint8_t> packet);
+    virtual void sendPacket(const vector<uint8_t> &packet);
+
+/*! \brief Same as sendPacket(const vector<uint8_t>&), moving the packet into the output queue instead of copying it. */
+	virtual void sendPacket(vector<uint8_t> &&packet);
+
+/*! \brief Reserves a packet in the output queue, to be written in place.
+ * \param length Length of the packet in Bytes.
+ * \return The first Byte of the packet. It stays valid until the packet has been sent.
+ *
+ * Like sendPacket(), but the packet is not copied: the caller writes it directly into the queue (see SpacePacketBuilder).
+ * The packet has to be completely written before the next call to sendFrame().
+ *
+ * \note 
+ * If the output queue has reached its limit or the length is zero, will throw a TmVirtualChannelError.
+ */
+    virtual uint8_t* allocSendPacket(size_t length);
 	
 public:
 /*! \brief Retrieves a packet with its timestamp from the input queue.
@@ -182,12 +202,30 @@ public:
  * Any errors occured in this process are returned within an instance of TmChannelWarning.
  *
  */
-	virtual TmChannelWarning receiveFrame(TmTransferFrame frame);
+	virtual TmChannelWarning receiveFrame(TmTransferFrame &&frame);
+
+/*! \brief Same as receiveFrame(TmTransferFrame&&) for a frame the caller keeps.
+ *
+ * The frame, including its Data Field, is deep-copied first. A caller passing a frame down by const reference at each
+ * layer pays one copy per layer (see Examples/Allocation_Example.cpp): move the frame in if it is no longer needed, or
+ * pass the raw frame to TmPhysicalChannel::receiveFrame(), which reads it in place.
+ */
+	virtual TmChannelWarning receiveFrame(const TmTransferFrame &frame);
+
+/*! \brief Updates the Rx Frame Counter for a received frame which only carries idle data.
+ *	\param frame The received frame (only the headers need to be unwrapped).
+ *	\return An instance of TmChannelWarning with any warnings/errors occured.
+ *
+ * Performs the same consistency check and counter update as TmVirtualChannel::receiveFrame, but the Data Field is not read. \n
+ * Called by the master channel for idle frames (see TmMasterChannel::isIdleFrame).
+ */
+	virtual TmChannelWarning receiveIdleFrame(TmTransferFrame &frame);
 	
 /*! \brief Creates a new TM frame, adjusts its settings and populates its Data Field.
  * \param timestamp TmFrameTimestamp when the frame will be send.
  *
- * This member function starts by creating a TM Transfer Frame and adjusting its settings to match those set in the master- and virtual channel it belongs. \n
+ * This member function starts by copying the frame template of this virtual channel, which already has the settings of the master- and virtual channel it belongs to. \n
+ * The template is only rebuilt (see TmVirtualChannel::updateSendTemplate) if any of these settings changed since the last frame.
  *	- Default First Header Pointer = fhpNoFirstHeader.
  *
  * Settings taken from the master channel:
@@ -292,6 +330,30 @@ protected:
  */
 	virtual TmChannelWarning signalNewPacket();
 
+/*! \brief Rebuilds the frame template used by sendFrame() if the master- or virtual channel settings changed.
+ *
+ * The template is a TM Transfer Frame with the frame length, OCF and FECF flags of the master channel and the
+ * Virtual Channel ID, Secondary Header, extended frame counter and Synchronization flags of this virtual channel. \n
+ * Each frame sent is a copy of this template; only the counters, the First Header Pointer and the Data Field are set per frame.
+ */
+	virtual void updateSendTemplate();
+
+/*! \brief Checks the settings of a received frame against the VC settings and updates the Rx Frame Counter.
+ *	\param frame The received frame.
+ *	\param warning Accumulates the warnings found.
+ *	\return TRUE if the frame settings match this virtual channel.
+ *
+ * If the frame counter does not match, the pre-buffer for received packets is cleared and the lost frames are counted.
+ */
+	virtual bool checkReceivedFrame(TmTransferFrame &frame, TmChannelWarning &warning);
+
+/*! \brief Validates the packets completed in the last received frame and places the valid ones in the input queue.
+ *
+ * All packets of a frame are checked in one pass with NetProtConf::validatePacket before any of them is queued,
+ * so corrupted packets never reach the packet sink. Invalid packets are dropped and counted in the returned warning.
+ */
+	virtual TmChannelWarning queueReceivedPackets();
+
 //
 // variables
 //
@@ -304,13 +366,17 @@ protected:
 	// attributes set for this virtual channel
     uint16_t virtualChannelId;	/*!< Virtual Channel ID. */
     uint64_t sendFrameCount;	/*!< Transmitted frames counter. */
-    uint64_t recFrameCount;		/*!< Received frames counter. */
+    TmSequenceTracker recSequence;	/*!< Follows the received frame counter (losses, duplicates and late frames). */
     bool secondHeaderPresent;	/*!< Secondary Header Flag. */
 	bool extendedFrameCountSet;	/*!< (Not part of the standard) Locally used flag to indicate usage of the Extended VC Frame Counter.*/
     bool dataFieldSynchronised;	/*!< The Synchronization Flag indicates the formatting of the Transfer Frame Data Field.
 											CAUTION! This variable is misleading: if dataFieldSynchronised = TRUE, it means the Synchronization Flag = FALSE*/
 	bool debugOutput;			/*!< Indicates whether any debug messages are to be displayed or not (default = FALSE). */
 	bool directDataFieldAccess;	/*!< Indicates the Data Field can be accessed directly (by means of a function wrapper). */
+
+	// frame template for sending
+	TmTransferFrame sendTemplate;	/*!< Preconfigured frame copied for each sent frame. See TmVirtualChannel::updateSendTemplate. */
+	bool sendTemplateValid;			/*!< Indicates whether sendTemplate matches the current virtual channel settings. */
 	
 	// Function object wrappers - boost library.
 	/*! Placeholder for a function that implements direct Data Field access to prepare packets for transmission. */
@@ -325,9 +391,12 @@ protected:
 														before sending them to the ground packet server. */
 	vector<uint8_t>::iterator sendPointer;		/*!< Position last Byte in the output queue which was sucessfully encapsulated in a frame. 
 														Useful to encapsulate chunks of oversized packets across several frames. */
+	vector<TimeTaggedPacket> recBatch;			/*!< Packets completed in the current frame, waiting for validation. */
 	vector<uint8_t> recPacket;					/*!< Pre-Buffer for received packets. Stores pieces of packets that span several frames, before putting the entire packet in the queue. */
 	uint64_t recPacketHeaderLength;				/*!< Packet header length according to the NetProtConf settings. */
 	uint64_t recPacketLength;					/*!< Total Packet length stored in the Packet Header and extracted as specified in NetProtConf. */
+	TmFrameTimestamp recPacketTimestamp;		/*!< Timestamp of the first Byte of the packet in the pre-buffer. */
+	TmFrameBitrate recPacketBitrate;			/*!< Reference bitrate of the timestamp of the packet in the pre-buffer. */
 };
 
 #endif // TmVirtualChannel_h
@@ -0,0 +1,158 @@
+#ifndef TmViterbiDecoder_h
+#define TmViterbiDecoder_h
+
+#include "myErrors.h"
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+/*! \brief Viterbi decoder for the CCSDS rate 1/2, constraint length 7 convolutional code (see TmConvolutionalEncoder).
+ *
+ * The decoder takes soft symbols: one Byte per channel symbol, from 0 (surely a 0 bit) to 255 (surely a 1 bit), 128 for
+ * an erased symbol. Hard-decision symbols can be passed packed into Bytes (see decodeHardSymbols()). Symbols are taken
+ * in pairs (G1, G2); a symbol left over at the end of a call is kept for the next one.
+ *
+ * The 64 path metrics are 16-bit values. With SSE2, each step runs the 32 add-compare-select butterflies 8 at a time
+ * and collects the 64 survivor decisions into one 64-bit word. The metrics are normalized to the best state after each step,
+ * so they never overflow. \n
+ * The decoded bits are released by tracing the survivors back from the best state over the traceback depth, a block
+ * of bits at a time. The decoded stream therefore lags the symbols by up to the traceback depth plus one block; flush()
+ * releases the rest at the end of a pass. \n
+ * The symbols carry no marker of which one is G1, so a stream may start with the pairs shifted by one symbol. Such a
+ * stream never matches a code sequence, and the best path metric grows much faster than with the right pairing. The
+ * decoder measures this growth over windows of TmViterbiDecoder::phaseWindowLength steps (see getMetricGrowth()) and
+ * shifts the pairing by one symbol when it exceeds a threshold (node synchronization, see setAutoPhase()). \n
+ * The decoded stream is not aligned to Bytes, so it is usually passed to a TmBitFrameSynchronizer. A decoder working on
+ * its own thread is provided by TmViterbiWorker.
+ */
+class TmViterbiDecoder {
+//
+// definitions
+//
+public:
+	static const uint16_t stateCount = 64;					/**< Number of encoder states (2^(K-1)). */
+	static const size_t defaultTracebackDepth = 96;		/**< Default traceback depth in bits (about 14 constraint lengths). */
+	static const size_t blockLength = 256;				/**< Number of bits released per traceback. */
+	static const uint8_t erasedSymbol = 128;				/**< Soft value of an erased (unknown) symbol. */
+	static const size_t phaseWindowLength = 1024;			/**< Steps over which the metric growth is measured. */
+	static const uint16_t defaultPhaseThreshold = 13;	/**< Default metric growth (percent of the symbol confidence) taken for a wrong symbol pairing. */
+
+//
+// methods
+//
+public:
+
+/*! \brief Constructor of the TmViterbiDecoder class.
+ *	\param tracebackDepth Number of steps traced back before a bit is released (at least 32).
+ *
+ * The G2 symbols are expected inverted (CCSDS).
+ * \note May throw TmViterbiDecoderError if the traceback depth is too short.
+ */
+	TmViterbiDecoder(size_t tracebackDepth = defaultTracebackDepth);
+
+/*! \brief Sets the inversion flag of the G2 symbol (TRUE for CCSDS). */
+	virtual void setInvertSecondSymbol(bool invert);
+
+/*! \brief Retrieves the inversion flag of the G2 symbol. */
+	virtual bool getInvertSecondSymbol();
+
+/*! \brief Retrieves the traceback depth in bits. */
+	virtual size_t getTracebackDepth();
+
+/*! \brief Selects whether the symbol pairing is shifted automatically when the metric growth exceeds the threshold (default = TRUE). */
+	virtual void setAutoPhase(bool active);
+
+/*! \brief Retrieves whether the symbol pairing is shifted automatically. */
+	virtual bool getAutoPhase();
+
+/*! \brief Sets the metric growth (see getMetricGrowth()) above which the symbol pairing is taken for the wrong one.
+ *
+ * With the right pairing the growth stays below 10 % down to an Eb/N0 of about 1 dB; a shifted pairing grows by 16 % or
+ * more. Streams too noisy to decode may make the decoder shift back and forth.
+ */
+	virtual void setPhaseThreshold(uint16_t threshold);
+
+/*! \brief Retrieves the phase threshold. */
+	virtual uint16_t getPhaseThreshold();
+
+/*! \brief Shifts the symbol pairing by one symbol. The survivors and any bits not released yet are dropped. */
+	virtual void flipPhase();
+
+/*! \brief Forgets the path metrics, the survivors and any bits not released yet. The counters are kept. */
+	virtual void reset();
+
+/*! \brief Decodes soft symbols.
+ *	\param symbols The soft symbols, alternately G1 and G2.
+ *	\param count Number of symbols.
+ *	\param output Receives the decoded Bytes released by this call, first bit in the most significant bit.
+ */
+	virtual void decode(const uint8_t *symbols, size_t count, vector<uint8_t> &output);
+
+/*! \brief Decodes hard-decision symbols packed into Bytes, first symbol in the most significant bit. */
+	virtual void decodeHardSymbols(const uint8_t *data, size_t length, vector<uint8_t> &output);
+
+/*! \brief Releases all decoded bits at the end of a pass. A last incomplete Byte is padded with zeros. */
+	virtual void flush(vector<uint8_t> &output);
+
+/*! \brief Retrieves the number of symbol pairs decoded. */
+	virtual uint64_t getStepCount();
+
+/*! \brief Retrieves the number of bits released. */
+	virtual uint64_t getReleasedBitCount();
+
+/*! \brief Retrieves the growth of the best path metric over the last complete window (0 before the first one).
+ *
+ * The growth beyond the hard decisions of the symbols, in percent of the confidence of the symbols (their distance from
+ * an erasure). It is 0 for a noiseless stream with the right pairing. A value close to the phase threshold means the
+ * symbols are shifted or too noisy to decode.
+ */
+	virtual uint16_t getMetricGrowth();
+
+/*! \brief Retrieves the number of times the symbol pairing was shifted. */
+	virtual uint64_t getPhaseFlipCount();
+
+/*! \brief Retrieves the number of symbols dropped by shifts of the symbol pairing, including those of steps not released as Bytes. */
+	virtual uint64_t getDroppedSymbolCount();
+
+protected:
+/*! \brief Runs one step of the trellis and stores the survivor decisions. */
+	virtual void addCompareSelect(uint8_t symbol1, uint8_t symbol2);
+
+/*! \brief Traces the survivors back and releases the oldest bits.
+ *	\param count Number of bits to release.
+ *	\param output Receives the completed Bytes.
+ */
+	virtual void traceback(size_t count, vector<uint8_t> &output);
+
+/*! \brief Evaluates the metric growth of a complete window and shifts the symbol pairing if it is too high. Returns TRUE if shifted. */
+	virtual bool checkPhase();
+
+//
+// variables
+//
+protected:
+	bool invertSecondSymbol;		/*!< Inversion flag of the G2 symbol (default = TRUE). */
+	bool autoPhase;					/*!< Indicates whether the symbol pairing is shifted automatically (default = TRUE). */
+	uint16_t phaseThreshold;		/*!< Metric growth (percent) above which the pairing is shifted. */
+	size_t tracebackDepth;			/*!< Steps traced back before a bit is released. */
+	int16_t metrics[stateCount];	/*!< Path metric of each state (lower is better). */
+	vector<uint64_t> decisions;		/*!< Survivor decisions of each step not released yet, one bit per state. */
+	uint8_t pendingSymbol;			/*!< G1 symbol waiting for its G2 symbol. */
+	bool symbolPending;				/*!< Indicates whether pendingSymbol is valid. */
+	bool skipSymbol;				/*!< Indicates whether the next symbol is dropped to shift the pairing. */
+	uint64_t phaseGrowth;			/*!< Growth of the best path metric in the current window. */
+	uint64_t phaseConfidence;		/*!< Confidence of the symbols in the current window. */
+	size_t phaseSteps;				/*!< Steps in the current window. */
+	uint16_t metricGrowth;			/*!< Metric growth of the last complete window (percent). */
+	uint32_t partialByte;			/*!< Released bits not forming a complete Byte yet. */
+	uint16_t partialBits;			/*!< Number of bits in partialByte. */
+	uint64_t stepCount;				/*!< Symbol pairs decoded. */
+	uint64_t releasedBitCount;		/*!< Bits released. */
+	uint64_t phaseFlipCount;		/*!< Times the symbol pairing was shifted. */
+	uint64_t droppedSymbolCount;	/*!< Symbols dropped by shifts of the symbol pairing. */
+};
+
+#endif // TmViterbiDecoder_h
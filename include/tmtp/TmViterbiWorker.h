@@ -0,0 +1,129 @@
+#ifndef TmViterbiWorker_h
+#define TmViterbiWorker_h
+
+#include "myErrors.h"
+#include "TmFrameTimestamp.h"
+#include "TmFrameBitrate.h"
+
+#include <vector>
+#include <deque>
+#include <stdint.h>
+#include <stddef.h>
+#include <boost/thread.hpp>
+
+using namespace std;
+
+class TmViterbiDecoder;		// Uses the TmViterbiDecoder class.
+class TmFrameSynchronizer;	// Uses the TmFrameSynchronizer class.
+
+/*! \brief Runs a TmViterbiDecoder on its own thread and passes the decoded stream to a frame synchronizer.
+ *
+ * The receiver pushes chunks of soft symbols (see pushSymbols()); they are copied into a bounded queue and decoded by
+ * the worker thread, which passes the decoded Bytes to the frame synchronizer (usually a TmBitFrameSynchronizer). So
+ * the decoder, the synchronizer and the physical channel behind it run on the worker thread, while the receiving
+ * thread only copies symbols. pushSymbols() blocks while the queue is full, which throttles a receiver faster than
+ * the decoder.
+ *
+ * The timestamp of each chunk is the receipt time of its first symbol. The worker keeps the timestamps of the chunks
+ * not decoded yet and advances them to the first decoded Byte passed on, using the symbol rate; the synchronizer gets
+ * the decoded bitrate (half the symbol rate). \n
+ * A shift of the symbol pairing by the decoder (see TmViterbiDecoder::setAutoPhase()) is reported as a warning.
+ *
+ * \note The callbacks of the physical channel (e.g. the virtual channel handlers) are called from the worker thread.
+ * The decoder and the synchronizer must not be used by other threads while the worker runs. Warnings of the physical
+ * channel are collected and retrieved with popWarnings().
+ */
+class TmViterbiWorker {
+//
+// definitions
+//
+public:
+	static const size_t defaultQueueLength = 64;	/**< Default number of symbol chunks in the queue. */
+
+//
+// methods
+//
+public:
+
+/*! \brief Constructor of the TmViterbiWorker class.
+ *	\param decoder The decoder run on the worker thread (not owned).
+ *	\param synchronizer The synchronizer receiving the decoded stream (not owned).
+ *	\param queueLength Number of symbol chunks the queue holds before pushSymbols() blocks.
+ *
+ * \note May throw TmViterbiDecoderError if the decoder or the synchronizer is missing.
+ */
+	TmViterbiWorker(TmViterbiDecoder *decoder, TmFrameSynchronizer *synchronizer, size_t queueLength = defaultQueueLength);
+
+/*! \brief Destructor of the TmViterbiWorker class. Stops the worker thread. */
+	virtual ~TmViterbiWorker();
+
+/*! \brief Starts the worker thread. Does nothing if it already runs. */
+	virtual void start();
+
+/*! \brief Decodes the queued symbols, flushes the decoder and stops the worker thread. */
+	virtual void stop();
+
+/*! \brief Indicates whether the worker thread runs. */
+	virtual bool isRunning();
+
+/*! \brief Queues a chunk of soft symbols for decoding.
+ *	\param symbols The soft symbols, alternately G1 and G2 (see TmViterbiDecoder::decode()).
+ *	\param count Number of symbols.
+ *	\param timestamp Receipt time of the first symbol of the chunk.
+ *	\param symbolRate The symbol rate of the channel, to compute the timestamps.
+ *
+ * The symbols are copied. Blocks while the queue is full. \n
+ * \note May throw TmViterbiDecoderError if the worker thread does not run.
+ */
+	virtual void pushSymbols(const uint8_t *symbols, size_t count, TmFrameTimestamp timestamp = TmFrameTimestamp(),
+			TmFrameBitrate symbolRate = TmFrameBitrate());
+
+/*! \brief Retrieves the warnings collected since the last call and clears them. */
+	virtual TmChannelWarning popWarnings();
+
+/*! \brief Retrieves the number of decoded Bytes passed to the synchronizer. */
+	virtual uint64_t getDecodedByteCount();
+
+protected:
+/*! \brief Main loop of the worker thread. */
+	virtual void run();
+
+/*! \brief Passes decoded Bytes to the synchronizer with the timestamp of their first bit. */
+	virtual void passData(vector<uint8_t> &data);
+
+//
+// variables
+//
+protected:
+	/*! \brief A chunk of soft symbols waiting in the queue. */
+	struct SymbolChunk {
+		vector<uint8_t> symbols;		/**< The soft symbols. */
+		TmFrameTimestamp timestamp;		/**< Receipt time of the first symbol. */
+		TmFrameBitrate symbolRate;		/**< Symbol rate of the channel. */
+	};
+
+	/*! \brief The timestamp of a chunk, kept until its symbols are released by the decoder. */
+	struct ChunkTime {
+		uint64_t firstSymbol;			/**< Index of the first symbol of the chunk in the stream. */
+		TmFrameTimestamp timestamp;		/**< Receipt time of the first symbol. */
+		TmFrameBitrate symbolRate;		/**< Symbol rate of the channel. */
+	};
+
+	TmViterbiDecoder *decoder;				/*!< The decoder (not owned). */
+	TmFrameSynchronizer *synchronizer;		/*!< The synchronizer receiving the decoded stream (not owned). */
+	size_t queueLength;						/*!< Chunks the queue holds before pushSymbols() blocks. */
+
+	deque<SymbolChunk> queue;				/*!< Chunks waiting to be decoded. */
+	boost::thread thread;					/*!< The worker thread. */
+	boost::mutex mutex;						/*!< Protects the queue, the flags and the warnings. */
+	boost::condition_variable queueChanged;	/*!< Signals a chunk pushed or taken, or a stop request. */
+	bool running;							/*!< Indicates whether the worker thread runs. */
+	bool stopRequested;						/*!< Asks the worker thread to finish. */
+	TmChannelWarning warnings;				/*!< Warnings collected by the worker thread. */
+
+	deque<ChunkTime> chunkTimes;			/*!< Timestamps of the chunks not released by the decoder (worker thread only). */
+	uint64_t symbolCount;					/*!< Symbols decoded (worker thread only). */
+	uint64_t decodedByteCount;				/*!< Decoded Bytes passed to the synchronizer. */
+};
+
+#endif // TmViterbiWorker_h
@@ -5,9 +5,24 @@
 #include "TmMasterChannel.h"
 #include "TmVirtualChannel.h"
 #include "TmTransferFrame.h"
+#include "TmFrameLayout.h"
+#include "TmCrc16.h"
+#include "TmSequenceTracker.h"
 #include "TmOcf.h"
 #include "TmFrameTimestamp.h"
+#include "TmFixedTimestamp.h"
 #include "TmFrameBitrate.h"
+#include "TmTimeCorrelation.h"
+#include "TmReedSolomon.h"
+#include "TmCadu.h"
+#include "TmFrameSynchronizer.h"
+#include "TmBitFrameSynchronizer.h"
+#include "TmConvolutionalEncoder.h"
+#include "TmViterbiDecoder.h"
+#include "TmViterbiWorker.h"
+#include "TmFrameIngestServer.h"
+#include "TmSharedFrameRing.h"
+#include "TmCortexFraming.h"
 #include "myErrors.h"
 
 #endif // Tmtp_h
\ No newline at end of file
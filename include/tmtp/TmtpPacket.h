@@ -3,9 +3,15 @@
 
 #include "NetProtConf.h"
 #include "SpacePacketConf.h"
+#include "SpacePacketBuilder.h"
+#include "EncapsulationPacketConf.h"
+#include "MultiplexedProtConf.h"
 #include "TestProtConf.h"
 #include "PacketServer.h"
 #include "GroundPacketServer.h"
+#include "PacketRouter.h"
+#include "SpacePacketSequencer.h"
+#include "TmPacketPublisher.h"
 #include "myErrors.h"
 
 #endif // TmtpPacket_h
\ No newline at end of file
@@ -185,6 +185,132 @@ public:
 		: runtime_error(what_arg)
 	{}
 };
+
+/*! \brief Reports any errors related to the generation of Space Packets.
+ *
+ * Inherits the contructor of std::runtime_error. \n
+ * Basically, this is just runtime_error under another name. 
+ * Each time a packet cannot be built (e.g. the buffer is too small or the APID is out of range) 
+ * there is a "throw" instruction specifying what went wrong using a message stored in a string variable. \n
+ */
+class SpacePacketBuilderError : public runtime_error {
+public:
+
+/*! \brief Constructor of the SpacePacketBuilderError class.
+ *	\param what_arg The error message to display or to accumulate.
+ */
+	explicit SpacePacketBuilderError(const string& what_arg)
+		: runtime_error(what_arg)
+	{}
+};
+
+/*! \brief Reports any errors related to the Reed-Solomon code.
+ *
+ * Inherits the contructor of std::runtime_error. \n
+ * Basically, this is just runtime_error under another name. 
+ * Each time a frame does not fit the code (e.g. its length is not a multiple of the interleave depth) 
+ * there is a "throw" instruction specifying what went wrong using a message stored in a string variable. \n
+ */
+class TmReedSolomonError : public runtime_error {
+public:
+
+/*! \brief Constructor of the TmReedSolomonError class.
+ *	\param what_arg The error message to display or to accumulate.
+ */
+	explicit TmReedSolomonError(const string& what_arg)
+		: runtime_error(what_arg)
+	{}
+};
+
+/*! \brief Reports any errors related to the frame synchronizer.
+ *
+ * Inherits the contructor of std::runtime_error. \n
+ * Basically, this is just runtime_error under another name. 
+ * Each time the synchronizer cannot work on the configured physical channel (e.g. with variable-length frames) 
+ * there is a "throw" instruction specifying what went wrong using a message stored in a string variable. \n
+ */
+class TmFrameSynchronizerError : public runtime_error {
+public:
+
+/*! \brief Constructor of the TmFrameSynchronizerError class.
+ *	\param what_arg The error message to display or to accumulate.
+ */
+	explicit TmFrameSynchronizerError(const string& what_arg)
+		: runtime_error(what_arg)
+	{}
+};
+
+/*! \brief Reports any errors related to the Viterbi decoder.
+ *
+ * Inherits the contructor of std::runtime_error. \n
+ * Basically, this is just runtime_error under another name. 
+ * Each time the decoder or its worker thread is misconfigured (e.g. the traceback depth is too short) 
+ * there is a "throw" instruction specifying what went wrong using a message stored in a string variable. \n
+ */
+class TmViterbiDecoderError : public runtime_error {
+public:
+
+/*! \brief Constructor of the TmViterbiDecoderError class.
+ *	\param what_arg The error message to display or to accumulate.
+ */
+	explicit TmViterbiDecoderError(const string& what_arg)
+		: runtime_error(what_arg)
+	{}
+};
+
+/*! \brief Reports any errors related to the frame ingest server.
+ *
+ * Inherits the contructor of std::runtime_error. \n
+ * Basically, this is just runtime_error under another name. 
+ * Each time a socket cannot be opened or a received record is malformed 
+ * there is a "throw" instruction specifying what went wrong using a message stored in a string variable. \n
+ */
+class TmFrameIngestServerError : public runtime_error {
+public:
+
+/*! \brief Constructor of the TmFrameIngestServerError class.
+ *	\param what_arg The error message to display or to accumulate.
+ */
+	explicit TmFrameIngestServerError(const string& what_arg)
+		: runtime_error(what_arg)
+	{}
+};
+
+/*! \brief Reports any errors related to the shared-memory frame ring.
+ *
+ * Inherits the contructor of std::runtime_error. \n
+ * Basically, this is just runtime_error under another name. 
+ * Each time the shared memory cannot be opened or mapped, or a frame does not fit into a slot, 
+ * there is a "throw" instruction specifying what went wrong using a message stored in a string variable. \n
+ */
+class TmSharedFrameRingError : public runtime_error {
+public:
+
+/*! \brief Constructor of the TmSharedFrameRingError class.
+ *	\param what_arg The error message to display or to accumulate.
+ */
+	explicit TmSharedFrameRingError(const string& what_arg)
+		: runtime_error(what_arg)
+	{}
+};
+
+/*! \brief Reports any errors related to the Cortex message framing.
+ *
+ * Inherits the contructor of std::runtime_error. \n
+ * Basically, this is just runtime_error under another name. 
+ * Each time a message flag or length is invalid or a frame is too long for a message 
+ * there is a "throw" instruction specifying what went wrong using a message stored in a string variable. \n
+ */
+class TmCortexFramingError : public runtime_error {
+public:
+
+/*! \brief Constructor of the TmCortexFramingError class.
+ *	\param what_arg The error message to display or to accumulate.
+ */
+	explicit TmCortexFramingError(const string& what_arg)
+		: runtime_error(what_arg)
+	{}
+};
 
 
 //
@@ -201,6 +327,9 @@ public:
  * 	- frameUnwrapError is cleared.
  * 	- lostMCFrames = 0
  * 	- lostVCFrames = 0
+ * 	- duplicateFrames = 0
+ * 	- outOfOrderFrames = 0
+ * 	- invalidPackets = 0
  * 	- packetResync = false
  * 	- noPacketSinkSpecified = false
  * 	- noOcfSinkSpecified = false
@@ -250,6 +379,21 @@ public:
  */
 	virtual void addVCLostFramesCount(uint64_t count);
 
+/*! \brief Accumulates the ammount of frames dropped because they were received twice.
+ *	\param count The ammount of duplicate frames.
+ */
+	virtual void addDuplicateFramesCount(uint64_t count);
+
+/*! \brief Accumulates the ammount of frames dropped because they arrived after later frames.
+ *	\param count The ammount of late frames.
+ */
+	virtual void addOutOfOrderFramesCount(uint64_t count);
+
+/*! \brief Accumulates the ammount of packets dropped because their packet error control failed.
+ *	\param count The ammount of invalid packets.
+ */
+	virtual void addInvalidPacketsCount(uint64_t count);
+
 /*! \brief Sets the packetResync flag to TRUE. */
 	virtual void setPacketResynced();
 
@@ -304,6 +448,9 @@ private:
 	string frameUnwrapError;		/*!< Error message while unwrapping a frame. */
 	uint16_t lostMCFrames;	/*!< Ammount of lost frames in a master channel. */
 	uint64_t lostVCFrames;		/*!< Ammount of lost frames in a vitual channel. */
+	uint64_t duplicateFrames;		/*!< Ammount of dropped duplicate frames. */
+	uint64_t outOfOrderFrames;		/*!< Ammount of dropped frames which arrived out of order. */
+	uint64_t invalidPackets;		/*!< Ammount of dropped packets with a wrong packet error control field. */
 	bool packetResync;				/*!< Indicates if a packet has been moved within the Data Field. */
 	bool noPacketSinkSpecified;		/*!< Indicates if a packet sink has been defined in the ground packet server. */
 	bool noOcfSinkSpecified;		/*!< Indicates if an OCF sink has been defined in the ground OCF server. */
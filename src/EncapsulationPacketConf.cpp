@@ -0,0 +1,202 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "EncapsulationPacketConf.h"
+#include "NetProtConf.h"
+
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+// Computes the header length of each possible first Byte (zero if it is not an Encapsulation Packet).
+static const uint8_t *encapsulationHeaderTable()
+{
+	static uint8_t table[256];
+	const uint8_t lengths[4] = {1, 2, 4, 8};	// Header length for each length of length.
+	for (uint16_t byte = 0; byte < 256; byte++) {
+		table[byte] = (((byte >> 5) & 0x07) == EncapsulationPacketConf::packetVersion) ? lengths[byte & 0x03] : 0;
+	}
+	return table;
+}
+static const uint8_t *headerLengthLookup = encapsulationHeaderTable();	// The table is built once when the library is loaded.
+
+// Constructor of the EncapsulationPacketConf class.
+EncapsulationPacketConf::EncapsulationPacketConf()
+{
+	testProtocolId = ipeProtocolId;
+}
+
+// Sets the protocol ID of the test packets.
+void EncapsulationPacketConf::setProtocolId(uint8_t protocolId)
+{
+	testProtocolId = protocolId & 0x07;
+}
+
+// Checks if the first Byte of a packet belongs to an idle packet.
+bool EncapsulationPacketConf::isIdlePacket(uint8_t firstByteOfHeader)
+{
+	return (firstByteOfHeader & 0xFC) == idlePacket;	// Version 111 and protocol ID 000, any length of length.
+}
+
+// Returns the header length selected by the first Byte of a packet.
+uint64_t EncapsulationPacketConf::getPacketHeaderLength(uint8_t firstByteOfHeader)
+{
+	uint8_t headerLength = headerLengthLookup[firstByteOfHeader];
+	return (headerLength > 0) ? headerLength : 1;	// Anything else is taken as a 1-Byte packet and dropped by validatePacket().
+}
+
+// Extracts the total packet length from a complete header.
+uint64_t EncapsulationPacketConf::extractPacketLength(const vector<uint8_t> &header)
+{
+	if (header.empty()) {
+		return 1;
+	}
+	uint64_t packetLength = 0;
+	uint64_t headerLength = parseHeader(&header[0], header.size(), packetLength);
+	if (headerLength == 0) {
+		return header.size();
+	}
+	return (packetLength > headerLength) ? packetLength : headerLength;
+}
+
+// Parses the header of an Encapsulation Packet in place.
+uint64_t EncapsulationPacketConf::parseHeader(const uint8_t *data, size_t length, uint64_t &packetLength)
+{
+	if (length == 0) {
+		return 0;
+	}
+	uint8_t headerLength = headerLengthLookup[data[0]];
+	if ((headerLength == 0) || (length < headerLength)) {
+		return 0;
+	}
+	switch (headerLength) {
+		case 1:
+			packetLength = 1;
+			break;
+		case 2:
+			packetLength = data[1];
+			break;
+		case 4:
+			packetLength = ((uint64_t) data[2] << 8) | data[3];
+			break;
+		default:
+			packetLength = ((uint64_t) data[4] << 24) | ((uint64_t) data[5] << 16) | ((uint64_t) data[6] << 8) | data[7];
+			break;
+	}
+	return headerLength;
+}
+
+// Counts the idle packets at the beginning of a buffer.
+size_t EncapsulationPacketConf::skipIdlePackets(const uint8_t *data, size_t length)
+{
+	size_t pos = 0;
+	while (pos < length) {
+		pos += countLeadingMasked(data + pos, length - pos, 0xFF, idlePacket);	// The whole run of 1-Byte idle packets.
+		if ((pos >= length) || ((data[pos] & 0xFC) != idlePacket)) {
+			break;
+		}
+		// A longer idle packet is skipped if it lies completely within the buffer.
+		uint64_t packetLength = 0;
+		uint64_t headerLength = parseHeader(data + pos, length - pos, packetLength);
+		if ((headerLength == 0) || (packetLength < headerLength) || (packetLength > length - pos)) {
+			break;
+		}
+		pos += packetLength;
+	}
+	return pos;
+}
+
+// Checks that the length field of a complete received packet matches its size.
+bool EncapsulationPacketConf::validatePacket(const vector<uint8_t> &packet)
+{
+	if (packet.empty()) {
+		return false;
+	}
+	uint64_t packetLength = 0;
+	uint64_t headerLength = parseHeader(&packet[0], packet.size(), packetLength);
+	if (headerLength == 0) {
+		return false;							// Not an Encapsulation Packet.
+	}
+	if (headerLength == 1) {
+		return (packet.size() == 1) && ((packet[0] & 0xFC) == idlePacket);	// Only idle packets have no length field.
+	}
+	return packetLength == packet.size();
+}
+
+// Returns a 1-Byte idle packet.
+uint8_t EncapsulationPacketConf::genIdlePacket()
+{
+	return idlePacket;
+}
+
+// Encapsulates a message into an Encapsulation Packet with the shortest header its length fits into.
+vector<uint8_t> EncapsulationPacketConf::genTestPacket(vector<uint8_t> message)
+{
+	vector<uint8_t> packet;
+	uint8_t firstByte = (packetVersion << 5) | (testProtocolId << 2);
+	uint64_t packetLength;
+
+	if (message.size() + 2 <= 0xFF) {				// Length of length 01: the length fits into one Byte.
+		packetLength = message.size() + 2;
+		packet.reserve(packetLength);
+		packet.push_back(firstByte | 0x01);
+		packet.push_back(packetLength & 0xFF);
+	} else if (message.size() + 4 <= 0xFFFF) {		// Length of length 10: two Bytes.
+		packetLength = message.size() + 4;
+		packet.reserve(packetLength);
+		packet.push_back(firstByte | 0x02);
+		packet.push_back(0x00);						// User defined field and protocol ID extension.
+		packet.push_back((packetLength >> 8) & 0xFF);
+		packet.push_back(packetLength & 0xFF);
+	} else {										// Length of length 11: four Bytes.
+		packetLength = message.size() + 8;
+		packet.reserve(packetLength);
+		packet.push_back(firstByte | 0x03);
+		packet.push_back(0x00);						// User defined field and protocol ID extension.
+		packet.push_back(0x00);						// CCSDS defined field.
+		packet.push_back(0x00);
+		for (int shift = 24; shift >= 0; shift -= 8) {
+			packet.push_back((packetLength >> shift) & 0xFF);
+		}
+	}
+	packet.insert(packet.end(), message.begin(), message.end());
+	return packet;
+}
+
+// Displays the header fields of a packet for debugging.
+void EncapsulationPacketConf::packetDebugOutput(vector<uint8_t> packet)
+{
+	uint64_t packetLength = 0;
+	uint64_t headerLength = packet.empty() ? 0 : parseHeader(&packet[0], packet.size(), packetLength);
+	if (headerLength == 0) {
+		cout << "Error: Not an Encapsulation Packet." << endl;
+		return;
+	}
+	cout << "Encapsulation Packet[" << dec << packetLength << "] ";
+	cout << "PID: " << dec << ((packet[0] >> 2) & 0x07) << ", ";
+	cout << "LoL: " << dec << (packet[0] & 0x03) << ", ";
+	cout << "Header: " << dec << headerLength << endl;
+	if (packet.size() > packetLength) {
+		cout << "Warning: Packet is too long." << endl;
+	} else if (packet.size() < packetLength) {
+		cout << "Error: Packet is too short." << endl;
+	}
+}
@@ -0,0 +1,160 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "MultiplexedProtConf.h"
+#include "NetProtConf.h"
+
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+// Constructor of the MultiplexedProtConf class.
+MultiplexedProtConf::MultiplexedProtConf()
+{
+	for (uint8_t version = 0; version < versionCount; version++) {
+		versionConfs[version] = NULL;
+	}
+	defaultConf = NULL;
+	this->refreshLookupTables();
+}
+
+// Assigns a configuration to a packet version.
+void MultiplexedProtConf::setProtConf(uint8_t version, NetProtConf *conf)
+{
+	versionConfs[version & 0x07] = conf;
+	if (!defaultConf) {
+		defaultConf = conf;
+	}
+	this->refreshLookupTables();
+}
+
+// Retrieves the configuration of a packet version.
+NetProtConf *MultiplexedProtConf::getProtConf(uint8_t version)
+{
+	return versionConfs[version & 0x07];
+}
+
+// Selects the configuration which generates idle fill and test packets.
+void MultiplexedProtConf::setDefaultProtConf(NetProtConf *conf)
+{
+	defaultConf = conf;
+}
+
+// Retrieves the configuration which generates idle fill and test packets.
+NetProtConf *MultiplexedProtConf::getDefaultProtConf()
+{
+	return defaultConf;
+}
+
+// Queries the sub-configurations for the header length and idle flag of each first Byte.
+void MultiplexedProtConf::refreshLookupTables()
+{
+	for (uint16_t byte = 0; byte < 256; byte++) {
+		NetProtConf *conf = versionConfs[(byte >> 5) & 0x07];
+		confLookup[byte] = conf;
+		if (conf) {
+			headerLengthLookup[byte] = conf->getPacketHeaderLength(byte);
+			idleLookup[byte] = conf->isIdlePacket(byte);
+		} else {
+			headerLengthLookup[byte] = 1;		// Versions without configuration are skipped one Byte at a time.
+			idleLookup[byte] = true;
+		}
+	}
+}
+
+// Checks if the first Byte of a packet belongs to an idle packet.
+bool MultiplexedProtConf::isIdlePacket(uint8_t firstByteOfHeader)
+{
+	return idleLookup[firstByteOfHeader];
+}
+
+// Returns the header length of a packet.
+uint64_t MultiplexedProtConf::getPacketHeaderLength(uint8_t firstByteOfHeader)
+{
+	return headerLengthLookup[firstByteOfHeader];
+}
+
+// Extracts the packet length with the configuration of the packet version.
+uint64_t MultiplexedProtConf::extractPacketLength(const vector<uint8_t> &header)
+{
+	NetProtConf *conf = header.empty() ? NULL : confLookup[header[0]];
+	return conf ? conf->extractPacketLength(header) : 1;
+}
+
+// Counts the idle packets at the beginning of a buffer.
+size_t MultiplexedProtConf::skipIdlePackets(const uint8_t *data, size_t length)
+{
+	size_t pos = 0;
+	while (pos < length) {
+		NetProtConf *conf = confLookup[data[pos]];
+		size_t skipped;
+		if (conf) {
+			skipped = conf->skipIdlePackets(data + pos, length - pos);
+		} else {
+			skipped = countLeadingVersion(data + pos, length - pos, data[pos] >> 5);	// The whole run of the unknown version.
+		}
+		if (skipped == 0) {
+			break;
+		}
+		pos += skipped;
+	}
+	return pos;
+}
+
+// Checks a complete received packet with the configuration of its version.
+bool MultiplexedProtConf::validatePacket(const vector<uint8_t> &packet)
+{
+	NetProtConf *conf = packet.empty() ? NULL : confLookup[packet[0]];
+	return conf ? conf->validatePacket(packet) : false;
+}
+
+// Generates an idle packet with the default configuration.
+uint8_t MultiplexedProtConf::genIdlePacket()
+{
+	return defaultConf ? defaultConf->genIdlePacket() : NetProtConf::genIdlePacket();
+}
+
+// Fills a buffer with idle packets of the default configuration.
+void MultiplexedProtConf::genIdleFill(uint8_t *dest, size_t length)
+{
+	if (defaultConf) {
+		defaultConf->genIdleFill(dest, length);
+	} else {
+		NetProtConf::genIdleFill(dest, length);
+	}
+}
+
+// Generates a test packet with the default configuration.
+vector<uint8_t> MultiplexedProtConf::genTestPacket(vector<uint8_t> message)
+{
+	return defaultConf ? defaultConf->genTestPacket(message) : NetProtConf::genTestPacket(message);
+}
+
+// Displays a packet with the configuration of its version.
+void MultiplexedProtConf::packetDebugOutput(vector<uint8_t> packet)
+{
+	NetProtConf *conf = packet.empty() ? NULL : confLookup[packet[0]];
+	if (conf) {
+		conf->packetDebugOutput(packet);
+	} else {
+		cout << "Error: No configuration for this packet version." << endl;
+	}
+}
@@ -20,6 +20,11 @@ along with tmtp. If not, see <http://www.gnu.org/licenses/>.
 #include <vector>
 #include <iostream>
 #include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 
@@ -33,7 +38,7 @@ bool NetProtConf::isIdlePacket(uint8_t)
 	return true;
 }
 
-uint64_t NetProtConf::extractPacketLength(vector<uint8_t>)
+uint64_t NetProtConf::extractPacketLength(const vector<uint8_t> &)
 {
 	// Idle packets have a length of 1.
 	return 1;
@@ -51,6 +56,59 @@ uint8_t NetProtConf::genIdlePacket()
 	return '*';
 }
 
+void NetProtConf::genIdleFill(uint8_t *dest, size_t length)
+{
+	// All idle packets are a single Byte, so the whole buffer is set at once.
+	memset(dest, this->genIdlePacket(), length);
+}
+
+size_t NetProtConf::skipIdlePackets(const uint8_t *data, size_t length)
+{
+	size_t i = 0;
+	while ((i < length) && this->isIdlePacket(data[i])) {
+		i++;
+	}
+	return i;
+}
+
+bool NetProtConf::validatePacket(const vector<uint8_t> &)
+{
+	// No error control: every packet is accepted.
+	return true;
+}
+
+size_t NetProtConf::countLeadingVersion(const uint8_t *data, size_t length, uint8_t version)
+{
+	// The packet version is stored in the three most significant bits.
+	return countLeadingMasked(data, length, 0xE0, (version & 0x07) << 5);
+}
+
+size_t NetProtConf::countLeadingMasked(const uint8_t *data, size_t length, uint8_t mask, uint8_t bits)
+{
+	const uint8_t versionMask = mask;
+	const uint8_t versionBits = bits & mask;
+	size_t i = 0;
+
+#ifdef __SSE2__
+	// Compares 16 Bytes at once. The first mismatch is located by means of the comparison bit mask.
+	const __m128i maskBlock = _mm_set1_epi8((char) versionMask);
+	const __m128i pattern = _mm_set1_epi8((char) versionBits);
+	for (; i + 16 <= length; i += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i*) (data + i));
+		int match = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(block, maskBlock), pattern));
+		if (match != 0xFFFF) {
+			return i + __builtin_ctz(~match);
+		}
+	}
+#endif
+
+	// Remaining Bytes (or all of them without SSE2).
+	while ((i < length) && ((data[i] & versionMask) == versionBits)) {
+		i++;
+	}
+	return i;
+}
+
 vector<uint8_t> NetProtConf::genTestPacket(vector<uint8_t>)
 {
 	// The test packet is also an idle packet
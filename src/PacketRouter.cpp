@@ -0,0 +1,253 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "PacketRouter.h"
+#include "GroundPacketServer.h"
+#include "TmVirtualChannel.h"
+#include "NetProtConf.h"
+#include "myErrors.h"
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <map>
+#include <string>
+#include <stdint.h>
+
+using namespace std;
+
+const size_t PacketRouter::noRoute;		// Bound to references by vector::assign, so it needs a definition.
+
+// Constructor of the PacketRouter class.
+PacketRouter::PacketRouter(NetProtConf *conf) : GroundPacketServer(conf)
+{
+	apidRoutes.assign(SpacePacketConf::apidCount, noRoute);		// No APID has a route yet.
+	apidHasPusRoutes.assign(SpacePacketConf::apidCount, false);
+	defaultRoute = noRoute;						// Packets without a route are dropped.
+	unroutedCount = 0;
+}
+
+// Adds a route with its own queue.
+size_t PacketRouter::addRoute(string name, size_t capacity, OverflowPolicy policy)
+{
+	PacketRoute route;
+	route.name = name;
+	route.capacity = (capacity > 0) ? capacity : 1;
+	route.policy = policy;
+	route.routedCount = 0;
+	route.droppedCount = 0;
+	routes.push_back(route);
+	return routes.size() - 1;
+}
+
+// Routes all packets of an APID to a route.
+void PacketRouter::routeApid(uint16_t apid, size_t route)
+{
+	this->routeApidRange(apid, apid, route);
+}
+
+// Routes all packets of a range of APIDs to a route.
+void PacketRouter::routeApidRange(uint16_t firstApid, uint16_t lastApid, size_t route)
+{
+	this->checkRoute(route);
+	if ((firstApid > lastApid) || (lastApid >= SpacePacketConf::apidCount)) {
+		ostringstream error;
+		error << "APID range " << dec << firstApid << "-" << lastApid << " out of range (0-" << SpacePacketConf::apidCount - 1 << ")." << endl;
+		throw GroundPacketServerError(error.str());
+	}
+	for (uint16_t apid = firstApid; apid <= lastApid; apid++) {
+		apidRoutes[apid] = route;
+	}
+}
+
+// Routes the packets of an APID with a PUS service type and subtype to a route.
+void PacketRouter::routePusService(uint16_t apid, uint8_t serviceType, uint8_t serviceSubtype, size_t route)
+{
+	this->checkRoute(route);
+	if (apid >= SpacePacketConf::apidCount) {
+		ostringstream error;
+		error << "APID " << dec << apid << " out of range (0-" << SpacePacketConf::apidCount - 1 << ")." << endl;
+		throw GroundPacketServerError(error.str());
+	}
+	pusRoutes[pusKey(apid, serviceType, serviceSubtype)] = route;
+	apidHasPusRoutes[apid] = true;
+}
+
+// Removes the route of an APID, including its PUS service routes.
+void PacketRouter::unrouteApid(uint16_t apid)
+{
+	if (apid >= SpacePacketConf::apidCount) {
+		return;
+	}
+	apidRoutes[apid] = noRoute;
+	if (apidHasPusRoutes[apid]) {
+		pusRoutes.erase(pusRoutes.lower_bound(pusKey(apid, 0, 0)), pusRoutes.upper_bound(pusKey(apid, 0xFF, 0xFF)));
+		apidHasPusRoutes[apid] = false;
+	}
+}
+
+// Routes the packets of all APIDs without a route to a route.
+void PacketRouter::setDefaultRoute(size_t route)
+{
+	this->checkRoute(route);
+	defaultRoute = route;
+}
+
+// Drops the packets of all APIDs without a route.
+void PacketRouter::clearDefaultRoute()
+{
+	defaultRoute = noRoute;
+}
+
+// Finds the route of a packet.
+size_t PacketRouter::findRoute(const vector<uint8_t> &packet)
+{
+	if (packet.size() < 2) {
+		return defaultRoute;
+	}
+	uint16_t apid = SpacePacketConf::extractApid(&packet[0]);
+	if (apidHasPusRoutes[apid] && ((packet[0] >> 3) & 0x01) && (packet.size() >= 9)) {	// The Data Field Header flag.
+		// The PUS service type and subtype follow the PUS version in the Data Field Header.
+		map<uint32_t, size_t>::iterator found = pusRoutes.find(pusKey(apid, packet[7], packet[8]));
+		if (found != pusRoutes.end()) {
+			return found->second;
+		}
+	}
+	return (apidRoutes[apid] != noRoute) ? apidRoutes[apid] : defaultRoute;
+}
+
+// Places a packet in the queue of its route, applying the overflow policy of the route.
+void PacketRouter::routePacket(const TimeTaggedPacket &packet)
+{
+	size_t found = this->findRoute(packet.data);
+	if (found == noRoute) {
+		unroutedCount++;
+		return;
+	}
+	PacketRoute &route = routes[found];
+	if (route.queue.size() >= route.capacity) {
+		route.droppedCount++;
+		if (route.policy == dropNewest) {
+			return;
+		}
+		route.queue.pop_front();		// dropOldest: the new packet takes the place of the oldest one.
+	}
+	route.queue.push_back(packet);
+	route.routedCount++;
+	if (debugOutput) {
+		cout << "Routed to " << route.name << ": " << flush;
+		netProtConf->packetDebugOutput(packet.data);
+	}
+}
+
+// Takes all packets from the input queue of the virtual channel and routes them.
+void PacketRouter::signalNewPacket()
+{
+	if (tmVc) {								// If a virtual channel has been defined.
+		while (tmVc->packetAvailable()) {	// ... And while there are packets waiting in the input queue:
+			try {
+				this->routePacket(tmVc->receivePacket());
+			} catch (TmVirtualChannelError& e) {
+				ostringstream error;
+				error << "Error in TmVirtualChannel: " << e.what() << endl;
+				throw GroundPacketServerError(error.str());
+			}
+		}
+	} else {
+		ostringstream error;
+		error << "No TmVirtualChannel specified." << endl;
+		throw GroundPacketServerError(error.str());
+	}
+}
+
+// Indicates whether the queue of a route holds a packet.
+bool PacketRouter::packetAvailable(size_t route)
+{
+	return (route < routes.size()) && !routes[route].queue.empty();
+}
+
+// Takes the oldest packet from the queue of a route.
+TimeTaggedPacket PacketRouter::receivePacket(size_t route)
+{
+	this->checkRoute(route);
+	if (routes[route].queue.empty()) {
+		ostringstream error;
+		error << "No packet available on route " << routes[route].name << "." << endl;
+		throw GroundPacketServerError(error.str());
+	}
+	TimeTaggedPacket packet = routes[route].queue.front();
+	routes[route].queue.pop_front();
+	return packet;
+}
+
+// Retrieves the number of routes.
+size_t PacketRouter::getRouteCount()
+{
+	return routes.size();
+}
+
+// Retrieves the name of a route.
+string PacketRouter::getRouteName(size_t route)
+{
+	this->checkRoute(route);
+	return routes[route].name;
+}
+
+// Retrieves the number of packets in the queue of a route.
+size_t PacketRouter::getQueuedCount(size_t route)
+{
+	this->checkRoute(route);
+	return routes[route].queue.size();
+}
+
+// Retrieves the number of packets placed in the queue of a route.
+uint64_t PacketRouter::getRoutedCount(size_t route)
+{
+	this->checkRoute(route);
+	return routes[route].routedCount;
+}
+
+// Retrieves the number of packets dropped by the overflow policy of a route.
+uint64_t PacketRouter::getDroppedCount(size_t route)
+{
+	this->checkRoute(route);
+	return routes[route].droppedCount;
+}
+
+// Retrieves the number of packets dropped because they had no route.
+uint64_t PacketRouter::getUnroutedCount()
+{
+	return unroutedCount;
+}
+
+// Throws a GroundPacketServerError if the route does not exist.
+void PacketRouter::checkRoute(size_t route)
+{
+	if (route >= routes.size()) {
+		ostringstream error;
+		error << "Route " << dec << route << " does not exist." << endl;
+		throw GroundPacketServerError(error.str());
+	}
+}
+
+// Key of a PUS service route.
+uint32_t PacketRouter::pusKey(uint16_t apid, uint8_t serviceType, uint8_t serviceSubtype)
+{
+	return ((uint32_t) apid << 16) | ((uint32_t) serviceType << 8) | serviceSubtype;
+}
@@ -0,0 +1,189 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "SpacePacketBuilder.h"
+#include "SpacePacketConf.h"
+#include "TmVirtualChannel.h"
+#include "myErrors.h"
+
+#include <sstream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+using namespace std;
+
+// Constructor of the SpacePacketBuilder class.
+SpacePacketBuilder::SpacePacketBuilder()
+{
+	packetType = 0;									// Telemetry.
+	pusVersion = 1;
+	errorControl = SpacePacketConf::noErrorControl;
+	this->resetSequenceCounts();
+}
+
+// Sets the packet type.
+void SpacePacketBuilder::setPacketType(uint16_t type)
+{
+	packetType = type & 0x0001;
+}
+
+// Sets the PUS version written into the PUS Data Field Header.
+void SpacePacketBuilder::setPusVersion(uint16_t version)
+{
+	pusVersion = version & 0x0007;
+}
+
+// Selects the Packet Error Control field appended to each packet.
+void SpacePacketBuilder::setPacketErrorControl(SpacePacketConf::PacketErrorControl type)
+{
+	errorControl = type;
+}
+
+// Retrieves the selected Packet Error Control.
+SpacePacketConf::PacketErrorControl SpacePacketBuilder::getPacketErrorControl()
+{
+	return errorControl;
+}
+
+// Computes the total length of a packet.
+size_t SpacePacketBuilder::getPacketLength(size_t length, bool pusHeader)
+{
+	return primaryHeaderLength + (pusHeader ? pusHeaderLength : 0) + length
+		+ ((errorControl == SpacePacketConf::noErrorControl) ? 0 : 2);
+}
+
+// Writes a packet without Data Field Header into a buffer.
+size_t SpacePacketBuilder::buildPacket(uint8_t *dest, size_t capacity, uint16_t apid, const uint8_t *data, size_t length,
+		uint16_t groupingFlags)
+{
+	size_t packetLength = this->checkPacket(apid, length, false, groupingFlags);
+	if (packetLength > capacity) {
+		ostringstream error;
+		error << "Buffer too small for the packet (" << dec << capacity << " instead of " << packetLength << " Bytes)." << endl;
+		throw SpacePacketBuilderError(error.str());
+	}
+	this->writePacket(dest, packetLength, apid, false, 0, 0, data, length, groupingFlags);
+	return packetLength;
+}
+
+// Writes a packet with a PUS Data Field Header into a buffer.
+size_t SpacePacketBuilder::buildPusPacket(uint8_t *dest, size_t capacity, uint16_t apid, uint8_t serviceType,
+		uint8_t serviceSubtype, const uint8_t *data, size_t length)
+{
+	size_t packetLength = this->checkPacket(apid, length, true, SpacePacketConf::unsegmented);
+	if (packetLength > capacity) {
+		ostringstream error;
+		error << "Buffer too small for the packet (" << dec << capacity << " instead of " << packetLength << " Bytes)." << endl;
+		throw SpacePacketBuilderError(error.str());
+	}
+	this->writePacket(dest, packetLength, apid, true, serviceType, serviceSubtype, data, length, SpacePacketConf::unsegmented);
+	return packetLength;
+}
+
+// Writes a packet without Data Field Header directly into the output queue of a virtual channel.
+size_t SpacePacketBuilder::sendPacket(TmVirtualChannel *vc, uint16_t apid, const uint8_t *data, size_t length,
+		uint16_t groupingFlags)
+{
+	size_t packetLength = this->checkPacket(apid, length, false, groupingFlags);
+	uint8_t *dest = vc->allocSendPacket(packetLength);	// The packet is written in its place in the output queue.
+	this->writePacket(dest, packetLength, apid, false, 0, 0, data, length, groupingFlags);
+	return packetLength;
+}
+
+// Writes a packet with a PUS Data Field Header directly into the output queue of a virtual channel.
+size_t SpacePacketBuilder::sendPusPacket(TmVirtualChannel *vc, uint16_t apid, uint8_t serviceType, uint8_t serviceSubtype,
+		const uint8_t *data, size_t length)
+{
+	size_t packetLength = this->checkPacket(apid, length, true, SpacePacketConf::unsegmented);
+	uint8_t *dest = vc->allocSendPacket(packetLength);	// The packet is written in its place in the output queue.
+	this->writePacket(dest, packetLength, apid, true, serviceType, serviceSubtype, data, length, SpacePacketConf::unsegmented);
+	return packetLength;
+}
+
+// Retrieves the source sequence count of the next packet of an APID.
+uint16_t SpacePacketBuilder::getSequenceCount(uint16_t apid)
+{
+	return sequenceCounts[apid & 0x07FF];
+}
+
+// Sets the source sequence count of the next packet of an APID.
+void SpacePacketBuilder::setSequenceCount(uint16_t apid, uint16_t count)
+{
+	sequenceCounts[apid & 0x07FF] = count & 0x3FFF;
+}
+
+// Sets the sequence counts and PUS packet subcounters of all APIDs to zero.
+void SpacePacketBuilder::resetSequenceCounts()
+{
+	sequenceCounts.assign(SpacePacketConf::apidCount, 0);
+	pusSubcounters.assign(SpacePacketConf::apidCount, 0);
+}
+
+// Checks the parameters of a packet and returns its total length.
+size_t SpacePacketBuilder::checkPacket(uint16_t apid, size_t length, bool pusHeader, uint16_t groupingFlags)
+{
+	ostringstream error;
+	size_t dataFieldLength = this->getPacketLength(length, pusHeader) - primaryHeaderLength;
+	if (apid >= SpacePacketConf::apidCount) {
+		error << "APID " << dec << apid << " out of range (0-" << SpacePacketConf::apidCount - 1 << ")." << endl;
+	} else if (groupingFlags > SpacePacketConf::unsegmented) {
+		error << "Grouping flags out of range (0-3)." << endl;
+	} else if (dataFieldLength == 0) {
+		error << "A packet needs at least one Byte of data." << endl;
+	} else if (dataFieldLength > maxDataFieldLength) {
+		error << "Packet Data Field too long (" << dec << dataFieldLength << " Bytes, max. " << maxDataFieldLength << ")." << endl;
+	} else {
+		return primaryHeaderLength + dataFieldLength;
+	}
+	throw SpacePacketBuilderError(error.str());
+}
+
+// Writes a packet of known length and advances the counters of the APID.
+void SpacePacketBuilder::writePacket(uint8_t *dest, size_t packetLength, uint16_t apid, bool pusHeader, uint8_t serviceType,
+		uint8_t serviceSubtype, const uint8_t *data, size_t length, uint16_t groupingFlags)
+{
+	uint16_t count = sequenceCounts[apid];
+	uint16_t lengthField = packetLength - primaryHeaderLength - 1;	// The length field holds the Data Field length minus one.
+
+	dest[0] = (packetType << 4) | ((pusHeader ? 1 : 0) << 3) | (apid >> 8);	// Version 0, type, Data Field Header flag, APID.
+	dest[1] = apid & 0xFF;
+	dest[2] = (groupingFlags << 6) | (count >> 8);		// Grouping flags and source sequence count.
+	dest[3] = count & 0xFF;
+	dest[4] = lengthField >> 8;
+	dest[5] = lengthField & 0xFF;
+	uint8_t *pos = dest + primaryHeaderLength;
+
+	if (pusHeader) {
+		pos[0] = pusVersion << 4;		// Spare bit, PUS version and spare bits.
+		pos[1] = serviceType;
+		pos[2] = serviceSubtype;
+		pos[3] = pusSubcounters[apid]++;
+		pos += pusHeaderLength;
+	}
+	if (length > 0) {
+		memcpy(pos, data, length);		// The only copy of the user data.
+		pos += length;
+	}
+	if (errorControl != SpacePacketConf::noErrorControl) {
+		uint16_t field = SpacePacketConf::computeErrorControl(errorControl, dest, pos - dest);
+		pos[0] = field >> 8;
+		pos[1] = field & 0xFF;
+	}
+	sequenceCounts[apid] = (count + 1) & 0x3FFF;
+}
@@ -17,6 +17,8 @@ You should have received a copy of the GNU General Public License
 along with tmtp. If not, see <http://www.gnu.org/licenses/>.
 */
 #include "SpacePacketConf.h"
+#include "TmCrc16.h"
+#include <vector>
 #include <iostream>
 #include <stdint.h>
 
@@ -25,6 +27,8 @@ using namespace std;
 // Constructor
 SpacePacketConf::SpacePacketConf()
 {
+	errorControl = noErrorControl;				// By default, packets carry no error control field.
+	invalidPacketCount.assign(apidCount, 0);
 }
 
 // Receives a packet header (only the first Byte) and checks if it describes an idle packet.
@@ -35,8 +39,120 @@ bool SpacePacketConf::isIdlePacket(uint8_t firstByteOfHeader)
 	return (packetVersion == idlePacketVersion);	// returns TRUE if the extracted packet version is eq. to 001
 }
 
+// Counts the idle packets at the beginning of a buffer.
+size_t SpacePacketConf::skipIdlePackets(const uint8_t *data, size_t length)
+{
+	return countLeadingVersion(data, length, idlePacketVersion);
+}
+
+// Selects the Packet Error Control. Resets the invalid packet counters.
+void SpacePacketConf::setPacketErrorControl(PacketErrorControl type)
+{
+	errorControl = type;
+	invalidPacketCount.assign(apidCount, 0);
+}
+
+// Retrieves the selected Packet Error Control.
+SpacePacketConf::PacketErrorControl SpacePacketConf::getPacketErrorControl()
+{
+	return errorControl;
+}
+
+// Checks the Packet Error Control field of a complete received packet.
+bool SpacePacketConf::validatePacket(const vector<uint8_t> &packet)
+{
+	if (errorControl == noErrorControl) {
+		return true;
+	}
+	if (packet.size() < 2) {				// Not even a packet ID to count it with.
+		invalidPacketCount[idleApid]++;
+		return false;
+	}
+	uint16_t apid = extractApid(&packet[0]);
+	if (apid == idleApid) {					// Idle packets carry no error control.
+		return true;
+	}
+
+	bool valid = false;
+	if (packet.size() >= packetHeaderLength + 2u) {	// The error control field follows at least the header.
+		if (errorControl == crcErrorControl) {
+			valid = (crc16(&packet[0], packet.size()) == 0);			// The CRC over a packet and its own CRC is zero.
+		} else {
+			valid = (isoChecksumSums(&packet[0], packet.size()) == 0);	// Both sums over a packet and its own checksum are zero.
+		}
+	}
+	if (!valid) {
+		invalidPacketCount[apid]++;
+	}
+	return valid;
+}
+
+// Retrieves the number of invalid packets received for an APID.
+uint64_t SpacePacketConf::getInvalidPacketCount(uint16_t apid)
+{
+	return invalidPacketCount[apid & 0x07FF];
+}
+
+// Retrieves the number of invalid packets received for all APIDs.
+uint64_t SpacePacketConf::getInvalidPacketCount()
+{
+	uint64_t total = 0;
+	for (uint16_t apid = 0; apid < apidCount; apid++) {
+		total += invalidPacketCount[apid];
+	}
+	return total;
+}
+
+// Extracts the APID from a packet primary header.
+uint16_t SpacePacketConf::extractApid(const uint8_t *header)
+{
+	return ((header[0] << 8) | header[1]) & 0x07FF;		// The lower 11 bits of the packet ID.
+}
+
+// Extracts the grouping flags from a packet primary header.
+uint16_t SpacePacketConf::extractGroupingFlags(const uint8_t *header)
+{
+	return (header[2] >> 6) & 0x0003;					// The upper 2 bits of the sequence control.
+}
+
+// Computes the Packet Error Control field of a packet.
+uint16_t SpacePacketConf::computeErrorControl(PacketErrorControl type, const uint8_t *data, size_t length)
+{
+	if (type == crcErrorControl) {
+		return crc16(data, length);
+	} else if (type == checksumErrorControl) {
+		// Check Bytes X and Y make both sums over the whole packet zero (ISO 8473).
+		uint16_t sums = isoChecksumSums(data, length);
+		uint16_t c0 = sums >> 8, c1 = sums & 0x00FF;
+		uint16_t x = (510 - c0 - c1) % 255;
+		uint16_t y = c1;
+		x = (x == 0) ? 255 : x;		// Zero is sent as 255, which is the same modulo 255.
+		y = (y == 0) ? 255 : y;
+		return (x << 8) | y;
+	}
+	return 0;
+}
+
+// Computes the CRC-16 of a buffer (see TmCrc16).
+uint16_t SpacePacketConf::crc16(const uint8_t *data, size_t length)
+{
+	return TmCrc16::compute(data, length);
+}
+
+// Computes the two ISO checksum sums C0 and C1 of a buffer, both modulo 255.
+uint16_t SpacePacketConf::isoChecksumSums(const uint8_t *data, size_t length)
+{
+	// C1 stays below 255 * length^2 / 2, which fits into 64 bits for any buffer below 2^27 Bytes.
+	uint64_t c0 = 0, c1 = 0;
+	for (size_t i = 0; i < length; i++) {
+		c0 += data[i];
+		c1 += c0;
+	}
+	return (uint16_t) (((c0 % 255) << 8) | (c1 % 255));
+}
+
 // Extracts and calculates the total packet length (header length + message length + 1).
-uint64_t SpacePacketConf::extractPacketLength(vector<uint8_t> header)
+uint64_t SpacePacketConf::extractPacketLength(const vector<uint8_t> &header)
 {
 	uint64_t length = (header[4] << 8) | header[5];	// The 5th and 6th Bytes of the header are stored in variable "length".
 	return length + 1 + packetHeaderLength;					// Returns the TOTAL packet length +1.
@@ -61,7 +177,9 @@ uint8_t SpacePacketConf::genIdlePacket()
 vector<uint8_t> SpacePacketConf::genTestPacket(vector<uint8_t> message)
 {
 	vector<uint8_t> packet;
-	uint16_t dataSize = message.size() - 1;
+	uint16_t errorControlLength = (errorControl == noErrorControl) ? 0 : 2;
+	uint16_t dataSize = message.size() + errorControlLength - 1;
+	packet.reserve(packetHeaderLength + message.size() + errorControlLength);	// The message is copied only once.
 
 	packet.push_back(0x00);						// First Byte	- Packet ID			0000 0000
 	packet.push_back(0x00);						// Second Byte	- Sequence Control	0000 0000
@@ -72,6 +190,12 @@ vector<uint8_t> SpacePacketConf::genTestPacket(vector<uint8_t> message)
 
 	packet.insert(packet.end(),message.begin(),message.end());	// After the 6th header Byte, 
 																// the whole message is inserted
+	
+	if (errorControl != noErrorControl) {			// The Packet Error Control field closes the packet.
+		uint16_t field = computeErrorControl(errorControl, &packet[0], packet.size());
+		packet.push_back((field >> 8) & 0x00FF);
+		packet.push_back(field & 0x00FF);
+	}
 
 	return packet;
 }
@@ -89,7 +213,7 @@ void SpacePacketConf::packetDebugOutput(vector<uint8_t> packet)
 		uint16_t version = (id >> 13) & 0x0007;			// The packet version (3 bits).
 		uint16_t type = (id >> 12) & 0x0001;				// The packet type (1 bit).
 		bool dataFieldHeaderPresent = (id >> 11) & 0x0001;		// The data field header flag (1 bit).
-		uint16_t apid = id & 0x07FF;						// The application ID (11 bits).
+		uint16_t apid = extractApid(&packet[0]);			// The application ID (11 bits).
 		
 		// From the sequence control, the following are extracted:
 		uint16_t groupingFlags = (sequenceControl >> 14) & 0x0003;	// The grouping flags (2 bits).
@@ -0,0 +1,272 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "SpacePacketSequencer.h"
+#include "GroundPacketServer.h"
+#include "TmVirtualChannel.h"
+#include "TmSequenceTracker.h"
+#include "NetProtConf.h"
+#include "myErrors.h"
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <queue>
+#include <stdint.h>
+
+using namespace std;
+
+static const uint16_t spacePacketHeaderLength = 6;	// Primary header of a Space Packet.
+
+// Constructor of the SpacePacketSequencer class.
+SpacePacketSequencer::SpacePacketSequencer(NetProtConf *conf, size_t bufferSize) : GroundPacketServer(conf)
+{
+	aduBufferSize = (bufferSize > 0) ? bufferSize : 1;
+	this->reset();
+}
+
+// Follows the sequence count of a packet and reassembles it into an application data unit.
+TmSequenceTracker::SequenceStatus SpacePacketSequencer::processPacket(const TimeTaggedPacket &packet)
+{
+	if (packet.data.size() <= spacePacketHeaderLength) {
+		malformedCount++;
+		return TmSequenceTracker::malformed;		// Not a Space Packet with data: dropped.
+	}
+	uint16_t apid = SpacePacketConf::extractApid(&packet.data[0]);
+	uint16_t groupingFlags = SpacePacketConf::extractGroupingFlags(&packet.data[0]);
+	uint16_t count = ((packet.data[2] << 8) | packet.data[3]) & 0x3FFF;
+	ApidState &state = apidStates[apid];
+
+	TmSequenceTracker::SequenceStatus status;
+	if (!state.synchronised) {
+		state.synchronised = true;
+		state.receivedMask = ~(uint64_t) 0;		// Counts before the first one are not expected anymore.
+		status = TmSequenceTracker::firstCount;
+	} else {
+		uint64_t distance = 0;
+		status = TmSequenceTracker::classify(state.expectedCount, count, sequenceCountModulus, distance);
+		if (status == TmSequenceTracker::outOfOrder) {
+			if (distance > recentCounts) {		// Too far behind to be remembered: the source restarted its counter.
+				status = TmSequenceTracker::resync;
+				state.receivedMask = ~(uint64_t) 0;
+			} else {
+				uint64_t bit = (uint64_t) 1 << (distance - 1);
+				if (state.receivedMask & bit) {
+					state.duplicateCount++;
+					return TmSequenceTracker::duplicate;	// Duplicates are dropped.
+				}
+				state.receivedMask |= bit;		// The packet was counted as lost, but arrived late.
+				state.lostCount--;
+				state.outOfOrderCount++;
+				state.packetCount++;
+				this->processLatePacket(packet, apid, groupingFlags);
+				return TmSequenceTracker::outOfOrder;
+			}
+		} else if (status == TmSequenceTracker::gap) {
+			state.lostCount += distance;
+			// The skipped counts are marked as missing, the count before the received one as received.
+			state.receivedMask = (distance + 1 >= 64) ? 0 : (state.receivedMask << (distance + 1));
+		} else {
+			state.receivedMask <<= 1;
+		}
+	}
+	state.receivedMask |= 1;				// The received count is the one before the next expected count.
+	state.expectedCount = (count + 1) % sequenceCountModulus;
+	state.packetCount++;
+	this->reassemble(packet, apid, groupingFlags, (status == TmSequenceTracker::inSequence));
+	return status;
+}
+
+// Adds a packet to the segmented unit being reassembled for its APID, or turns it into a unit of its own.
+void SpacePacketSequencer::reassemble(const TimeTaggedPacket &packet, uint16_t apid, uint16_t groupingFlags, bool inSequence)
+{
+	ApidState &state = apidStates[apid];
+	ApplicationDataUnit &unit = segmentedUnits[apid];
+	vector<uint8_t>::const_iterator dataField = packet.data.begin() + spacePacketHeaderLength;
+
+	if ((groupingFlags == SpacePacketConf::unsegmented) || (groupingFlags == SpacePacketConf::firstSegment)) {
+		if (state.segmenting) {				// The last segment of the previous unit never arrived.
+			state.incompleteCount++;
+			state.segmenting = false;
+		}
+		unit.apid = apid;
+		unit.data.assign(dataField, packet.data.end());
+		unit.segments = 1;
+		unit.timestamp = packet.timestamp;
+		unit.bitrate = packet.bitrate;
+		if (groupingFlags == SpacePacketConf::unsegmented) {
+			this->queueAdu(unit);
+		} else {
+			state.segmenting = true;
+		}
+		return;
+	}
+
+	// Continuation or last segment: it only belongs to the unit if no segment was skipped.
+	if (!state.segmenting || !inSequence) {
+		state.segmenting = false;
+		state.incompleteCount++;			// The unit misses at least one segment.
+		return;
+	}
+	unit.data.insert(unit.data.end(), dataField, packet.data.end());
+	unit.segments++;
+	if (groupingFlags == SpacePacketConf::lastSegment) {
+		state.segmenting = false;
+		this->queueAdu(unit);
+	}
+}
+
+// Turns a late unsegmented packet into a unit of its own and drops a late segment.
+void SpacePacketSequencer::processLatePacket(const TimeTaggedPacket &packet, uint16_t apid, uint16_t groupingFlags)
+{
+	if (groupingFlags != SpacePacketConf::unsegmented) {
+		apidStates[apid].lateSegmentCount++;	// The unit of the segment was already completed or discarded.
+		return;
+	}
+	ApplicationDataUnit unit;
+	unit.apid = apid;
+	unit.data.assign(packet.data.begin() + spacePacketHeaderLength, packet.data.end());
+	unit.segments = 1;
+	unit.timestamp = packet.timestamp;
+	unit.bitrate = packet.bitrate;
+	this->queueAdu(unit);
+}
+
+// Places an application data unit in the output queue.
+void SpacePacketSequencer::queueAdu(ApplicationDataUnit &adu)
+{
+	if (aduFifo.size() >= aduBufferSize) {
+		overflowCount++;
+		return;
+	}
+	aduFifo.push(ApplicationDataUnit());
+	ApplicationDataUnit &queued = aduFifo.back();
+	queued.apid = adu.apid;
+	queued.data.swap(adu.data);			// The data of the unit is moved, not copied.
+	queued.segments = adu.segments;
+	queued.timestamp = adu.timestamp;
+	queued.bitrate = adu.bitrate;
+	if (debugOutput) {
+		cout << "Reassembled APID " << dec << queued.apid << " from " << queued.segments << " packets: "
+			<< queued.data.size() << " Bytes." << endl;
+	}
+}
+
+// Takes all packets from the input queue of the virtual channel and processes them.
+void SpacePacketSequencer::signalNewPacket()
+{
+	if (tmVc) {								// If a virtual channel has been defined.
+		while (tmVc->packetAvailable()) {	// ... And while there are packets waiting in the input queue:
+			try {
+				this->processPacket(tmVc->receivePacket());
+			} catch (TmVirtualChannelError& e) {
+				ostringstream error;
+				error << "Error in TmVirtualChannel: " << e.what() << endl;
+				throw GroundPacketServerError(error.str());
+			}
+		}
+	} else {
+		ostringstream error;
+		error << "No TmVirtualChannel specified." << endl;
+		throw GroundPacketServerError(error.str());
+	}
+}
+
+// Indicates whether an application data unit is waiting in the output queue.
+bool SpacePacketSequencer::aduAvailable()
+{
+	return !aduFifo.empty();
+}
+
+// Takes the oldest application data unit from the output queue.
+ApplicationDataUnit SpacePacketSequencer::receiveAdu()
+{
+	if (aduFifo.empty()) {
+		ostringstream error;
+		error << "No application data unit available." << endl;
+		throw GroundPacketServerError(error.str());
+	}
+	ApplicationDataUnit adu = aduFifo.front();
+	aduFifo.pop();
+	return adu;
+}
+
+// Forgets the sequence count, the statistics and the segments of all APIDs.
+void SpacePacketSequencer::reset()
+{
+	ApidState empty = {0, 0, 0, 0, 0, 0, 0, 0, false, false};
+	apidStates.assign(SpacePacketConf::apidCount, empty);
+	segmentedUnits.assign(SpacePacketConf::apidCount, ApplicationDataUnit());
+	aduFifo = queue<ApplicationDataUnit>();
+	overflowCount = 0;
+	malformedCount = 0;
+}
+
+// Retrieves the source sequence count expected next for an APID.
+uint16_t SpacePacketSequencer::getExpectedCount(uint16_t apid)
+{
+	return apidStates[apid & 0x07FF].expectedCount;
+}
+
+// Retrieves the number of packets accepted for an APID.
+uint64_t SpacePacketSequencer::getPacketCount(uint16_t apid)
+{
+	return apidStates[apid & 0x07FF].packetCount;
+}
+
+// Retrieves the number of packets lost for an APID.
+uint64_t SpacePacketSequencer::getLostCount(uint16_t apid)
+{
+	return apidStates[apid & 0x07FF].lostCount;
+}
+
+// Retrieves the number of duplicate packets dropped for an APID.
+uint64_t SpacePacketSequencer::getDuplicateCount(uint16_t apid)
+{
+	return apidStates[apid & 0x07FF].duplicateCount;
+}
+
+// Retrieves the number of packets which arrived out of order for an APID.
+uint64_t SpacePacketSequencer::getOutOfOrderCount(uint16_t apid)
+{
+	return apidStates[apid & 0x07FF].outOfOrderCount;
+}
+
+// Retrieves the number of segmented units discarded for an APID because of a missing segment.
+uint64_t SpacePacketSequencer::getIncompleteCount(uint16_t apid)
+{
+	return apidStates[apid & 0x07FF].incompleteCount;
+}
+
+// Retrieves the number of segments dropped for an APID because they arrived late.
+uint64_t SpacePacketSequencer::getLateSegmentCount(uint16_t apid)
+{
+	return apidStates[apid & 0x07FF].lateSegmentCount;
+}
+
+// Retrieves the number of application data units dropped because the output queue was full.
+uint64_t SpacePacketSequencer::getOverflowCount()
+{
+	return overflowCount;
+}
+
+// Retrieves the number of packets dropped because they were too short to be Space Packets with data.
+uint64_t SpacePacketSequencer::getMalformedCount()
+{
+	return malformedCount;
+}
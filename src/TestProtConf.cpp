@@ -34,8 +34,14 @@ bool TestProtConf::isIdlePacket(uint8_t firstByteOfHeader)
 	return (packetVersion == idlePacketVersion);	// returns TRUE if the extracted packet version is eq. to 000
 }
 
+// Counts the idle packets at the beginning of a buffer.
+size_t TestProtConf::skipIdlePackets(const uint8_t *data, size_t length)
+{
+	return countLeadingVersion(data, length, idlePacketVersion);
+}
+
 // Extracts and calculates the total packet length (header length + message length + 1).
-uint64_t TestProtConf::extractPacketLength(vector<uint8_t> header)
+uint64_t TestProtConf::extractPacketLength(const vector<uint8_t> &header)
 {
 	uint16_t tmp = (header[0] << 8) | header[1];	// The whole content of the header is stored in temporary variable "tmp".
 	return (tmp & 0x1FFF);								// The 13 least significant bits are take as the packet length.
@@ -0,0 +1,337 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "TmBitFrameSynchronizer.h"
+#include "TmPhysicalChannel.h"
+#include "TmCadu.h"
+#include "myErrors.h"
+
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+// Loads 8 Bytes as a big-endian word: the first bit of the stream becomes the most significant bit.
+static inline uint64_t loadBits(const uint8_t *data)
+{
+	uint64_t word;
+	memcpy(&word, data, 8);
+	return __builtin_bswap64(word);
+}
+
+// Counts the bits set in each 32-bit half of a word, without a popcount instruction.
+static inline uint64_t countBitPairs(uint64_t v)
+{
+	v -= (v >> 1) & 0x5555555555555555ULL;
+	v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+	v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	v += v >> 8;
+	v += v >> 16;
+	return v & 0x000000FF000000FFULL;	// Bytes 0 and 4 hold the counts of the two halves.
+}
+
+// Ways to compare the 32 bits at each bit offset with the ASM.
+enum AsmMatch {
+	exactMatch,			// No bit errors.
+	bitCountMatch		// Bit errors counted two offsets at a time in a 64-bit word.
+};
+
+// Searches a buffer for the first ASM from a bit position on; the 8 bit offsets of each Byte are checked at once.
+template <AsmMatch match>
+static inline size_t scanAsm(const uint8_t *data, size_t size, size_t bit, uint32_t tolerance)
+{
+	size_t lastBit = 8 * (size - TmCadu::asmLength);	// Last position an ASM can start at.
+	const uint64_t pattern = ((uint64_t) TmCadu::attachedSyncMarker << 32) | TmCadu::attachedSyncMarker;
+	uint32_t offsets = 0xFF << (bit % 8);				// Bit offsets still to check in the first Byte.
+
+	for (size_t byte = bit / 8; 8 * byte <= lastBit; byte++, offsets = 0xFF) {
+		uint64_t word;
+		if (byte + 8 <= size) {
+			word = loadBits(data + byte);
+		} else {										// The end of the buffer is padded with zeros.
+			word = 0;
+			for (size_t k = 0; byte + k < size; k++) {
+				word |= (uint64_t) data[byte + k] << (56 - 8 * k);
+			}
+		}
+		if (8 * byte + 7 > lastBit) {
+			offsets &= (1 << (lastBit - 8 * byte + 1)) - 1;
+		}
+
+		// The 32 bits at bit offset s are the upper half of the word shifted left by s.
+		uint32_t matches = 0;
+		if (match == exactMatch) {
+			for (uint32_t s = 0; s < 8; s++) {
+				matches |= (uint32_t) ((uint32_t) (word >> (32 - s)) == TmCadu::attachedSyncMarker) << s;
+			}
+		} else {
+			for (uint32_t s = 0; s < 8; s += 2) {		// Two offsets per word: (s, s + 1) in the upper and lower half.
+				uint64_t pair = ((word << s) & 0xFFFFFFFF00000000ULL) | ((word >> (31 - s)) & 0xFFFFFFFFULL);
+				uint64_t errors = countBitPairs(pair ^ pattern);
+				matches |= (uint32_t) ((errors >> 32) <= tolerance) << s;
+				matches |= (uint32_t) ((errors & 0xFF) <= tolerance) << (s + 1);
+			}
+		}
+		matches &= offsets;
+		if (matches != 0) {
+			return 8 * byte + __builtin_ctz(matches);
+		}
+	}
+	return lastBit + 1;
+}
+
+#ifdef __SSE2__
+// Searches a buffer for the first ASM with at most 3 bit errors, 16 Bytes at a time.
+// With t bit errors, at least 4 - t of the 4 ASM Bytes are received without errors. The stream is realigned to each bit
+// offset (Byte shifts of 16 Bytes with SSE2) and compared with the ASM Bytes; only the positions where enough of them
+// match are counted bit by bit. Returns the first bit position not searched if there is no ASM.
+static size_t scanAsmBlocks(const uint8_t *data, size_t size, size_t bit, uint32_t tolerance)
+{
+	const __m128i asmBytes[4] = {
+		_mm_set1_epi8((char) (TmCadu::attachedSyncMarker >> 24)), _mm_set1_epi8((char) (TmCadu::attachedSyncMarker >> 16)),
+		_mm_set1_epi8((char) (TmCadu::attachedSyncMarker >> 8)), _mm_set1_epi8((char) TmCadu::attachedSyncMarker)
+	};
+	const __m128i fewestMatches = _mm_set1_epi8((char) (3 - tolerance));
+	size_t byte = bit / 8;
+	for (; byte + 16 + TmCadu::asmLength <= size; byte += 16) {
+		__m128i blocks[5];		// The stream at Byte offsets 0 to 4.
+		for (int j = 0; j < 5; j++) {
+			blocks[j] = _mm_loadu_si128((const __m128i *) (data + byte + j));
+		}
+		uint32_t candidates[8];
+		uint32_t any = 0;
+		for (int s = 0; s < 8; s++) {
+			const __m128i leftMask = _mm_set1_epi8((char) (0xFF << s));
+			const __m128i rightMask = _mm_set1_epi8((char) (0xFF >> (8 - s)));
+			__m128i matches = _mm_setzero_si128();
+			for (int j = 0; j < 4; j++) {	// The 8 bits at bit offset s of Byte j: Byte j shifted left, Byte j + 1 shifted right.
+				__m128i shifted = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(blocks[j], s), leftMask),
+						_mm_and_si128(_mm_srli_epi16(blocks[j + 1], 8 - s), rightMask));
+				matches = _mm_sub_epi8(matches, _mm_cmpeq_epi8(shifted, asmBytes[j]));	// Counts the matching Bytes.
+			}
+			candidates[s] = _mm_movemask_epi8(_mm_cmpgt_epi8(matches, fewestMatches));
+			any |= candidates[s];
+		}
+		while (any != 0) {				// The candidates are checked in stream order.
+			size_t first = SIZE_MAX;
+			int offset = 0;
+			for (int s = 0; s < 8; s++) {
+				if (candidates[s] != 0) {
+					size_t position = 8 * __builtin_ctz(candidates[s]) + s;
+					if (position < first) {
+						first = position;
+						offset = s;
+					}
+				}
+			}
+			candidates[offset] &= candidates[offset] - 1;
+			any = 0;
+			for (int s = 0; s < 8; s++) {
+				any |= candidates[s];
+			}
+			const uint8_t *pos = data + byte + first / 8;
+			uint64_t bits = ((uint64_t) pos[0] << 32) | ((uint64_t) pos[1] << 24) | ((uint64_t) pos[2] << 16)
+				| ((uint64_t) pos[3] << 8) | pos[4];
+			if ((8 * byte + first >= bit)
+					&& ((countBitPairs((uint32_t) (bits >> (8 - offset)) ^ TmCadu::attachedSyncMarker) & 0xFF) <= tolerance)) {
+				return 8 * byte + first;
+			}
+		}
+	}
+	return (8 * byte > bit) ? 8 * byte : bit;
+}
+#endif
+
+// Constructor of the TmBitFrameSynchronizer class.
+TmBitFrameSynchronizer::TmBitFrameSynchronizer(TmPhysicalChannel *channel)
+	: TmFrameSynchronizer(channel)
+{
+	asmErrorTolerance = 0;
+	slipWindow = 1;
+	slipCount = 0;
+	this->reset();
+}
+
+// Sets the number of bit errors tolerated in the ASM.
+void TmBitFrameSynchronizer::setAsmErrorTolerance(uint16_t bits)
+{
+	if (bits > 8) {
+		throw TmFrameSynchronizerError("ASM error tolerance out of range (0-8).\n");
+	}
+	asmErrorTolerance = bits;
+}
+
+// Retrieves the number of bit errors tolerated in the ASM.
+uint16_t TmBitFrameSynchronizer::getAsmErrorTolerance()
+{
+	return asmErrorTolerance;
+}
+
+// Sets the largest bit slip followed in the lock and flywheel states.
+void TmBitFrameSynchronizer::setSlipWindow(uint16_t bits)
+{
+	if (bits > 7) {
+		throw TmFrameSynchronizerError("Slip window out of range (0-7).\n");
+	}
+	slipWindow = bits;
+}
+
+// Retrieves the largest bit slip followed.
+uint16_t TmBitFrameSynchronizer::getSlipWindow()
+{
+	return slipWindow;
+}
+
+// Processes the next chunk of the received bit stream.
+TmChannelWarning TmBitFrameSynchronizer::receiveData(const uint8_t *data, size_t length, TmFrameTimestamp timestamp,
+		TmFrameBitrate bitrate)
+{
+	if (physicalChannel->getVariableFrameLengthStatus()) {
+		throw TmFrameSynchronizerError("Variable-length frames cannot be synchronized by their length.\n");
+	}
+	TmChannelWarning warning;
+	const size_t asmBits = 8 * TmCadu::asmLength;
+	size_t codeblockLength = physicalChannel->getCodeblockLength();
+	size_t caduBits = asmBits + 8 * codeblockLength;
+	int64_t chunkStart = 8 * (int64_t) buffer.size();	// First bit of the chunk, for the timestamps.
+	buffer.insert(buffer.end(), data, data + length);
+	size_t totalBits = 8 * buffer.size();
+
+	size_t bit = bitOffset;
+	while (totalBits - bit >= asmBits) {
+		if (state == searchState) {
+			size_t found = this->findAsm(bit);
+			skippedByteCount += (found - bit) / 8;
+			bit = found;
+			if (bit + asmBits > totalBits) {
+				break;		// No ASM: the last 31 bits are kept, they may be the start of one.
+			}
+			asmBitOffset = bit % 8;
+			state = (checkThreshold > 0) ? checkState : lockState;
+			stateCount = 0;
+		}
+		if (totalBits - bit < caduBits + slipWindow) {
+			break;		// The CADU (and a slipped ASM after it) is completed by the next chunk.
+		}
+
+		bool asmFound = this->matchAsm(bit);
+		if (!asmFound && ((state == lockState) || (state == flywheelState))) {
+			for (size_t slip = 1; slip <= slipWindow; slip++) {		// The nearest slip wins.
+				if ((bit >= slip) && this->matchAsm(bit - slip)) {
+					bit -= slip;
+					asmFound = true;
+				} else if (this->matchAsm(bit + slip)) {
+					bit += slip;
+					asmFound = true;
+				}
+				if (asmFound) {
+					slipCount++;
+					asmBitOffset = bit % 8;
+					break;
+				}
+			}
+		}
+		if (!this->updateState(asmFound, warning)) {
+			bit++;		// The search restarts one bit after the expected ASM.
+			continue;
+		}
+		if (state != checkState) {
+			vector<uint8_t> frame(codeblockLength);
+			this->extractBits(bit + asmBits, &frame[0], codeblockLength);
+			warning += this->deliverFrame(frame, timestamp, bitrate, (int64_t) (bit + asmBits) - chunkStart);
+		}
+		bit += caduBits;
+	}
+	buffer.erase(buffer.begin(), buffer.begin() + bit / 8);	// The processed Bytes are discarded once per chunk.
+	bitOffset = bit % 8;
+	return warning;
+}
+
+// Discards the buffered bits and returns to the search.
+void TmBitFrameSynchronizer::reset()
+{
+	TmFrameSynchronizer::reset();
+	bitOffset = 0;
+	asmBitOffset = 0;
+}
+
+// Retrieves the bit offset of the last ASM found.
+uint16_t TmBitFrameSynchronizer::getBitOffset()
+{
+	return asmBitOffset;
+}
+
+// Retrieves the number of bit slips followed.
+uint64_t TmBitFrameSynchronizer::getSlipCount()
+{
+	return slipCount;
+}
+
+// Searches the buffer for the first ASM from a bit position on.
+size_t TmBitFrameSynchronizer::findAsm(size_t bit)
+{
+	if (8 * buffer.size() < bit + 8 * TmCadu::asmLength) {
+		return bit;
+	}
+#ifdef __SSE2__
+	if (asmErrorTolerance <= 3) {
+		bit = scanAsmBlocks(&buffer[0], buffer.size(), bit, asmErrorTolerance);	// The end of the buffer is left to the scan below.
+	}
+#endif
+	if (asmErrorTolerance == 0) {
+		return scanAsm<exactMatch>(&buffer[0], buffer.size(), bit, 0);
+	}
+	return scanAsm<bitCountMatch>(&buffer[0], buffer.size(), bit, asmErrorTolerance);
+}
+
+// Checks if the ASM (with the tolerated bit errors) starts at a bit position.
+bool TmBitFrameSynchronizer::matchAsm(size_t bit)
+{
+	size_t byte = bit / 8;
+	size_t shift = bit % 8;
+	uint64_t bits = ((uint64_t) buffer[byte] << 32) | ((uint64_t) buffer[byte + 1] << 24) | ((uint64_t) buffer[byte + 2] << 16)
+		| ((uint64_t) buffer[byte + 3] << 8) | ((shift > 0) ? buffer[byte + 4] : 0);
+	uint32_t candidate = (uint32_t) (bits >> (8 - shift));
+	uint64_t errors = countBitPairs((uint64_t) (candidate ^ TmCadu::attachedSyncMarker));
+	return (errors & 0xFF) <= asmErrorTolerance;
+}
+
+// Copies Bytes starting at a bit position of the buffer into a frame.
+void TmBitFrameSynchronizer::extractBits(size_t bit, uint8_t *dest, size_t length)
+{
+	const uint8_t *src = &buffer[bit / 8];
+	size_t shift = bit % 8;
+	if (shift == 0) {
+		memcpy(dest, src, length);
+		return;
+	}
+	size_t available = buffer.size() - bit / 8;		// Bytes readable from src on.
+	size_t i = 0;
+	for (; (i + 8 < available) && (i + 8 <= length); i += 8) {	// 8 Bytes per shift, completed by the next Byte.
+		uint64_t word = (loadBits(src + i) << shift) | (src[i + 8] >> (8 - shift));
+		word = __builtin_bswap64(word);
+		memcpy(dest + i, &word, 8);
+	}
+	for (; i < length; i++) {
+		dest[i] = (src[i] << shift) | (src[i + 1] >> (8 - shift));
+	}
+}
@@ -0,0 +1,147 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "TmCadu.h"
+
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+const uint32_t TmCadu::attachedSyncMarker;
+const size_t TmCadu::asmLength;
+const size_t TmCadu::randomPeriod;
+
+// Computes one period of the pseudo-random sequence.
+static const uint8_t *randomTable()
+{
+	static uint8_t table[TmCadu::randomPeriod];
+	uint8_t bits[TmCadu::randomPeriod * 8];
+	for (size_t n = 0; n < TmCadu::randomPeriod * 8; n++) {
+		// All ones for the first 8 bits, then b(n+8) = b(n+7) + b(n+5) + b(n+3) + b(n) from x^8 + x^7 + x^5 + x^3 + 1.
+		bits[n] = (n < 8) ? 1 : (bits[n - 1] ^ bits[n - 3] ^ bits[n - 5] ^ bits[n - 8]);
+	}
+	for (size_t i = 0; i < TmCadu::randomPeriod; i++) {
+		uint8_t byte = 0;
+		for (size_t j = 0; j < 8; j++) {
+			byte = (byte << 1) | bits[i * 8 + j];
+		}
+		table[i] = byte;
+	}
+	return table;
+}
+static const uint8_t *randomSequence = randomTable();
+
+// XORs a buffer with the pseudo-random sequence.
+void TmCadu::randomize(uint8_t *data, size_t length)
+{
+	while (length > 0) {
+		size_t chunk = (length < randomPeriod) ? length : randomPeriod;	// One period of the sequence.
+		size_t i = 0;
+		for (; i + 8 <= chunk; i += 8) {
+			uint64_t word, random;
+			memcpy(&word, data + i, 8);			// Unaligned 8-Byte loads, compiled to single moves.
+			memcpy(&random, randomSequence + i, 8);
+			word ^= random;
+			memcpy(data + i, &word, 8);
+		}
+		for (; i < chunk; i++) {
+			data[i] ^= randomSequence[i];
+		}
+		data += chunk;
+		length -= chunk;
+	}
+}
+
+// Retrieves the first 255 Bytes of the pseudo-random sequence.
+const uint8_t *TmCadu::getRandomSequence()
+{
+	return randomSequence;
+}
+
+// Builds a CADU.
+vector<uint8_t> TmCadu::wrap(const vector<uint8_t> &frame, bool randomized)
+{
+	vector<uint8_t> cadu(asmLength + frame.size());
+	cadu[0] = (attachedSyncMarker >> 24) & 0xFF;
+	cadu[1] = (attachedSyncMarker >> 16) & 0xFF;
+	cadu[2] = (attachedSyncMarker >> 8) & 0xFF;
+	cadu[3] = attachedSyncMarker & 0xFF;
+	if (!frame.empty()) {
+		memcpy(&cadu[asmLength], &frame[0], frame.size());
+		if (randomized) {
+			randomize(&cadu[asmLength], frame.size());
+		}
+	}
+	return cadu;
+}
+
+// Checks and removes the ASM of a CADU and derandomizes the frame.
+bool TmCadu::unwrap(vector<uint8_t> &cadu, bool randomized)
+{
+	if ((cadu.size() < asmLength) || !isAsm(&cadu[0])) {
+		return false;
+	}
+	cadu.erase(cadu.begin(), cadu.begin() + asmLength);
+	if (randomized && !cadu.empty()) {
+		randomize(&cadu[0], cadu.size());
+	}
+	return true;
+}
+
+// Checks if a buffer holds the ASM at its beginning.
+bool TmCadu::isAsm(const uint8_t *data)
+{
+	return (((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) | ((uint32_t) data[2] << 8) | data[3]) == attachedSyncMarker;
+}
+
+// Searches a buffer for the first ASM.
+size_t TmCadu::findAsm(const uint8_t *data, size_t length)
+{
+	if (length < asmLength) {
+		return length;
+	}
+	size_t last = length - asmLength;	// Last position an ASM can start at.
+	size_t i = 0;
+#ifdef __SSE2__
+	const __m128i asm0 = _mm_set1_epi8((char) (attachedSyncMarker >> 24));
+	const __m128i asm1 = _mm_set1_epi8((char) (attachedSyncMarker >> 16));
+	const __m128i asm2 = _mm_set1_epi8((char) (attachedSyncMarker >> 8));
+	const __m128i asm3 = _mm_set1_epi8((char) attachedSyncMarker);
+	for (; i + 16 + asmLength - 1 <= length; i += 16) {
+		__m128i match = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (data + i)), asm0);
+		match = _mm_and_si128(match, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (data + i + 1)), asm1));
+		match = _mm_and_si128(match, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (data + i + 2)), asm2));
+		match = _mm_and_si128(match, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (data + i + 3)), asm3));
+		int mask = _mm_movemask_epi8(match);
+		if (mask != 0) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+#endif
+	for (; i <= last; i++) {
+		if (isAsm(data + i)) {
+			return i;
+		}
+	}
+	return length;
+}
@@ -0,0 +1,81 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "TmConvolutionalEncoder.h"
+
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+const uint8_t TmConvolutionalEncoder::polynomialG1;
+const uint8_t TmConvolutionalEncoder::polynomialG2;
+
+// Computes the two symbols of each 8-bit encoder state, G1 in bit 1 and G2 in bit 0.
+static const uint8_t *symbolTable()
+{
+	static uint8_t table[256];
+	for (int reg = 0; reg < 256; reg++) {
+		table[reg] = (__builtin_parity(reg & 0x7F & TmConvolutionalEncoder::polynomialG1) << 1)
+			| __builtin_parity(reg & 0x7F & TmConvolutionalEncoder::polynomialG2);
+	}
+	return table;
+}
+static const uint8_t *symbolLookup = symbolTable();
+
+// Constructor of the TmConvolutionalEncoder class.
+TmConvolutionalEncoder::TmConvolutionalEncoder()
+{
+	invertSecondSymbol = true;
+	this->reset();
+}
+
+// Sets the inversion flag of the G2 symbol.
+void TmConvolutionalEncoder::setInvertSecondSymbol(bool invert)
+{
+	invertSecondSymbol = invert;
+}
+
+// Retrieves the inversion flag of the G2 symbol.
+bool TmConvolutionalEncoder::getInvertSecondSymbol()
+{
+	return invertSecondSymbol;
+}
+
+// Clears the shift register.
+void TmConvolutionalEncoder::reset()
+{
+	shiftRegister = 0;
+}
+
+// Encodes data Bytes.
+void TmConvolutionalEncoder::encode(const uint8_t *data, size_t length, vector<uint8_t> &symbols)
+{
+	uint16_t inversion = invertSecondSymbol ? 0x5555 : 0x0000;	// The G2 symbol of each pair.
+	symbols.reserve(symbols.size() + 2 * length);
+	for (size_t i = 0; i < length; i++) {
+		uint16_t pairs = 0;
+		for (int bit = 7; bit >= 0; bit--) {
+			shiftRegister = ((shiftRegister << 1) | ((data[i] >> bit) & 1)) & 0x7F;	// The oldest bit leaves the register.
+			pairs = (pairs << 2) | symbolLookup[shiftRegister];
+		}
+		pairs ^= inversion;
+		symbols.push_back(pairs >> 8);
+		symbols.push_back(pairs & 0xFF);
+	}
+}
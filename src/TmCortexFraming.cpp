@@ -0,0 +1,141 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "TmCortexFraming.h"
+#include "myErrors.h"
+
+#include <vector>
+#include <sstream>
+#include <stdint.h>
+#include <string.h>
+
+using namespace std;
+
+const uint32_t TmCortexFraming::startFlag;
+const uint32_t TmCortexFraming::endFlag;
+const size_t TmCortexFraming::headerLength;
+const size_t TmCortexFraming::postambleLength;
+const size_t TmCortexFraming::maxFrameHeaderLength;
+const size_t TmCortexFraming::maxFrameLength;
+const size_t TmCortexFraming::maxMessageLength;
+
+// Constructor of the TmCortexFraming class.
+TmCortexFraming::TmCortexFraming(size_t frameHeaderLength)
+{
+	if (frameHeaderLength > maxFrameHeaderLength) {
+		ostringstream error;
+		error << "Frame header too long (" << dec << frameHeaderLength << " Bytes, max. " << maxFrameHeaderLength << ")." << endl;
+		throw TmCortexFramingError(error.str());
+	}
+	this->frameHeaderLength = frameHeaderLength;
+	flowId = 0;
+	flowFilter = false;
+}
+
+// Destructor of the TmCortexFraming class.
+TmCortexFraming::~TmCortexFraming()
+{
+}
+
+// Retrieves the length of the frame header.
+size_t TmCortexFraming::getFrameHeaderLength()
+{
+	return frameHeaderLength;
+}
+
+// Sets the flow ID of the built messages.
+void TmCortexFraming::setFlowId(uint32_t flowId)
+{
+	this->flowId = flowId;
+}
+
+// Retrieves the flow ID of the built messages.
+uint32_t TmCortexFraming::getFlowId()
+{
+	return flowId;
+}
+
+// Selects whether only messages with the flow ID are accepted.
+void TmCortexFraming::setFlowFilter(bool active)
+{
+	flowFilter = active;
+}
+
+// Checks if the frames of a flow are passed on.
+bool TmCortexFraming::acceptsFlow(uint32_t flowId)
+{
+	return !flowFilter || (flowId == this->flowId);
+}
+
+// Builds the message of a frame.
+vector<uint8_t> TmCortexFraming::wrapFrame(const vector<uint8_t> &frame)
+{
+	if (frame.size() > maxFrameLength) {
+		ostringstream error;
+		error << "Frame too long for a message (" << dec << frame.size() << " Bytes, max. " << maxFrameLength << ")." << endl;
+		throw TmCortexFramingError(error.str());
+	}
+	size_t messageLength = headerLength + frameHeaderLength + frame.size() + postambleLength;
+	vector<uint8_t> message(messageLength, 0);		// The frame header stays zero.
+	storeWord(&message[0], startFlag);
+	storeWord(&message[4], messageLength);
+	storeWord(&message[8], flowId);
+	if (!frame.empty()) {
+		memcpy(&message[headerLength + frameHeaderLength], &frame[0], frame.size());
+	}
+	storeWord(&message[messageLength - postambleLength], endFlag);
+	return message;
+}
+
+// Parses a message in place.
+size_t TmCortexFraming::parseMessage(const uint8_t *data, size_t length, Message &message)
+{
+	ostringstream error;
+	if (length < 4) {
+		if (memcmp(data, "\x49\x96\x02\xD2", length) != 0) {		// A partial start flag has to match too.
+			error << "Start flag of Cortex message missing." << endl;
+			throw TmCortexFramingError(error.str());
+		}
+		return 0;
+	}
+	if (loadWord(data) != startFlag) {
+		error << "Start flag of Cortex message missing." << endl;
+		throw TmCortexFramingError(error.str());
+	}
+	if (length < headerLength) {
+		return 0;
+	}
+
+	uint32_t messageLength = loadWord(data + 4);
+	if ((messageLength < headerLength + frameHeaderLength + postambleLength) || (messageLength > maxMessageLength)) {
+		error << "Invalid Cortex message length (" << dec << messageLength << " Bytes)." << endl;
+		throw TmCortexFramingError(error.str());
+	}
+	if (length < messageLength) {
+		return 0;
+	}
+	if (loadWord(data + messageLength - postambleLength) != endFlag) {
+		error << "End flag of Cortex message missing." << endl;
+		throw TmCortexFramingError(error.str());
+	}
+
+	message.flowId = loadWord(data + 8);
+	message.frame = data + headerLength + frameHeaderLength;
+	message.frameLength = messageLength - headerLength - frameHeaderLength - postambleLength;
+	return messageLength;
+}
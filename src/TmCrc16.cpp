@@ -0,0 +1,52 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "TmCrc16.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+const uint16_t TmCrc16::polynomial;
+const uint16_t TmCrc16::initialValue;
+
+// Computes the lookup table of the CRC: the Shift Register contribution of each possible Byte.
+static const uint16_t *crcTable()
+{
+	static uint16_t table[256];
+	for (uint16_t byte = 0; byte < 256; byte++) {
+		uint16_t sr = byte << 8;
+		for (uint16_t bit = 0; bit < 8; bit++) {
+			sr = (sr & 0x8000) ? ((sr << 1) ^ TmCrc16::polynomial) : (sr << 1);
+		}
+		table[byte] = sr;
+	}
+	return table;
+}
+static const uint16_t *crcLookup = crcTable();	// The table is built once when the library is loaded.
+
+// Computes the CRC of a buffer, one Byte at a time using the lookup table.
+uint16_t TmCrc16::compute(const uint8_t *data, size_t length)
+{
+	uint16_t sr = initialValue;		// The Shift Register starts full of 1's.
+	for (size_t i = 0; i < length; i++) {
+		sr = (sr << 8) ^ crcLookup[(sr >> 8) ^ data[i]];	// The whole Byte is shifted through the register at once.
+	}
+	return sr;
+}
@@ -0,0 +1,116 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "TmFixedTimestamp.h"
+#include "TmFrameTimestamp.h"
+
+#include <stdint.h>
+
+using namespace std;
+
+static const double fractionsPerSecond = 4294967296.0;	// 2^32
+
+// Default constructor. Creates an empty (invalid) timestamp.
+TmFixedTimestamp::TmFixedTimestamp()
+{
+	seconds = 0;
+	fractions = 0;
+}
+
+// Constructor of the TmFixedTimestamp class.
+TmFixedTimestamp::TmFixedTimestamp(uint64_t secs, uint32_t fracs)
+{
+	seconds = secs;
+	fractions = fracs;
+}
+
+// Converts a TmFrameTimestamp.
+TmFixedTimestamp::TmFixedTimestamp(TmFrameTimestamp timestamp)
+{
+	seconds = timestamp.getSeconds();
+	fractions = (uint32_t) (timestamp.getFractions() * fractionsPerSecond);	// Fractions are in [0,1), so the result fits.
+}
+
+// Computes the duration of one Byte at a given bitrate.
+uint64_t TmFixedTimestamp::byteScale(double bitrate)
+{
+	if (!(bitrate > 0.0)) {
+		return 0;
+	}
+	// 8 bits per Byte, in units of 2^-(32+scaleFractionBits) seconds.
+	double scale = 8.0 * fractionsPerSecond * (double) (1 << scaleFractionBits) / bitrate;
+	if (scale >= 18446744073709551615.0) {	// Bitrates far below 1 bit/s are saturated.
+		return UINT64_MAX;
+	}
+	return (uint64_t) (scale + 0.5);
+}
+
+// Advances the timestamp by the duration of a number of Bytes.
+void TmFixedTimestamp::addBytes(uint64_t bytes, uint64_t scale)
+{
+	if ((scale != 0) && (bytes > UINT64_MAX / scale)) {
+		// Only for very long offsets at very low bitrates: split the product to avoid the overflow.
+		uint64_t bytesPerStep = UINT64_MAX / scale;
+		while (bytes > bytesPerStep) {
+			this->addFractions((bytesPerStep * scale) >> scaleFractionBits);
+			bytes -= bytesPerStep;
+		}
+	}
+	this->addFractions((bytes * scale) >> scaleFractionBits);	// The common case: one multiply and one add.
+}
+
+// Advances the timestamp by a duration in units of 2^-32 seconds.
+void TmFixedTimestamp::addFractions(uint64_t fracs)
+{
+	uint64_t sum = (fracs & 0xFFFFFFFF) + fractions;
+	seconds += (fracs >> 32) + (sum >> 32);		// Whole seconds and the carry of the fractions.
+	fractions = (uint32_t) sum;
+}
+
+// Converts the timestamp into a TmFrameTimestamp.
+TmFrameTimestamp TmFixedTimestamp::toTimestamp()
+{
+	TmFrameTimestamp timestamp;
+	timestamp.setSeconds(seconds);
+	timestamp.setFractions(fractions / fractionsPerSecond);	// At most (2^32-1)/2^32, which is exact and smaller than 1.
+	return timestamp;
+}
+
+// Retrieves the seconds part of the timestamp.
+uint64_t TmFixedTimestamp::getSeconds()
+{
+	return seconds;
+}
+
+// Retrieves the fractions of a second in units of 2^-32 seconds.
+uint32_t TmFixedTimestamp::getFractions()
+{
+	return fractions;
+}
+
+// Retrieves the fractions of a second in nanoseconds.
+uint32_t TmFixedTimestamp::getNanoseconds()
+{
+	return (uint32_t) (((uint64_t) fractions * 1000000000) >> 32);
+}
+
+// Returns FALSE if the seconds are zero.
+bool TmFixedTimestamp::isValid()
+{
+	return (seconds != 0);
+}
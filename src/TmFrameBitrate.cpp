@@ -55,10 +55,10 @@ double TmFrameBitrate::getBitrate()
 bool TmFrameBitrate::isValid()
 {
 	if (bps == bpsInitPattern) {
-		return true;
+		return false;
 		}
 	else {
-		return false;
+		return true;
 		}
 }
 
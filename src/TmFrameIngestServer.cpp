@@ -0,0 +1,524 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "TmFrameIngestServer.h"
+#include "TmPhysicalChannel.h"
+#include "TmCortexFraming.h"
+#include "myErrors.h"
+
+#include <vector>
+#include <map>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <boost/asio.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+
+using namespace std;
+using boost::asio::ip::tcp;
+using boost::asio::ip::udp;
+
+const size_t TmFrameIngestServer::recordHeaderLength;
+const uint8_t TmFrameIngestServer::recordMarker[2] = {0x54, 0x4D};
+const size_t TmFrameIngestServer::maxRecordLength;
+const size_t TmFrameIngestServer::defaultThreadCount;
+const size_t TmFrameIngestServer::frameBatchLength;
+
+// Formats the address and port of an endpoint.
+template <typename Endpoint>
+static string endpointName(const Endpoint &endpoint)
+{
+	ostringstream name;
+	name << endpoint.address().to_string() << ":" << dec << endpoint.port();
+	return name.str();
+}
+
+// Accepts the TCP connections of a port.
+class TmFrameIngestServer::TcpListener : public boost::enable_shared_from_this<TmFrameIngestServer::TcpListener> {
+public:
+	TcpListener(TmFrameIngestServer *server, TmPhysicalChannel *channel, TmCortexFraming *cortex, const tcp::endpoint &endpoint);
+	void accept();
+	void handleAccept(boost::shared_ptr<TcpSession> session, const boost::system::error_code &error);
+
+	TmFrameIngestServer *server;	// The server (outlives the listener's handlers).
+	TmPhysicalChannel *channel;		// The physical channel fed by the connections.
+	TmCortexFraming *cortex;		// The framing of Cortex messages, NULL for records.
+	tcp::acceptor acceptor;			// The listening socket.
+};
+
+// Receives the records of a TCP connection.
+class TmFrameIngestServer::TcpSession : public boost::enable_shared_from_this<TmFrameIngestServer::TcpSession> {
+public:
+	TcpSession(TmFrameIngestServer *server, TmPhysicalChannel *channel, TmCortexFraming *cortex);
+	void start(uint16_t localPort);
+	void read();
+	void handleRead(const boost::system::error_code &error, size_t received);
+
+	TmFrameIngestServer *server;	// The server.
+	TmPhysicalChannel *channel;		// The physical channel fed by the connection.
+	TmCortexFraming *cortex;		// The framing of Cortex messages, NULL for records.
+	tcp::socket socket;				// The connection.
+	vector<uint8_t> buffer;			// Receive buffer; records are parsed in place.
+	size_t filled;					// Bytes in the buffer.
+	size_t connection;				// Index of the counters of the connection.
+};
+
+// Receives the datagrams of a port.
+class TmFrameIngestServer::UdpListener : public boost::enable_shared_from_this<TmFrameIngestServer::UdpListener> {
+public:
+	UdpListener(TmFrameIngestServer *server, TmPhysicalChannel *channel, const udp::endpoint &endpoint);
+	void receive();
+	void handleReceive(const boost::system::error_code &error, size_t received);
+
+	TmFrameIngestServer *server;	// The server.
+	TmPhysicalChannel *channel;		// The physical channel fed by the datagrams.
+	udp::socket socket;				// The listening socket.
+	vector<uint8_t> buffer;			// Receive buffer of one datagram; records are parsed in place.
+	udp::endpoint sender;			// Sender of the last datagram.
+	map<udp::endpoint, size_t> connections;	// Index of the counters of each sender (used by one handler at a time).
+};
+
+// Constructor of the TcpListener class.
+TmFrameIngestServer::TcpListener::TcpListener(TmFrameIngestServer *server, TmPhysicalChannel *channel,
+		TmCortexFraming *cortex, const tcp::endpoint &endpoint)
+	: server(server), channel(channel), cortex(cortex), acceptor(server->ioContext, endpoint)
+{
+}
+
+// Waits for the next connection.
+void TmFrameIngestServer::TcpListener::accept()
+{
+	boost::shared_ptr<TcpSession> session(new TcpSession(server, channel, cortex));
+	acceptor.async_accept(session->socket, boost::bind(&TcpListener::handleAccept, shared_from_this(), session,
+			boost::asio::placeholders::error));
+}
+
+// Starts a new connection and waits for the next one.
+void TmFrameIngestServer::TcpListener::handleAccept(boost::shared_ptr<TcpSession> session, const boost::system::error_code &error)
+{
+	if (error == boost::asio::error::operation_aborted) {		// The listener is closed.
+		return;
+	}
+	if (!error) {
+		session->start(acceptor.local_endpoint().port());
+	}
+	this->accept();
+}
+
+// Constructor of the TcpSession class.
+TmFrameIngestServer::TcpSession::TcpSession(TmFrameIngestServer *server, TmPhysicalChannel *channel, TmCortexFraming *cortex)
+	: server(server), channel(channel), cortex(cortex), socket(server->ioContext),
+	buffer(2 * ((cortex != NULL) ? TmCortexFraming::maxMessageLength : maxRecordLength)), filled(0), connection(0)
+{
+}
+
+// Adds the counters of the connection and starts reading.
+void TmFrameIngestServer::TcpSession::start(uint16_t localPort)
+{
+	boost::system::error_code error;
+	tcp::endpoint remote = socket.remote_endpoint(error);
+	connection = server->addConnection(tcpTransport, error ? string("unknown") : endpointName(remote), localPort);
+	this->read();
+}
+
+// Reads the next Bytes of the stream behind the incomplete record.
+void TmFrameIngestServer::TcpSession::read()
+{
+	socket.async_read_some(boost::asio::buffer(&buffer[filled], buffer.size() - filled), boost::bind(&TcpSession::handleRead,
+			shared_from_this(), boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred));
+}
+
+// Passes the complete records on and keeps the rest for the next read.
+void TmFrameIngestServer::TcpSession::handleRead(const boost::system::error_code &error, size_t received)
+{
+	if (error) {		// Closed by the peer or by the server; the session ends with its last handler.
+		boost::mutex::scoped_lock lock(server->mutex);
+		server->metrics[connection].open = false;
+		return;
+	}
+	filled += received;
+	size_t consumed = server->processRecords(&buffer[0], filled, channel, cortex, connection, false, received);
+	if (consumed > 0) {
+		memmove(&buffer[0], &buffer[consumed], filled - consumed);
+		filled -= consumed;
+	}
+	this->read();
+}
+
+// Constructor of the UdpListener class.
+TmFrameIngestServer::UdpListener::UdpListener(TmFrameIngestServer *server, TmPhysicalChannel *channel,
+		const udp::endpoint &endpoint)
+	: server(server), channel(channel), socket(server->ioContext, endpoint), buffer(maxRecordLength)
+{
+	boost::system::error_code error;
+	socket.set_option(udp::socket::receive_buffer_size(4 << 20), error);	// Bursts while all workers are busy.
+}
+
+// Waits for the next datagram.
+void TmFrameIngestServer::UdpListener::receive()
+{
+	socket.async_receive_from(boost::asio::buffer(buffer), sender, boost::bind(&UdpListener::handleReceive,
+			shared_from_this(), boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred));
+}
+
+// Passes the records of a datagram on and waits for the next one.
+void TmFrameIngestServer::UdpListener::handleReceive(const boost::system::error_code &error, size_t received)
+{
+	if (error == boost::asio::error::operation_aborted) {		// The listener is closed.
+		return;
+	}
+	if (!error) {
+		map<udp::endpoint, size_t>::iterator it = connections.find(sender);
+		if (it == connections.end()) {
+			it = connections.insert(make_pair(sender, server->addConnection(udpTransport, endpointName(sender),
+					socket.local_endpoint().port()))).first;
+		}
+		server->processRecords(&buffer[0], received, channel, NULL, it->second, true, received);
+	}
+	this->receive();
+}
+
+// Constructor of the TmFrameIngestServer class.
+TmFrameIngestServer::TmFrameIngestServer(size_t threadCount)
+{
+	this->threadCount = (threadCount > 0) ? threadCount : 1;
+	running = false;
+	defaultCortexFraming = new TmCortexFraming();
+}
+
+// Destructor of the TmFrameIngestServer class.
+TmFrameIngestServer::~TmFrameIngestServer()
+{
+	this->stop();
+	boost::system::error_code error;
+	for (size_t i = 0; i < tcpListeners.size(); i++) {
+		tcpListeners[i]->acceptor.close(error);
+	}
+	for (size_t i = 0; i < udpListeners.size(); i++) {
+		udpListeners[i]->socket.close(error);
+	}
+	// The connections still open are closed when the io_context destroys their pending handlers.
+	delete defaultCortexFraming;
+}
+
+// Opens a TCP listener feeding a physical channel.
+uint16_t TmFrameIngestServer::listenTcp(uint16_t port, TmPhysicalChannel *channel, string address)
+{
+	return this->openTcpListener(port, channel, NULL, address);
+}
+
+// Opens a TCP listener receiving Cortex messages and feeding a physical channel.
+uint16_t TmFrameIngestServer::listenCortexTcp(uint16_t port, TmPhysicalChannel *channel, TmCortexFraming *framing,
+		string address)
+{
+	return this->openTcpListener(port, channel, (framing != NULL) ? framing : defaultCortexFraming, address);
+}
+
+// Opens a TCP listener of records or Cortex messages.
+uint16_t TmFrameIngestServer::openTcpListener(uint16_t port, TmPhysicalChannel *channel, TmCortexFraming *cortex,
+		string address)
+{
+	if (channel == NULL) {
+		throw TmFrameIngestServerError("A listener needs a physical channel.\n");
+	}
+	boost::shared_ptr<TcpListener> listener;
+	try {
+		listener.reset(new TcpListener(this, channel, cortex, tcp::endpoint(boost::asio::ip::make_address(address), port)));
+	} catch (boost::system::system_error &e) {
+		ostringstream error;
+		error << "Cannot listen on TCP " << address << ":" << dec << port << " (" << e.what() << ")." << endl;
+		throw TmFrameIngestServerError(error.str());
+	}
+	this->getChannelMutex(channel);
+	tcpListeners.push_back(listener);
+	listener->accept();
+	return listener->acceptor.local_endpoint().port();
+}
+
+// Opens a UDP listener feeding a physical channel.
+uint16_t TmFrameIngestServer::listenUdp(uint16_t port, TmPhysicalChannel *channel, string address)
+{
+	if (channel == NULL) {
+		throw TmFrameIngestServerError("A listener needs a physical channel.\n");
+	}
+	boost::shared_ptr<UdpListener> listener;
+	try {
+		listener.reset(new UdpListener(this, channel, udp::endpoint(boost::asio::ip::make_address(address), port)));
+	} catch (boost::system::system_error &e) {
+		ostringstream error;
+		error << "Cannot listen on UDP " << address << ":" << dec << port << " (" << e.what() << ")." << endl;
+		throw TmFrameIngestServerError(error.str());
+	}
+	this->getChannelMutex(channel);
+	udpListeners.push_back(listener);
+	listener->receive();
+	return listener->socket.local_endpoint().port();
+}
+
+// Starts the worker threads.
+void TmFrameIngestServer::start()
+{
+	if (running) {
+		return;
+	}
+	ioContext.restart();
+	workGuard.reset(new boost::asio::executor_work_guard<boost::asio::io_context::executor_type>(ioContext.get_executor()));
+	for (size_t i = 0; i < threadCount; i++) {
+		threads.create_thread(boost::bind(&boost::asio::io_context::run, &ioContext));
+	}
+	running = true;
+}
+
+// Stops the worker threads.
+void TmFrameIngestServer::stop()
+{
+	if (!running) {
+		return;
+	}
+	workGuard.reset();
+	ioContext.stop();			// The pending reads are kept and resumed by start().
+	threads.join_all();
+	running = false;
+}
+
+// Indicates whether the worker threads run.
+bool TmFrameIngestServer::isRunning()
+{
+	return running;
+}
+
+// Retrieves a copy of the counters of all connections.
+vector<TmFrameIngestServer::ConnectionMetrics> TmFrameIngestServer::getConnectionMetrics()
+{
+	boost::mutex::scoped_lock lock(mutex);
+	return metrics;
+}
+
+// Retrieves the warnings collected since the last call and clears them.
+TmChannelWarning TmFrameIngestServer::popWarnings()
+{
+	boost::mutex::scoped_lock lock(mutex);
+	TmChannelWarning collected = warnings;
+	warnings = TmChannelWarning();
+	return collected;
+}
+
+// Builds the record of a frame.
+vector<uint8_t> TmFrameIngestServer::wrapFrame(const vector<uint8_t> &frame, TmFrameTimestamp timestamp, TmFrameBitrate bitrate)
+{
+	if (frame.size() > 65535) {
+		ostringstream error;
+		error << "Frame too long for a record (" << dec << frame.size() << " Bytes, max. 65535)." << endl;
+		throw TmFrameIngestServerError(error.str());
+	}
+	uint64_t seconds = timestamp.isValid() ? timestamp.getSeconds() : 0;
+	uint32_t fractions = timestamp.isValid() ? (uint32_t) min(floor(timestamp.getFractions() * 4294967296.0), 4294967295.0) : 0;
+	uint32_t rate = (bitrate.isValid() && (bitrate.getBitrate() > 0.0))
+			? (uint32_t) min(floor(bitrate.getBitrate() + 0.5), 4294967295.0) : 0;
+
+	vector<uint8_t> record(recordHeaderLength + frame.size());
+	record[0] = recordMarker[0];
+	record[1] = recordMarker[1];
+	record[2] = frame.size() >> 8;
+	record[3] = frame.size() & 0xFF;
+	for (int i = 0; i < 8; i++) {
+		record[4 + i] = (seconds >> (56 - 8 * i)) & 0xFF;
+	}
+	for (int i = 0; i < 4; i++) {
+		record[12 + i] = (fractions >> (24 - 8 * i)) & 0xFF;
+		record[16 + i] = (rate >> (24 - 8 * i)) & 0xFF;
+	}
+	if (!frame.empty()) {
+		memcpy(&record[recordHeaderLength], &frame[0], frame.size());
+	}
+	return record;
+}
+
+// Parses a record in place.
+size_t TmFrameIngestServer::parseRecord(const uint8_t *data, size_t length, TmFrameTimestamp &timestamp, TmFrameBitrate &bitrate)
+{
+	if (((length > 0) && (data[0] != recordMarker[0])) || ((length > 1) && (data[1] != recordMarker[1]))) {
+		throw TmFrameIngestServerError("Record marker missing.\n");
+	}
+	if (length < recordHeaderLength) {
+		return 0;
+	}
+	size_t recordLength = recordHeaderLength + ((data[2] << 8) | data[3]);
+	if (length < recordLength) {
+		return 0;
+	}
+
+	uint64_t seconds = 0;
+	uint32_t fractions = 0;
+	uint32_t rate = 0;
+	for (int i = 0; i < 8; i++) {
+		seconds = (seconds << 8) | data[4 + i];
+	}
+	for (int i = 0; i < 4; i++) {
+		fractions = (fractions << 8) | data[12 + i];
+		rate = (rate << 8) | data[16 + i];
+	}
+	timestamp = TmFrameTimestamp();
+	if (seconds != 0) {
+		timestamp.setSeconds(seconds);
+		timestamp.setFractions(fractions / 4294967296.0);
+	}
+	bitrate = TmFrameBitrate();
+	if (rate != 0) {
+		bitrate.setBitrate(rate);
+	}
+	return recordLength;
+}
+
+// Adds the counters of a new connection and returns their index.
+size_t TmFrameIngestServer::addConnection(Transport transport, string remoteEndpoint, uint16_t localPort)
+{
+	ConnectionMetrics connection;
+	connection.transport = transport;
+	connection.remoteEndpoint = remoteEndpoint;
+	connection.localPort = localPort;
+	connection.open = true;
+	connection.byteCount = 0;
+	connection.frameCount = 0;
+	connection.framingErrorCount = 0;
+	connection.warningCount = 0;
+
+	boost::mutex::scoped_lock lock(mutex);
+	metrics.push_back(connection);
+	return metrics.size() - 1;
+}
+
+// Passes the complete records of a buffer to a physical channel.
+size_t TmFrameIngestServer::processRecords(const uint8_t *data, size_t length, TmPhysicalChannel *channel,
+		TmCortexFraming *cortex, size_t connection, bool datagram, size_t received)
+{
+	static const uint8_t cortexMarker[4] = {0x49, 0x96, 0x02, 0xD2};	// The start flag of a Cortex message.
+	const uint8_t *marker = (cortex != NULL) ? cortexMarker : recordMarker;
+	size_t markerLength = (cortex != NULL) ? sizeof(cortexMarker) : sizeof(recordMarker);
+
+	FrameReference batch[frameBatchLength];
+	size_t batchCount = 0;
+	TmChannelWarning collected;
+	uint64_t frameCount = 0;
+	uint64_t framingErrorCount = 0;
+	uint64_t warningCount = 0;
+	size_t position = 0;
+
+	while (position < length) {
+		FrameReference &reference = batch[batchCount];
+		size_t recordLength;
+		bool accepted = true;
+		try {
+			if (cortex != NULL) {
+				TmCortexFraming::Message message;
+				recordLength = cortex->parseMessage(data + position, length - position, message);
+				if (recordLength > 0) {
+					reference.frame = message.frame;
+					reference.length = message.frameLength;
+					reference.timestamp = TmFrameTimestamp();
+					reference.bitrate = TmFrameBitrate();
+					accepted = cortex->acceptsFlow(message.flowId);
+				}
+			} else {
+				recordLength = parseRecord(data + position, length - position, reference.timestamp, reference.bitrate);
+				reference.frame = data + position + recordHeaderLength;
+				reference.length = recordLength - recordHeaderLength;
+			}
+		} catch (runtime_error &) {		// TmFrameIngestServerError or TmCortexFramingError.
+			framingErrorCount++;
+			if (datagram) {				// The rest of the datagram cannot be trusted.
+				position = length;
+				break;
+			}
+			const uint8_t *next = search(data + position + 1, data + length, marker, marker + markerLength);
+			for (size_t keep = min(markerLength - 1, length - position - 1); (next == data + length) && (keep > 0); keep--) {
+				if (memcmp(data + length - keep, marker, keep) == 0) {
+					next = data + length - keep;		// The marker may continue in the next read.
+				}
+			}
+			position = next - data;
+			continue;
+		}
+		if (recordLength == 0) {		// Incomplete record.
+			if (datagram) {
+				framingErrorCount++;
+				position = length;
+			}
+			break;
+		}
+
+		position += recordLength;
+		if (accepted && (++batchCount == frameBatchLength)) {	// Messages of other flows are skipped.
+			warningCount += this->deliverFrames(batch, batchCount, channel, collected);
+			frameCount += batchCount;
+			batchCount = 0;
+		}
+	}
+	if (batchCount > 0) {
+		warningCount += this->deliverFrames(batch, batchCount, channel, collected);
+		frameCount += batchCount;
+	}
+
+	boost::mutex::scoped_lock lock(mutex);
+	metrics[connection].byteCount += received;
+	metrics[connection].frameCount += frameCount;
+	metrics[connection].framingErrorCount += framingErrorCount;
+	metrics[connection].warningCount += warningCount;
+	if (warningCount > 0) {
+		warnings += collected;
+	}
+	return position;
+}
+
+// Passes a batch of frames to a physical channel, holding its lock once.
+uint64_t TmFrameIngestServer::deliverFrames(FrameReference *frames, size_t count, TmPhysicalChannel *channel,
+		TmChannelWarning &collected)
+{
+	boost::mutex::scoped_lock lock(*this->getChannelMutex(channel));
+	uint64_t warningCount = 0;
+	for (size_t i = 0; i < count; i++) {
+		TmChannelWarning warning;
+		try {			// The frame is read where it is in the receive buffer.
+			warning = channel->receiveFrame(frames[i].frame, frames[i].length, frames[i].timestamp, frames[i].bitrate);
+		} catch (runtime_error &error) {	// Nobody would catch it on this thread.
+			warning.appendFreeMessage(error.what());
+		}
+		if (warning.warningAvailable()) {
+			warningCount++;
+			collected += warning;
+		}
+	}
+	return warningCount;
+}
+
+// Retrieves the mutex serializing the calls of a physical channel.
+boost::mutex *TmFrameIngestServer::getChannelMutex(TmPhysicalChannel *channel)
+{
+	boost::mutex::scoped_lock lock(mutex);
+	boost::shared_ptr<boost::mutex> &channelMutex = channelMutexes[channel];
+	if (!channelMutex) {
+		channelMutex.reset(new boost::mutex());
+	}
+	return channelMutex.get();
+}
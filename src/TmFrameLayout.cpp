@@ -0,0 +1,66 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "TmFrameLayout.h"
+#include "TmOcf.h"
+
+#include <stdint.h>
+
+using namespace std;
+
+// Default constructor: minimum size frame without optional fields.
+TmFrameLayout::TmFrameLayout()
+{
+	*this = TmFrameLayout(7, 0, false, false);
+}
+
+// Constructor of the TmFrameLayout class.
+TmFrameLayout::TmFrameLayout(uint16_t length, uint16_t secondHeader, bool ocf, bool fecf)
+{
+	frameLength = length;
+	secondHeaderLength = secondHeader;
+	ocfPresent = ocf;
+	fecfPresent = fecf;
+
+	// The trailer (OCF and FECF) is placed at the end of the frame.
+	int32_t trailerLength = 0;
+	if (ocfPresent) {
+		trailerLength += TmOcf::ocfLength;
+	}
+	if (fecfPresent) {
+		trailerLength += fecfLength;
+	}
+
+	// Signed arithmetic is used so that configurations which do not fit in the frame end up with a zero length.
+	int32_t end = (int32_t) frameLength - trailerLength;
+	int32_t start = primaryHeaderLength + secondHeaderLength;
+	int32_t dataLength = end - start;
+
+	dataFieldStart = start;
+	dataFieldEnd = (end > 0) ? end : 0;
+	dataFieldLength = (dataLength > 0) ? dataLength : 0;
+
+	// The Secondary Header may use everything except the Primary Header, the trailer and one Byte of Data Field.
+	int32_t maxSh = end - primaryHeaderLength - 1;
+	if (maxSh < 0) {
+		maxSh = 0;
+	} else if (maxSh > maxSecondHeaderLength) {	// The maximum length allowed by standard is 64, so we truncate higher lengths.
+		maxSh = maxSecondHeaderLength;
+	}
+	maxSecondHeader = maxSh;
+}
@@ -0,0 +1,228 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "TmFrameSynchronizer.h"
+#include "TmPhysicalChannel.h"
+#include "TmCadu.h"
+#include "TmFrameTimestamp.h"
+#include "TmFrameBitrate.h"
+#include "myErrors.h"
+
+#include <vector>
+#include <sstream>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+using namespace std;
+
+// Constructor of the TmFrameSynchronizer class.
+TmFrameSynchronizer::TmFrameSynchronizer(TmPhysicalChannel *channel)
+{
+	if (!channel) {
+		throw TmFrameSynchronizerError("No physical channel given.\n");
+	}
+	physicalChannel = channel;
+	derandomize = true;
+	checkThreshold = 1;
+	flywheelThreshold = 3;
+	frameCount = 0;
+	flywheelFrameCount = 0;
+	lostLockCount = 0;
+	skippedByteCount = 0;
+	this->reset();
+}
+
+// Sets the derandomization flag to TRUE.
+void TmFrameSynchronizer::activateDerandomization()
+{
+	derandomize = true;
+}
+
+// Sets the derandomization flag to FALSE.
+void TmFrameSynchronizer::deactivateDerandomization()
+{
+	derandomize = false;
+}
+
+// Retrieves the value of the derandomization flag.
+bool TmFrameSynchronizer::getDerandomizationStatus()
+{
+	return derandomize;
+}
+
+// Sets the number of CADUs which have to start with the ASM before the frames are passed on.
+void TmFrameSynchronizer::setCheckThreshold(uint16_t count)
+{
+	checkThreshold = count;
+}
+
+// Retrieves the check threshold.
+uint16_t TmFrameSynchronizer::getCheckThreshold()
+{
+	return checkThreshold;
+}
+
+// Sets the number of missing ASMs in a row which are bridged before returning to the search.
+void TmFrameSynchronizer::setFlywheelThreshold(uint16_t count)
+{
+	flywheelThreshold = count;
+}
+
+// Retrieves the flywheel threshold.
+uint16_t TmFrameSynchronizer::getFlywheelThreshold()
+{
+	return flywheelThreshold;
+}
+
+// Retrieves the state of the synchronizer.
+TmFrameSynchronizer::SyncState TmFrameSynchronizer::getState()
+{
+	return state;
+}
+
+// Processes the next chunk of the received Byte stream.
+TmChannelWarning TmFrameSynchronizer::receiveData(const uint8_t *data, size_t length, TmFrameTimestamp timestamp,
+		TmFrameBitrate bitrate)
+{
+	if (physicalChannel->getVariableFrameLengthStatus()) {
+		throw TmFrameSynchronizerError("Variable-length frames cannot be synchronized by their length.\n");
+	}
+	TmChannelWarning warning;
+	size_t caduLength = TmCadu::asmLength + physicalChannel->getCodeblockLength();
+	int64_t pending = buffer.size();			// Bytes of earlier chunks, for the timestamps.
+	buffer.insert(buffer.end(), data, data + length);
+
+	size_t position = 0;
+	while (buffer.size() - position >= TmCadu::asmLength) {
+		if (state == searchState) {
+			size_t found = TmCadu::findAsm(&buffer[position], buffer.size() - position);
+			if (position + found + TmCadu::asmLength > buffer.size()) {		// No ASM: the last Bytes may be the start of one.
+				size_t keep = TmCadu::asmLength - 1;
+				size_t skip = buffer.size() - position - keep;
+				skippedByteCount += skip;
+				position += skip;
+				break;
+			}
+			skippedByteCount += found;
+			position += found;
+			state = (checkThreshold > 0) ? checkState : lockState;
+			stateCount = 0;
+		}
+		if (buffer.size() - position < caduLength) {
+			break;		// The CADU is completed by the next chunk.
+		}
+
+		if (!this->updateState(TmCadu::isAsm(&buffer[position]), warning)) {
+			position++;		// The search restarts one Byte after the expected ASM.
+			continue;
+		}
+		if (state != checkState) {
+			vector<uint8_t> frame(buffer.begin() + position + TmCadu::asmLength, buffer.begin() + position + caduLength);
+			warning += this->deliverFrame(frame, timestamp, bitrate, 8 * ((int64_t) (position + TmCadu::asmLength) - pending));
+		}
+		position += caduLength;
+	}
+	buffer.erase(buffer.begin(), buffer.begin() + position);	// The processed Bytes are discarded once per chunk.
+	return warning;
+}
+
+// Discards the buffered Bytes and returns to the search.
+void TmFrameSynchronizer::reset()
+{
+	buffer.clear();
+	state = searchState;
+	stateCount = 0;
+}
+
+// Retrieves the number of frames passed to the physical channel.
+uint64_t TmFrameSynchronizer::getFrameCount()
+{
+	return frameCount;
+}
+
+// Retrieves the number of frames passed on without their ASM.
+uint64_t TmFrameSynchronizer::getFlywheelFrameCount()
+{
+	return flywheelFrameCount;
+}
+
+// Retrieves the number of times the synchronization was lost.
+uint64_t TmFrameSynchronizer::getLostLockCount()
+{
+	return lostLockCount;
+}
+
+// Retrieves the number of Bytes skipped while searching the ASM.
+uint64_t TmFrameSynchronizer::getSkippedByteCount()
+{
+	return skippedByteCount;
+}
+
+// Advances the state machine by one CADU.
+bool TmFrameSynchronizer::updateState(bool asmFound, TmChannelWarning &warning)
+{
+	if (state == checkState) {
+		if (!asmFound) {
+			state = searchState;
+			return false;
+		}
+		if (++stateCount > checkThreshold) {		// The ASM was confirmed often enough: this frame is passed on.
+			state = lockState;
+		}
+	} else if (asmFound) {
+		state = lockState;
+		stateCount = 0;
+	} else if (++stateCount > flywheelThreshold) {
+		state = searchState;
+		lostLockCount++;
+		warning.appendFreeMessage("Frame synchronization lost.");
+		return false;
+	} else {
+		state = flywheelState;
+		flywheelFrameCount++;
+	}
+	return true;
+}
+
+// Derandomizes a frame and passes it to the physical channel.
+TmChannelWarning TmFrameSynchronizer::deliverFrame(vector<uint8_t> &frame, TmFrameTimestamp timestamp, TmFrameBitrate bitrate,
+		int64_t bitOffset)
+{
+	if (derandomize) {
+		TmCadu::randomize(&frame[0], frame.size());
+	}
+
+	TmFrameTimestamp frameTimestamp;		// Zero seconds: invalid unless the time of the frame is set below.
+	if (timestamp.isValid() && bitrate.isValid() && (bitrate.getBitrate() > 0.0)) {	// The chunk timestamp is advanced to the frame.
+		double time = timestamp.getFractions() + (double) bitOffset / bitrate.getBitrate();
+		double whole = floor(time);
+		double fractions = time - whole;
+		if (fractions >= 1.0) {		// Rounding of a tiny negative time.
+			whole += 1.0;
+			fractions = 0.0;
+		}
+		int64_t seconds = (int64_t) timestamp.getSeconds() + (int64_t) whole;
+		if (seconds >= 1) {			// Zero or negative seconds cannot be told from a missing timestamp: left invalid.
+			frameTimestamp.setSeconds(seconds);
+			frameTimestamp.setFractions(fractions);
+		}
+	}
+	frameCount++;
+	return physicalChannel->receiveFrame(frame, frameTimestamp, bitrate);
+}
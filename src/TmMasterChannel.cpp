@@ -27,6 +27,7 @@ along with tmtp. If not, see <http://www.gnu.org/licenses/>.
 
 #include <vector>
 #include <sstream>
+#include <utility>
 #include <stdint.h>
 
 using namespace std;
@@ -45,7 +46,8 @@ TmMasterChannel::TmMasterChannel(uint16_t scid, TmPhysicalChannel *parent)
 
     ocfPresent = true;					// Will use the Operational Control Field.
     sendFrameCount = 0;					// Resets the sent frame counter.
-    recFrameCount = 0;					// Resets the received frame counter.
+    recSequence.setModulus(256);		// The first received frame starts the sequence of the 8-bit counter.
+	recIdleFrameCount = 0;				// Resets the received idle frame counter.
     secondHeaderPresent = false;		// Will NOT use the TM Secondary Header,
 	extendedVcFrameCountUsed = false;	// 	and therefore no extended VC Frame Counter will be used.
 
@@ -64,7 +66,7 @@ TmMasterChannel::TmMasterChannel(uint16_t scid, TmPhysicalChannel *parent)
 			// initialConf = netProtConf = new NetProtConf;
 			// debugOutput = false;
 			// sendFrameCount = 0;
-			// recFrameCount = 0;
+			// recSequence = TmSequenceTracker(256);
 			// recPacketHeaderLength = 0;
 			// recPacketLength = 0;
 		
@@ -98,7 +100,19 @@ uint16_t TmMasterChannel::getSendFrameCount()
 // Retrieves the received frame counter.
 uint16_t TmMasterChannel::getRecFrameCount()
 {
-	return recFrameCount;
+	return recSequence.getExpectedCount();
+}
+
+// Retrieves the tracker of the received frame counter.
+TmSequenceTracker& TmMasterChannel::getRecSequence()
+{
+	return recSequence;
+}
+
+// Retrieves the number of idle frames received.
+uint64_t TmMasterChannel::getRecIdleFrameCount()
+{
+	return recIdleFrameCount;
 }
 
 // Retrieves the total frame length as configured in the physical channel.
@@ -113,6 +127,12 @@ bool TmMasterChannel::getFecfStatus()
 	return physicalChannel->getFecfStatus();
 }
 
+// Retrieves the variable frame length flag as configured in the physical channel.
+bool TmMasterChannel::getVariableFrameLengthStatus()
+{
+	return physicalChannel->getVariableFrameLengthStatus();
+}
+
 // Sets the OCF Flag to TRUE.
 void TmMasterChannel::activateOcf()
 {
@@ -210,23 +230,35 @@ bool TmMasterChannel::frameAvailable()
 	return a;
 }
 
-// Verifies if a received frame has the correct settings for this master channel.
-TmChannelWarning TmMasterChannel::receiveFrame(TmTransferFrame frame)
+// Verifies a received frame the caller keeps; the whole frame is copied first.
+TmChannelWarning TmMasterChannel::receiveFrame(const TmTransferFrame &frame)
+{
+	TmTransferFrame copy(frame);
+	return this->receiveFrame(std::move(copy));
+}
+
+// Verifies a received frame the caller no longer needs; it is passed on without copies.
+TmChannelWarning TmMasterChannel::receiveFrame(TmTransferFrame &&frame)
 {
 	TmChannelWarning warning;		// Creates an instance of TmChannelWarning to receive any warnings/errors occured.
+	TmSequenceTracker::SequenceStatus sequence = TmSequenceTracker::inSequence;
 
 	// check scid
 	if (frame.getSpacecraftId() != spacecraftId) {
 		// warning message
 		warning.setWrongScid();
+	} else if ((sequence = recSequence.update(frame.getMasterChannelFrameCount())) == TmSequenceTracker::duplicate) {
+		// warning message
+		warning.addDuplicateFramesCount(1);		// A frame received twice is dropped.
+	} else if (sequence == TmSequenceTracker::outOfOrder) {
+		// warning message
+		warning.addOutOfOrderFramesCount(1);	// A frame received after later frames is dropped.
 	} else {
 		// check frame count
-		if (recFrameCount == frame.getMasterChannelFrameCount()) {
-			recFrameCount = (recFrameCount+1) % 256;	// Increases the counter and performs a modulo 256
-		} else {
+		if (((sequence == TmSequenceTracker::gap) || (sequence == TmSequenceTracker::resync))
+				&& (recSequence.getLastGapLength() > 0)) {
 			// warning message
-			warning.addMCLostFramesCount((frame.getMasterChannelFrameCount() - recFrameCount + 256) % 256);
-			recFrameCount = (frame.getMasterChannelFrameCount()+1) % 256;	// Rectifies the received frame counter.
+			warning.addMCLostFramesCount(recSequence.getLastGapLength());
 		}
 		// check OCF flag
 		if (ocfPresent != frame.getOcfStatus()) {
@@ -245,7 +277,12 @@ TmChannelWarning TmMasterChannel::receiveFrame(TmTransferFrame frame)
 		}
 		uint16_t vcid = frame.getVirtualChannelId();	// Extracts the frame's Virtual Channel ID and...
 		if (virtualChannels[vcid]) {					// ... If such a VC is configured (i. e. it exists):
-			 warning += virtualChannels[vcid]->receiveFrame(frame);		// The frame is sent/assigned to that VC.
+			if (this->isIdleFrame(frame)) {
+				recIdleFrameCount++;
+				warning += virtualChannels[vcid]->receiveIdleFrame(frame);	// Only the VC counters are updated.
+			} else {
+				warning += virtualChannels[vcid]->receiveFrame(std::move(frame));	// The frame is sent/assigned to that VC.
+			}
 		} else {
 			// warning message
 			warning.setUnconfiguredVC();
@@ -254,6 +291,17 @@ TmChannelWarning TmMasterChannel::receiveFrame(TmTransferFrame frame)
 	return warning;
 }
 
+// Checks whether a received frame carries only idle data.
+bool TmMasterChannel::isIdleFrame(TmTransferFrame &frame)
+{
+	if (frame.getVirtualChannelId() == idleChannel) {
+		return true;
+	}
+	// The First Header Pointer is only present if the Synchronization Flag is zero.
+	return frame.getDataFieldSynchronisationStatus()
+			&& (frame.getFirstHeaderPointer() == TmTransferFrame::fhpOnlyIdleData);
+}
+
 // Prepares a frame according to the physical channel settings to be sent over a virtual channel and appends a timestamp.
 TmTransferFrame TmMasterChannel::sendFrame(TmFrameTimestamp timestamp)
 {
@@ -104,7 +104,7 @@ vector<uint8_t> TmOcf::wrap()
 }
 
 // Takes a raw vector (Report Type flags + contents), reads and sets the flags to '0', sets "reportType" accordingly and stores all back into "content".
-void TmOcf::unwrap(vector<uint8_t> raw)
+void TmOcf::unwrap(const vector<uint8_t> &raw)
 {
 	if (raw.size() != ocfLength) {	// Checks if the received raw vector is 4 Bytes long.
 		ostringstream error;
@@ -0,0 +1,447 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "TmPacketPublisher.h"
+#include "GroundPacketServer.h"
+#include "TmVirtualChannel.h"
+#include "myErrors.h"
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <boost/asio.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+
+using namespace std;
+using boost::asio::ip::tcp;
+
+const uint8_t TmPacketPublisher::framingVersion;
+const size_t TmPacketPublisher::framingHeaderLength;
+const size_t TmPacketPublisher::messageHeaderLength;
+const uint8_t TmPacketPublisher::packetMessage;
+const uint8_t TmPacketPublisher::subscriptionMessage;
+const uint8_t TmPacketPublisher::anyVc;
+const uint16_t TmPacketPublisher::anyApid;
+const uint16_t TmPacketPublisher::vcCount;
+const size_t TmPacketPublisher::defaultQueueLength;
+
+static const size_t maxRequestLength = 65536;		// Longest subscription message accepted.
+static const size_t maxWriteBatch = 64;				// Messages handed to one write.
+
+// A connected subscriber with its queue and filter.
+class TmPacketPublisher::Subscriber : public boost::enable_shared_from_this<TmPacketPublisher::Subscriber> {
+public:
+	Subscriber(TmPacketPublisher *publisher);
+	void readHeader();
+	void handleHeader(const boost::system::error_code &error);
+	void handleRequest(const boost::system::error_code &error);
+	void setFilter(const uint8_t *entries, size_t count);
+	bool accepts(uint16_t vcid, uint16_t apid);
+	void write();
+	void handleWrite(const boost::system::error_code &error);
+
+	TmPacketPublisher *publisher;	// The publisher.
+	tcp::socket socket;				// The connection.
+	uint8_t header[framingHeaderLength];	// Framing header of the message being read.
+	vector<uint8_t> request;		// Message being read.
+	vector<bool> filter;			// Accepted packets: virtual channel times APID (the last one for non-Space Packets).
+	deque<boost::shared_ptr<const vector<uint8_t> > > queue;		// Messages waiting (protected by the publisher mutex).
+	vector<boost::shared_ptr<const vector<uint8_t> > > inFlight;	// Messages being written.
+	bool writing;					// Indicates whether a write is pending or posted.
+	bool closed;					// Indicates whether the subscriber was removed.
+};
+
+// Constructor of the Subscriber class. All packets are accepted.
+TmPacketPublisher::Subscriber::Subscriber(TmPacketPublisher *publisher)
+	: publisher(publisher), socket(publisher->ioContext), filter(vcCount * (SpacePacketConf::apidCount + 1), true), writing(false), closed(false)
+{
+}
+
+// Reads the framing header of the next message of the subscriber.
+void TmPacketPublisher::Subscriber::readHeader()
+{
+	boost::asio::async_read(socket, boost::asio::buffer(header, framingHeaderLength), boost::bind(&Subscriber::handleHeader,
+			shared_from_this(), boost::asio::placeholders::error));
+}
+
+// Checks the framing header and reads the message.
+void TmPacketPublisher::Subscriber::handleHeader(const boost::system::error_code &error)
+{
+	uint32_t length = ((uint32_t) header[1] << 24) | (header[2] << 16) | (header[3] << 8) | header[4];
+	if (error || (header[0] != framingVersion) || (length <= framingHeaderLength) || (length > maxRequestLength)) {
+		publisher->removeSubscriber(this);
+		return;
+	}
+	request.resize(length - framingHeaderLength);
+	boost::asio::async_read(socket, boost::asio::buffer(request), boost::bind(&Subscriber::handleRequest,
+			shared_from_this(), boost::asio::placeholders::error));
+}
+
+// Applies a subscription and reads the next message.
+void TmPacketPublisher::Subscriber::handleRequest(const boost::system::error_code &error)
+{
+	if (error || (request[0] != subscriptionMessage) || ((request.size() - 1) % 3 != 0)) {
+		publisher->removeSubscriber(this);
+		return;
+	}
+	this->setFilter(&request[1], (request.size() - 1) / 3);
+	this->readHeader();
+}
+
+// Compiles a list of virtual channel and APID pairs into the filter table.
+void TmPacketPublisher::Subscriber::setFilter(const uint8_t *entries, size_t count)
+{
+	vector<bool> table(vcCount * (SpacePacketConf::apidCount + 1), count == 0);	// No pairs: all packets.
+	for (size_t i = 0; i < count; i++) {
+		uint8_t vcid = entries[3 * i];
+		uint16_t apid = (entries[3 * i + 1] << 8) | entries[3 * i + 2];
+		for (uint16_t vc = 0; vc < vcCount; vc++) {
+			if ((vcid != anyVc) && (vcid != vc)) {
+				continue;
+			}
+			if (apid == anyApid) {
+				fill(table.begin() + vc * (SpacePacketConf::apidCount + 1), table.begin() + (vc + 1) * (SpacePacketConf::apidCount + 1), true);
+			} else if (apid < SpacePacketConf::apidCount) {
+				table[vc * (SpacePacketConf::apidCount + 1) + apid] = true;
+			}
+		}
+	}
+	boost::mutex::scoped_lock lock(publisher->mutex);
+	filter.swap(table);
+}
+
+// Indicates whether the filter accepts a packet (called with the publisher mutex held).
+bool TmPacketPublisher::Subscriber::accepts(uint16_t vcid, uint16_t apid)
+{
+	return filter[vcid * (SpacePacketConf::apidCount + 1) + ((apid == anyApid) ? SpacePacketConf::apidCount : apid)];
+}
+
+// Writes the queued messages.
+void TmPacketPublisher::Subscriber::write()
+{
+	vector<boost::asio::const_buffer> buffers;
+	{
+		boost::mutex::scoped_lock lock(publisher->mutex);
+		inFlight.clear();
+		while (!queue.empty() && (inFlight.size() < maxWriteBatch)) {
+			inFlight.push_back(queue.front());
+			queue.pop_front();
+		}
+		if (inFlight.empty() || closed) {
+			writing = false;
+			return;
+		}
+	}
+	for (size_t i = 0; i < inFlight.size(); i++) {		// The shared messages are written from where they are.
+		buffers.push_back(boost::asio::buffer(*inFlight[i]));
+	}
+	boost::asio::async_write(socket, buffers, boost::bind(&Subscriber::handleWrite, shared_from_this(),
+			boost::asio::placeholders::error));
+}
+
+// Writes the messages queued meanwhile.
+void TmPacketPublisher::Subscriber::handleWrite(const boost::system::error_code &error)
+{
+	if (error) {
+		publisher->removeSubscriber(this);
+		return;
+	}
+	this->write();
+}
+
+// Constructor of the TmPacketPublisher class.
+TmPacketPublisher::TmPacketPublisher(NetProtConf *conf, size_t queueLength) : GroundPacketServer(conf)
+{
+	this->queueLength = (queueLength > 0) ? queueLength : 1;
+	running = false;
+	publishedCount = 0;
+	droppedCount = 0;
+}
+
+// Destructor of the TmPacketPublisher class.
+TmPacketPublisher::~TmPacketPublisher()
+{
+	this->stop();
+	boost::system::error_code error;
+	if (acceptor) {
+		acceptor->close(error);
+	}
+	boost::mutex::scoped_lock lock(mutex);
+	for (size_t i = 0; i < subscribers.size(); i++) {
+		subscribers[i]->closed = true;
+		subscribers[i]->socket.close(error);
+	}
+	subscribers.clear();
+}
+
+// Opens the TCP port the subscribers connect to.
+uint16_t TmPacketPublisher::listen(uint16_t port, string address)
+{
+	if (acceptor) {
+		throw GroundPacketServerError("The publisher already listens.\n");
+	}
+	try {
+		acceptor.reset(new tcp::acceptor(ioContext, tcp::endpoint(boost::asio::ip::make_address(address), port)));
+	} catch (boost::system::system_error &e) {
+		ostringstream error;
+		error << "Cannot listen on TCP " << address << ":" << dec << port << " (" << e.what() << ")." << endl;
+		throw GroundPacketServerError(error.str());
+	}
+	this->accept();
+	return acceptor->local_endpoint().port();
+}
+
+// Starts the network thread.
+void TmPacketPublisher::start()
+{
+	if (running) {
+		return;
+	}
+	ioContext.restart();
+	workGuard.reset(new boost::asio::executor_work_guard<boost::asio::io_context::executor_type>(ioContext.get_executor()));
+	thread = boost::thread(boost::bind(&boost::asio::io_context::run, &ioContext));
+	running = true;
+}
+
+// Stops the network thread.
+void TmPacketPublisher::stop()
+{
+	if (!running) {
+		return;
+	}
+	workGuard.reset();
+	ioContext.stop();
+	thread.join();
+	running = false;
+}
+
+// Adds a virtual channel whose packets are published.
+void TmPacketPublisher::addTmVc(TmVirtualChannel *vc)
+{
+	if ((vc != NULL) && (find(tmVcs.begin(), tmVcs.end(), vc) == tmVcs.end())) {
+		tmVcs.push_back(vc);
+	}
+}
+
+// Takes all packets from the input queues of the virtual channels and publishes them.
+void TmPacketPublisher::signalNewPacket()
+{
+	if (!tmVc && tmVcs.empty()) {
+		ostringstream error;
+		error << "No TmVirtualChannel specified." << endl;
+		throw GroundPacketServerError(error.str());
+	}
+	for (size_t i = 0; i <= tmVcs.size(); i++) {
+		TmVirtualChannel *vc = (i < tmVcs.size()) ? tmVcs[i] : tmVc;
+		if (!vc || ((i == tmVcs.size()) && (find(tmVcs.begin(), tmVcs.end(), vc) != tmVcs.end()))) {
+			continue;			// The channel of connectTmVc() is also in the list.
+		}
+		while (vc->packetAvailable()) {
+			try {
+				this->publishPacket(vc->getVirtualChannelId(), vc->receivePacket());
+			} catch (TmVirtualChannelError& e) {
+				ostringstream error;
+				error << "Error in TmVirtualChannel: " << e.what() << endl;
+				throw GroundPacketServerError(error.str());
+			}
+		}
+	}
+}
+
+// Encodes a packet once and queues it for all subscribers whose filter accepts it.
+size_t TmPacketPublisher::publishPacket(uint16_t vcid, const TimeTaggedPacket &packet)
+{
+	vcid &= vcCount - 1;
+	uint16_t apid = extractApid(packet.data);
+	TmFrameTimestamp timestamp = packet.timestamp;
+	uint64_t seconds = timestamp.isValid() ? timestamp.getSeconds() : 0;
+	uint32_t fractions = timestamp.isValid() ? (uint32_t) min(floor(timestamp.getFractions() * 4294967296.0), 4294967295.0) : 0;
+	uint32_t length = framingHeaderLength + messageHeaderLength + packet.data.size();
+
+	vector<uint8_t> *message = new vector<uint8_t>(length);
+	boost::shared_ptr<const vector<uint8_t> > shared(message);		// Encoded once for all subscribers.
+	uint8_t *pos = &(*message)[0];
+	pos[0] = framingVersion;
+	for (int i = 0; i < 4; i++) {
+		pos[1 + i] = (length >> (24 - 8 * i)) & 0xFF;
+	}
+	pos[5] = packetMessage;
+	pos[6] = vcid;
+	pos[7] = apid >> 8;
+	pos[8] = apid & 0xFF;
+	for (int i = 0; i < 8; i++) {
+		pos[9 + i] = (seconds >> (56 - 8 * i)) & 0xFF;
+	}
+	for (int i = 0; i < 4; i++) {
+		pos[17 + i] = (fractions >> (24 - 8 * i)) & 0xFF;
+	}
+	if (!packet.data.empty()) {
+		memcpy(pos + framingHeaderLength + messageHeaderLength, &packet.data[0], packet.data.size());
+	}
+
+	size_t queued = 0;
+	boost::mutex::scoped_lock lock(mutex);
+	publishedCount++;
+	for (size_t i = 0; i < subscribers.size(); i++) {
+		Subscriber &subscriber = *subscribers[i];
+		if (!subscriber.accepts(vcid, apid)) {
+			continue;
+		}
+		if (subscriber.queue.size() >= queueLength) {	// Lagging subscriber: the oldest packet makes room.
+			subscriber.queue.pop_front();
+			droppedCount++;
+		}
+		subscriber.queue.push_back(shared);
+		queued++;
+		if (!subscriber.writing) {
+			subscriber.writing = true;
+			boost::asio::post(ioContext, boost::bind(&Subscriber::write, subscribers[i]));
+		}
+	}
+	return queued;
+}
+
+// Retrieves the number of connected subscribers.
+size_t TmPacketPublisher::getSubscriberCount()
+{
+	boost::mutex::scoped_lock lock(mutex);
+	return subscribers.size();
+}
+
+// Retrieves the number of packets published.
+uint64_t TmPacketPublisher::getPublishedCount()
+{
+	boost::mutex::scoped_lock lock(mutex);
+	return publishedCount;
+}
+
+// Retrieves the number of packets dropped from the queues of lagging subscribers.
+uint64_t TmPacketPublisher::getDroppedCount()
+{
+	boost::mutex::scoped_lock lock(mutex);
+	return droppedCount;
+}
+
+// Builds a subscription message.
+vector<uint8_t> TmPacketPublisher::buildSubscription(const vector<Subscription> &subscriptions)
+{
+	uint32_t length = framingHeaderLength + 1 + 3 * subscriptions.size();
+	vector<uint8_t> message;
+	message.reserve(length);
+	message.push_back(framingVersion);
+	for (int i = 0; i < 4; i++) {
+		message.push_back((length >> (24 - 8 * i)) & 0xFF);
+	}
+	message.push_back(subscriptionMessage);
+	for (size_t i = 0; i < subscriptions.size(); i++) {
+		message.push_back(subscriptions[i].vcid);
+		message.push_back(subscriptions[i].apid >> 8);
+		message.push_back(subscriptions[i].apid & 0xFF);
+	}
+	return message;
+}
+
+// Parses a published message.
+bool TmPacketPublisher::parseMessage(const vector<uint8_t> &message, uint16_t &vcid, uint16_t &apid, TmFrameTimestamp &timestamp,
+		vector<uint8_t> &packet)
+{
+	if ((message.size() < framingHeaderLength + messageHeaderLength) || (message[0] != framingVersion)
+			|| (message[framingHeaderLength] != packetMessage)) {
+		return false;
+	}
+	uint32_t length = ((uint32_t) message[1] << 24) | (message[2] << 16) | (message[3] << 8) | message[4];
+	if (length != message.size()) {
+		return false;
+	}
+	vcid = message[6];
+	apid = (message[7] << 8) | message[8];
+	uint64_t seconds = 0;
+	uint32_t fractions = 0;
+	for (int i = 0; i < 8; i++) {
+		seconds = (seconds << 8) | message[9 + i];
+	}
+	for (int i = 0; i < 4; i++) {
+		fractions = (fractions << 8) | message[17 + i];
+	}
+	timestamp = TmFrameTimestamp();
+	if (seconds != 0) {
+		timestamp.setSeconds(seconds);
+		timestamp.setFractions(fractions / 4294967296.0);
+	}
+	packet.assign(message.begin() + framingHeaderLength + messageHeaderLength, message.end());
+	return true;
+}
+
+// Waits for the next subscriber.
+void TmPacketPublisher::accept()
+{
+	boost::shared_ptr<Subscriber> subscriber(new Subscriber(this));
+	acceptor->async_accept(subscriber->socket, boost::bind(&TmPacketPublisher::handleAccept, this, subscriber,
+			boost::asio::placeholders::error));
+}
+
+// Adds an accepted subscriber and waits for the next one.
+void TmPacketPublisher::handleAccept(boost::shared_ptr<Subscriber> subscriber, const boost::system::error_code &error)
+{
+	if (error == boost::asio::error::operation_aborted) {		// The publisher is closed.
+		return;
+	}
+	if (!error) {
+		boost::system::error_code ignored;
+		subscriber->socket.set_option(tcp::no_delay(true), ignored);
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			subscribers.push_back(subscriber);
+		}
+		subscriber->readHeader();
+	}
+	this->accept();
+}
+
+// Removes a subscriber whose connection failed.
+void TmPacketPublisher::removeSubscriber(Subscriber *subscriber)
+{
+	boost::mutex::scoped_lock lock(mutex);
+	for (size_t i = 0; i < subscribers.size(); i++) {
+		if (subscribers[i].get() == subscriber) {
+			subscribers.erase(subscribers.begin() + i);
+			break;
+		}
+	}
+	subscriber->closed = true;
+	subscriber->queue.clear();
+	boost::system::error_code error;
+	subscriber->socket.close(error);		// Ends the pending read or write of the other direction.
+}
+
+// Extracts the APID of a Space Packet.
+uint16_t TmPacketPublisher::extractApid(const vector<uint8_t> &packet)
+{
+	if ((packet.size() < 2) || ((packet[0] >> 5) != 0)) {		// Packet version 000 only.
+		return anyApid;
+	}
+	return SpacePacketConf::extractApid(&packet[0]);
+}
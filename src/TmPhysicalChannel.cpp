@@ -19,6 +19,8 @@ along with tmtp. If not, see <http://www.gnu.org/licenses/>.
 #include "TmPhysicalChannel.h"
 #include "TmMasterChannel.h"
 #include "TmTransferFrame.h"
+#include "TmTimeCorrelation.h"
+#include "TmReedSolomon.h"
 #include "TmFrameTimestamp.h"
 #include "TmFrameBitrate.h"
 #include "myErrors.h"
@@ -26,6 +28,7 @@ along with tmtp. If not, see <http://www.gnu.org/licenses/>.
 #include <vector>
 #include <iostream>
 #include <sstream>
+#include <utility>
 #include <stdint.h>
 
 using namespace std;
@@ -33,17 +36,20 @@ using namespace std;
 // Constructor of the TmPhysicalChannel class.
 TmPhysicalChannel::TmPhysicalChannel(uint16_t length)
 {
-	if ((length >= 7) && (length <= 2048)) {	// Total frame length must be min. 7, max. 2048 Bytes long.
+	if (length >= TmTransferFrame::minFrameLength) {	// Total frame length must be min. 7, max. 65535 Bytes long.
 		frameLength = length;
 	} else {
 		ostringstream error;
-		error << "Frame length out of range (7-2048)." << endl;
+		error << "Frame length out of range (" << TmTransferFrame::minFrameLength << "-" << TmTransferFrame::maxFrameLength << ")." << endl;
 		throw TmPhysicalChannelError(error.str());
 	}
 	
 	// By default, sets the following flags:
 	fecfPresent = false;	// No Frame Error Control Field present.
+	variableFrameLength = false;	// All frames have the configured length.
 	masterChannel = NULL;	// The generated master channel pointer is intialized to NULL.
+	timeCorrelation = NULL;	// No time correlation model connected.
+	reedSolomon = NULL;		// No Reed-Solomon code connected.
 }
 
 // Destructor of the TmPhysicalChannel class.
@@ -76,6 +82,33 @@ bool TmPhysicalChannel::getFecfStatus()
 	return fecfPresent;
 }
 
+// Retrieves the length of a frame on the link.
+size_t TmPhysicalChannel::getCodeblockLength()
+{
+	return (size_t) frameLength + (reedSolomon ? reedSolomon->getCheckLength() : 0);
+}
+
+// Switches to variable-length frames.
+void TmPhysicalChannel::activateVariableFrameLength()
+{
+	if (reedSolomon) {				// The Reed-Solomon codeblocks have a fixed length.
+		throw TmPhysicalChannelError("Variable-length frames cannot be used with a Reed-Solomon code.\n");
+	}
+	variableFrameLength = true;
+}
+
+// Switches back to fixed-length frames.
+void TmPhysicalChannel::deactivateVariableFrameLength()
+{
+	variableFrameLength = false;
+}
+
+// Retrieves the value of the variable frame length flag.
+bool TmPhysicalChannel::getVariableFrameLengthStatus()
+{
+	return variableFrameLength;
+}
+
 // Creates a master channel bound to this physical channel.
 TmMasterChannel* TmPhysicalChannel::createTmMasterChannel(uint16_t scid)
 {
@@ -85,7 +118,7 @@ TmMasterChannel* TmPhysicalChannel::createTmMasterChannel(uint16_t scid)
 		// 	- Spacecraft ID = scid;
 		// 	- ocfPresent = true;
 		// 	- sendFrameCount = 0;
-		// 	- recFrameCount = 0;
+		// 	- recSequence = TmSequenceTracker(256);
 		// 	- secondHeaderPresent = false;
 		// 	- extendedVcFrameCountUsed = false;
 		// 	- ocfSink = NULL;
@@ -102,7 +135,7 @@ TmMasterChannel* TmPhysicalChannel::createTmMasterChannel(uint16_t scid)
 		// 	- initialConf = netProtConf = new NetProtConf;
 		// 	- debugOutput = false;
 		// 	- sendFrameCount = 0;
-		// 	- recFrameCount = 0;
+		// 	- recSequence = TmSequenceTracker(256);
 		// 	- recPacketHeaderLength = 0;
 		// 	- recPacketLength = 0;
 		// 
@@ -118,9 +151,46 @@ TmMasterChannel* TmPhysicalChannel::createTmMasterChannel(uint16_t scid)
 }
 
 // Unwraps and analyzes a raw frame for master/virtual channel setting discrepancies and displays the corresponding warnings.
-TmChannelWarning TmPhysicalChannel::receiveFrame(vector<uint8_t> rawFrame, TmFrameTimestamp timestamp, TmFrameBitrate bitrate)
+TmChannelWarning TmPhysicalChannel::receiveFrame(const vector<uint8_t> &rawFrame, TmFrameTimestamp timestamp,
+		TmFrameBitrate bitrate)
+{
+	return this->receiveFrame(rawFrame.empty() ? NULL : &rawFrame[0], rawFrame.size(), timestamp, bitrate);
+}
+
+// Unwraps a raw frame the caller no longer needs; a Reed-Solomon code corrects it in place.
+TmChannelWarning TmPhysicalChannel::receiveFrame(vector<uint8_t> &&rawFrame, TmFrameTimestamp timestamp, TmFrameBitrate bitrate)
 {
 	TmChannelWarning warning;			// Creates an instance of the TmChannelWarning class.
+	if (reedSolomon) {					// The errors are corrected before anything of the frame is read.
+		try {
+			if (!reedSolomon->decode(rawFrame)) {
+				warning.addFrameUnwrapError("Reed-Solomon decoding failed, frame dropped.\n");
+				return warning;
+			}
+		} catch (TmReedSolomonError& e) {
+			warning.addFrameUnwrapError(string(e.what()));
+			return warning;
+		}
+	}
+	return this->unwrapFrame(rawFrame.empty() ? NULL : &rawFrame[0], rawFrame.size(), timestamp, bitrate);
+}
+
+// Unwraps and analyzes a raw frame given in place.
+TmChannelWarning TmPhysicalChannel::receiveFrame(const uint8_t *rawFrame, size_t length, TmFrameTimestamp timestamp,
+		TmFrameBitrate bitrate)
+{
+	if (reedSolomon) {					// The decoder corrects the frame, so it works on a copy.
+		vector<uint8_t> copy(rawFrame, rawFrame + length);
+		return this->receiveFrame(std::move(copy), timestamp, bitrate);
+	}
+	return this->unwrapFrame(rawFrame, length, timestamp, bitrate);
+}
+
+// Reads a decoded raw frame in place and passes it to the master channel.
+TmChannelWarning TmPhysicalChannel::unwrapFrame(const uint8_t *rawFrame, size_t length, TmFrameTimestamp timestamp,
+		TmFrameBitrate bitrate)
+{
+	TmChannelWarning warning;
 	try {
 		TmTransferFrame frame (frameLength);	// Creates a TM Transfer Frame object to receive the data carried by the raw frame.
 		frame.setTimestamp(timestamp);		// Passes the reference timestamp to the frame.
@@ -129,9 +199,23 @@ TmChannelWarning TmPhysicalChannel::receiveFrame(vector<uint8_t> rawFrame, TmFra
 		if (fecfPresent) {						// Checks the FECF Flag and activates it if used in this physical channel.
 			frame.activateFecf();
 		}
-		frame.unwrap(rawFrame);		// Takes the raw frame, reads its fields and flags and stores them in the new frame.
+		if (variableFrameLength) {				// The frame length is read from the frame itself.
+			frame.activateFrameLengthField();
+		}
+		frame.unwrapHeader(rawFrame, length);	// Takes the raw frame, reads its headers and stores them in the new frame.
 		if (masterChannel) {		// If a master channel has been defined for this physical channel,
-			warning += masterChannel->receiveFrame(frame);	// assign the received frame to its corresponding master channel and accumulate any warnings thrown.
+			if (timeCorrelation && (frame.getSpacecraftId() == masterChannel->getSpacecraftId())) {
+				uint64_t frameIndex = timeCorrelation->addSample(timestamp, frame.getMasterChannelFrameCount());
+				if (timeCorrelation->isValid()) {	// The model replaces the jittering timestamp and the nominal bitrate.
+					frame.setTimestamp(timeCorrelation->estimateTimestamp(frameIndex));
+					frame.setBitrate(timeCorrelation->estimateBitrate(frame.getLength()));
+				}
+			}
+			if (!masterChannel->isIdleFrame(frame)) {
+				frame.unwrapDataField(rawFrame, length);	// The Data Field is only copied if it carries any packets.
+			}
+			frame.unwrapOcf(rawFrame, length);		// The OCF is read for every frame.
+			warning += masterChannel->receiveFrame(std::move(frame));	// assign the received frame to its corresponding master channel and accumulate any warnings thrown.
 		} else {
 			// warning message
 			warning.setUnconfiguredMC();	// Otherwise throw a warning that no master channel has been configured.
@@ -153,8 +237,14 @@ vector<uint8_t> TmPhysicalChannel::sendFrame(TmFrameTimestamp timestamp)
 			TmTransferFrame frame = masterChannel->sendFrame(timestamp);	// Prepares a frame to be sent in this master channel and 
 																			// in an available VC (scheduled using RR) with the current timestamp.
 			if (frame.getFecfStatus() == fecfPresent) {		// If the frame FECF configuration and
-				if (frame.getLength() == frameLength) {		// the total frame lenght match the physical channel configuration,
+				bool lengthMatches = variableFrameLength		// the total frame lenght match the physical channel configuration,
+					? (frame.getFrameLengthFieldStatus() && (frame.getLength() <= frameLength))
+					: (frame.getLength() == frameLength);
+				if (lengthMatches) {
 					rawFrame = frame.wrap();				// The frame is wrapped and we get a new raw frame.
+					if (reedSolomon) {						// The check symbols are appended to the wrapped frame.
+						reedSolomon->encode(rawFrame);
+					}
 				} else {
 					ostringstream error;					// Otherwise we send an error message with wrong frame length.
 					error << "Received frame from master channel has wrong frame length. It is ";
@@ -178,6 +268,11 @@ vector<uint8_t> TmPhysicalChannel::sendFrame(TmFrameTimestamp timestamp)
 			ostringstream error;
 			error << "Error in TmMasterChannel: " << e.what() << endl;
 			throw TmPhysicalChannelError(error.str());
+		// Scan for any Reed-Solomon errors.
+		} catch (TmReedSolomonError& e) {
+			ostringstream error;
+			error << "Error in TmReedSolomon: " << e.what() << endl;
+			throw TmPhysicalChannelError(error.str());
 		}
 	} else {	// If no master channel has been defined for this physical channel, we throw an error.
 		ostringstream error;
@@ -186,3 +281,36 @@ vector<uint8_t> TmPhysicalChannel::sendFrame(TmFrameTimestamp timestamp)
 	}
 	return rawFrame;	// A new TM Transfer Frame is born!
 }
+
+// Connects a time correlation model to this physical channel.
+void TmPhysicalChannel::connectTimeCorrelation(TmTimeCorrelation *model)
+{
+	timeCorrelation = model;
+}
+
+// Disconnects the time correlation model.
+void TmPhysicalChannel::disconnectTimeCorrelation()
+{
+	timeCorrelation = NULL;
+}
+
+// Connects a Reed-Solomon code to this physical channel.
+void TmPhysicalChannel::connectReedSolomon(TmReedSolomon *code)
+{
+	if (variableFrameLength) {		// The Reed-Solomon codeblocks have a fixed length.
+		throw TmPhysicalChannelError("A Reed-Solomon code cannot be used with variable-length frames.\n");
+	}
+	if ((frameLength % code->getInterleaveDepth() != 0) || (frameLength > code->getMaxFrameLength())) {
+		ostringstream error;
+		error << "Frame length " << dec << frameLength << " does not fit the Reed-Solomon code (multiple of "
+			<< code->getInterleaveDepth() << ", max. " << code->getMaxFrameLength() << ")." << endl;
+		throw TmPhysicalChannelError(error.str());
+	}
+	reedSolomon = code;
+}
+
+// Disconnects the Reed-Solomon code.
+void TmPhysicalChannel::disconnectReedSolomon()
+{
+	reedSolomon = NULL;
+}
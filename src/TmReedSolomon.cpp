@@ -0,0 +1,417 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "TmReedSolomon.h"
+#include "myErrors.h"
+
+#include <sstream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+// Lookup tables of the code, built once when the library is loaded.
+struct ReedSolomonTables {
+	uint8_t alphaTo[256];		// Power of alpha -> symbol (alphaTo[255] = 0).
+	uint8_t indexOf[256];		// Symbol -> power of alpha (indexOf[0] = 255, i.e. log of zero).
+	uint8_t generator[33];		// Generator polynomial coefficients, as powers of alpha.
+	uint8_t toDual[256];		// Conventional -> dual basis representation.
+	uint8_t fromDual[256];		// Dual basis -> conventional representation.
+	uint8_t rows[256][32];		// Check symbol update for each feedback symbol (conventional representation).
+};
+
+static const int nn = 255;				// Symbols per codeword; also the log of zero.
+static const int firstRoot = 112;		// First consecutive root of the generator, in powers of the primitive element.
+static const int primitive = 11;		// The primitive element is alpha^11.
+static const int inversePrimitive = 116;	// 11 * 116 = 1 modulo 255.
+
+// Reduces a power of alpha modulo 255.
+static inline int modnn(int x)
+{
+	while (x >= nn) {
+		x -= nn;
+		x = (x >> 8) + (x & nn);
+	}
+	return x;
+}
+
+// Computes the Galois field, generator and dual basis tables of the code.
+static const ReedSolomonTables *reedSolomonTables()
+{
+	static ReedSolomonTables t;
+
+	// GF(2^8) with the field polynomial x^8 + x^7 + x^2 + x + 1.
+	t.indexOf[0] = nn;
+	t.alphaTo[nn] = 0;
+	uint16_t sr = 1;
+	for (int i = 0; i < nn; i++) {
+		t.indexOf[sr] = i;
+		t.alphaTo[i] = sr;
+		sr <<= 1;
+		if (sr & 0x100) {
+			sr ^= 0x187;
+		}
+	}
+
+	// Generator polynomial: product of (x - alpha^(11*j)) for j = 112 to 143.
+	uint8_t g[33];
+	g[0] = 1;
+	for (int i = 0, root = firstRoot * primitive; i < TmReedSolomon::parityLength; i++, root += primitive) {
+		g[i + 1] = 1;
+		for (int j = i; j > 0; j--) {
+			g[j] = g[j] ? (g[j - 1] ^ t.alphaTo[modnn(t.indexOf[g[j]] + root)]) : g[j - 1];
+		}
+		g[0] = t.alphaTo[modnn(t.indexOf[g[0]] + root)];
+	}
+	for (int i = 0; i <= TmReedSolomon::parityLength; i++) {
+		t.generator[i] = t.indexOf[g[i]];
+	}
+
+	// Berlekamp's dual basis (CCSDS 131.0-B, annex F).
+	const uint8_t tal[8] = {0x8D, 0xEF, 0xEC, 0x86, 0xFA, 0x99, 0xAF, 0x7B};
+	for (int i = 0; i < 256; i++) {
+		uint8_t dual = 0;
+		for (int j = 0; j < 8; j++) {
+			if (i & (1 << j)) {
+				dual ^= tal[7 - j];
+			}
+		}
+		t.toDual[i] = dual;
+		t.fromDual[dual] = i;
+	}
+
+	// Feedback f changes check symbol k by f * g[31 - k] once the register is shifted by one symbol.
+	for (int f = 0; f < 256; f++) {
+		for (int k = 0; k < TmReedSolomon::parityLength; k++) {
+			t.rows[f][k] = f ? t.alphaTo[modnn(t.indexOf[f] + t.generator[TmReedSolomon::parityLength - 1 - k])] : 0;
+		}
+	}
+	return &t;
+}
+static const ReedSolomonTables *rs = reedSolomonTables();
+
+// Constructor of the TmReedSolomon class.
+TmReedSolomon::TmReedSolomon(uint16_t depth)
+{
+	if ((depth < 1) || (depth > maxInterleaveDepth)) {
+		ostringstream error;
+		error << "Interleave depth out of range (1-" << maxInterleaveDepth << ")." << endl;
+		throw TmReedSolomonError(error.str());
+	}
+	interleaveDepth = depth;
+	this->resetCounters();
+}
+
+// Retrieves the interleave depth.
+uint16_t TmReedSolomon::getInterleaveDepth()
+{
+	return interleaveDepth;
+}
+
+// Retrieves the number of check symbols appended to each frame.
+size_t TmReedSolomon::getCheckLength()
+{
+	return (size_t) parityLength * interleaveDepth;
+}
+
+// Retrieves the longest frame which can be encoded.
+size_t TmReedSolomon::getMaxFrameLength()
+{
+	return (size_t) dataLength * interleaveDepth;
+}
+
+// Appends the check symbols of all codewords to a frame.
+void TmReedSolomon::encode(vector<uint8_t> &block)
+{
+	size_t frameLength = block.size();
+	if ((frameLength == 0) || (frameLength % interleaveDepth != 0) || (frameLength > this->getMaxFrameLength())) {
+		ostringstream error;
+		error << "Frame length " << dec << frameLength << " does not fit the code (multiple of " << interleaveDepth
+			<< ", max. " << this->getMaxFrameLength() << ")." << endl;
+		throw TmReedSolomonError(error.str());
+	}
+	size_t symbols = frameLength / interleaveDepth;
+	block.resize(frameLength + this->getCheckLength());
+	uint8_t parity[parityLength];
+	for (uint16_t c = 0; c < interleaveDepth; c++) {
+		encodeCodeword(&block[c], interleaveDepth, symbols, parity);
+		for (uint16_t j = 0; j < parityLength; j++) {
+			block[frameLength + c + j * interleaveDepth] = parity[j];	// The check symbols are interleaved like the data.
+		}
+	}
+}
+
+// Corrects the errors of a received frame and removes its check symbols.
+bool TmReedSolomon::decode(vector<uint8_t> &block)
+{
+	size_t checkLength = this->getCheckLength();
+	size_t frameLength = (block.size() > checkLength) ? (block.size() - checkLength) : 0;
+	if ((frameLength == 0) || (frameLength % interleaveDepth != 0) || (frameLength > this->getMaxFrameLength())) {
+		ostringstream error;
+		error << "Block length " << dec << block.size() << " does not fit the code (interleave depth " << interleaveDepth << ")." << endl;
+		throw TmReedSolomonError(error.str());
+	}
+	size_t symbols = frameLength / interleaveDepth;
+	int pad = dataLength - symbols;					// Virtual fill of a shortened code.
+	bool decoded = true;
+	lastCorrections.assign(interleaveDepth, 0);
+
+	uint8_t parity[parityLength];
+	uint8_t codeword[codewordLength];
+	for (uint16_t c = 0; c < interleaveDepth; c++) {
+		codewordCount++;
+		// Fast path: an error-free codeword has the check symbols of its data.
+		encodeCodeword(&block[c], interleaveDepth, symbols, parity);
+		const uint8_t *received = &block[frameLength + c];
+		bool intact = true;
+		for (uint16_t j = 0; j < parityLength; j++) {
+			intact &= (parity[j] == received[j * interleaveDepth]);
+		}
+		if (intact) {
+			continue;
+		}
+
+		// The codeword is collected in the conventional representation and corrected.
+		for (size_t j = 0; j < symbols; j++) {
+			codeword[j] = rs->fromDual[block[c + j * interleaveDepth]];
+		}
+		for (uint16_t j = 0; j < parityLength; j++) {
+			codeword[symbols + j] = rs->fromDual[received[j * interleaveDepth]];
+		}
+		int corrected = decodeCodeword(codeword, pad);
+		lastCorrections[c] = corrected;
+		if (corrected == uncorrectable) {
+			uncorrectableCount++;
+			decoded = false;
+		} else {
+			correctedSymbolCount += corrected;
+			for (size_t j = 0; j < symbols; j++) {
+				block[c + j * interleaveDepth] = rs->toDual[codeword[j]];
+			}
+		}
+	}
+	block.resize(frameLength);
+	return decoded;
+}
+
+// Retrieves the number of symbols corrected in each codeword of the last decoded frame.
+const vector<int> &TmReedSolomon::getLastCorrections()
+{
+	return lastCorrections;
+}
+
+// Retrieves the number of codewords decoded.
+uint64_t TmReedSolomon::getCodewordCount()
+{
+	return codewordCount;
+}
+
+// Retrieves the number of symbols corrected in all decoded codewords.
+uint64_t TmReedSolomon::getCorrectedSymbolCount()
+{
+	return correctedSymbolCount;
+}
+
+// Retrieves the number of codewords which had too many errors.
+uint64_t TmReedSolomon::getUncorrectableCount()
+{
+	return uncorrectableCount;
+}
+
+// Sets the decoding statistics to zero.
+void TmReedSolomon::resetCounters()
+{
+	lastCorrections.assign(interleaveDepth, 0);
+	codewordCount = 0;
+	correctedSymbolCount = 0;
+	uncorrectableCount = 0;
+}
+
+// Computes the check symbols of one codeword.
+void TmReedSolomon::encodeCodeword(const uint8_t *data, size_t stride, size_t length, uint8_t *parity)
+{
+	// The virtual fill symbols are zero and leave the register unchanged, so they are skipped.
+#ifdef __SSE2__
+	__m128i low = _mm_setzero_si128();			// Check symbols 0 to 15.
+	__m128i high = _mm_setzero_si128();			// Check symbols 16 to 31.
+	for (size_t i = 0; i < length; i++) {
+		uint8_t feedback = rs->fromDual[data[i * stride]] ^ (uint8_t) _mm_cvtsi128_si32(low);
+		low = _mm_or_si128(_mm_srli_si128(low, 1), _mm_slli_si128(high, 15));	// The register is shifted by one symbol.
+		high = _mm_srli_si128(high, 1);
+		low = _mm_xor_si128(low, _mm_loadu_si128((const __m128i *) &rs->rows[feedback][0]));
+		high = _mm_xor_si128(high, _mm_loadu_si128((const __m128i *) &rs->rows[feedback][16]));
+	}
+	uint8_t reg[parityLength];
+	_mm_storeu_si128((__m128i *) &reg[0], low);
+	_mm_storeu_si128((__m128i *) &reg[16], high);
+#else
+	uint8_t reg[parityLength];
+	memset(reg, 0, parityLength);
+	for (size_t i = 0; i < length; i++) {
+		uint8_t feedback = rs->fromDual[data[i * stride]] ^ reg[0];
+		const uint8_t *row = rs->rows[feedback];
+		for (uint16_t k = 0; k < parityLength - 1; k++) {
+			reg[k] = reg[k + 1] ^ row[k];
+		}
+		reg[parityLength - 1] = row[parityLength - 1];
+	}
+#endif
+	for (uint16_t k = 0; k < parityLength; k++) {
+		parity[k] = rs->toDual[reg[k]];
+	}
+}
+
+// Corrects one codeword given in the conventional representation.
+int TmReedSolomon::decodeCodeword(uint8_t *codeword, int pad)
+{
+	const int nroots = parityLength;
+	const uint8_t *alphaTo = rs->alphaTo;
+	const uint8_t *indexOf = rs->indexOf;
+	int length = nn - pad;
+	int i, j, k;
+
+	// Syndromes: the codeword evaluated at each root of the generator.
+	uint8_t s[nroots];
+	int syndromeError = 0;
+	for (i = 0; i < nroots; i++) {
+		s[i] = codeword[0];
+	}
+	for (j = 1; j < length; j++) {
+		for (i = 0; i < nroots; i++) {
+			s[i] = s[i] ? (codeword[j] ^ alphaTo[modnn(indexOf[s[i]] + (firstRoot + i) * primitive)]) : codeword[j];
+		}
+	}
+	for (i = 0; i < nroots; i++) {
+		syndromeError |= s[i];
+		s[i] = indexOf[s[i]];
+	}
+	if (!syndromeError) {
+		return 0;
+	}
+
+	// Berlekamp-Massey: the error locator polynomial lambda.
+	uint8_t lambda[nroots + 1], b[nroots + 1], t[nroots + 1];
+	memset(lambda, 0, sizeof(lambda));
+	lambda[0] = 1;
+	for (i = 0; i <= nroots; i++) {
+		b[i] = indexOf[lambda[i]];
+	}
+	int el = 0;
+	for (int r = 1; r <= nroots; r++) {
+		uint8_t discrepancy = 0;
+		for (i = 0; i < r; i++) {
+			if ((lambda[i] != 0) && (s[r - i - 1] != nn)) {
+				discrepancy ^= alphaTo[modnn(indexOf[lambda[i]] + s[r - i - 1])];
+			}
+		}
+		int discrepancyIndex = indexOf[discrepancy];
+		if (discrepancyIndex == nn) {
+			memmove(&b[1], b, nroots);
+			b[0] = nn;
+		} else {
+			t[0] = lambda[0];
+			for (i = 0; i < nroots; i++) {
+				t[i + 1] = (b[i] != nn) ? (lambda[i + 1] ^ alphaTo[modnn(discrepancyIndex + b[i])]) : lambda[i + 1];
+			}
+			if (2 * el <= r - 1) {
+				el = r - el;
+				for (i = 0; i <= nroots; i++) {
+					b[i] = (lambda[i] == 0) ? nn : modnn(indexOf[lambda[i]] - discrepancyIndex + nn);
+				}
+			} else {
+				memmove(&b[1], b, nroots);
+				b[0] = nn;
+			}
+			memcpy(lambda, t, nroots + 1);
+		}
+	}
+	int degLambda = 0;
+	for (i = 0; i <= nroots; i++) {
+		lambda[i] = indexOf[lambda[i]];
+		if (lambda[i] != nn) {
+			degLambda = i;
+		}
+	}
+
+	// Chien search: the roots of lambda are the error locations.
+	uint8_t reg[nroots + 1];
+	int root[nroots], location[nroots];
+	int count = 0;
+	memcpy(&reg[1], &lambda[1], nroots);
+	for (i = 1, k = inversePrimitive - 1; i <= nn; i++, k = modnn(k + inversePrimitive)) {
+		uint8_t q = 1;
+		for (j = degLambda; j > 0; j--) {
+			if (reg[j] != nn) {
+				reg[j] = modnn(reg[j] + j);
+				q ^= alphaTo[reg[j]];
+			}
+		}
+		if (q != 0) {
+			continue;
+		}
+		root[count] = i;
+		location[count] = k;
+		if (++count == degLambda) {
+			break;
+		}
+	}
+	if (degLambda != count) {
+		return uncorrectable;		// Lambda has fewer roots than its degree: more than 16 errors.
+	}
+	for (j = 0; j < count; j++) {
+		if (location[j] < pad) {
+			return uncorrectable;	// An error in the virtual fill cannot be real.
+		}
+	}
+
+	// Forney: the error values from the error evaluator polynomial omega.
+	uint8_t omega[nroots + 1];
+	int degOmega = degLambda - 1;
+	for (i = 0; i <= degOmega; i++) {
+		uint8_t tmp = 0;
+		for (j = i; j >= 0; j--) {
+			if ((s[i - j] != nn) && (lambda[j] != nn)) {
+				tmp ^= alphaTo[modnn(s[i - j] + lambda[j])];
+			}
+		}
+		omega[i] = indexOf[tmp];
+	}
+	for (j = count - 1; j >= 0; j--) {
+		uint8_t num1 = 0;
+		for (i = degOmega; i >= 0; i--) {
+			if (omega[i] != nn) {
+				num1 ^= alphaTo[modnn(omega[i] + i * root[j])];
+			}
+		}
+		uint8_t num2 = alphaTo[modnn(root[j] * (firstRoot - 1) + nn)];
+		uint8_t den = 0;
+		for (i = ((degLambda < nroots - 1) ? degLambda : nroots - 1) & ~1; i >= 0; i -= 2) {
+			if (lambda[i + 1] != nn) {
+				den ^= alphaTo[modnn(lambda[i + 1] + i * root[j])];
+			}
+		}
+		if (num1 != 0) {
+			codeword[location[j] - pad] ^= alphaTo[modnn(indexOf[num1] + indexOf[num2] + nn - indexOf[den])];
+		}
+	}
+	return count;
+}
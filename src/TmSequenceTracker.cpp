@@ -0,0 +1,270 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "TmSequenceTracker.h"
+
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+// Constructor of the TmSequenceTracker class.
+TmSequenceTracker::TmSequenceTracker(uint64_t modulus, size_t gapHistory)
+{
+	this->modulus = (modulus > 1) ? modulus : 2;	// A counter needs at least two values.
+	resyncThreshold = defaultResyncThreshold;
+	duplicateWindow = defaultDuplicateWindow;
+	maxGapLength = defaultMaxGapLength;
+	SequenceGap empty = {0, 0, 0};
+	gaps.assign((gapHistory > 0) ? gapHistory : 1, empty);
+	this->reset();
+}
+
+// Compares two counts of a modular counter.
+TmSequenceTracker::SequenceStatus TmSequenceTracker::classify(uint64_t expected, uint64_t received, uint64_t modulus, uint64_t &distance)
+{
+	uint64_t ahead = (received + modulus - (expected % modulus)) % modulus;	// Counts skipped, seen modulo the counter.
+	if (ahead == 0) {
+		distance = 0;
+		return inSequence;
+	}
+	if (ahead < modulus / 2) {		// Less than half the counter ahead: frames were lost.
+		distance = ahead;
+		return gap;
+	}
+	distance = modulus - ahead;		// Otherwise the count is behind the expected one.
+	return outOfOrder;
+}
+
+// Classifies a received count and updates the expected count and statistics.
+TmSequenceTracker::SequenceStatus TmSequenceTracker::update(uint64_t count)
+{
+	count %= modulus;
+	if (!synchronised) {			// The first count is accepted as it is.
+		synchronised = true;
+		expectedCount = (count + 1) % modulus;
+		receivedMask = ~(uint64_t) 0;		// Counts before the first one are not expected anymore.
+		acceptedCount++;
+		return firstCount;
+	}
+
+	uint64_t distance = 0;
+	SequenceStatus status = classify(expectedCount, count, modulus, distance);
+	if ((status == outOfOrder) && (distance > duplicateWindow)) {
+		if (modulus - distance > maxGapLength) {
+			// Far too many counts for a fade: the counter jumped back, e.g. because the source restarted.
+			expectedCount = (count + 1) % modulus;
+			receivedMask = ~(uint64_t) 0;
+			lastGapLength = 0;
+			rejectedRun = 0;
+			acceptedCount++;
+			resyncCount++;
+			return resync;
+		}
+		// Too far behind to be a repeated frame: the counter jumped ahead by more than half the modulus
+		// (e.g. a long fade). The frame is accepted and the skipped counts are lost.
+		distance = modulus - distance;
+		status = gap;
+	}
+	if (status != outOfOrder) {
+		if (status == gap) {
+			SequenceGap &entry = gaps[nextGap];		// The oldest gap in the ring is overwritten.
+			entry.first = expectedCount;
+			entry.length = distance;
+			entry.recovered = 0;
+			nextGap = (nextGap + 1) % gaps.size();
+			lastGapLength = distance;
+			lostCount += distance;
+			gapCount++;
+		}
+		// The skipped counts are marked as missing, the received one as received.
+		receivedMask = (distance + 1 >= recentCounts) ? 1 : ((receivedMask << (distance + 1)) | 1);
+		expectedCount = (count + 1) % modulus;
+		rejectedRun = 0;
+		acceptedCount++;
+		return status;
+	}
+
+	// The count is behind the expected one. If it is remembered as missing, the frame simply arrived late.
+	uint64_t bit = (distance <= recentCounts) ? ((uint64_t) 1 << (distance - 1)) : 0;
+	if (bit && !(receivedMask & bit)) {
+		receivedMask |= bit;				// A second copy of the frame is a duplicate.
+		this->recoverFromGap(count);
+		lostCount--;
+		outOfOrderCount++;
+		return outOfOrder;
+	}
+
+	// Otherwise it was already received, unless the source restarted its counter: this shows as consecutive counts behind the expected one.
+	if ((rejectedRun > 0) && (count == (lastRejectedCount + 1) % modulus)) {
+		rejectedRun++;
+	} else {
+		rejectedRun = 1;
+	}
+	lastRejectedCount = count;
+	if (rejectedRun >= resyncThreshold) {
+		expectedCount = (count + 1) % modulus;
+		receivedMask = ~(uint64_t) 0;
+		lastGapLength = rejectedRun - 1;		// The earlier counts of the run were dropped as duplicates.
+		lostCount += lastGapLength;
+		duplicateCount -= lastGapLength;
+		rejectedRun = 0;
+		acceptedCount++;
+		resyncCount++;
+		return resync;
+	}
+	duplicateCount++;
+	return duplicate;
+}
+
+// Looks for a remembered gap containing the count and marks it as recovered.
+bool TmSequenceTracker::recoverFromGap(uint64_t count)
+{
+	for (size_t i = 0; i < gaps.size(); i++) {
+		SequenceGap &entry = gaps[i];
+		if ((entry.recovered < entry.length)
+				&& ((count + modulus - entry.first) % modulus < entry.length)) {
+			entry.recovered++;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Sets the longest gap a count behind the duplicate window is taken for.
+void TmSequenceTracker::setMaxGapLength(uint64_t length)
+{
+	maxGapLength = length;
+}
+
+// Retrieves the longest gap a count behind the duplicate window is taken for.
+uint64_t TmSequenceTracker::getMaxGapLength()
+{
+	return maxGapLength;
+}
+
+// Changes the counter modulus. Resets the tracker.
+void TmSequenceTracker::setModulus(uint64_t modulus)
+{
+	this->modulus = (modulus > 1) ? modulus : 2;
+	this->reset();
+}
+
+// Retrieves the counter modulus.
+uint64_t TmSequenceTracker::getModulus()
+{
+	return modulus;
+}
+
+// Sets the number of consecutive counts behind the expected one that restart the sequence.
+void TmSequenceTracker::setResyncThreshold(uint16_t threshold)
+{
+	resyncThreshold = (threshold > 0) ? threshold : 1;
+}
+
+// Sets how far behind the expected count a count is still taken for a duplicate or a late frame.
+void TmSequenceTracker::setDuplicateWindow(uint64_t window)
+{
+	duplicateWindow = window;
+}
+
+// Retrieves how far behind the expected count a count is still taken for a duplicate or a late frame.
+uint64_t TmSequenceTracker::getDuplicateWindow()
+{
+	return duplicateWindow;
+}
+
+// Forgets the expected count, the gaps and the statistics.
+void TmSequenceTracker::reset()
+{
+	expectedCount = 0;
+	synchronised = false;
+	lastGapLength = 0;
+	receivedMask = ~(uint64_t) 0;
+	rejectedRun = 0;
+	lastRejectedCount = 0;
+	SequenceGap empty = {0, 0, 0};
+	gaps.assign(gaps.size(), empty);
+	nextGap = 0;
+	acceptedCount = 0;
+	lostCount = 0;
+	gapCount = 0;
+	duplicateCount = 0;
+	outOfOrderCount = 0;
+	resyncCount = 0;
+}
+
+// Retrieves the count expected next.
+uint64_t TmSequenceTracker::getExpectedCount()
+{
+	return expectedCount;
+}
+
+// Retrieves the number of counts lost by the last gap or resync.
+uint64_t TmSequenceTracker::getLastGapLength()
+{
+	return lastGapLength;
+}
+
+// Retrieves the number of counts accepted.
+uint64_t TmSequenceTracker::getAcceptedCount()
+{
+	return acceptedCount;
+}
+
+// Retrieves the number of counts lost.
+uint64_t TmSequenceTracker::getLostCount()
+{
+	return lostCount;
+}
+
+// Retrieves the number of gaps.
+uint64_t TmSequenceTracker::getGapCount()
+{
+	return gapCount;
+}
+
+// Retrieves the number of duplicates.
+uint64_t TmSequenceTracker::getDuplicateCount()
+{
+	return duplicateCount;
+}
+
+// Retrieves the number of counts which arrived out of order.
+uint64_t TmSequenceTracker::getOutOfOrderCount()
+{
+	return outOfOrderCount;
+}
+
+// Retrieves the number of times the sequence was restarted.
+uint64_t TmSequenceTracker::getResyncCount()
+{
+	return resyncCount;
+}
+
+// Retrieves the most recent gaps, the oldest first.
+vector<TmSequenceTracker::SequenceGap> TmSequenceTracker::getGaps()
+{
+	vector<SequenceGap> result;
+	size_t stored = (gapCount < gaps.size()) ? gapCount : gaps.size();
+	size_t start = (nextGap + gaps.size() - stored) % gaps.size();
+	for (size_t i = 0; i < stored; i++) {
+		result.push_back(gaps[(start + i) % gaps.size()]);
+	}
+	return result;
+}
@@ -0,0 +1,520 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "TmSharedFrameRing.h"
+#include "TmPhysicalChannel.h"
+#include "myErrors.h"
+
+#include <string>
+#include <sstream>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace std;
+
+const uint32_t TmSharedFrameRing::magicNumber;
+const uint32_t TmSharedFrameRing::layoutVersion;
+const size_t TmSharedFrameRing::defaultSlotCount;
+const size_t TmSharedFrameRing::defaultSlotSize;
+
+// Header of the ring at the beginning of the shared memory object. Each side writes its own cache line only.
+struct RingHeader {
+	uint32_t magic;					// TmSharedFrameRing::magicNumber once the ring is initialized.
+	uint32_t version;				// TmSharedFrameRing::layoutVersion.
+	uint64_t slotCount;				// Number of slots.
+	uint64_t slotSize;				// Maximum frame length.
+	uint32_t generation;			// Incremented by each producer attaching to the ring.
+	uint8_t reserved0[36];
+
+	uint64_t writeIndex;			// Sequence number of the next frame written (producer).
+	uint32_t dataFutex;				// Incremented for each frame, the consumer waits on it.
+	uint32_t consumerWaiting;		// Set while the consumer waits for a frame.
+	uint8_t reserved1[48];
+
+	uint64_t readIndex;				// Sequence number of the next frame read (consumer).
+	uint32_t spaceFutex;			// Incremented for each released slot, the producer waits on it.
+	uint32_t producerWaiting;		// Set while the producer waits for a free slot.
+	uint8_t reserved2[48];
+};
+
+// Header of a slot, followed by the frame.
+struct SlotHeader {
+	uint64_t sequence;				// Sequence number of the frame plus one, zero if the slot was never written.
+	uint32_t length;				// Frame length.
+	uint32_t flags;					// Validity of the timestamp and the bitrate.
+	uint64_t seconds;				// Timestamp.
+	double fractions;
+	double bitrate;					// Bitrate.
+	uint8_t reserved[24];
+};
+
+static const uint32_t timestampValid = 0x01;		// Flag of a valid timestamp.
+static const uint32_t bitrateValid = 0x02;			// Flag of a valid bitrate.
+static const size_t slotAlignment = 64;				// Slots start on a cache line.
+
+// Retrieves the header of a mapped ring.
+static inline RingHeader *ringHeader(uint8_t *mapping)
+{
+	return reinterpret_cast<RingHeader *>(mapping);
+}
+
+// Computes the distance between two slots.
+static size_t slotStride(size_t slotSize)
+{
+	return sizeof(SlotHeader) + (slotSize + slotAlignment - 1) / slotAlignment * slotAlignment;
+}
+
+// Computes the size of the shared memory object of a ring.
+static size_t ringSize(size_t slotCount, size_t slotSize)
+{
+	return sizeof(RingHeader) + slotCount * slotStride(slotSize);
+}
+
+// Waits until a futex word no longer holds a value, at most a given time.
+static void futexWait(uint32_t *word, uint32_t value, int timeoutMs)
+{
+	struct timespec timeout;
+	timeout.tv_sec = timeoutMs / 1000;
+	timeout.tv_nsec = (timeoutMs % 1000) * 1000000L;
+#ifdef __linux__
+	syscall(SYS_futex, word, FUTEX_WAIT, value, &timeout, NULL, 0);	// The word is shared between processes.
+#else
+	(void) word;
+	(void) value;
+	if (timeout.tv_sec > 0 || timeout.tv_nsec > 1000000L) {		// Polls every millisecond instead.
+		timeout.tv_sec = 0;
+		timeout.tv_nsec = 1000000L;
+	}
+	nanosleep(&timeout, NULL);
+#endif
+}
+
+// Wakes the process waiting on a futex word.
+static void futexWake(uint32_t *word)
+{
+#ifdef __linux__
+	syscall(SYS_futex, word, FUTEX_WAKE, 1, NULL, NULL, 0);
+#else
+	(void) word;
+#endif
+}
+
+// Retrieves the time of a monotonic clock in milliseconds.
+static int64_t monotonicMs()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// Waits until a condition holds, sleeping on a futex word between the checks.
+// The waiting flag tells the other side to wake us; the futex value is read before the condition is checked, so a
+// change after the check makes the wait return at once.
+template <typename Condition>
+static bool waitFor(Condition condition, uint32_t *futex, uint32_t *waiting, int timeoutMs)
+{
+	if (condition()) {
+		return true;
+	}
+	int64_t deadline = monotonicMs() + timeoutMs;
+	int remaining = timeoutMs;
+	bool satisfied = false;
+	__atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+	while (remaining > 0) {
+		uint32_t value = __atomic_load_n(futex, __ATOMIC_SEQ_CST);
+		if (condition()) {
+			satisfied = true;
+			break;
+		}
+		futexWait(futex, value, remaining);
+		remaining = (int) (deadline - monotonicMs());
+	}
+	__atomic_store_n(waiting, 0, __ATOMIC_SEQ_CST);
+	return satisfied || condition();
+}
+
+// Signals the other side of the ring after a change of an index.
+static void signalChange(uint32_t *futex, uint32_t *waiting)
+{
+	__atomic_add_fetch(futex, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(waiting, __ATOMIC_SEQ_CST) != 0) {		// No system call unless the other side sleeps.
+		futexWake(futex);
+	}
+}
+
+// Checks that the producer index is ahead of the consumer index.
+struct FrameAvailable {
+	FrameAvailable(RingHeader *header) : header(header) {}
+	bool operator()() const {
+		return __atomic_load_n(&header->writeIndex, __ATOMIC_ACQUIRE) != __atomic_load_n(&header->readIndex, __ATOMIC_RELAXED);
+	}
+	RingHeader *header;
+};
+
+// Checks that the ring has a free slot.
+struct SlotAvailable {
+	SlotAvailable(RingHeader *header) : header(header) {}
+	bool operator()() const {
+		return __atomic_load_n(&header->writeIndex, __ATOMIC_RELAXED) - __atomic_load_n(&header->readIndex, __ATOMIC_ACQUIRE)
+				< header->slotCount;
+	}
+	RingHeader *header;
+};
+
+
+// Constructor of the TmSharedFrameRing class.
+TmSharedFrameRing::TmSharedFrameRing(string name, bool create, size_t slotCount, size_t slotSize)
+	: name(name), fd(-1), mapping(NULL), mappingSize(0)
+{
+	ostringstream error;
+	if (create && ((slotCount == 0) || (slotSize == 0) || (slotSize > 0xFFFFFFFF))) {
+		error << "Invalid ring geometry (" << dec << slotCount << " slots of " << slotSize << " Bytes)." << endl;
+		throw TmSharedFrameRingError(error.str());
+	}
+	fd = shm_open(name.c_str(), O_RDWR | (create ? O_CREAT : 0), 0660);
+	if (fd < 0) {
+		error << "Cannot open shared memory object " << name << ": " << strerror(errno) << endl;
+		throw TmSharedFrameRingError(error.str());
+	}
+	struct stat status;
+	if (fstat(fd, &status) != 0) {
+		status.st_size = 0;
+	}
+
+	try {
+		if ((size_t) status.st_size >= sizeof(RingHeader)) {
+			this->map(status.st_size);
+		}
+		if (create) {
+			size_t required = ringSize(slotCount, slotSize);
+			if (!this->isValidLayout(slotCount, slotSize)) {
+				if ((mapping != NULL) && this->isValidLayout(ringHeader(mapping)->slotCount, ringHeader(mapping)->slotSize)) {
+					// A consumer may still map the ring: resizing it would fault the consumer on the truncated pages.
+					error << "Shared memory object " << name << " holds a ring of " << dec << ringHeader(mapping)->slotCount
+							<< " slots of " << ringHeader(mapping)->slotSize << " Bytes; remove it to change the geometry." << endl;
+					throw TmSharedFrameRingError(error.str());
+				}
+				if (ftruncate(fd, required) != 0) {
+					error << "Cannot resize shared memory object " << name << ": " << strerror(errno) << endl;
+					throw TmSharedFrameRingError(error.str());
+				}
+				this->map(required);
+				this->initialize(slotCount, slotSize);
+			}
+		} else if ((mapping == NULL) || !this->isValidLayout(ringHeader(mapping)->slotCount, ringHeader(mapping)->slotSize)) {
+			error << "Shared memory object " << name << " holds no frame ring." << endl;
+			throw TmSharedFrameRingError(error.str());
+		}
+	} catch (TmSharedFrameRingError &) {
+		if (mapping != NULL) {
+			munmap(mapping, mappingSize);
+		}
+		close(fd);
+		throw;
+	}
+}
+
+// Destructor of the TmSharedFrameRing class.
+TmSharedFrameRing::~TmSharedFrameRing()
+{
+	if (mapping != NULL) {
+		munmap(mapping, mappingSize);
+	}
+	close(fd);
+}
+
+// Retrieves the number of slots.
+size_t TmSharedFrameRing::getSlotCount()
+{
+	return ringHeader(mapping)->slotCount;
+}
+
+// Retrieves the maximum frame length.
+size_t TmSharedFrameRing::getSlotSize()
+{
+	return ringHeader(mapping)->slotSize;
+}
+
+// Retrieves the generation counter.
+uint32_t TmSharedFrameRing::getGeneration()
+{
+	return __atomic_load_n(&ringHeader(mapping)->generation, __ATOMIC_ACQUIRE);
+}
+
+// Retrieves the number of frames in the ring.
+size_t TmSharedFrameRing::getFillLevel()
+{
+	RingHeader *header = ringHeader(mapping);
+	uint64_t readIndex = __atomic_load_n(&header->readIndex, __ATOMIC_ACQUIRE);
+	uint64_t writeIndex = __atomic_load_n(&header->writeIndex, __ATOMIC_ACQUIRE);
+	return (writeIndex > readIndex) ? writeIndex - readIndex : 0;
+}
+
+// Removes a shared memory object.
+void TmSharedFrameRing::remove(string name)
+{
+	shm_unlink(name.c_str());
+}
+
+// Checks whether the mapped object holds a ring of the given geometry.
+bool TmSharedFrameRing::isValidLayout(size_t slotCount, size_t slotSize)
+{
+	if ((mapping == NULL) || (mappingSize < sizeof(RingHeader))) {
+		return false;
+	}
+	RingHeader *header = ringHeader(mapping);
+	return (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) == magicNumber) && (header->version == layoutVersion)
+			&& (header->slotCount == slotCount) && (header->slotSize == slotSize) && (slotCount > 0)
+			&& (mappingSize == ringSize(slotCount, slotSize));
+}
+
+// Writes the header of an empty ring.
+void TmSharedFrameRing::initialize(size_t slotCount, size_t slotSize)
+{
+	RingHeader *header = ringHeader(mapping);
+	uint32_t generation = (header->magic == magicNumber) ? header->generation : 0;	// Restarts are still counted.
+	__atomic_store_n(&header->magic, 0, __ATOMIC_RELEASE);
+	memset(mapping + sizeof(uint32_t), 0, mappingSize - sizeof(uint32_t));	// Clears the sequence numbers of the slots too.
+	header->version = layoutVersion;
+	header->slotCount = slotCount;
+	header->slotSize = slotSize;
+	header->generation = generation;
+	__atomic_store_n(&header->magic, magicNumber, __ATOMIC_RELEASE);
+}
+
+// Maps the shared memory object with a given size.
+void TmSharedFrameRing::map(size_t size)
+{
+	if (mapping != NULL) {
+		munmap(mapping, mappingSize);
+		mapping = NULL;
+		mappingSize = 0;
+	}
+	void *address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (address == MAP_FAILED) {
+		ostringstream error;
+		error << "Cannot map shared memory object " << name << ": " << strerror(errno) << endl;
+		throw TmSharedFrameRingError(error.str());
+	}
+	mapping = static_cast<uint8_t *>(address);
+	mappingSize = size;
+}
+
+// Retrieves the slot of a frame sequence number.
+uint8_t *TmSharedFrameRing::slot(uint64_t sequence)
+{
+	RingHeader *header = ringHeader(mapping);
+	return mapping + sizeof(RingHeader) + (sequence % header->slotCount) * slotStride(header->slotSize);
+}
+
+
+// Constructor of the TmSharedFrameProducer class.
+TmSharedFrameProducer::TmSharedFrameProducer(string name, size_t slotCount, size_t slotSize)
+	: TmSharedFrameRing(name, true, slotCount, slotSize), openSlot(NULL), droppedCount(0)
+{
+	// A slot left half-written by the previous producer was never published; it is simply written again.
+	__atomic_add_fetch(&ringHeader(mapping)->generation, 1, __ATOMIC_RELEASE);
+}
+
+// Retrieves the next free slot to write a frame into.
+uint8_t *TmSharedFrameProducer::beginFrame(int timeoutMs)
+{
+	RingHeader *header = ringHeader(mapping);
+	if (!waitFor(SlotAvailable(header), &header->spaceFutex, &header->producerWaiting, timeoutMs)) {
+		droppedCount++;
+		openSlot = NULL;
+		return NULL;
+	}
+	openSlot = this->slot(header->writeIndex);
+	return openSlot + sizeof(SlotHeader);
+}
+
+// Publishes the frame written into the slot returned by beginFrame().
+void TmSharedFrameProducer::commitFrame(size_t length, TmFrameTimestamp timestamp, TmFrameBitrate bitrate)
+{
+	RingHeader *header = ringHeader(mapping);
+	ostringstream error;
+	if (openSlot == NULL) {
+		error << "No slot taken with beginFrame()." << endl;
+		throw TmSharedFrameRingError(error.str());
+	}
+	if (length > header->slotSize) {
+		error << "Frame too long for the ring (" << dec << length << " Bytes, max. " << header->slotSize << ")." << endl;
+		throw TmSharedFrameRingError(error.str());
+	}
+
+	SlotHeader *slotHeader = reinterpret_cast<SlotHeader *>(openSlot);
+	uint64_t writeIndex = header->writeIndex;
+	slotHeader->length = length;
+	slotHeader->flags = (timestamp.isValid() ? timestampValid : 0) | (bitrate.isValid() ? bitrateValid : 0);
+	slotHeader->seconds = timestamp.isValid() ? timestamp.getSeconds() : 0;
+	slotHeader->fractions = timestamp.isValid() ? timestamp.getFractions() : 0.0;
+	slotHeader->bitrate = bitrate.isValid() ? bitrate.getBitrate() : 0.0;
+	__atomic_store_n(&slotHeader->sequence, writeIndex + 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&header->writeIndex, writeIndex + 1, __ATOMIC_RELEASE);	// Publishes the frame.
+	openSlot = NULL;
+	signalChange(&header->dataFutex, &header->consumerWaiting);
+}
+
+// Copies a frame into the ring.
+bool TmSharedFrameProducer::publishFrame(const uint8_t *frame, size_t length, TmFrameTimestamp timestamp,
+		TmFrameBitrate bitrate, int timeoutMs)
+{
+	if (length > this->getSlotSize()) {
+		ostringstream error;
+		error << "Frame too long for the ring (" << dec << length << " Bytes, max. " << this->getSlotSize() << ")." << endl;
+		throw TmSharedFrameRingError(error.str());
+	}
+	uint8_t *dest = this->beginFrame(timeoutMs);
+	if (dest == NULL) {
+		return false;
+	}
+	memcpy(dest, frame, length);
+	this->commitFrame(length, timestamp, bitrate);
+	return true;
+}
+
+// Retrieves the number of frames dropped because the ring was full.
+uint64_t TmSharedFrameProducer::getDroppedCount()
+{
+	return droppedCount;
+}
+
+
+// Constructor of the TmSharedFrameConsumer class.
+TmSharedFrameConsumer::TmSharedFrameConsumer(string name, TmPhysicalChannel *channel)
+	: TmSharedFrameRing(name, false), physicalChannel(channel), frameCount(0), restartCount(0)
+{
+	generation = this->getGeneration();
+}
+
+// Passes the frames in the ring to the physical channel.
+TmChannelWarning TmSharedFrameConsumer::poll(int timeoutMs, size_t maxFrames)
+{
+	TmChannelWarning warnings;
+	RingHeader *header = ringHeader(mapping);
+
+	uint32_t currentGeneration = this->getGeneration();
+	if (currentGeneration != generation) {
+		ostringstream message;
+		message << "Frame producer of " << name << " restarted (generation " << dec << currentGeneration << ")." << endl;
+		warnings.appendFreeMessage(message.str());
+		restartCount += (uint32_t) (currentGeneration - generation);
+		generation = currentGeneration;
+	}
+	if (!this->isValidLayout(header->slotCount, header->slotSize)) {
+		return warnings;		// Being initialized by the producer.
+	}
+
+	if (!waitFor(FrameAvailable(header), &header->dataFutex, &header->consumerWaiting, timeoutMs)) {
+		if (this->reattach()) {		// A producer with another geometry replaced the ring; it is read from the next call on.
+			ostringstream message;
+			message << "Frame ring " << name << " was replaced, attached to the new one." << endl;
+			warnings.appendFreeMessage(message.str());
+		}
+		return warnings;
+	}
+
+	for (size_t count = 0; count < maxFrames; count++) {
+		uint64_t readIndex = __atomic_load_n(&header->readIndex, __ATOMIC_RELAXED);
+		uint64_t writeIndex = __atomic_load_n(&header->writeIndex, __ATOMIC_ACQUIRE);
+		if (readIndex == writeIndex) {
+			break;
+		}
+		if ((readIndex > writeIndex) || (writeIndex - readIndex > header->slotCount)) {
+			ostringstream message;		// Indexes left over from another ring.
+			message << "Inconsistent indexes of frame ring " << name << " (read " << dec << readIndex << ", write "
+					<< writeIndex << "), frames skipped." << endl;
+			warnings.appendFreeMessage(message.str());
+			__atomic_store_n(&header->readIndex, writeIndex, __ATOMIC_RELEASE);
+			break;
+		}
+
+		uint8_t *slot = this->slot(readIndex);
+		SlotHeader *slotHeader = reinterpret_cast<SlotHeader *>(slot);
+		if ((__atomic_load_n(&slotHeader->sequence, __ATOMIC_ACQUIRE) != readIndex + 1) || (slotHeader->length > header->slotSize)) {
+			ostringstream message;
+			message << "Frame " << dec << readIndex << " of frame ring " << name << " is out of sequence, skipped." << endl;
+			warnings.appendFreeMessage(message.str());
+		} else {
+			TmFrameTimestamp timestamp;
+			TmFrameBitrate bitrate;
+			if (slotHeader->flags & timestampValid) {
+				timestamp.setSeconds(slotHeader->seconds);
+				timestamp.setFractions(slotHeader->fractions);
+			}
+			if (slotHeader->flags & bitrateValid) {
+				bitrate.setBitrate(slotHeader->bitrate);
+			}
+			try {			// The frame is read where it is in the shared memory.
+				warnings += physicalChannel->receiveFrame(slot + sizeof(SlotHeader), slotHeader->length, timestamp, bitrate);
+			} catch (runtime_error &error) {	// A frame which cannot be processed must not block the ring.
+				warnings.appendFreeMessage(error.what());
+			}
+			frameCount++;
+		}
+
+		__atomic_store_n(&header->readIndex, readIndex + 1, __ATOMIC_RELEASE);	// Releases the slot.
+		signalChange(&header->spaceFutex, &header->producerWaiting);
+	}
+	return warnings;
+}
+
+// Attaches to a new object of the same name if the mapped one was removed.
+bool TmSharedFrameConsumer::reattach()
+{
+	struct stat status;
+	if ((fstat(fd, &status) != 0) || (status.st_nlink > 0)) {
+		return false;			// The mapped object is still the current one.
+	}
+	int newFd = shm_open(name.c_str(), O_RDWR, 0);
+	if (newFd < 0) {
+		return false;			// No new ring yet.
+	}
+	if ((fstat(newFd, &status) != 0) || ((size_t) status.st_size < sizeof(RingHeader))) {
+		close(newFd);			// Not sized by the producer yet.
+		return false;
+	}
+	close(fd);
+	fd = newFd;
+	this->map(status.st_size);	// The size is final: the producer sizes the object before initializing it.
+	generation = 0;				// The attachment of the new producer is counted as a restart.
+	return true;
+}
+
+// Retrieves the number of frames passed to the physical channel.
+uint64_t TmSharedFrameConsumer::getFrameCount()
+{
+	return frameCount;
+}
+
+// Retrieves the number of producer restarts seen.
+uint64_t TmSharedFrameConsumer::getRestartCount()
+{
+	return restartCount;
+}
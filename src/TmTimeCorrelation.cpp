@@ -0,0 +1,257 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "TmTimeCorrelation.h"
+#include "TmFrameTimestamp.h"
+#include "TmFrameBitrate.h"
+#include "TmFixedTimestamp.h"
+
+#include <vector>
+#include <math.h>
+#include <stdint.h>
+
+using namespace std;
+
+// Constructor of the TmTimeCorrelation class.
+TmTimeCorrelation::TmTimeCorrelation(size_t windowSize)
+{
+	Sample empty = {0.0, 0.0};
+	samples.assign((windowSize > minimumSamples) ? windowSize : minimumSamples, empty);
+	overheadLength = 0;
+	resetThreshold = 1.0;
+	resetCount = 0;
+	this->reset();
+}
+
+// Sets the number of Bytes sent between two frames.
+void TmTimeCorrelation::setOverheadLength(uint16_t bytes)
+{
+	overheadLength = bytes;
+}
+
+// Retrieves the number of Bytes sent between two frames.
+uint16_t TmTimeCorrelation::getOverheadLength()
+{
+	return overheadLength;
+}
+
+// Sets the largest distance between a sample and the model before the model is restarted.
+void TmTimeCorrelation::setResetThreshold(double seconds)
+{
+	resetThreshold = seconds;
+}
+
+// Forgets all samples.
+void TmTimeCorrelation::reset()
+{
+	nextSample = 0;
+	sampleCount = 0;
+	referenceSeconds = 0;
+	referenceIndex = 0;
+	lastIndex = 0;
+	sumIndex = 0.0;
+	sumTime = 0.0;
+	sumIndexIndex = 0.0;
+	sumIndexTime = 0.0;
+	baseIndex = 0.0;
+	baseTime = 0.0;
+	samplesSinceRebase = 0;
+	fitDone = false;
+	offset = 0.0;
+	period = 0.0;
+	lastResidual = 0.0;
+}
+
+// Adds the receipt time of a frame to the model.
+uint64_t TmTimeCorrelation::addSample(TmFrameTimestamp timestamp, uint8_t frameCount)
+{
+	if (!timestamp.isValid()) {
+		return lastIndex;
+	}
+
+	uint64_t index = lastIndex + ((frameCount - lastIndex) & 0xFF);	// Without a model, at most 255 frames may be lost between two samples.
+	if (sampleCount == 0) {
+		index = (lastIndex == 0) ? frameCount : index;		// Indices keep increasing when the model is restarted.
+		referenceSeconds = timestamp.getSeconds();
+		referenceIndex = index;
+	} else if (this->isValid()) {
+		// The index closest to the receipt time which matches the frame count.
+		int64_t relative = llround((this->secondsSinceReference(timestamp) - offset) / period);
+		int64_t delta = (int64_t) ((frameCount - (uint64_t) (referenceIndex + relative)) & 0xFF);
+		if (delta >= 128) {
+			delta -= 256;
+		}
+		relative += delta;
+		index = referenceIndex + relative;
+		int64_t behind = (int64_t) lastIndex - (int64_t) index;
+		if ((behind >= 0) && (behind < 128)) {
+			return index;		// Duplicate or late frame.
+		}
+
+		lastResidual = this->secondsSinceReference(timestamp) - (offset + period * (double) relative);
+		if ((behind >= 0) || (fabs(lastResidual) > resetThreshold)) {	// The receiver clock jumped, or the channel was reconfigured.
+			uint64_t previous = lastIndex;
+			this->reset();
+			lastIndex = previous;
+			resetCount++;
+			return this->addSample(timestamp, frameCount);
+		}
+	} else if (index == lastIndex) {
+		return index;		// The same frame count again.
+	}
+
+	Sample sample;
+	sample.index = (double) (index - referenceIndex);
+	sample.time = this->secondsSinceReference(timestamp);
+	lastIndex = index;
+
+	if (sampleCount == 0) {
+		baseIndex = sample.index;
+		baseTime = sample.time;
+	}
+	if (sampleCount == samples.size()) {	// The oldest sample in the ring is overwritten.
+		const Sample &oldest = samples[nextSample];
+		double x = oldest.index - baseIndex;
+		double y = oldest.time - baseTime;
+		sumIndex -= x;
+		sumTime -= y;
+		sumIndexIndex -= x * x;
+		sumIndexTime -= x * y;
+	} else {
+		sampleCount++;
+	}
+	samples[nextSample] = sample;
+	nextSample = (nextSample + 1) % samples.size();
+
+	double x = sample.index - baseIndex;
+	double y = sample.time - baseTime;
+	sumIndex += x;
+	sumTime += y;
+	sumIndexIndex += x * x;
+	sumIndexTime += x * y;
+	fitDone = false;
+
+	if (++samplesSinceRebase >= samples.size()) {	// Keeps the sums small, so they do not lose precision over a long pass.
+		this->rebase();
+	}
+	return index;
+}
+
+// Returns TRUE if the model holds enough samples to be used.
+bool TmTimeCorrelation::isValid()
+{
+	if (sampleCount < minimumSamples) {
+		return false;
+	}
+	this->fit();
+	return (period > 0.0);
+}
+
+// Estimates the receipt time of the first Byte of a frame.
+TmFrameTimestamp TmTimeCorrelation::estimateTimestamp(uint64_t frameIndex)
+{
+	if (!this->isValid()) {
+		return TmFrameTimestamp();
+	}
+	double time = offset + period * (double) (int64_t) (frameIndex - referenceIndex);
+	double whole = floor(time);
+	if (whole + (double) referenceSeconds < 1.0) {	// Before the Epoch: no valid timestamp.
+		return TmFrameTimestamp();
+	}
+	TmFixedTimestamp estimate(referenceSeconds + (int64_t) whole, (uint32_t) ((time - whole) * 4294967296.0));
+	return estimate.toTimestamp();
+}
+
+// Estimates the bitrate of the physical channel.
+TmFrameBitrate TmTimeCorrelation::estimateBitrate(uint16_t frameLength)
+{
+	TmFrameBitrate bitrate;
+	if (this->isValid()) {
+		bitrate.setBitrate(8.0 * ((double) frameLength + overheadLength) / period);
+	}
+	return bitrate;
+}
+
+// Retrieves the fitted frame period in seconds.
+double TmTimeCorrelation::getFramePeriod()
+{
+	return this->isValid() ? period : 0.0;
+}
+
+// Retrieves the distance of the last sample from the model.
+double TmTimeCorrelation::getLastResidual()
+{
+	return lastResidual;
+}
+
+// Retrieves the number of samples in the model.
+size_t TmTimeCorrelation::getSampleCount()
+{
+	return sampleCount;
+}
+
+// Retrieves the number of times the model was restarted by a sample off the line.
+uint64_t TmTimeCorrelation::getResetCount()
+{
+	return resetCount;
+}
+
+// Computes the line through the samples, if not done since the last sample.
+void TmTimeCorrelation::fit()
+{
+	if (fitDone) {
+		return;
+	}
+	fitDone = true;
+	double n = (double) sampleCount;
+	double denominator = n * sumIndexIndex - sumIndex * sumIndex;
+	if (denominator <= 0.0) {		// All samples have the same index.
+		period = 0.0;
+		return;
+	}
+	period = (n * sumIndexTime - sumIndex * sumTime) / denominator;
+	offset = baseTime + (sumTime - period * sumIndex) / n - period * baseIndex;
+}
+
+// Computes the sums of the fit again relative to the oldest sample.
+void TmTimeCorrelation::rebase()
+{
+	const Sample &oldest = samples[(nextSample + samples.size() - sampleCount) % samples.size()];
+	baseIndex = oldest.index;
+	baseTime = oldest.time;
+	sumIndex = 0.0;
+	sumTime = 0.0;
+	sumIndexIndex = 0.0;
+	sumIndexTime = 0.0;
+	for (size_t i = 0; i < sampleCount; i++) {
+		const Sample &sample = samples[(nextSample + samples.size() - sampleCount + i) % samples.size()];
+		double x = sample.index - baseIndex;
+		double y = sample.time - baseTime;
+		sumIndex += x;
+		sumTime += y;
+		sumIndexIndex += x * x;
+		sumIndexTime += x * y;
+	}
+	samplesSinceRebase = 0;
+}
+
+// Retrieves the time in seconds since the reference time.
+double TmTimeCorrelation::secondsSinceReference(TmFrameTimestamp timestamp)
+{
+	return (double) (int64_t) (timestamp.getSeconds() - referenceSeconds) + timestamp.getFractions();
+}
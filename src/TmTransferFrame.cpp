@@ -21,23 +21,27 @@ along with tmtp. If not, see <http://www.gnu.org/licenses/>.
 #include "myErrors.h"
 #include "TmFrameTimestamp.h"
 #include "TmFrameBitrate.h"
+#include "TmFrameLayout.h"
+#include "TmCrc16.h"
 
 #include <vector>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <utility>
 #include <stdint.h>
+#include <string.h>
 
 using namespace std;
 
 // Constructor for the TmTransferFrame class.
 TmTransferFrame::TmTransferFrame(uint16_t length)
 {
-	if ((length >= 7) && (length <= 2048)) {	// Verifies if the total frame length (in Bytes) given falls within the required range.
+	if (length >= minFrameLength) {	// Verifies if the total frame length (in Bytes) given falls within the required range.
 		frameLength = length;
 	} else {
 		ostringstream error;
-		error << "Frame length out of range (7-2048)." << endl;
+		error << "Frame length out of range (" << minFrameLength << "-" << maxFrameLength << ")." << endl;
 		throw TmTransferFrameError(error.str());
 	}
 	
@@ -52,6 +56,8 @@ TmTransferFrame::TmTransferFrame(uint16_t length)
     dataFieldSynchronised = false;	// The packet format in the TM Data Field will NOT be Byte-syncrhonized, forward-ordered.
     firstHeaderPointer = 0;			// Initializes the First Header Pointer to 0000 0000 0000 0000.
 	fecfPresent = false;			// No Frame Error Control Field present.
+	frameLengthField = false;		// Fixed-length frame.
+	this->updateLayout();			// Computes the field positions for this (default) configuration.
 }
 
 // Retrieves the Transfer Frame Version Number.
@@ -102,6 +108,7 @@ uint16_t TmTransferFrame::getVirtualChannelId()
 void TmTransferFrame::activateOcf()
 {
 	ocfPresent = true;
+	this->updateLayout();
 }
 
 // Retrieves the value of the Operational Control Field Flag.
@@ -126,6 +133,7 @@ TmOcf TmTransferFrame::getOcf()
 void TmTransferFrame::activateFecf()
 {
 	fecfPresent = true;
+	this->updateLayout();
 }
 
 // Retrieves the value of the Frame Error Control Field flag.
@@ -180,6 +188,7 @@ uint64_t TmTransferFrame::getVirtualChannelFrameCount()
 void TmTransferFrame::activateSecondHeader()
 {
 	secondHeaderPresent = true;
+	this->updateLayout();
 }
 
 // Retrieves the value of the Secondary Header flag.
@@ -210,11 +219,9 @@ void TmTransferFrame::activateExtendedVcFrameCount()
 			throw TmTransferFrameError(error.str());
 		}
 		// So, if the Secondary Header flag is TRUE and the SH Data Field length is 3 Bytes, then we most likely have some Extended Counter data in there already.
-		virtualChannelFrameCount |= (secondHeaderDataField[0] << 24);	// The 1st Byte of the SH Data Field is OR'd to the most significant Byte of the VC Frame Counter,
-		virtualChannelFrameCount |= (secondHeaderDataField[1] << 16);	// the 2nd Byte of the SH Data Field is OR'd to the 2nd msB of the VC Frame Counter,
-		virtualChannelFrameCount |= (secondHeaderDataField[2] << 8);	// the 3rd Byte of the SH Data Field is OR'd to the 3rd msB of the VC Frame Counter...
-																		// and the last Byte of the VC Frame Counter (the original counter) is left untouched.
+		this->mergeExtendedVcFrameCount();
 	}
+	this->updateLayout();	// The Secondary Header might have changed size.
 }
 
 // Retrieves the value of the Extended VC Frame Conter flag.
@@ -232,23 +239,33 @@ uint16_t TmTransferFrame::getSecondHeaderVersion()
 // Retrieves the length of the Secondary Header Data Field.
 uint16_t TmTransferFrame::getSecondHeaderLength()
 {
-	return secondHeaderDataField.size() + 1; // The +1 takes into account the lengths of Version Number and the Length Fields.
+	// The +1 takes into account the lengths of Version Number and the Length Fields.
+	return secondHeaderDataField.size() + 1 + (frameLengthField ? frameLengthFieldLength : 0);
 }
 
 // Populates the Secondary Header Data Field.
-void TmTransferFrame::setSecondHeaderDataField(vector<uint8_t> data)
+void TmTransferFrame::setSecondHeaderDataField(const vector<uint8_t> &data)
+{
+	vector<uint8_t> copy(data);
+	this->setSecondHeaderDataField(std::move(copy));
+}
+
+// Populates the Secondary Header Data Field, taking over the vector.
+void TmTransferFrame::setSecondHeaderDataField(vector<uint8_t> &&data)
 {
 	if (extendedVcFrameCount) {	// If the Extended VF Frame Counter is active, this Data Field shall NOT be used for any other purpose.
 		ostringstream error;
 		error << "Assignment of second header data field is invalid if extended VC frame count is used." << endl;
 		throw TmTransferFrameError(error.str());
 	}
-	if ((uint16_t) data.size() > (this->getMaxSecondHeaderLength() - 1)) {	// If somehow the data to be stored needs more than the max, an error is thrown.
+	uint16_t maxDataLength = this->getMaxSecondHeaderLength() - 1 - (frameLengthField ? frameLengthFieldLength : 0);
+	if ((uint16_t) data.size() > maxDataLength) {	// If somehow the data to be stored needs more than the max, an error is thrown.
 		ostringstream error;
 		error << "Second header data field is too long." << endl;
 		throw TmTransferFrameError(error.str());
 	}
-	secondHeaderDataField = data;	// If none of the above is the case, then we store "data" into the SH Data Field.
+	secondHeaderDataField = std::move(data);	// If none of the above is the case, then we store "data" into the SH Data Field.
+	this->updateLayout();			// The Secondary Header might have changed size.
 }
 
 // Retrieves the contents of the Secondary Header Data Field.
@@ -272,7 +289,10 @@ bool TmTransferFrame::getDataFieldSynchronisationStatus()
 // Sets the location in the TM Data Field where the 1st Byte of a new packet starts.
 void TmTransferFrame::setFirstHeaderPointer(uint16_t location)
 {
-	uint16_t maxLocation = this->getDataFieldLength() - 1;	// We set the higher boundary by calculating the Data Field Length and subtracting 1. 
+	uint16_t maxLocation = layout.getDataFieldLength() - 1;	// We set the higher boundary by calculating the Data Field Length and subtracting 1. 
+	if (maxLocation > maxFirstHeaderPointer) {				// In long frames, the 11 bits of the FHP only reach part of the Data Field.
+		maxLocation = maxFirstHeaderPointer;
+	}
 
 	if ((location <= maxLocation) || (location==fhpNoFirstHeader)	// If the location specified does not go beyond the higher limit,  
 			|| (location==fhpOnlyIdleData)) {						// or if it matches the predefined patterns for no-first-header or idle data...
@@ -297,65 +317,96 @@ uint16_t TmTransferFrame::getLength()
 	return frameLength;
 }
 
-// Calculates the Data Field length.
-uint16_t TmTransferFrame::getDataFieldLength()
+// Changes the length of the whole TM Transfer Frame.
+void TmTransferFrame::setLength(uint16_t length)
 {
-	uint64_t length = frameLength;						// As a precaution, the total frame length is copied into a local (signed) variable.
-	length -= primaryHeaderLength;					// First, we subtract the Primary Header length (constant 6 Bytes).
-	if (secondHeaderPresent) {
-		length -= this->getSecondHeaderLength();	// Second, if a Secondary Header is present, it will be subtracted.
-	}
-	if (ocfPresent) {								// Third, if the Trailed fields are present, we start removing the Operational Control Field
-		length -= TmOcf::ocfLength;
+	if (length < minFrameLength) {
+		ostringstream error;
+		error << "Frame length out of range (" << minFrameLength << "-" << maxFrameLength << ")." << endl;
+		throw TmTransferFrameError(error.str());
 	}
-	if (fecfPresent) {								// and finish by removing the Frame Error Control Field.
-		length -= fecfLength;
+	frameLength = length;
+	this->updateLayout();
+	if (!dataField.empty()) {
+		dataField.resize(layout.getDataFieldLength());	// The Data Field follows the new length.
 	}
+}
 
-	uint16_t ret;
-	if (length > 0) {						// If after all the subtractions we end up with a positive integer,
-		ret = (uint16_t) length;			// the length is casted as a two-Byte long number.
-	} else {
-		ret = 1;							// Otherwise we just say the Data Field length is 1.
-	}
-	return ret;			// And the result is returned as the Data Field Length.
+// Activates the frame length field for variable-length frames.
+void TmTransferFrame::activateFrameLengthField()
+{
+	frameLengthField = true;
+	this->activateSecondHeader();		// The field is carried in the Secondary Header.
 }
 
-// Calculates the Secondary Header length.
-uint16_t TmTransferFrame::getMaxSecondHeaderLength()
+// Retrieves the value of the frame length field flag.
+bool TmTransferFrame::getFrameLengthFieldStatus()
 {
-	uint64_t length = frameLength;		// As a precaution, the total frame length is copied into a local (signed) variable.
-	length -= primaryHeaderLength;	// First, we subtract the Primary Header length.
-	if (ocfPresent) {
-		length -= TmOcf::ocfLength;	// Second, if the Trailed fields are present, we start removing the Operational Control Field
-	}
-	if (fecfPresent) {				// and then by removing the Frame Error Control Field.
-		length -= fecfLength;
-	}
-	length -= 1; 					// We finish by subtracting 1, to account for the TM Data Field minimum size.
+	return frameLengthField;
+}
 
-	uint16_t ret;
-	if (length > 0) {					// If after all the subtractions we end up with a positive integer,
-		ret = (uint16_t) length;		// the length is casted as a two-Byte long number.
-	} else {
-		ret = 0;						// Otherwise we say there is no secondary header (length is zero).
+// Reads the frame length field of a raw frame in place.
+uint32_t TmTransferFrame::peekFrameLength(const uint8_t *raw, size_t length)
+{
+	const size_t fieldStart = primaryHeaderLength + 1;			// The field follows the Secondary Header ID.
+	if (length < fieldStart + frameLengthFieldLength) {
+		return 0;
 	}
-	if (ret > 64) { 					// The maximum length allowed by standard is 64, so we truncate higher lengths.
-		ret = 64;
+	bool secondHeader = (raw[4] >> 7) & 0x01;					// The TF Secondary Header Flag.
+	uint16_t secondHeaderLength = (raw[primaryHeaderLength] & 0x3F) + 1;
+	if (!secondHeader || (secondHeaderLength < 1 + frameLengthFieldLength)) {
+		return 0;
 	}
-	return ret;
+	return (((uint32_t) raw[fieldStart] << 8) | raw[fieldStart + 1]) + 1;	// The field holds the frame length minus one.
+}
+
+// Retrieves the Data Field length.
+uint16_t TmTransferFrame::getDataFieldLength()
+{
+	return layout.getDataFieldLength();	// Precomputed by updateLayout() whenever the configuration changes.
+}
+
+// Retrieves the maximum Secondary Header length.
+uint16_t TmTransferFrame::getMaxSecondHeaderLength()
+{
+	return layout.getMaxSecondHeaderLength();
+}
+
+// Retrieves the precomputed layout for the current frame configuration.
+const TmFrameLayout& TmTransferFrame::getFrameLayout()
+{
+	return layout;
 }
 
 // Populates the TM Data Field.
-void TmTransferFrame::setDataField(vector<uint8_t> data)
+void TmTransferFrame::setDataField(const vector<uint8_t> &data)
 {
-	if (data.size() == this->getDataFieldLength()) {
-		dataField = data;			// Only if the provided data is the exact same length as the calculated field length, then we store it there.
+	this->setDataField(data.empty() ? NULL : &data[0], data.size());
+}
+
+// Populates the TM Data Field, taking over the vector.
+void TmTransferFrame::setDataField(vector<uint8_t> &&data)
+{
+	if (data.size() == layout.getDataFieldLength()) {
+		dataField = std::move(data);	// Only if the provided data is the exact same length as the calculated field length, then we store it there.
 									// This (protected) variable will be available for all of the other function members in this class.
 	} else {
 		ostringstream error;
 		error << "Data field has wrong size. It is " << data.size() << " but should be ";
-		error << this->getDataFieldLength() << " bytes long." << endl;
+		error << layout.getDataFieldLength() << " bytes long." << endl;
+		throw TmTransferFrameError(error.str());
+	}
+}
+
+// Populates the TM Data Field from data given in place.
+void TmTransferFrame::setDataField(const uint8_t *data, size_t length)
+{
+	if (length == layout.getDataFieldLength()) {
+		dataField.assign(data, data + length);		// Reuses the capacity of the Data Field.
+	} else {
+		ostringstream error;
+		error << "Data field has wrong size. It is " << length << " but should be ";
+		error << layout.getDataFieldLength() << " bytes long." << endl;
 		throw TmTransferFrameError(error.str());
 	}
 }
@@ -364,10 +415,11 @@ void TmTransferFrame::setDataField(vector<uint8_t> data)
 vector<uint8_t> TmTransferFrame::getDataField()
 {
 	vector<uint8_t> retVec;	// We create a retrieval vector of length X and undefined contents.
+	uint16_t dataFieldLength = layout.getDataFieldLength();
 	
-	if (this->getDataFieldLength() > 0) {		// The Data Field length is calculated and if it is not zero,
+	if (dataFieldLength > 0) {		// The Data Field length is looked up and if it is not zero,
 		retVec = dataField;						// the contents of dataField are stored in the retrieval vector.
-		long dif = this->getDataFieldLength() - retVec.size();		// We calculate the difference btw. length X and the Data Field length.
+		long dif = dataFieldLength - (long) retVec.size();		// We calculate the difference btw. length X and the Data Field length.
 		if (dif > 0) {
 			retVec.insert(retVec.end(),dif,0);				// If the Data Field length is greater, the diference in retVec is filled with zeroes.
 		} else if (dif < 0) {
@@ -382,10 +434,25 @@ vector<uint8_t> TmTransferFrame::getDataField()
 	}
 }
 
+// Moves the TM Data Field out of the frame.
+vector<uint8_t> TmTransferFrame::releaseDataField()
+{
+	uint16_t dataFieldLength = layout.getDataFieldLength();
+	if (dataFieldLength == 0) {
+		ostringstream error;
+		error << "Invalid Data Field size (less than 1 Byte).";
+		throw TmTransferFrameError(error.str());
+	}
+	vector<uint8_t> released;
+	released.swap(dataField);
+	released.resize(dataFieldLength, 0);	// Same length as getDataField() returns.
+	return released;
+}
+
 // Builds the different frame fields and encapsulates a packet in it.
 vector<uint8_t> TmTransferFrame::wrap()
 {
-	vector<uint8_t> raw; // A vector is created into which the whole frame will be assembled, piece by piece.
+	vector<uint8_t> raw; // A vector is created into which the whole frame will be assembled at the offsets of the frame layout.
 
 	// The wrap begins by checking if the Data Field length is correct.
 	// In order to correctly calculate the Data Field length, 
@@ -406,7 +473,7 @@ vector<uint8_t> TmTransferFrame::wrap()
 	// 4.- The Frame Error Control Field:
 	//	- TmTransferFrame::activateFecf()
 	
-	if (this->getDataFieldLength() == 0) {	// The Data Field length is calculated and checked.
+	if (layout.getDataFieldLength() == 0) {	// The Data Field length is looked up and checked.
 		ostringstream error;
 		error << "Frame too short to carry all configured information." << endl;
 		throw TmTransferFrameError(error.str());
@@ -457,52 +524,102 @@ vector<uint8_t> TmTransferFrame::wrap()
 		secondHeaderId |= (this->getSecondHeaderLength()-1) & 0x003F; // length-1 is encoded in the last 6 bits
 	}
 
-	// Now we put everything together:
-	raw.push_back(headerFirstPart >> 8 );					// The 1st Byte of the Primary Header is inserted.
-	raw.push_back(headerFirstPart & 0x00FF);				// The 2nd Byte of the Primary Header is inserted.
+	// Now we put everything together. The frame is allocated once with its final length and each field is stored at its offset:
+	raw.resize(layout.getFrameLength());
+	uint8_t *pos = &raw[0];
+
+	pos[0] = headerFirstPart >> 8;						// The 1st Byte of the Primary Header is inserted.
+	pos[1] = headerFirstPart & 0x00FF;					// The 2nd Byte of the Primary Header is inserted.
 	
-	raw.push_back(masterChannelFrameCount & 0x00FF);		// The Master Channel Frame Counter is inserted.
-	raw.push_back(virtualChannelFrameCount & 0x000000FF);	// The Virtual Channel Frame Counter is inserted.
+	pos[2] = masterChannelFrameCount & 0x00FF;			// The Master Channel Frame Counter is inserted.
+	pos[3] = virtualChannelFrameCount & 0x000000FF;		// The Virtual Channel Frame Counter is inserted.
 	
-	raw.push_back(dataFieldStatus >> 8 );					// The 1st Byte of the Data Field Status is inserted.
-	raw.push_back(dataFieldStatus & 0x00FF);				// The 2nd Byte of the Data Field Status is inserted.
+	pos[4] = dataFieldStatus >> 8;						// The 1st Byte of the Data Field Status is inserted.
+	pos[5] = dataFieldStatus & 0x00FF;					// The 2nd Byte of the Data Field Status is inserted.
 	
 	if (secondHeaderPresent) {								// If the Secondary Header is going to be used:
-		raw.push_back(secondHeaderId & 0x00FF);				// The Secondary Header Id is inserted.
-		raw.insert(raw.end(), secondHeaderDataField.begin(), secondHeaderDataField.end());	// The SH Data Field is inserted.
+		pos[TmFrameLayout::primaryHeaderLength] = secondHeaderId & 0x00FF;	// The Secondary Header Id is inserted.
+		uint8_t *shData = pos + TmFrameLayout::primaryHeaderLength + 1;
+		if (frameLengthField) {								// The frame length field comes first (frame length minus one).
+			shData[0] = (frameLength - 1) >> 8;
+			shData[1] = (frameLength - 1) & 0x00FF;
+			shData += frameLengthFieldLength;
+		}
+		if (!secondHeaderDataField.empty()) {
+			memcpy(shData, &secondHeaderDataField[0], secondHeaderDataField.size());	// The SH Data Field is inserted.
+		}
 	}
 	
-	vector<uint8_t> tmpDataField = this->getDataField();
-	raw.insert(raw.end(), tmpDataField.begin(), tmpDataField.end());	// The packet is inserted in the TM Data Field.
+	if (dataField.size() == layout.getDataFieldLength()) {
+		memcpy(pos + layout.getDataFieldStart(), &dataField[0], dataField.size());	// The packet is inserted in the TM Data Field.
+	} else {
+		vector<uint8_t> tmpDataField = this->getDataField();						// Pads or truncates a Data Field of the wrong size.
+		memcpy(pos + layout.getDataFieldStart(), &tmpDataField[0], tmpDataField.size());
+	}
 
 	if (ocfPresent) {											// Of the Operational Control Field is going to be used:
 		vector<uint8_t> rawOcf = ocf.wrap();				// The Operational Control Field is wrapped.
-		raw.insert(raw.end(), rawOcf.begin(), rawOcf.end());	// The raw Operational Control Field is inserted.
+		memcpy(pos + layout.getDataFieldEnd(), &rawOcf[0], TmOcf::ocfLength);	// The raw Operational Control Field is inserted.
 	}
 	
 	if (fecfPresent) {						// If the Frame Error Control Field is going to be used:
-		uint16_t FECF = crc(raw);		// A CRC is computed from what we have stored in the raw vector.
-		raw.push_back(FECF >> 8);			// The 1st Byte of the CRC is inserted.
-		raw.push_back(FECF & 0x00FF);		// The 2nd Byte of the CRC is inserted and we're done!
+		uint16_t fecfStart = layout.getFrameLength() - TmFrameLayout::fecfLength;
+		uint16_t FECF = crc(pos, fecfStart);	// A CRC is computed over everything in front of the FECF.
+		pos[fecfStart] = FECF >> 8;				// The 1st Byte of the CRC is inserted.
+		pos[fecfStart + 1] = FECF & 0x00FF;		// The 2nd Byte of the CRC is inserted and we're done!
 	}
 
 	return raw;	// A new TMTP Frame is born!
 }
 
 // Takes a TMTP Frame, reads the Fields and Flags and stores their values in local variables accordingly.
-void TmTransferFrame::unwrap(vector<uint8_t> raw)
+void TmTransferFrame::unwrap(const vector<uint8_t> &raw)
 {
-	if (raw.size() != frameLength) {	// All frames must be fixed length, so the received frame should match the established length.
+	this->unwrap(raw.empty() ? NULL : &raw[0], raw.size());
+}
+
+// Reads all fields of a frame given in place.
+void TmTransferFrame::unwrap(const uint8_t *raw, size_t length)
+{
+	this->unwrapHeader(raw, length);
+	this->unwrapDataField(raw, length);
+	this->unwrapOcf(raw, length);
+}
+
+// Checks the frame length and FECF and reads the Primary and Secondary Headers.
+void TmTransferFrame::unwrapHeader(const vector<uint8_t> &raw)
+{
+	this->unwrapHeader(raw.empty() ? NULL : &raw[0], raw.size());
+}
+
+// Checks the frame length and FECF and reads the headers of a frame given in place.
+void TmTransferFrame::unwrapHeader(const uint8_t *raw, size_t length)
+{
+	if (frameLengthField) {			// Variable-length frames carry their length, which is read before anything else.
+		uint32_t fieldLength = peekFrameLength(raw, length);
+		if ((fieldLength < minFrameLength) || (fieldLength > frameLength)) {
+			ostringstream error;
+			error << "Frame length field missing or out of range (" << dec << fieldLength << ", max. " << frameLength << ")." << endl;
+			throw TmTransferFrameError(error.str());
+		}
+		if (length != fieldLength) {
+			ostringstream error;
+			error << "Wrong frame length. ";
+			error << dec << length << " bytes instead of " << fieldLength << "." << endl;
+			throw TmTransferFrameError(error.str());
+		}
+		frameLength = fieldLength;	// From now on, the frame has the received length.
+	} else if (length != frameLength) {	// All frames must be fixed length, so the received frame should match the established length.
 		ostringstream error;
 		error << "Wrong frame length. ";
-		error << dec << raw.size() << " bytes instead of " << frameLength << "." << endl;
+		error << dec << length << " bytes instead of " << frameLength << "." << endl;
 		throw TmTransferFrameError(error.str());
 	}
 
 	if (fecfPresent) {					// If there is a Frame Error Control Field present, a CRC is computed against the whole frame.
-		if (crc(raw) != 0) {
+		if (crc(raw, length) != 0) {
 			cout << "Checksum error, received packet: ";
-			for(unsigned int i=0;i<raw.size();i++) {
+			for(unsigned int i=0;i<length;i++) {
 				cout << hex << (unsigned int)raw[i];
 				cout << " ";
 			}
@@ -534,6 +651,10 @@ void TmTransferFrame::unwrap(vector<uint8_t> raw)
 		firstHeaderPointer = dataFieldStatus & 0x07FF;	// ... The First Header Pointer is extracted.
 	}
 
+	dataField.clear();					// The Data Field is only extracted by unwrapDataField().
+	secondHeaderDataField.clear();		// The Secondary Header of a previously unwrapped frame is discarded
+	this->updateLayout();				// and the layout is computed for the received trailer flags.
+
 	if (secondHeaderPresent) {								// If a Secondary Header is present:
 		uint16_t secondHeaderId = raw[primaryHeaderLength];	// The Secondary Header ID is extracted.
 		uint16_t recSecondHeaderVersion = (secondHeaderId >> 6) & 0x0003;	// The version is extracted.
@@ -543,13 +664,15 @@ void TmTransferFrame::unwrap(vector<uint8_t> raw)
 			throw TmTransferFrameError(error.str());
 		}
 		uint16_t secondHeaderLength = (secondHeaderId & 0x003F) + 1;	// The Secondary Header Length is extracted and increased by 1.
-		if (secondHeaderLength > this->getMaxSecondHeaderLength()) {		// The current SH Length is calculated and compared to the length received.
+		if (secondHeaderLength > layout.getMaxSecondHeaderLength()) {		// The current max. SH Length is compared to the length received.
 			ostringstream error;
 			error << "Second Header too long.";
 			throw TmTransferFrameError(error.str());
 		}
-		secondHeaderDataField.assign(raw.begin()+primaryHeaderLength+1,	// The Secondary Header Field is extracted.
-			raw.begin()+primaryHeaderLength+secondHeaderLength);
+		uint16_t shDataStart = primaryHeaderLength + 1 + (frameLengthField ? frameLengthFieldLength : 0);	// Behind the frame length field.
+		secondHeaderDataField.assign(raw+shDataStart,	// The Secondary Header Field is extracted.
+			raw+primaryHeaderLength+secondHeaderLength);
+		this->updateLayout();										// The Data Field now starts after the Secondary Header.
 		if (extendedVcFrameCount) {						// If using an extended VC Frame Counter...
 			if (secondHeaderDataField.size() != 3) {	// ... Its length should be of three Bytes.
 				ostringstream error;
@@ -558,9 +681,7 @@ void TmTransferFrame::unwrap(vector<uint8_t> raw)
 			}
 			
 			// The most significant three Bytes of the counter are added to the already extracted least significant Byte.
-			virtualChannelFrameCount |= (secondHeaderDataField[0] << 24);
-			virtualChannelFrameCount |= (secondHeaderDataField[1] << 16);
-			virtualChannelFrameCount |= (secondHeaderDataField[2] << 8);
+			this->mergeExtendedVcFrameCount();
 		}
 	} else if (extendedVcFrameCount) {	// If no Secondary Header is present but the Extended VC Frame Counter flag was activated
 		ostringstream error;			// then we have a funny error.
@@ -568,16 +689,40 @@ void TmTransferFrame::unwrap(vector<uint8_t> raw)
 		throw TmTransferFrameError(error.str());
 	}
 
-	if (this->getDataFieldLength() == 0) {	// The Data Field length is calculated and should not be zero.
+	if (layout.getDataFieldLength() == 0) {	// The Data Field length is looked up and should not be zero.
 		ostringstream error;
 		error << "Frame too short for configured features." << endl;
 		throw TmTransferFrameError(error.str());
 	}
-	dataField.assign(raw.begin()+getDataFieldStart(), raw.begin()+getDataFieldEnd());	// The Data Field is extracted.
+}
+
+// Copies the TM Data Field out of the raw frame.
+void TmTransferFrame::unwrapDataField(const vector<uint8_t> &raw)
+{
+	this->unwrapDataField(raw.empty() ? NULL : &raw[0], raw.size());
+}
+
+// Copies the TM Data Field out of a frame given in place.
+void TmTransferFrame::unwrapDataField(const uint8_t *raw, size_t length)
+{
+	this->checkUnwrappedLength(raw, length);
+	dataField.assign(raw+layout.getDataFieldStart(), raw+layout.getDataFieldEnd());	// The Data Field is extracted.
+}
 
+// Reads the Operational Control Field (if present) out of the raw frame.
+void TmTransferFrame::unwrapOcf(const vector<uint8_t> &raw)
+{
+	this->unwrapOcf(raw.empty() ? NULL : &raw[0], raw.size());
+}
+
+// Reads the Operational Control Field (if present) out of a frame given in place.
+void TmTransferFrame::unwrapOcf(const uint8_t *raw, size_t length)
+{
+	this->checkUnwrappedLength(raw, length);
 	if (ocfPresent) {
-		vector<uint8_t> rawOcf (raw.begin()+getDataFieldEnd(),	// The Operational Control Field is extracted.
-			raw.begin()+getDataFieldEnd()+TmOcf::ocfLength);
+		uint16_t dataFieldEnd = layout.getDataFieldEnd();
+		vector<uint8_t> rawOcf (raw+dataFieldEnd,	// The Operational Control Field is extracted.
+			raw+dataFieldEnd+TmOcf::ocfLength);
 		try {
 			ocf.unwrap(rawOcf);		// The unwrap function of the TmOcf class is used.
 		} catch (TmOcfError& e) {
@@ -605,50 +750,71 @@ void TmTransferFrame::debugOutput()
 	cout << "FHP: " << dec << setw(4) << this->getFirstHeaderPointer() << ", ";
 	cout << "FECF: " << boolalpha << setw(5) << this->getFecfStatus() << ", ";
 	cout << "Content: \"";
-	for (uint16_t i=0; i < this->getDataFieldLength(); i++) {
+	uint16_t dataFieldLength = layout.getDataFieldLength();
+	for (uint16_t i=0; (i < dataFieldLength) && (i < dataField.size()); i++) {
 		cout << dataField[i];
 	}
-	cout << "\"[" << dec << this->getDataFieldLength() << "]";
+	cout << "\"[" << dec << dataFieldLength << "]";
 	cout << endl;
 }
 
-// Calculates the position (in Bytes) where the TM Data Field starts.
+// Retrieves the position (in Bytes) where the TM Data Field starts.
 uint16_t TmTransferFrame::getDataFieldStart()
 {
-	uint16_t start = primaryHeaderLength;
-	if (secondHeaderPresent) {
-		start += this->getSecondHeaderLength();
-	}
-	return start;
+	return layout.getDataFieldStart();
 }
 
-// Calculates the position (in Bytes) where the TM Data Field ends.
+// Retrieves the position (in Bytes) where the TM Data Field ends.
 uint16_t TmTransferFrame::getDataFieldEnd()
 {
-	uint16_t end = frameLength;
-	if (ocfPresent) {
-		end -= TmOcf::ocfLength;
+	return layout.getDataFieldEnd();
+}
+
+// Combines the counter extension stored in the Secondary Header with the least significant Byte of the VC Frame Counter.
+void TmTransferFrame::mergeExtendedVcFrameCount()
+{
+	// Only the least significant Byte (the original counter) is kept; bits 8-31 are replaced, not OR'd,
+	// so a counter extension left over from a previous frame cannot leak into the result.
+	virtualChannelFrameCount = (virtualChannelFrameCount & 0xFF)
+		| ((uint64_t) secondHeaderDataField[0] << 24)	// The 1st Byte of the SH Data Field is the most significant Byte of the VC Frame Counter,
+		| ((uint64_t) secondHeaderDataField[1] << 16)	// the 2nd Byte of the SH Data Field is the 2nd msB of the VC Frame Counter,
+		| ((uint64_t) secondHeaderDataField[2] << 8);	// the 3rd Byte of the SH Data Field is the 3rd msB of the VC Frame Counter.
+}
+
+// Verifies that a frame given in place has the length of the frame whose headers were unwrapped.
+void TmTransferFrame::checkUnwrappedLength(const uint8_t *raw, size_t length)
+{
+	if ((raw == NULL) || (length != layout.getFrameLength())) {	// The layout was computed by unwrapHeader() for the received frame.
+		ostringstream error;
+		error << "Wrong frame length. ";
+		error << dec << length << " bytes instead of " << layout.getFrameLength() << " (unwrapHeader() not called for this frame?)." << endl;
+		throw TmTransferFrameError(error.str());
 	}
-	if (fecfPresent) {
-		end -= fecfLength;
+}
+
+// Recomputes the frame layout after a change of the optional fields.
+void TmTransferFrame::updateLayout()
+{
+	uint16_t secondHeaderLength = 0;
+	if (secondHeaderPresent) {
+		secondHeaderLength = this->getSecondHeaderLength();
 	}
-	return end;
+	layout = TmFrameLayout(frameLength, secondHeaderLength, ocfPresent, fecfPresent);
 }
 
 // Computes a Cyclic Redundancy Check on a message (the whole frame except the FECF). 
-uint16_t TmTransferFrame::crc(vector<uint8_t> message)
-{
-	uint16_t sr = 0xFFFF;		// We initialize a two-Byte Shift Register full of 1's.
-	for (uint16_t i=0; i < message.size(); i++) {
-		uint16_t byte = message[i];				// We take the one Byte of the message.
-		for (uint16_t bit=0; bit < 8; bit++) {	
-			uint16_t newBit = byte >> (7 - bit);	// 
-			uint16_t add = ((sr >> 15) ^ newBit) & 0x0001;
-			add |= (add << 5) | (add << 12);
-			sr = (sr << 1) ^ add;
-		}
+uint16_t TmTransferFrame::crc(const vector<uint8_t> &message)
+{
+	if (message.empty()) {
+		return 0xFFFF;
 	}
-	return sr;
+	return this->crc(&message[0], message.size());
+}
+
+// Computes a Cyclic Redundancy Check on a buffer (see TmCrc16).
+uint16_t TmTransferFrame::crc(const uint8_t *message, size_t length)
+{
+	return TmCrc16::compute(message, length);
 }
 
 // Inserts a timestamp object.
@@ -33,12 +33,14 @@ along with tmtp. If not, see <http://www.gnu.org/licenses/>.
 #include <sstream>
 #include <string>
 #include <vector>
+#include <utility>
 #include <stdint.h>
 
 using namespace std;
 
 // Constructor of the TmVirtualChannel class.
 TmVirtualChannel::TmVirtualChannel(uint16_t id, TmMasterChannel *parent)
+	: sendTemplate(7)	// The frame template is built on the first call to sendFrame().
 {
 	if (id < 8) {		// Verifies the Virtual Channel ID falls within the range of 0 to 7.
 		virtualChannelId = id;
@@ -55,10 +57,12 @@ TmVirtualChannel::TmVirtualChannel(uint16_t id, TmMasterChannel *parent)
 	dataFieldSynchronised = true;	// The packet format in the TM Data Field will be Byte-synchronized, forward-ordered.
 	initialConf = netProtConf = new NetProtConf;	// The initial configuration considers all packets as idle.
 	debugOutput = false;			// Does not include debug output in the warning messages.
+	directDataFieldAccess = false;	// Uses the normal packet mode.
+	sendTemplateValid = false;		// The frame template still has to be built.
 
 	// Initializes all the counters to zero
 	sendFrameCount = 0;
-	recFrameCount = 0;
+	recSequence.setModulus(256);	// The first received frame starts the sequence.
 	recPacketHeaderLength = 0;
 	recPacketLength = 0;
 }
@@ -84,7 +88,13 @@ uint64_t TmVirtualChannel::getSendFrameCount()
 // Retrieves the received frame counter.
 uint64_t TmVirtualChannel::getRecFrameCount()
 {
-	return recFrameCount;
+	return recSequence.getExpectedCount();
+}
+
+// Retrieves the tracker of the received frame counter.
+TmSequenceTracker& TmVirtualChannel::getRecSequence()
+{
+	return recSequence;
 }
 
 // Sets the Secondary Header and the extended frame counter flags to TRUE.
@@ -92,6 +102,8 @@ void TmVirtualChannel::activateExtendedFrameCount()
 {
 	secondHeaderPresent = true;
 	extendedFrameCountSet  = true;
+	recSequence.setModulus((uint64_t)1<<32);	// ((uint64_t)1<<32) = (64-bit wide unsigned int) 2^32
+	sendTemplateValid = false;
 }
 
 // Sets the Secondary Header and the extended frame counter flags to FALSE.
@@ -99,6 +111,8 @@ void TmVirtualChannel::deactivateExtendedFrameCount()
 {
 	secondHeaderPresent = false;
 	extendedFrameCountSet = false;
+	recSequence.setModulus(256);
+	sendTemplateValid = false;
 }
 
 // Retrieves the value of the extended frame counter flag.
@@ -126,21 +140,49 @@ bool TmVirtualChannel::getDirectDataFieldAccessStatus()
 }
 
 // Places a packet in the output queue.
-void TmVirtualChannel::sendPacket(vector<uint8_t> packet)
+void TmVirtualChannel::sendPacket(const vector<uint8_t> &packet)
+{
+	vector<uint8_t> copy(packet);
+	this->sendPacket(std::move(copy));
+}
+
+// Moves a packet into the output queue.
+void TmVirtualChannel::sendPacket(vector<uint8_t> &&packet)
 {
 	if (sendFifo.size() < sendPacketBufferSize) {	// If the output queue has not reached its limit,
 		if (sendFifo.empty()) {						// and if the the output queue is empty,
-			sendFifo.push(packet);						// place the packet in the output queue and
+			sendFifo.push(std::move(packet));			// place the packet in the output queue and
 			sendPointer = sendFifo.front().begin();		// update the iterator position to the oldest element in the queue, 
 															// and specifically, to the 1st element of the vector in that position.
 		} else {
-			sendFifo.push(packet);					// If the queue is not empty, just put packet in the queue and don't touch the iterator.
+			sendFifo.push(std::move(packet));		// If the queue is not empty, just put packet in the queue and don't touch the iterator.
+		}
+	} else {
+		ostringstream error;						// If the output queue has reached its limit, throw an error.
+		error << "Packet buffer overflow." << endl;
+		throw TmVirtualChannelError(virtualChannelId, error.str());
+	}
+}
+
+// Reserves a packet in the output queue, to be written in place.
+uint8_t* TmVirtualChannel::allocSendPacket(size_t length)
+{
+	if (length == 0) {
+		ostringstream error;
+		error << "Empty packet requested." << endl;
+		throw TmVirtualChannelError(virtualChannelId, error.str());
+	}
+	if (sendFifo.size() < sendPacketBufferSize) {	// If the output queue has not reached its limit,
+		sendFifo.push(vector<uint8_t>(length));		// the packet is created in its final place in the queue.
+		if (sendFifo.size() == 1) {					// If it is the only packet, the iterator points to its 1st Byte.
+			sendPointer = sendFifo.front().begin();
 		}
 	} else {
 		ostringstream error;						// If the output queue has reached its limit, throw an error.
 		error << "Packet buffer overflow." << endl;
 		throw TmVirtualChannelError(virtualChannelId, error.str());
 	}
+	return &sendFifo.back()[0];
 }
 
 // Retrieves a packet with its timestamp from the input queue.
@@ -177,87 +219,45 @@ bool TmVirtualChannel::packetAvailable()
 	return !recFifo.empty();
 }
 
-// Reads the Data Field of a received frame and extracts the packets it contains (must be unwrapped first).
-TmChannelWarning TmVirtualChannel::receiveFrame(TmTransferFrame frame)
+// Extracts the packets of a received frame the caller keeps; the whole frame is copied first.
+TmChannelWarning TmVirtualChannel::receiveFrame(const TmTransferFrame &frame)
 {
-	// Retrieves the Data Field from the received frame, extracts its data and initializes recPointer to its 1st position.
-	vector<uint8_t> data = frame.getDataField();
-	vector<uint8_t>::iterator recPointer = data.begin();
+	TmTransferFrame copy(frame);
+	return this->receiveFrame(std::move(copy));
+}
+
+// Extracts the packets of a received frame the caller no longer needs; its Data Field is moved, not copied.
+TmChannelWarning TmVirtualChannel::receiveFrame(TmTransferFrame &&frame)
+{
+	vector<uint8_t> data;		// The Data Field, moved out of the frame once the frame passed the checks.
+	vector<uint8_t>::iterator recPointer;
 	vector<uint8_t>::iterator firstHeaderPointer;
 	//bool firstHeaderAlreadyMatched = false; /* not used at the moment */
 	
 	TmFrameTimestamp frameTimestamp = frame.getTimestamp();	// Extracts the reference timestamp from the frame.
 	TmFrameBitrate frameBitrate = frame.getBitrate();		// Extracts the reference bitrate from the frame.
 
-	double rawPacketTimestamp = 0.0;	// Stores the estimated timestamp of each packet before being separated into seconds and fractions.
-	TmFrameTimestamp packetTimestamp;	// Temorarily houses the estimated timestamp of each packet.
+	// The packet timestamps are computed in fixed point from the frame timestamp and the duration of one Byte.
+	bool timestampsValid = frameTimestamp.isValid() && frameBitrate.isValid();
+	TmFixedTimestamp frameStart;		// Timestamp of the first Byte of the frame.
+	uint64_t byteScale = 0;				// Duration of one Byte, computed once per frame.
+	if (timestampsValid) {
+		frameStart = TmFixedTimestamp(frameTimestamp);
+		byteScale = TmFixedTimestamp::byteScale(frameBitrate.getBitrate());
+	}
 	TimeTaggedPacket packetAndTimestamp;	// Stores a packet and a timestamp together in a single structure before sending it to the input queue.*/
 	
 	TmChannelWarning warning;
 
-	// Check for frame setting consistency (compares the values of the received frame against the VC settings.)
-	if (frame.getVirtualChannelId() != virtualChannelId) {
-		// warning message
-		warning.setWrongVcid();
-	} else if (frame.getSecondHeaderStatus() != secondHeaderPresent) {
-		// warning message
-		warning.setWrongSecondHeaderFlag();
-	} else if (frame.getDataFieldSynchronisationStatus() != dataFieldSynchronised) {
-		// warning message
-		warning.setWrongSynchronisationFlag();
-	} else {	
-	
-	// If the consistency check is all hunky dory:
-		if (extendedFrameCountSet) {
-			try {
-				frame.activateExtendedVcFrameCount();	// Reads the SH Data Field to retrieve the 3-Bytes long counter extension.
-			} catch (TmTransferFrameError& e) {
-				// warning message
-				warning.addFrameUnwrapError(string(e.what()));
-			}
-		}
-		
-		// The received frame contents are displayed.
-		// debug frame output
-		if (debugOutput) {
-			cout << "Received " << flush;
-			frame.debugOutput();
-		}
-		
-		// check frame count
-		if (recFrameCount == frame.getVirtualChannelFrameCount()) {
-			if (extendedFrameCountSet) {
-				recFrameCount = (recFrameCount+1) % ((uint64_t)1<<32); // ((uint64_t)1<<32) = (64-bit wide unsigned int) 2^32
-			} else {
-				recFrameCount = (recFrameCount+1) % 256;
-			}
-		} else {
-			// discard current packet
-			recPacket.clear();
-			recPacketHeaderLength = 0;
-			recPacketLength = 0;
-			
-			// warning message
-			if (extendedFrameCountSet) {
-				warning.addVCLostFramesCount((frame.getVirtualChannelFrameCount()
-					- recFrameCount + ((uint64_t)1<<32)) % ((uint64_t)1<<32)); // ((uint64_t)1<<32) = (64-bit wide unsigned int) 2^32
-			} else {
-				warning.addVCLostFramesCount((frame.getVirtualChannelFrameCount()
-					- recFrameCount + 256) % 256);
-			}
-			
-			// Rectify the frame counter.
-			if (extendedFrameCountSet) {
-				recFrameCount = (frame.getVirtualChannelFrameCount()+1) % ((uint64_t)1<<32); // ((uint64_t)1<<32) = (64-bit wide unsigned int) 2^32
-			} else {
-				recFrameCount = (frame.getVirtualChannelFrameCount()+1) % 256;
-			}
-		}
-
+	// Check for frame setting consistency and update the VC counters.
+	if (this->checkReceivedFrame(frame, warning)) {
 		// Frame unwrapped:				OK
 		// Frame consistency check :	OK
 		// VC Counters updated :		OK
 		// Now we extract the data..
+		// Retrieves the Data Field from the received frame and initializes recPointer to its 1st position.
+		data = frame.releaseDataField();
+		recPointer = data.begin();
 		
 		if (frame.getFirstHeaderPointer() != TmTransferFrame::fhpOnlyIdleData) {
 			/* handle direct data field access if configured */
@@ -281,6 +281,12 @@ TmChannelWarning TmVirtualChannel::receiveFrame(TmTransferFrame frame)
 					firstHeaderPointer = data.begin() + frame.getFirstHeaderPointer();
 					}
 				
+				// In Data Fields longer than the reach of the FHP, packets starting beyond it are announced as fhpNoFirstHeader.
+				// Once a packet has been completed in such a frame, the following packets are found by their lengths.
+				bool fhpOutOfReach = (frame.getFirstHeaderPointer() == TmTransferFrame::fhpNoFirstHeader)
+						&& (data.size() > TmTransferFrame::maxFirstHeaderPointer + 1u);
+				bool followLengths = false;
+
 				// Now we scan the whole Data Field:
 				while (recPointer < data.end()) {
 					// recPacket is a "pre-buffer" in which we store the Bytes (or pieces) of a packet.
@@ -291,7 +297,7 @@ TmChannelWarning TmVirtualChannel::receiveFrame(TmTransferFrame frame)
 					
 					// If we are receiving the very first Byte of a new packet:
 					if (recPacket.size() == 0) {
-						if (recPointer < firstHeaderPointer) {	// Verify recPointer points to the start of a packet.
+						if ((recPointer < firstHeaderPointer) && !followLengths) {	// Verify recPointer points to the start of a packet.
 							recPointer = firstHeaderPointer;	// Otherwise adjust the pointer.
 							//firstHeaderAlreadyMatched = true;
 							warning.setPacketResynced();		// Let the application know that the pointer was adjusted:
@@ -300,27 +306,26 @@ TmChannelWarning TmVirtualChannel::receiveFrame(TmTransferFrame frame)
 																// was left at the beginning of the current Data Field.
 
 						} else {	// ... But if recPointer actually points to the start of a packet:
-							if (netProtConf->isIdlePacket(*recPointer)) {	// Check if, according to the packet protocol config, we have an idle packet.
-								recPointer++;								// In which case, we simply ignore the packet.
+							size_t idleLength = netProtConf->skipIdlePackets(&*recPointer, data.end() - recPointer);
+							if (idleLength > 0) {	// Check if, according to the packet protocol config, we have one or more idle packets.
+								recPointer += idleLength;					// In which case, we simply ignore the whole run of idle packets.
 
 							} else {	// If we are dealing with a packet with actual data:
 								recPacketHeaderLength = netProtConf->getPacketHeaderLength(*recPointer);	// Extract the packet header length.
 								recPacket.push_back(*recPointer);			// Place current Byte in the pre-buffer.
 								
 								// The following procedure is to be done on the first Byte of each packet:
-								if (frameTimestamp.isValid() && frameBitrate.isValid()) {	// If the timestamp *and* bitrate stored in the frame 
-																							// contain actual data:
+								if (timestampsValid) {	// If the timestamp *and* bitrate stored in the frame contain actual data:
 									// Take the Primary_Header_Length + Secondary_Header_Length + Data_Field_pos._of _1st_packet_Byte 
-									// and divide that by the reference bitrate stored in the frame to get a "raw packet timestamp".
-									int position = distance(data.begin(),recPointer);
-									rawPacketTimestamp = ((6 + frame.getSecondHeaderLength() + position) * 8) / frameBitrate.getBitrate();
-									
-									// Now we put the seconds and fractions in their respective places within the packet timestamp object:
-									packetTimestamp.setSeconds(frameTimestamp.getSeconds() + static_cast<int>(rawPacketTimestamp));
-									packetTimestamp.setFractions(rawPacketTimestamp - static_cast<int>(rawPacketTimestamp));
-									// And we put the new timestamp as well as the reference bitrate in the joint data structure, waiting for the complete packet to be assembled.
-									packetAndTimestamp.timestamp = packetTimestamp;
-									packetAndTimestamp.bitrate = frameBitrate;
+									// and add the duration of that many Bytes to the frame timestamp.
+									TmFixedTimestamp fixedTimestamp = frameStart;
+									fixedTimestamp.addBytes(frame.getFrameLayout().getDataFieldStart() + (recPointer - data.begin()), byteScale);
+									// The timestamp and the reference bitrate are kept until the complete packet is assembled, possibly in a later frame.
+									recPacketTimestamp = fixedTimestamp.toTimestamp();
+									recPacketBitrate = frameBitrate;
+								} else {
+									recPacketTimestamp = TmFrameTimestamp();
+									recPacketBitrate = TmFrameBitrate();
 								}
 								recPointer++;	// ... On to the next Byte.
 								}
@@ -342,9 +347,8 @@ TmChannelWarning TmVirtualChannel::receiveFrame(TmTransferFrame frame)
 								recPacketHeaderLength = 0;
 								recPacketLength = 0;
 								//firstHeaderAlreadyMatched = true;
-								packetAndTimestamp.timestamp = packetTimestamp = TmFrameTimestamp();	// The Timestamps are discarded. 
-								rawPacketTimestamp = 0.0;
-								packetAndTimestamp.bitrate = TmFrameBitrate();							// The stored bitrate is also discarded. 
+								recPacketTimestamp = TmFrameTimestamp();	// The Timestamps are discarded. 
+								recPacketBitrate = TmFrameBitrate();		// The stored bitrate is also discarded. 
 								warning.setPacketResynced();			// ... And a warning message is sent.
 
 							} else {									// ... But if we are still on track and nothing funny has happened:
@@ -352,30 +356,117 @@ TmChannelWarning TmVirtualChannel::receiveFrame(TmTransferFrame frame)
 								recPointer++;							// And jump to the next Byte.
 								// ... Now the magic:
 								if (recPacket.size() == recPacketLength) {		// If the packet has been completely read:
-									if (recFifo.size() < recPacketBufferSize) { // Check if the input queue can store one more packet.
-										packetAndTimestamp.data = recPacket;	// Store the assembled packet in the joint data structure.
-										recFifo.push(packetAndTimestamp);		// Place the joint data structure in the input queue.
-										recPacket.clear();						// Discard current packet in the pre-buffer.
-										recPacketHeaderLength = 0;
-										recPacketLength = 0;
-										packetTimestamp = TmFrameTimestamp();	// The information stored in the Timestamp instance is discarded. 
-										rawPacketTimestamp = 0.0;
-										warning += this->signalNewPacket();		// And finally, tell the application we have a new packet!
-
-									} else {									// If we have reached the maximum amount of inbound packets, 
-										warning.setRecPacketBufferOverflow();	// throw a warning about the buffer overflow.
-										}
+									packetAndTimestamp.data = recPacket;	// Store the assembled packet in the joint data structure,
+									packetAndTimestamp.timestamp = recPacketTimestamp;	// together with the timestamp of its first Byte
+									packetAndTimestamp.bitrate = recPacketBitrate;		// and the reference bitrate.
+									recBatch.push_back(packetAndTimestamp);	// It is validated together with the other packets of this frame.
+									followLengths = fhpOutOfReach;
+									recPacket.clear();						// Discard current packet in the pre-buffer.
+									recPacketHeaderLength = 0;
+									recPacketLength = 0;
+									recPacketTimestamp = TmFrameTimestamp();	// The information stored in the Timestamp instance is discarded. 
 								}
 								}
 							}
 						}
 				}
+				warning += this->queueReceivedPackets();	// The packets completed in this frame are validated and queued.
 				}
 		}
 	}
 	return warning;
 }
 
+// Validates the packets completed in the last received frame and places the valid ones in the input queue.
+TmChannelWarning TmVirtualChannel::queueReceivedPackets()
+{
+	TmChannelWarning warning;
+	uint64_t invalidPackets = 0;
+	for (size_t i = 0; i < recBatch.size(); i++) {
+		if (netProtConf->isIdlePacket(recBatch[i].data[0])) {	// Idle packets spanning frames are reassembled, then dropped.
+			continue;
+		} else if (!netProtConf->validatePacket(recBatch[i].data)) {	// Corrupted packets are dropped.
+			invalidPackets++;
+		} else if (recFifo.size() < recPacketBufferSize) {	// Check if the input queue can store one more packet.
+			recFifo.push(recBatch[i]);					// Place the joint data structure in the input queue.
+			warning += this->signalNewPacket();			// And finally, tell the application we have a new packet!
+		} else {										// If we have reached the maximum amount of inbound packets, 
+			warning.setRecPacketBufferOverflow();		// throw a warning about the buffer overflow.
+		}
+	}
+	if (invalidPackets > 0) {
+		warning.addInvalidPacketsCount(invalidPackets);
+	}
+	recBatch.clear();		// The capacity is kept for the next frame.
+	return warning;
+}
+
+// Checks the settings of a received frame against the VC settings and updates the received frame counter.
+bool TmVirtualChannel::checkReceivedFrame(TmTransferFrame &frame, TmChannelWarning &warning)
+{
+	// Check for frame setting consistency (compares the values of the received frame against the VC settings.)
+	if (frame.getVirtualChannelId() != virtualChannelId) {
+		// warning message
+		warning.setWrongVcid();
+	} else if (frame.getSecondHeaderStatus() != (secondHeaderPresent || frame.getFrameLengthFieldStatus())) {
+		// warning message
+		warning.setWrongSecondHeaderFlag();
+	} else if (frame.getDataFieldSynchronisationStatus() != dataFieldSynchronised) {
+		// warning message
+		warning.setWrongSynchronisationFlag();
+	} else {	
+	
+	// If the consistency check is all hunky dory:
+		if (extendedFrameCountSet) {
+			try {
+				frame.activateExtendedVcFrameCount();	// Reads the SH Data Field to retrieve the 3-Bytes long counter extension.
+			} catch (TmTransferFrameError& e) {
+				// warning message
+				warning.addFrameUnwrapError(string(e.what()));
+			}
+		}
+		
+		// The received frame contents are displayed.
+		// debug frame output
+		if (debugOutput) {
+			cout << "Received " << flush;
+			frame.debugOutput();
+		}
+		
+		// check frame count (the tracker uses a modulus of 2^32 for the extended counter, 256 otherwise)
+		TmSequenceTracker::SequenceStatus sequence = recSequence.update(frame.getVirtualChannelFrameCount());
+		if (sequence == TmSequenceTracker::duplicate) {
+			// warning message
+			warning.addDuplicateFramesCount(1);		// The frame was already received, so it is dropped.
+			return false;
+		} else if (sequence == TmSequenceTracker::outOfOrder) {
+			// warning message
+			warning.addOutOfOrderFramesCount(1);	// The packets of a late frame cannot be reassembled anymore, so it is dropped.
+			return false;
+		} else if ((sequence == TmSequenceTracker::gap) || (sequence == TmSequenceTracker::resync)) {
+			// discard current packet
+			recPacket.clear();
+			recPacketHeaderLength = 0;
+			recPacketLength = 0;
+			
+			if (recSequence.getLastGapLength() > 0) {
+				// warning message
+				warning.addVCLostFramesCount(recSequence.getLastGapLength());
+			}
+		}
+		return true;
+	}
+	return false;
+}
+
+// Updates the VC counters for a received frame which only carries idle data.
+TmChannelWarning TmVirtualChannel::receiveIdleFrame(TmTransferFrame &frame)
+{
+	TmChannelWarning warning;
+	this->checkReceivedFrame(frame, warning);	// There are no packets to extract.
+	return warning;
+}
+
 // Creates a new TM frame, adjusts its settings and populates its Data Field.
 TmTransferFrame TmVirtualChannel::sendFrame(TmFrameTimestamp timestamp)
 {
@@ -387,29 +478,14 @@ TmTransferFrame TmVirtualChannel::sendFrame(TmFrameTimestamp timestamp)
 	TmTransferFrame frame(7);			// TM Frame initialized with the minimum size (seven Bytes).
 
 	try {
-		// First thing to do: Adjust the new frame's properties and settings to match the master- and virtual channel:
-		
-		frame = TmTransferFrame(masterChannel->getFrameLength());	// Redimensions the frame using the settings of the master channel.
-		frame.setVirtualChannelId(virtualChannelId);				// Gets the frame VC ID from the current VC.
-		if (masterChannel->getOcfStatus()) {						
-			frame.activateOcf();									// If specified in the master channel settings, sets the OCF Flag to TRUE.
-		}
-		if (masterChannel->getFecfStatus()) {
-			frame.activateFecf();									// If specified in the master channel settings, sets the FECF Flag to TRUE.
-		}
-		if (secondHeaderPresent) {
-			frame.activateSecondHeader();							// If specified in the VC settings, sets the Secondary Header Flag to TRUE.
-		}
-		if (extendedFrameCountSet) {
-			frame.activateExtendedVcFrameCount();					// If specified in the VC settings, uses an extended frame counter.
-		}
-		if (dataFieldSynchronised) {
-			frame.activateDataFieldSynchronisation();				// If specified in the VC settings, sets the Synchronization Flag to TRUE.
-		}
+		// First thing to do: Take a frame whose properties and settings already match the master- and virtual channel:
+		this->updateSendTemplate();					// Rebuilds the template only if the settings changed.
+		frame = sendTemplate;
 		frame.setVirtualChannelFrameCount(sendFrameCount);			// Gets the current transmitted frame counter.
 		
-		// Important thing to do: calculate the Data Field length.
+		// Important thing to do: look up the Data Field length.
 		frameDataLength = frame.getDataFieldLength();
+		data.reserve(frameDataLength);				// The data vector is allocated only once.
 
 		// If using the Direct Data Field Access (DDFA) method to insert "raw data" in the Data Field:
 		if (directDataFieldAccess) {
@@ -471,23 +547,36 @@ TmTransferFrame TmVirtualChannel::sendFrame(TmFrameTimestamp timestamp)
 				
 				// If there are no more packets to send:
 				else {
+					if (frame.getFrameLengthFieldStatus()) {	// Variable-length frames end after the last packet instead of carrying idle data.
+						uint16_t keptLength = data.empty() ? 1 : data.size();
+						frame.setLength(frame.getLength() - (frameDataLength - keptLength));
+						frameDataLength = keptLength;
+					}
 					if (firstHeaderPointer == TmTransferFrame::fhpNoFirstHeader) {
-						if (data.size() != 0) {		// In case a chunk of a big packet remained in the data vector,
-							firstHeaderPointer = data.size();	// place the FHP to the end of the data...
-						} else {
+						if (data.size() == 0) {
 						// If there was no data at all to send,
 							firstHeaderPointer = TmTransferFrame::fhpOnlyIdleData; // Set the FHP to the predefined pattern to indicate idle contents...
-						}
+						} else if (data.size() < frameDataLength) {	// In case a chunk of a big packet remained in the data vector,
+							firstHeaderPointer = data.size();	// place the FHP to the end of the data...
+						}	// (A shortened frame which ends with the chunk has no idle data to point to.)
+					}
+					// ... And fill the rest of the data vector with idle packets.
+					size_t fillStart = data.size();
+					data.resize(frameDataLength);
+					if (fillStart < frameDataLength) {
+						netProtConf->genIdleFill(&data[fillStart], frameDataLength - fillStart);
 					}
-					// ... And put an idle packet at the end of the data vector. 
-					data.push_back(netProtConf->genIdlePacket());
 				}
 			}
 		}
 
 		// After the data vector has been locked and loaded:
+		if ((firstHeaderPointer > TmTransferFrame::maxFirstHeaderPointer) && (firstHeaderPointer != TmTransferFrame::fhpOnlyIdleData)) {
+			// Beyond the reach of the 11-bit FHP (frames longer than 2048 Bytes): the receiver follows the packet lengths.
+			firstHeaderPointer = TmTransferFrame::fhpNoFirstHeader;
+		}
 		frame.setFirstHeaderPointer(firstHeaderPointer);	// Set the frame FHP as indicated by the previous process.
-		frame.setDataField(data);							// And insert the holy data vector into the Data Field.
+		frame.setDataField(std::move(data));				// And insert the holy data vector into the Data Field.
 
 		if (extendedFrameCountSet) {						// Update the Tx Frame Counter
 			sendFrameCount = (sendFrameCount+1) % ((uint64_t)1<<32); // ((uint64_t)1<<32) = (64-bit wide unsigned int) 2^32
@@ -495,7 +584,10 @@ TmTransferFrame TmVirtualChannel::sendFrame(TmFrameTimestamp timestamp)
 			sendFrameCount = (sendFrameCount+1) % 256;
 		}
 		
-		frame.debugOutput();	// Dissects the frame into its components and displays them.
+		if (debugOutput) {
+			cout << "Sending " << flush;
+			frame.debugOutput();	// Dissects the frame into its components and displays them.
+		}
 
 	} catch (TmTransferFrameError& e) {						// Catch any errors.
 		ostringstream error;
@@ -506,6 +598,42 @@ TmTransferFrame TmVirtualChannel::sendFrame(TmFrameTimestamp timestamp)
 	return frame;	// A new frame has been born under this virtual channel!
 }
 
+// Rebuilds the frame template used by sendFrame() if the master- or virtual channel settings changed.
+void TmVirtualChannel::updateSendTemplate()
+{
+	// The master channel settings can change at any time, so they are compared against the template.
+	if (sendTemplateValid
+			&& (sendTemplate.getLength() == masterChannel->getFrameLength())
+			&& (sendTemplate.getOcfStatus() == masterChannel->getOcfStatus())
+			&& (sendTemplate.getFecfStatus() == masterChannel->getFecfStatus())
+			&& (sendTemplate.getFrameLengthFieldStatus() == masterChannel->getVariableFrameLengthStatus())) {
+		return;
+	}
+
+	TmTransferFrame frame(masterChannel->getFrameLength());	// Dimensions the frame using the settings of the master channel.
+	frame.setVirtualChannelId(virtualChannelId);				// Gets the frame VC ID from the current VC.
+	if (masterChannel->getOcfStatus()) {
+		frame.activateOcf();									// If specified in the master channel settings, sets the OCF Flag to TRUE.
+	}
+	if (masterChannel->getFecfStatus()) {
+		frame.activateFecf();									// If specified in the master channel settings, sets the FECF Flag to TRUE.
+	}
+	if (masterChannel->getVariableFrameLengthStatus()) {
+		frame.activateFrameLengthField();						// Variable-length frames carry their length in the Secondary Header.
+	}
+	if (secondHeaderPresent) {
+		frame.activateSecondHeader();							// If specified in the VC settings, sets the Secondary Header Flag to TRUE.
+	}
+	if (extendedFrameCountSet) {
+		frame.activateExtendedVcFrameCount();					// If specified in the VC settings, uses an extended frame counter.
+	}
+	if (dataFieldSynchronised) {
+		frame.activateDataFieldSynchronisation();				// If specified in the VC settings, sets the Synchronization Flag to TRUE.
+	}
+	sendTemplate = frame;
+	sendTemplateValid = true;
+}
+
 // Establishes the sink where OCF messages are received (GroundPacketServer instance).
 void TmVirtualChannel::connectPacketSink(GroundPacketServer *sink)
 {
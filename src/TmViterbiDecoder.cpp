@@ -0,0 +1,356 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "TmViterbiDecoder.h"
+#include "TmConvolutionalEncoder.h"
+#include "myErrors.h"
+
+#include <vector>
+#include <sstream>
+#include <stdint.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+const uint16_t TmViterbiDecoder::stateCount;
+const size_t TmViterbiDecoder::defaultTracebackDepth;
+const size_t TmViterbiDecoder::blockLength;
+const uint8_t TmViterbiDecoder::erasedSymbol;
+const size_t TmViterbiDecoder::phaseWindowLength;
+const uint16_t TmViterbiDecoder::defaultPhaseThreshold;
+
+// Expected symbols of the butterflies, as 0 or 255 per state: [inverted G2][G1 or G2][old state 0 to 31 with input 0].
+// Old state i + 32 and input 1 give the complemented symbols, since both polynomials use the newest and the oldest bit.
+static const int16_t (*butterflyTable())[2][32]
+{
+	static int16_t table[2][2][32];
+	for (int invert = 0; invert < 2; invert++) {
+		for (int state = 0; state < 32; state++) {
+			int reg = state << 1;
+			table[invert][0][state] = __builtin_parity(reg & TmConvolutionalEncoder::polynomialG1) ? 255 : 0;
+			table[invert][1][state] = (__builtin_parity(reg & TmConvolutionalEncoder::polynomialG2) ^ invert) ? 255 : 0;
+		}
+	}
+	return table;
+}
+static const int16_t (*butterflies)[2][32] = butterflyTable();
+
+// Constructor of the TmViterbiDecoder class.
+TmViterbiDecoder::TmViterbiDecoder(size_t tracebackDepth)
+{
+	if (tracebackDepth < 32) {
+		ostringstream error;
+		error << "Traceback depth too short (" << dec << tracebackDepth << " bits, min. 32)." << endl;
+		throw TmViterbiDecoderError(error.str());
+	}
+	this->tracebackDepth = tracebackDepth;
+	invertSecondSymbol = true;
+	autoPhase = true;
+	phaseThreshold = defaultPhaseThreshold;
+	metricGrowth = 0;
+	stepCount = 0;
+	releasedBitCount = 0;
+	phaseFlipCount = 0;
+	droppedSymbolCount = 0;
+	this->reset();
+}
+
+// Sets the inversion flag of the G2 symbol.
+void TmViterbiDecoder::setInvertSecondSymbol(bool invert)
+{
+	invertSecondSymbol = invert;
+}
+
+// Retrieves the inversion flag of the G2 symbol.
+bool TmViterbiDecoder::getInvertSecondSymbol()
+{
+	return invertSecondSymbol;
+}
+
+// Retrieves the traceback depth in bits.
+size_t TmViterbiDecoder::getTracebackDepth()
+{
+	return tracebackDepth;
+}
+
+// Selects whether the symbol pairing is switched automatically when the metric growth shows the wrong one.
+void TmViterbiDecoder::setAutoPhase(bool active)
+{
+	autoPhase = active;
+}
+
+// Retrieves whether the symbol pairing is switched automatically.
+bool TmViterbiDecoder::getAutoPhase()
+{
+	return autoPhase;
+}
+
+// Sets the metric growth (percent) above which the symbol pairing is taken for the wrong one.
+void TmViterbiDecoder::setPhaseThreshold(uint16_t threshold)
+{
+	phaseThreshold = threshold;
+}
+
+// Retrieves the metric growth (percent) above which the symbol pairing is taken for the wrong one.
+uint16_t TmViterbiDecoder::getPhaseThreshold()
+{
+	return phaseThreshold;
+}
+
+// Shifts the symbol pairing by one symbol.
+void TmViterbiDecoder::flipPhase()
+{
+	bool pending = symbolPending;
+	droppedSymbolCount += 2 * (decisions.size() + partialBits) + 1;	// Steps not released, bits short of a Byte and the shift.
+	this->reset();					// The survivors of the wrong pairing are worthless.
+	skipSymbol = !pending;			// A pending G1 symbol was really a G2 symbol and is dropped; otherwise the next one is.
+	phaseFlipCount++;
+}
+
+// Forgets the path metrics, the survivors and any bits not released yet.
+void TmViterbiDecoder::reset()
+{
+	memset(metrics, 0, sizeof(metrics));	// Any state may be the first one.
+	decisions.clear();
+	decisions.reserve(tracebackDepth + blockLength);
+	symbolPending = false;
+	skipSymbol = false;
+	partialByte = 0;
+	partialBits = 0;
+	phaseGrowth = 0;
+	phaseConfidence = 0;
+	phaseSteps = 0;
+}
+
+// Decodes soft symbols.
+void TmViterbiDecoder::decode(const uint8_t *symbols, size_t count, vector<uint8_t> &output)
+{
+	size_t i = 0;
+	while (i < count) {
+		if (skipSymbol) {					// The symbol pairing was shifted.
+			skipSymbol = false;
+			i++;
+			continue;
+		}
+		size_t steps = 1;
+		if (symbolPending) {				// The symbol pair started in the last call.
+			this->addCompareSelect(pendingSymbol, symbols[i]);
+			symbolPending = false;
+			i++;
+		} else if (i + 1 < count) {
+			// Runs up to the end of the metric window or of the traceback block, whichever comes first.
+			steps = (count - i) / 2;
+			steps = (steps < phaseWindowLength - phaseSteps) ? steps : phaseWindowLength - phaseSteps;
+			size_t room = tracebackDepth + blockLength - decisions.size();
+			steps = (steps < room) ? steps : room;
+			for (size_t n = 0; n < steps; n++, i += 2) {
+				this->addCompareSelect(symbols[i], symbols[i + 1]);
+			}
+		} else {
+			pendingSymbol = symbols[i];
+			symbolPending = true;
+			break;
+		}
+		phaseSteps += steps;
+		if ((phaseSteps == phaseWindowLength) && this->checkPhase()) {
+			continue;						// The pairing was shifted; the survivors are gone.
+		}
+		if (decisions.size() >= tracebackDepth + blockLength) {
+			this->traceback(blockLength, output);
+		}
+	}
+}
+
+// Decodes hard-decision symbols packed into Bytes.
+void TmViterbiDecoder::decodeHardSymbols(const uint8_t *data, size_t length, vector<uint8_t> &output)
+{
+	uint8_t soft[1024];
+	while (length > 0) {
+		size_t chunk = (length < sizeof(soft) / 8) ? length : sizeof(soft) / 8;
+		for (size_t i = 0; i < 8 * chunk; i++) {
+			soft[i] = ((data[i / 8] >> (7 - i % 8)) & 1) ? 255 : 0;
+		}
+		this->decode(soft, 8 * chunk, output);
+		data += chunk;
+		length -= chunk;
+	}
+}
+
+// Releases all decoded bits at the end of a pass.
+void TmViterbiDecoder::flush(vector<uint8_t> &output)
+{
+	this->traceback(decisions.size(), output);
+	if (partialBits > 0) {
+		output.push_back((partialByte << (8 - partialBits)) & 0xFF);
+		partialByte = 0;
+		partialBits = 0;
+	}
+}
+
+// Retrieves the number of symbol pairs decoded.
+uint64_t TmViterbiDecoder::getStepCount()
+{
+	return stepCount;
+}
+
+// Retrieves the number of bits released.
+uint64_t TmViterbiDecoder::getReleasedBitCount()
+{
+	return releasedBitCount;
+}
+
+// Retrieves the metric growth (percent) of the last complete window.
+uint16_t TmViterbiDecoder::getMetricGrowth()
+{
+	return metricGrowth;
+}
+
+// Retrieves the number of times the symbol pairing was shifted.
+uint64_t TmViterbiDecoder::getPhaseFlipCount()
+{
+	return phaseFlipCount;
+}
+
+// Retrieves the number of symbols dropped by shifts of the symbol pairing.
+uint64_t TmViterbiDecoder::getDroppedSymbolCount()
+{
+	return droppedSymbolCount;
+}
+
+// Evaluates the metric growth of a complete window and shifts the symbol pairing if it is too high.
+bool TmViterbiDecoder::checkPhase()
+{
+	metricGrowth = (uint16_t) ((phaseConfidence > 0) ? (100 * phaseGrowth + phaseConfidence / 2) / phaseConfidence : 0);
+	phaseGrowth = 0;
+	phaseConfidence = 0;
+	phaseSteps = 0;
+	if (autoPhase && (metricGrowth > phaseThreshold)) {
+		this->flipPhase();
+		return true;
+	}
+	return false;
+}
+
+// Runs one step of the trellis and stores the survivor decisions.
+void TmViterbiDecoder::addCompareSelect(uint8_t symbol1, uint8_t symbol2)
+{
+	// Butterfly i: old states i and i + 32 lead to new states 2i (input 0) and 2i + 1 (input 1). The branch metric of
+	// old state i with input 0 is the distance of the symbols to the expected ones; the other three are it or its complement.
+	const int16_t (*expected)[32] = butterflies[invertSecondSymbol ? 1 : 0];
+	int16_t next[stateCount];
+	uint64_t decision = 0;			// Bit n set: new state n came from old state n / 2 + 32.
+#ifdef __SSE2__
+	const __m128i soft1 = _mm_set1_epi16(symbol1);
+	const __m128i soft2 = _mm_set1_epi16(symbol2);
+	const __m128i maxMetric = _mm_set1_epi16(510);
+	__m128i best = _mm_set1_epi16(0x7FFF);
+	for (int g = 0; g < 4; g++) {	// 8 butterflies at a time.
+		__m128i metric = _mm_add_epi16(_mm_xor_si128(soft1, _mm_loadu_si128((const __m128i *) &expected[0][8 * g])),
+				_mm_xor_si128(soft2, _mm_loadu_si128((const __m128i *) &expected[1][8 * g])));
+		__m128i complement = _mm_sub_epi16(maxMetric, metric);
+		__m128i low = _mm_loadu_si128((const __m128i *) &metrics[8 * g]);
+		__m128i high = _mm_loadu_si128((const __m128i *) &metrics[8 * g + 32]);
+
+		__m128i even0 = _mm_add_epi16(low, metric);
+		__m128i even1 = _mm_add_epi16(high, complement);
+		__m128i odd0 = _mm_add_epi16(low, complement);
+		__m128i odd1 = _mm_add_epi16(high, metric);
+		__m128i even = _mm_min_epi16(even0, even1);
+		__m128i odd = _mm_min_epi16(odd0, odd1);
+		__m128i evenDecision = _mm_cmpgt_epi16(even0, even1);
+		__m128i oddDecision = _mm_cmpgt_epi16(odd0, odd1);
+		best = _mm_min_epi16(best, _mm_min_epi16(even, odd));
+
+		// New states 16g to 16g + 15 alternate between even and odd.
+		_mm_storeu_si128((__m128i *) &next[16 * g], _mm_unpacklo_epi16(even, odd));
+		_mm_storeu_si128((__m128i *) &next[16 * g + 8], _mm_unpackhi_epi16(even, odd));
+		uint32_t bits = _mm_movemask_epi8(_mm_packs_epi16(_mm_unpacklo_epi16(evenDecision, oddDecision),
+				_mm_unpackhi_epi16(evenDecision, oddDecision)));
+		decision |= (uint64_t) bits << (16 * g);
+	}
+	best = _mm_min_epi16(best, _mm_shuffle_epi32(best, _MM_SHUFFLE(1, 0, 3, 2)));
+	best = _mm_min_epi16(best, _mm_shuffle_epi32(best, _MM_SHUFFLE(2, 3, 0, 1)));
+	best = _mm_min_epi16(best, _mm_shufflelo_epi16(best, _MM_SHUFFLE(2, 3, 0, 1)));
+	const __m128i reference = _mm_shuffle_epi32(_mm_shufflelo_epi16(best, 0), 0);
+	for (int g = 0; g < 8; g++) {	// Normalized to the best state: the spread of the metrics is bounded, the values are not.
+		_mm_storeu_si128((__m128i *) &metrics[8 * g], _mm_sub_epi16(_mm_loadu_si128((const __m128i *) &next[8 * g]), reference));
+	}
+	int16_t growth = (int16_t) _mm_cvtsi128_si32(best);	// The best path metric grew by this much.
+#else
+	for (int i = 0; i < 32; i++) {
+		int16_t metric = (symbol1 ^ expected[0][i]) + (symbol2 ^ expected[1][i]);
+		int16_t complement = 510 - metric;
+		int16_t even0 = metrics[i] + metric;
+		int16_t even1 = metrics[i + 32] + complement;
+		int16_t odd0 = metrics[i] + complement;
+		int16_t odd1 = metrics[i + 32] + metric;
+		next[2 * i] = (even0 > even1) ? even1 : even0;
+		next[2 * i + 1] = (odd0 > odd1) ? odd1 : odd0;
+		decision |= ((uint64_t) (even0 > even1) << (2 * i)) | ((uint64_t) (odd0 > odd1) << (2 * i + 1));
+	}
+	int16_t reference = next[0];
+	for (int n = 1; n < stateCount; n++) {
+		reference = (next[n] < reference) ? next[n] : reference;
+	}
+	for (int n = 0; n < stateCount; n++) {
+		metrics[n] = next[n] - reference;
+	}
+	int16_t growth = reference;		// The best path metric grew by this much.
+#endif
+	// No branch can match the symbols better than their own hard decisions: only the growth beyond that counts.
+	int16_t floor = (symbol1 ^ ((0 - (symbol1 >> 7)) & 0xFF)) + (symbol2 ^ ((0 - (symbol2 >> 7)) & 0xFF));	// min(s, 255 - s) each.
+	phaseGrowth += growth - floor;
+	phaseConfidence += 255 - floor;		// Twice the distance of both symbols from an erasure.
+	decisions.push_back(decision);
+	stepCount++;
+}
+
+// Traces the survivors back and releases the oldest bits.
+void TmViterbiDecoder::traceback(size_t count, vector<uint8_t> &output)
+{
+	if (count == 0) {
+		return;
+	}
+	uint16_t state = 0;
+	for (uint16_t n = 1; n < stateCount; n++) {	// The best state at the end of the trellis.
+		if (metrics[n] < metrics[state]) {
+			state = n;
+		}
+	}
+	for (size_t t = decisions.size(); t > count; t--) {
+		state = (state >> 1) | (((decisions[t - 1] >> state) & 1) << 5);
+	}
+	vector<uint8_t> bits(count);
+	for (size_t t = count; t > 0; t--) {
+		bits[t - 1] = state & 1;				// The newest bit of a state is the decoded bit.
+		state = (state >> 1) | (((decisions[t - 1] >> state) & 1) << 5);
+	}
+	for (size_t t = 0; t < count; t++) {
+		partialByte = (partialByte << 1) | bits[t];
+		if (++partialBits == 8) {
+			output.push_back(partialByte & 0xFF);
+			partialByte = 0;
+			partialBits = 0;
+		}
+	}
+	decisions.erase(decisions.begin(), decisions.begin() + count);
+	releasedBitCount += count;
+}
@@ -0,0 +1,211 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "TmViterbiWorker.h"
+#include "TmViterbiDecoder.h"
+#include "TmFrameSynchronizer.h"
+#include "myErrors.h"
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <sstream>
+#include <stdint.h>
+#include <math.h>
+#include <boost/thread.hpp>
+
+using namespace std;
+
+const size_t TmViterbiWorker::defaultQueueLength;
+
+// Constructor of the TmViterbiWorker class.
+TmViterbiWorker::TmViterbiWorker(TmViterbiDecoder *decoder, TmFrameSynchronizer *synchronizer, size_t queueLength)
+{
+	if ((decoder == NULL) || (synchronizer == NULL)) {
+		throw TmViterbiDecoderError("The worker needs a decoder and a frame synchronizer.\n");
+	}
+	this->decoder = decoder;
+	this->synchronizer = synchronizer;
+	this->queueLength = (queueLength > 0) ? queueLength : 1;
+	running = false;
+	stopRequested = false;
+	symbolCount = 0;
+	decodedByteCount = 0;
+}
+
+// Destructor of the TmViterbiWorker class.
+TmViterbiWorker::~TmViterbiWorker()
+{
+	this->stop();
+}
+
+// Starts the worker thread.
+void TmViterbiWorker::start()
+{
+	boost::mutex::scoped_lock lock(mutex);
+	if (running) {
+		return;
+	}
+	running = true;
+	stopRequested = false;
+	thread = boost::thread(&TmViterbiWorker::run, this);
+}
+
+// Decodes the queued symbols, flushes the decoder and stops the worker thread.
+void TmViterbiWorker::stop()
+{
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		if (!running) {
+			return;
+		}
+		stopRequested = true;
+		queueChanged.notify_all();
+	}
+	thread.join();
+	boost::mutex::scoped_lock lock(mutex);
+	running = false;
+}
+
+// Indicates whether the worker thread runs.
+bool TmViterbiWorker::isRunning()
+{
+	boost::mutex::scoped_lock lock(mutex);
+	return running;
+}
+
+// Queues a chunk of soft symbols for decoding.
+void TmViterbiWorker::pushSymbols(const uint8_t *symbols, size_t count, TmFrameTimestamp timestamp, TmFrameBitrate symbolRate)
+{
+	if (count == 0) {
+		return;
+	}
+	SymbolChunk chunk;
+	chunk.symbols.assign(symbols, symbols + count);		// Copied outside the lock.
+	chunk.timestamp = timestamp;
+	chunk.symbolRate = symbolRate;
+
+	boost::mutex::scoped_lock lock(mutex);
+	if (!running || stopRequested) {
+		throw TmViterbiDecoderError("Symbols pushed while the worker thread does not run.\n");
+	}
+	while (queue.size() >= queueLength) {			// Throttles the receiver.
+		queueChanged.wait(lock);
+	}
+	queue.push_back(SymbolChunk());
+	queue.back().symbols.swap(chunk.symbols);
+	queue.back().timestamp = chunk.timestamp;
+	queue.back().symbolRate = chunk.symbolRate;
+	queueChanged.notify_all();
+}
+
+// Retrieves the warnings collected since the last call and clears them.
+TmChannelWarning TmViterbiWorker::popWarnings()
+{
+	boost::mutex::scoped_lock lock(mutex);
+	TmChannelWarning collected = warnings;
+	warnings = TmChannelWarning();
+	return collected;
+}
+
+// Retrieves the number of decoded Bytes passed to the synchronizer.
+uint64_t TmViterbiWorker::getDecodedByteCount()
+{
+	boost::mutex::scoped_lock lock(mutex);
+	return decodedByteCount;
+}
+
+// Main loop of the worker thread.
+void TmViterbiWorker::run()
+{
+	SymbolChunk chunk;
+	vector<uint8_t> decoded;
+	while (true) {
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			while (queue.empty() && !stopRequested) {
+				queueChanged.wait(lock);
+			}
+			if (queue.empty()) {					// Stop requested and nothing left.
+				break;
+			}
+			chunk.symbols.swap(queue.front().symbols);
+			chunk.timestamp = queue.front().timestamp;
+			chunk.symbolRate = queue.front().symbolRate;
+			queue.pop_front();
+			queueChanged.notify_all();
+		}
+
+		ChunkTime chunkTime;
+		chunkTime.firstSymbol = symbolCount;
+		chunkTime.timestamp = chunk.timestamp;
+		chunkTime.symbolRate = chunk.symbolRate;
+		chunkTimes.push_back(chunkTime);
+		symbolCount += chunk.symbols.size();
+
+		decoded.clear();
+		uint64_t phaseFlipCount = decoder->getPhaseFlipCount();
+		decoder->decode(&chunk.symbols[0], chunk.symbols.size(), decoded);
+		if (decoder->getPhaseFlipCount() != phaseFlipCount) {
+			ostringstream message;
+			message << "Viterbi decoder shifted the symbol pairing (" << dec << decoder->getPhaseFlipCount() << " shifts so far)." << endl;
+			boost::mutex::scoped_lock lock(mutex);
+			warnings.appendFreeMessage(message.str());
+		}
+		this->passData(decoded);
+	}
+	decoded.clear();
+	decoder->flush(decoded);
+	this->passData(decoded);
+}
+
+// Passes decoded Bytes to the synchronizer with the timestamp of their first bit.
+void TmViterbiWorker::passData(vector<uint8_t> &data)
+{
+	if (data.empty()) {
+		return;
+	}
+	uint64_t firstSymbol = 16 * decodedByteCount + decoder->getDroppedSymbolCount();	// Two symbols per decoded bit.
+	while ((chunkTimes.size() > 1) && (chunkTimes[1].firstSymbol <= firstSymbol)) {
+		chunkTimes.pop_front();
+	}
+
+	TmFrameTimestamp timestamp;
+	TmFrameBitrate bitrate;
+	if (!chunkTimes.empty() && chunkTimes.front().symbolRate.isValid() && (chunkTimes.front().symbolRate.getBitrate() > 0.0)) {
+		double symbolRate = chunkTimes.front().symbolRate.getBitrate();
+		bitrate.setBitrate(symbolRate / 2.0);
+		TmFrameTimestamp chunkTimestamp = chunkTimes.front().timestamp;
+		if (chunkTimestamp.isValid()) {			// The chunk timestamp is advanced to the first decoded bit.
+			double time = chunkTimestamp.getFractions() + (double) (firstSymbol - chunkTimes.front().firstSymbol) / symbolRate;
+			double whole = floor(time);
+			timestamp.setSeconds(chunkTimestamp.getSeconds() + (uint64_t) whole);
+			timestamp.setFractions(time - whole);
+		}
+	}
+
+	TmChannelWarning warning;
+	try {
+		warning = synchronizer->receiveData(&data[0], data.size(), timestamp, bitrate);
+	} catch (runtime_error &error) {		// Nobody would catch it on this thread.
+		warning.appendFreeMessage(error.what());
+	}
+	boost::mutex::scoped_lock lock(mutex);
+	decodedByteCount += data.size();
+	warnings += warning;
+}
@@ -29,6 +29,9 @@ TmChannelWarning::TmChannelWarning()
 	frameUnwrapError.clear();
 	lostMCFrames = 0;
 	lostVCFrames = 0;
+	duplicateFrames = 0;
+	outOfOrderFrames = 0;
+	invalidPackets = 0;
 	packetResync = false;
 	noPacketSinkSpecified = false;
 	noOcfSinkSpecified = false;
@@ -52,6 +55,9 @@ TmChannelWarning & TmChannelWarning::operator+=(const TmChannelWarning &rhs)
 	frameUnwrapError += rhs.frameUnwrapError;
 	lostMCFrames += rhs.lostMCFrames;
 	lostVCFrames += rhs.lostVCFrames;
+	duplicateFrames += rhs.duplicateFrames;
+	outOfOrderFrames += rhs.outOfOrderFrames;
+	invalidPackets += rhs.invalidPackets;
 	
 	packetResync |= rhs.packetResync;
 	noPacketSinkSpecified |= rhs.noPacketSinkSpecified;
@@ -96,6 +102,24 @@ void TmChannelWarning::addVCLostFramesCount(uint64_t count)
 	lostVCFrames += count;
 }
 
+// Accumulates the ammount of dropped duplicate frames.
+void TmChannelWarning::addDuplicateFramesCount(uint64_t count)
+{
+	duplicateFrames += count;
+}
+
+// Accumulates the ammount of dropped frames which arrived out of order.
+void TmChannelWarning::addOutOfOrderFramesCount(uint64_t count)
+{
+	outOfOrderFrames += count;
+}
+
+// Accumulates the ammount of dropped packets with a wrong packet error control field.
+void TmChannelWarning::addInvalidPacketsCount(uint64_t count)
+{
+	invalidPackets += count;
+}
+
 // Sets the packetResync flag to TRUE.
 void TmChannelWarning::setPacketResynced()
 {
@@ -195,6 +219,15 @@ string TmChannelWarning::popWarning()
 	} else if (lostVCFrames > 0) {
 		msg << "Lost " << dec << lostVCFrames << " virtual channel frames.";
 		lostVCFrames = 0;
+	} else if (duplicateFrames > 0) {
+		msg << "Dropped " << dec << duplicateFrames << " duplicate frames.";
+		duplicateFrames = 0;
+	} else if (outOfOrderFrames > 0) {
+		msg << "Dropped " << dec << outOfOrderFrames << " out-of-order frames.";
+		outOfOrderFrames = 0;
+	} else if (invalidPackets > 0) {
+		msg << "Dropped " << dec << invalidPackets << " invalid packets.";
+		invalidPackets = 0;
 	} else if (packetResync) {
 		msg << "Packet resync.";
 		packetResync = false;
@@ -244,6 +277,9 @@ bool TmChannelWarning::warningAvailable()
 	return ( !frameUnwrapError.empty()
 		|| (lostMCFrames > 0)
 		|| (lostVCFrames > 0)
+		|| (duplicateFrames > 0)
+		|| (outOfOrderFrames > 0)
+		|| (invalidPackets > 0)
 		|| packetResync
 		|| noPacketSinkSpecified
 		|| noOcfSinkSpecified
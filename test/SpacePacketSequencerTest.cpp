@@ -0,0 +1,125 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <tmtp/Tmtp.h>
+#include <tmtp/TmtpPacket.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Reports a failed check and remembers it.
+static int failures = 0;
+static void check(bool condition, const string &what)
+{
+	if (!condition) {
+		cerr << "FAILED: " << what << endl;
+		failures++;
+	}
+}
+
+// Builds a Space Packet of APID 1 with the given grouping flags, sequence count and data.
+static TimeTaggedPacket makePacket(uint16_t groupingFlags, uint16_t count, const string &text)
+{
+	TimeTaggedPacket packet;
+	packet.data.push_back(0x00);
+	packet.data.push_back(0x01);
+	packet.data.push_back((groupingFlags << 6) | ((count >> 8) & 0x3F));
+	packet.data.push_back(count & 0xFF);
+	packet.data.push_back(((text.size() - 1) >> 8) & 0xFF);
+	packet.data.push_back((text.size() - 1) & 0xFF);
+	packet.data.insert(packet.data.end(), text.begin(), text.end());
+	return packet;
+}
+
+// Takes the next unit from the sequencer and returns its data, or an empty string if there is none.
+static string nextUnit(SpacePacketSequencer &sequencer, uint16_t &segments)
+{
+	segments = 0;
+	if (!sequencer.aduAvailable()) {
+		return string();
+	}
+	ApplicationDataUnit adu = sequencer.receiveAdu();
+	segments = adu.segments;
+	return string(adu.data.begin(), adu.data.end());
+}
+
+// A late packet arriving while a segmented unit is reassembled leaves the unit alone.
+static void testLatePacket(uint16_t lateGroupingFlags)
+{
+	SpacePacketConf conf;
+	SpacePacketSequencer sequencer(&conf);
+	ostringstream name;
+	name << "late packet with grouping flags " << lateGroupingFlags << ": ";
+
+	check(sequencer.processPacket(makePacket(SpacePacketConf::unsegmented, 2, "a")) == TmSequenceTracker::firstCount,
+		name.str() + "first count");
+	check(sequencer.processPacket(makePacket(SpacePacketConf::unsegmented, 4, "b")) == TmSequenceTracker::gap,
+		name.str() + "count 3 lost");
+	check(sequencer.processPacket(makePacket(SpacePacketConf::firstSegment, 5, "c")) == TmSequenceTracker::inSequence,
+		name.str() + "first segment");
+	check(sequencer.processPacket(makePacket(SpacePacketConf::continuationSegment, 6, "d")) == TmSequenceTracker::inSequence,
+		name.str() + "continuation segment");
+	check(sequencer.processPacket(makePacket(lateGroupingFlags, 3, "x")) == TmSequenceTracker::outOfOrder,
+		name.str() + "count 3 arrives late");
+	check(sequencer.processPacket(makePacket(SpacePacketConf::lastSegment, 7, "e")) == TmSequenceTracker::inSequence,
+		name.str() + "last segment");
+
+	uint16_t segments = 0;
+	check(nextUnit(sequencer, segments) == "a", name.str() + "first unit");
+	check(nextUnit(sequencer, segments) == "b", name.str() + "unit after the gap");
+	if (lateGroupingFlags == SpacePacketConf::unsegmented) {
+		check(nextUnit(sequencer, segments) == "x", name.str() + "late packet is a unit of its own");
+		check(sequencer.getLateSegmentCount(1) == 0, name.str() + "no late segment");
+	} else {
+		check(sequencer.getLateSegmentCount(1) == 1, name.str() + "late segment is dropped");
+	}
+	check(nextUnit(sequencer, segments) == "cde", name.str() + "segmented unit is delivered");
+	check(segments == 3, name.str() + "segmented unit has three segments");
+	check(!sequencer.aduAvailable(), name.str() + "no further unit");
+	check(sequencer.getIncompleteCount(1) == 0, name.str() + "segmented unit is not incomplete");
+	check(sequencer.getLostCount(1) == 0, name.str() + "late packet is not lost");
+	check(sequencer.getOutOfOrderCount(1) == 1, name.str() + "late packet is out of order");
+}
+
+// Packets too short to carry data are malformed, not duplicates.
+static void testMalformedPacket()
+{
+	SpacePacketConf conf;
+	SpacePacketSequencer sequencer(&conf);
+	TimeTaggedPacket packet = makePacket(SpacePacketConf::unsegmented, 0, "a");
+	packet.data.resize(6);
+	check(sequencer.processPacket(packet) == TmSequenceTracker::malformed, "header without data is malformed");
+	check(sequencer.getMalformedCount() == 1, "malformed packet is counted");
+	check(sequencer.getDuplicateCount(1) == 0, "malformed packet is no duplicate");
+	check(sequencer.getPacketCount(1) == 0, "malformed packet is not accepted");
+	check(!sequencer.aduAvailable(), "malformed packet is dropped");
+}
+
+int main()
+{
+	testLatePacket(SpacePacketConf::unsegmented);
+	testLatePacket(SpacePacketConf::continuationSegment);
+	testMalformedPacket();
+
+	cerr << (failures ? "FAILED" : "PASSED") << endl;
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,167 @@
+/**
+        Copyright 2013 Institute for Communications and Navigation, TUM
+
+        This file is part of tmtp.
+
+tmtp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+any later version.
+
+tmtp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with tmtp. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <tmtp/Tmtp.h>
+#include <tmtp/TmtpPacket.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Reports a failed check and remembers it.
+static int failures = 0;
+static void check(bool condition, const string &what)
+{
+	if (!condition) {
+		cerr << "FAILED: " << what << endl;
+		failures++;
+	}
+}
+
+// Counts behind the expected one: duplicates close by, a gap beyond the duplicate window.
+static void testTracker()
+{
+	TmSequenceTracker tracker(256);
+	check(tracker.update(10) == TmSequenceTracker::firstCount, "first count");
+	check(tracker.update(11) == TmSequenceTracker::inSequence, "count in sequence");
+	check(tracker.update(11) == TmSequenceTracker::duplicate, "repeated count is a duplicate");
+	check(tracker.update(14) == TmSequenceTracker::gap, "skipped counts are a gap");
+	check(tracker.update(13) == TmSequenceTracker::outOfOrder, "late count within the gap");
+
+	// 200 counts skipped: the counter is 56 behind the expected one modulo 256.
+	check(tracker.update(215) == TmSequenceTracker::gap, "jump of 200 counts is a gap");
+	check(tracker.getLastGapLength() == 200, "jump of 200 counts loses 200 frames");
+	check(tracker.update(216) == TmSequenceTracker::inSequence, "sequence continues after the jump");
+
+	// Exactly half the counter skipped.
+	check(tracker.update(89) == TmSequenceTracker::gap, "jump of 128 counts is a gap");
+	check(tracker.getLastGapLength() == 128, "jump of 128 counts loses 128 frames");
+	check(tracker.getLostCount() == 1 + 200 + 128, "lost counts accumulate");
+	check(tracker.getDuplicateCount() == 1, "only the repeated count is a duplicate");
+
+	// A restart within the duplicate window resyncs and loses the frames dropped meanwhile.
+	tracker.reset();
+	check(tracker.update(87) == TmSequenceTracker::firstCount, "first count after a reset");
+	check(tracker.update(88) == TmSequenceTracker::inSequence, "count in sequence");
+	check(tracker.update(85) == TmSequenceTracker::duplicate, "restart behind the expected count");
+	check(tracker.update(86) == TmSequenceTracker::duplicate, "restart behind the expected count");
+	check(tracker.update(87) == TmSequenceTracker::resync, "restart is accepted after the resync threshold");
+	check(tracker.getLastGapLength() == 2, "frames dropped before the resync are lost");
+	check(tracker.getDuplicateCount() == 0, "frames dropped before the resync are no duplicates");
+
+	// A late frame received twice is a duplicate the second time.
+	tracker.reset();
+	check(tracker.update(20) == TmSequenceTracker::firstCount, "first count after a reset");
+	check(tracker.update(24) == TmSequenceTracker::gap, "three counts skipped");
+	check(tracker.update(22) == TmSequenceTracker::outOfOrder, "late count within the gap");
+	check(tracker.update(22) == TmSequenceTracker::duplicate, "repeated late count is a duplicate");
+	check(tracker.update(21) == TmSequenceTracker::outOfOrder, "other late count within the gap");
+	check(tracker.getLostCount() == 1, "only the count never received is lost");
+	check(tracker.getOutOfOrderCount() == 2, "each late count is out of order once");
+	check(tracker.getDuplicateCount() == 1, "the repeated late count is a duplicate");
+
+	// A 32-bit counter jumping back is a restart, not a gap of almost 2^32 frames.
+	TmSequenceTracker extended(4294967296ULL);
+	check(extended.update(5000) == TmSequenceTracker::firstCount, "first count of a 32-bit counter");
+	check(extended.update(4000) == TmSequenceTracker::resync, "jump back of a 32-bit counter is a resync");
+	check(extended.getLastGapLength() == 0, "jump back of a 32-bit counter loses no frames");
+	check(extended.getLostCount() == 0, "jump back of a 32-bit counter loses no frames");
+	check(extended.update(4001) == TmSequenceTracker::inSequence, "sequence continues after the jump back");
+}
+
+// Sends frames through a physical channel and drops a run of them in between.
+static void testChannelGap(uint16_t dropped)
+{
+	TestProtConf conf;
+	TmPhysicalChannel sendPc(1115), recPc(1115);
+	TmMasterChannel *sendMc = sendPc.createTmMasterChannel(102);
+	TmMasterChannel *recMc = recPc.createTmMasterChannel(102);
+	sendMc->deactivateOcf();
+	recMc->deactivateOcf();
+	TmVirtualChannel *sendVc = sendMc->createTmVirtualChannel(1);
+	TmVirtualChannel *recVc = recMc->createTmVirtualChannel(1);
+	sendVc->setNetProtConf(&conf);
+	recVc->setNetProtConf(&conf);
+
+	ostringstream name, mcText, vcText;
+	name << "gap of " << dropped << " frames: ";
+	mcText << "Lost " << dropped << " master channel frames.";
+	vcText << "Lost " << dropped << " virtual channel frames.";
+	unsigned mcLost = 0, vcLost = 0, duplicates = 0;
+	size_t packetsBefore = 0, packets = 0;
+	for (unsigned i = 0; i < 20u + dropped; i++) {
+		vector<uint8_t> message(500, 'a' + i % 26);
+		while (!sendVc->frameAvailable()) {
+			sendVc->sendPacket(conf.genTestPacket(message));
+		}
+		TmFrameTimestamp timestamp;
+		vector<uint8_t> raw = sendPc.sendFrame(timestamp);
+		if ((i >= 10) && (i < 10u + dropped)) {
+			continue;		// Lost on the link.
+		}
+		TmFrameBitrate bitrate;
+		TmChannelWarning warning = recPc.receiveFrame(raw, timestamp, bitrate);
+		while (warning.warningAvailable()) {
+			string text = warning.popWarning();
+			if (text == mcText.str()) {
+				mcLost += dropped;
+			} else if (text == vcText.str()) {
+				vcLost += dropped;
+			} else if (text.find("Lost") != string::npos) {
+				check(false, name.str() + text);
+			} else if (text.find("uplicate") != string::npos) {
+				duplicates++;
+			}
+		}
+		while (recVc->packetAvailable()) {
+			recVc->receivePacket();
+			packets++;
+		}
+		if (i == 9) {
+			packetsBefore = packets;
+		}
+	}
+
+	check(mcLost == dropped, name.str() + "master channel loss reported");
+	check(vcLost == dropped, name.str() + "virtual channel loss reported");
+	check(duplicates == 0, name.str() + "no frames dropped as duplicates");
+	check(recMc->getRecSequence().getLostCount() == dropped, name.str() + "master channel lost count");
+	check(recVc->getRecSequence().getLostCount() == dropped, name.str() + "virtual channel lost count");
+	check(recMc->getRecSequence().getDuplicateCount() == 0, name.str() + "master channel duplicate count");
+	check(recVc->getRecSequence().getDuplicateCount() == 0, name.str() + "virtual channel duplicate count");
+	check(packets > packetsBefore, name.str() + "packets received after the gap");
+}
+
+int main()
+{
+	streambuf *output = cout.rdbuf();		// The channels print debug output.
+	ostringstream sink;
+	cout.rdbuf(sink.rdbuf());
+
+	testTracker();
+	testChannelGap(5);
+	testChannelGap(128);
+	testChannelGap(200);
+
+	cout.rdbuf(output);
+	cerr << (failures ? "FAILED" : "PASSED") << endl;
+	return failures ? 1 : 0;
+}